@@ -30,7 +30,7 @@ extern "C" {
 /*!
  *  \fn      void hal_net_notify_init (void)
  *  \brief   Init function for net_notify thread
- *  \warning none
+ *  \warning the netlink configuration (nas_os_nl_config_set) is set before
  *  \param   void
  *  \return  success 0/failure -1
  *  \sa
@@ -26,6 +26,7 @@
 #include "std_error_codes.h"
 #include "cps_api_object.h"
 #include "ds_common_types.h"
+#include "nas_os_async.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,6 +42,21 @@ extern "C" {
 
 t_std_error nl_int_update_stp_state(cps_api_object_t obj);
 
+/*
+ * @brief Update the Interface STP state in the kernel without waiting for the kernel,
+ *        see nas_os_mac_update_entry_async
+ *
+ * @obj - CPS API object which contains ifindex and STP state to be updated.
+ * @done - called with the result from the netlink writer thread, or before the function
+ *         returns if the state is not written to the kernel (can be NULL)
+ * @context - given back to done
+ *
+ * @return STD_ERR_OK if the state is submitted (done is then always called),
+ *         otherwise different error code
+ */
+
+t_std_error nl_int_update_stp_state_async(cps_api_object_t obj, nas_os_async_done_fn done, void *context);
+
 /*
  * @brief Add/Update MAC entry in the kernel
  *
@@ -51,6 +67,32 @@ t_std_error nl_int_update_stp_state(cps_api_object_t obj);
 
 t_std_error nas_os_mac_update_entry(cps_api_object_t obj);
 
+/*
+ * @brief Add/Update a list of MAC entries in the kernel, the requests of the entries
+ *        are sent in batches instead of one round trip per entry
+ *
+ * @objs - CPS API objects which contain the mac entry details to be configured
+ * @results - if not NULL, filled with the result of each entry in the order of the list
+ *
+ * @return STD_ERR_OK if successful, otherwise the error of the first failed entry
+ */
+
+t_std_error nas_os_mac_update_entry_list(cps_api_object_list_t objs, t_std_error *results);
+
+/*
+ * @brief Add/Update MAC entry in the kernel without waiting for the kernel, the requests
+ *        are sent from the netlink writer thread in the order of submission
+ *
+ * @obj - CPS API object which contains mac entry details to be configured
+ * @done - called with the result from the netlink writer thread (can be NULL)
+ * @context - given back to done
+ *
+ * @return STD_ERR_OK if the entry is submitted (done is then always called),
+ *         otherwise different error code
+ */
+
+t_std_error nas_os_mac_update_entry_async(cps_api_object_t obj, nas_os_async_done_fn done, void *context);
+
 /*
  * @brief Change the MAC learning in the kernel for a given interface
  *
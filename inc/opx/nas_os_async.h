@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: nas_os_async.h
+ */
+
+#ifndef NAS_OS_ASYNC_H_
+#define NAS_OS_ASYNC_H_
+
+#include "std_error_codes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Completion callback of the asynchronous kernel writes (nas_os_*_async),
+ *        called from the netlink writer thread once the kernel has answered. It should
+ *        not block, the other completions wait for it.
+ *
+ * @param context caller context given with the request
+ * @param rc STD_ERR_OK if successful, otherwise the same error code as the
+ *           synchronous function
+ */
+typedef void (*nas_os_async_done_fn) (void *context, t_std_error rc);
+
+/**
+ * @brief Wait until all the asynchronous kernel writes submitted are completed
+ *
+ * @warning should not be called from a completion callback
+ */
+void nas_os_async_flush (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -24,6 +24,7 @@
 
 #include "cps_api_object.h"
 #include "std_error_codes.h"
+#include "nas_os_async.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -56,6 +57,37 @@ t_std_error nas_os_del_route (cps_api_object_t obj);
  */
 t_std_error nas_os_set_route (cps_api_object_t obj);
 
+/**
+ * @brief This adds a list of IPv4/v6 unicast routes in kernel, the requests of the
+ *        routes are sent in batches instead of one round trip per route
+ *
+ * @param objs CPS API objects which contain route params
+ * @param results if not NULL, filled with the result of each route in the order of the list
+ *
+ * @return STD_ERR_OK if all the routes are added, otherwise the error of the first failed route
+ */
+t_std_error nas_os_add_route_list (cps_api_object_list_t objs, t_std_error *results);
+
+/**
+ * @brief This deletes a list of IPv4/v6 unicast routes in kernel, see nas_os_add_route_list
+ *
+ * @param objs CPS API objects which contain route params
+ * @param results if not NULL, filled with the result of each route in the order of the list
+ *
+ * @return STD_ERR_OK if all the routes are deleted, otherwise the error of the first failed route
+ */
+t_std_error nas_os_del_route_list (cps_api_object_list_t objs, t_std_error *results);
+
+/**
+ * @brief This replaces a list of IPv4/v6 unicast routes in kernel, see nas_os_add_route_list
+ *
+ * @param objs CPS API objects which contain route params
+ * @param results if not NULL, filled with the result of each route in the order of the list
+ *
+ * @return STD_ERR_OK if all the routes are replaced, otherwise the error of the first failed route
+ */
+t_std_error nas_os_set_route_list (cps_api_object_list_t objs, t_std_error *results);
+
 /**
  * @brief Update Route Nexthop(s): This is used to apped/delete nexthop(s) of an existing IPv4/v6 unicast route in kernel
  *
@@ -92,6 +124,85 @@ t_std_error nas_os_del_neighbor (cps_api_object_t obj);
  */
 t_std_error nas_os_set_neighbor (cps_api_object_t obj);
 
+/**
+ * @brief This adds a list of neighbor entries in kernel, the requests of the
+ *        entries are sent in batches instead of one round trip per entry
+ *
+ * @param objs CPS API objects which contain arp/nd params
+ * @param results if not NULL, filled with the result of each entry in the order of the list
+ *
+ * @return STD_ERR_OK if all the entries are added, otherwise the error of the first failed entry
+ */
+t_std_error nas_os_add_neighbor_list (cps_api_object_list_t objs, t_std_error *results);
+
+/**
+ * @brief This deletes a list of neighbor entries in kernel, see nas_os_add_neighbor_list
+ *
+ * @param objs CPS API objects which contain arp/nd params
+ * @param results if not NULL, filled with the result of each entry in the order of the list
+ *
+ * @return STD_ERR_OK if all the entries are deleted, otherwise the error of the first failed entry
+ */
+t_std_error nas_os_del_neighbor_list (cps_api_object_list_t objs, t_std_error *results);
+
+/**
+ * @brief This replaces a list of neighbor entries in kernel, see nas_os_add_neighbor_list
+ *
+ * @param objs CPS API objects which contain arp/nd params
+ * @param results if not NULL, filled with the result of each entry in the order of the list
+ *
+ * @return STD_ERR_OK if all the entries are replaced, otherwise the error of the first failed entry
+ */
+t_std_error nas_os_set_neighbor_list (cps_api_object_list_t objs, t_std_error *results);
+
+/**
+ * @brief This adds an IPv4/v6 unicast route in kernel without waiting for the kernel,
+ *        the requests are sent from the netlink writer thread in the order of submission
+ *        per VRF. The route is handled as with nas_os_add_route once the kernel answers.
+ *
+ * @param obj CPS API object which contains route params, copied
+ * @param done called with the result from the netlink writer thread, or before the
+ *             function returns if the route is not written to the kernel (can be NULL)
+ * @param context given back to done
+ *
+ * @return STD_ERR_OK if the route is submitted (done is then always called),
+ *         otherwise different error code
+ */
+t_std_error nas_os_add_route_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context);
+
+/**
+ * @brief This deletes an IPv4/v6 unicast route in kernel, see nas_os_add_route_async
+ */
+t_std_error nas_os_del_route_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context);
+
+/**
+ * @brief This replaces an IPv4/v6 unicast route in kernel, see nas_os_add_route_async
+ */
+t_std_error nas_os_set_route_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context);
+
+/**
+ * @brief This adds a neighbor entry in kernel without waiting for the kernel, see
+ *        nas_os_add_route_async
+ *
+ * @param obj CPS API object which contains arp/nd params, copied
+ * @param done called with the result from the netlink writer thread (can be NULL)
+ * @param context given back to done
+ *
+ * @return STD_ERR_OK if the entry is submitted (done is then always called),
+ *         otherwise different error code
+ */
+t_std_error nas_os_add_neighbor_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context);
+
+/**
+ * @brief This deletes a neighbor entry in kernel, see nas_os_add_neighbor_async
+ */
+t_std_error nas_os_del_neighbor_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context);
+
+/**
+ * @brief This replaces a neighbor entry in kernel, see nas_os_add_neighbor_async
+ */
+t_std_error nas_os_set_neighbor_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context);
+
 /**
  * @brief This refreshes the neighbor entry in kernel
  *
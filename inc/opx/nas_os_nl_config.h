@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: nas_os_nl_config.h
+ */
+
+/*
+ * Configuration of the netlink event and request handling. The configuration is
+ * set by the NAS init before cps_api_net_notify_init, the event thread and the
+ * request path take it when they start - later changes are not applied.
+ */
+
+#ifndef NAS_OS_NL_CONFIG_H_
+#define NAS_OS_NL_CONFIG_H_
+
+#include "std_error_codes.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NL_DISPATCH_MAX_WORKERS 16
+#define NL_DISPATCH_MAX_WINDOW_USEC 100000
+#define NL_DISPATCH_DEFAULT_LOW_WEIGHT 64
+#define NL_DISPATCH_DEFAULT_MAX_QUEUED (16*1024)
+
+#define NL_DUMP_DEFAULT_THREADS 4
+#define NL_DUMP_MAX_THREADS 32
+
+#define NL_PUBLISH_MAX_BATCH 4096
+#define NL_PUBLISH_DEFAULT_DEADLINE_USEC 500
+#define NL_PUBLISH_MAX_DEADLINE_USEC 100000
+
+#define NL_CONFIG_PATH_LEN 256
+#define NL_CONFIG_LIST_LEN 128
+
+/* Policy of the dispatch lanes that are full */
+typedef enum {
+    NL_DISPATCH_OVERLOAD_COALESCE = 0,  /* wait for room */
+    NL_DISPATCH_OVERLOAD_SHED,          /* drop the low priority events (default) */
+    NL_DISPATCH_OVERLOAD_RESYNC,        /* drop the events */
+    NL_DISPATCH_OVERLOAD_MAX
+} nl_dispatch_overload_t;
+
+typedef struct {
+    /* Requests sent and received and the events received with io_uring if the kernel
+     * supports it, with sendmsg/recvmsg and epoll/recvmmsg otherwise (default) */
+    bool io_uring;
+
+    /* File the netlink messages are captured to (pcap), none if empty (default) */
+    char capture_path[NL_CONFIG_PATH_LEN];
+
+    /* Workers the events are dispatched to, 0 to process them on the event thread
+     * (default), max. NL_DISPATCH_MAX_WORKERS */
+    size_t dispatch_workers;
+    /* Queued events superseded by a later event of the key are dropped (default) */
+    bool dispatch_coalesce;
+    /* Time the workers hold the events to coalesce them, 0 to coalesce only while
+     * the events wait for the worker (default), max. NL_DISPATCH_MAX_WINDOW_USEC */
+    uint32_t dispatch_window_usec;
+    /* Low priority events processed before the high priority queue is checked again */
+    size_t dispatch_low_weight;
+    /* Max. events queued on a lane */
+    size_t dispatch_max_queued;
+    nl_dispatch_overload_t dispatch_overload;
+
+    /* Threads the tables are dumped on, 0 to dump on the event sockets one after
+     * another, max. NL_DUMP_MAX_THREADS */
+    size_t dump_threads;
+
+    /* Max. objects published in a batch, 0 or 1 to publish every object as it is
+     * translated (default), max. NL_PUBLISH_MAX_BATCH */
+    size_t publish_batch;
+    /* Time an object can wait for its batch to fill, max. NL_PUBLISH_MAX_DEADLINE_USEC */
+    uint32_t publish_deadline_usec;
+
+    /* Events of the VRFs received by the sockets of the default VRF through the
+     * NSIDs of the VRF namespaces, the VRFs get their own sockets otherwise (default) */
+    bool nsid_listener;
+
+    /* Event classes left out of the default subscription profile of the VRFs, comma
+     * separated class[:family] - e.g. "mdb:ipv6,netconf:ipv6". Classes are link, addr,
+     * route, neigh, netconf and mdb, families ipv4 and ipv6 (both if not given) */
+    char subscribe_off[NL_CONFIG_LIST_LEN];
+} nas_os_nl_config_t;
+
+/**
+ * @brief Fill the configuration with the defaults
+ *
+ * @param[out] cfg configuration
+ */
+void nas_os_nl_config_default (nas_os_nl_config_t *cfg);
+
+/**
+ * @brief Set the configuration, the values above the max. are lowered to the max.
+ *
+ * @param[in] cfg configuration
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nas_os_nl_config_set (const nas_os_nl_config_t *cfg);
+
+/**
+ * @brief Get the configuration, the defaults if it is not set
+ *
+ * @param[out] cfg configuration
+ */
+void nas_os_nl_config_get (nas_os_nl_config_t *cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NAS_OS_NL_CONFIG_H_ */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: nas_nlattr_parser.h
+ */
+
+/*
+ * Netlink attribute parser for the C++ modules - the attributes consumed by the handler
+ * are listed at compile time, only their slots are cleared and filled and their lengths
+ * validated. The other attributes (and the nested containers in them) are skipped, the
+ * slots point into the message (no copy).
+ *
+ *     typedef nas_nl::attr_parser<__IFLA_MAX,
+ *                                 nas_nl::sel<IFLA_IFNAME, 1>,
+ *                                 nas_nl::sel<IFLA_MTU, sizeof(uint32_t)>> if_parser;
+ *     struct nlattr *attrs[__IFLA_MAX];
+ *     if (if_parser::parse(attrs, head, len) != 0) ...
+ *
+ * C modules use nla_parse_selected with a nla_select_t table.
+ */
+
+#ifndef __NAS_NLATTR_PARSER_H
+#define __NAS_NLATTR_PARSER_H
+
+#include "nas_nlmsg.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace nas_nl {
+
+/* Selected attribute Type with a payload of at least MinLen bytes */
+template <uint16_t Type, uint16_t MinLen = 0>
+struct sel {
+    static constexpr uint16_t type = Type;
+    static constexpr uint16_t min_len = MinLen;
+};
+
+namespace parser_detail {
+
+template <size_t MaxType, typename... Sels>
+struct sel_list;
+
+template <size_t MaxType>
+struct sel_list<MaxType> {
+    static void clear(struct nlattr **) {}
+    static int store(struct nlattr **, struct nlattr *, int) { return 0; }
+};
+
+template <size_t MaxType, typename S, typename... Sels>
+struct sel_list<MaxType, S, Sels...> {
+    static_assert(S::type < MaxType, "selected attribute is out of the attribute table");
+
+    static void clear(struct nlattr **tb) {
+        tb[S::type] = nullptr;
+        sel_list<MaxType, Sels...>::clear(tb);
+    }
+
+    /* Compare chain unrolled at compile time - 0 if stored or not selected, -1 if too short */
+    static int store(struct nlattr **tb, struct nlattr *attr, int type) {
+        if (type != S::type) return sel_list<MaxType, Sels...>::store(tb, attr, type);
+        if (nla_len(attr) < S::min_len) return -1;
+        tb[S::type] = attr;
+        return 0;
+    }
+};
+
+}
+
+template <size_t MaxType, typename... Sels>
+struct attr_parser {
+    /* Parse the attributes from head, 0 if successful otherwise non zero -
+     * a selected attribute was too short and dropped */
+    static int parse(struct nlattr *(&tb)[MaxType], struct nlattr *head, int len) {
+        parser_detail::sel_list<MaxType, Sels...>::clear(tb);
+        int rc = 0;
+        for (struct nlattr *attr = head; nla_ok(attr, len); attr = nla_next(attr, &len)) {
+            if (parser_detail::sel_list<MaxType, Sels...>::store(tb, attr, nla_type(attr)) != 0) rc = -1;
+        }
+        return rc;
+    }
+
+    /* Parse the attributes nested in nla */
+    static int parse_nested(struct nlattr *(&tb)[MaxType], struct nlattr *nla) {
+        return parse(tb, static_cast<struct nlattr *>(nla_data(nla)), nla_len(nla));
+    }
+
+    /* Parse the attributes that follow the family header of the message */
+    static int parse_msg(struct nlattr *(&tb)[MaxType], struct nlmsghdr *nh, int family_hdr_len) {
+        return parse(tb, nlmsg_attrdata(nh, family_hdr_len), nlmsg_attrlen(nh, family_hdr_len));
+    }
+};
+
+}
+
+#endif
@@ -25,6 +25,8 @@
 #define CPS_API_LINUX_INC_PRIVATE_NAS_NLMSG_H_
 
 #include <linux/rtnetlink.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -221,6 +223,42 @@ static inline int nla_parse_nested(struct nlattr *tb[], int max_type,
     return nla_parse(tb, max_type, (struct nlattr *)nla_data(nla), nla_len(nla));
 }
 
+/* Attribute selected by nla_parse_selected, attributes with a payload shorter
+ * than min_len are dropped */
+typedef struct {
+    uint16_t type;
+    uint16_t min_len;
+} nla_select_t;
+
+/**
+ * Parse only the selected netlink attributes - only the slots of the selected attributes
+ * are cleared and filled, the other attributes (and the nested containers in them) are skipped.
+ * The attributes are not copied, the slots point into the message.
+ * @param tb is the array of netlink attributes
+ * @param max_type is the total size of the netlink attrib list
+ * @param sel is the list of the selected attributes, all below max_type
+ * @param sel_count is the number of entries in sel
+ * @param head is the start of the netlink attributes
+ * @param len is the length of the buffer to process
+ * @return 0 if successful otherwise non zero - a selected attribute was too short and dropped
+ */
+int nla_parse_selected(struct nlattr *tb[], int max_type, const nla_select_t *sel, size_t sel_count,
+                       struct nlattr *head, int len);
+
+/**
+ * Parse the selected attributes of a nested attribute structure using nla_parse_selected
+ * @param tb is the array returned
+ * @param max_type the length of the array
+ * @param sel is the list of the selected attributes
+ * @param sel_count is the number of entries in sel
+ * @param nla is the attribute with the embedded attributes to parse
+ * @return 0 if successful otherwise non-zero
+ */
+static inline int nla_parse_nested_selected(struct nlattr *tb[], int max_type, const nla_select_t *sel,
+                                            size_t sel_count, struct nlattr *nla) {
+    return nla_parse_selected(tb, max_type, sel, sel_count, (struct nlattr *)nla_data(nla), nla_len(nla));
+}
+
 static inline struct rtnexthop* rtnh_next(struct rtnexthop * rtnh, int *len) {
     *len -= RTNH_ALIGN(rtnh->rtnh_len);
     return RTNH_NEXT(rtnh);
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: nas_nlmsg_builder.h
+ */
+
+/*
+ * Netlink request builder for the C++ modules - the worst case size of a request is
+ * computed at compile time from its header and attributes so that the request is built
+ * in a buffer of exactly that size on the stack of the caller (no allocation, no shared
+ * buffer). Every write is checked against the buffer size, the builder goes to the
+ * failed state on overflow and the request is not sent.
+ *
+ *     typedef nas_nl::msg_size<ifinfomsg,
+ *                              nas_nl::attr_len<IFNAMSIZ>, nas_nl::attr<uint32_t>> req_size;
+ *     nas_nl::msg_buffer<req_size::value> buff;
+ *     nas_nl::msg_builder b(buff, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_ACK);
+ *     ifinfomsg *ifmsg = b.family_header<ifinfomsg>();
+ *     b.put_str(IFLA_IFNAME, name);
+ *     b.put(IFLA_MTU, mtu);
+ *     if (!b.ok()) ...
+ */
+
+#ifndef __NAS_NLMSG_BUILDER_H
+#define __NAS_NLMSG_BUILDER_H
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <type_traits>
+
+namespace nas_nl {
+
+/* Space taken by an attribute with a payload of len bytes */
+constexpr size_t attr_space(size_t len) {
+    return NLA_ALIGN(NLA_HDRLEN + len);
+}
+
+/* Attribute descriptors for msg_size - payload of type T or of Len bytes */
+template <typename T>
+struct attr {
+    static constexpr size_t value = attr_space(sizeof(T));
+};
+
+template <size_t Len>
+struct attr_len {
+    static constexpr size_t value = attr_space(Len);
+};
+
+/* Nested attribute holding the attributes As */
+template <typename... As>
+struct nest;
+
+template <>
+struct nest<> {
+    static constexpr size_t value = NLA_HDRLEN;
+};
+
+template <typename A, typename... As>
+struct nest<A, As...> {
+    static constexpr size_t value = A::value + nest<As...>::value;
+};
+
+/* RTA_MULTIPATH with Count next hops, each with the attributes As */
+template <size_t Count, typename... As>
+struct multipath {
+    static constexpr size_t value =
+        NLA_HDRLEN + (Count * (RTNH_ALIGN(sizeof(struct rtnexthop)) + (nest<As...>::value - NLA_HDRLEN)));
+};
+
+/* Size of a request with the family header H and the attributes As */
+template <typename H, typename... As>
+struct msg_size {
+    static constexpr size_t value = NLMSG_SPACE(sizeof(H)) + (nest<As...>::value - NLA_HDRLEN);
+};
+
+/* Request buffer of N bytes, allocated where it is declared */
+template <size_t N>
+struct msg_buffer {
+    static_assert(N >= NLMSG_HDRLEN, "netlink request buffer is smaller than the header");
+    alignas(struct nlmsghdr) char data[N];
+    static constexpr size_t size = N;
+};
+
+class msg_builder {
+public:
+    msg_builder(void *buff, size_t len, uint16_t type, uint16_t flags) :
+            _nlh(static_cast<struct nlmsghdr *>(buff)), _max_len(len), _ok(len >= NLMSG_HDRLEN) {
+        if (!_ok) return;
+        memset(_nlh, 0, NLMSG_HDRLEN);
+        _nlh->nlmsg_len = NLMSG_HDRLEN;
+        _nlh->nlmsg_type = type;
+        _nlh->nlmsg_flags = flags;
+    }
+
+    template <size_t N>
+    msg_builder(msg_buffer<N> &buff, uint16_t type, uint16_t flags) :
+            msg_builder(buff.data, N, type, flags) {}
+
+    msg_builder(const msg_builder &) = delete;
+    msg_builder &operator=(const msg_builder &) = delete;
+
+    /* Family header (ifinfomsg, rtmsg, ndmsg...) - zeroed, must be the first one added */
+    template <typename H>
+    H *family_header() {
+        static_assert(std::is_trivially_copyable<H>::value, "family header must be a plain struct");
+        return static_cast<H *>(reserve(sizeof(H)));
+    }
+
+    /* Reserve len bytes (zeroed) at the end of the message, nullptr on overflow */
+    void *reserve(size_t len) {
+        if (!_ok) return nullptr;
+        size_t offset = NLMSG_ALIGN(_nlh->nlmsg_len);
+        if ((offset + NLMSG_ALIGN(len)) > _max_len) {
+            _ok = false;
+            return nullptr;
+        }
+        void *p = reinterpret_cast<char *>(_nlh) + offset;
+        memset(p, 0, NLMSG_ALIGN(len));
+        _nlh->nlmsg_len = offset + NLMSG_ALIGN(len);
+        return p;
+    }
+
+    bool put(uint16_t type, const void *data, size_t len) {
+        struct nlattr *attr = static_cast<struct nlattr *>(reserve(NLA_HDRLEN + len));
+        if (attr == nullptr) return false;
+        attr->nla_type = type;
+        attr->nla_len = NLA_HDRLEN + len;
+        if (len != 0) memcpy(reinterpret_cast<char *>(attr) + NLA_HDRLEN, data, len);
+        return true;
+    }
+
+    template <typename T>
+    bool put(uint16_t type, const T &val) {
+        static_assert(std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value,
+                      "attribute payload must be a plain value, use the (data, len) form for buffers");
+        return put(type, &val, sizeof(T));
+    }
+
+    /* String attribute including the terminating NUL */
+    bool put_str(uint16_t type, const char *str) {
+        return put(type, str, strlen(str) + 1);
+    }
+
+    /* Start a nested attribute, closed by nest_end */
+    struct nlattr *nest_start(uint16_t type) {
+        struct nlattr *attr = static_cast<struct nlattr *>(reserve(NLA_HDRLEN));
+        if (attr == nullptr) return nullptr;
+        attr->nla_type = type;
+        return attr;
+    }
+
+    void nest_end(struct nlattr *attr) {
+        if ((attr == nullptr) || !_ok) return;
+        attr->nla_len = tail() - reinterpret_cast<char *>(attr);
+    }
+
+    /* Start a next hop in RTA_MULTIPATH, its attributes follow and nexthop_end closes it */
+    struct rtnexthop *nexthop_start() {
+        return static_cast<struct rtnexthop *>(reserve(sizeof(struct rtnexthop)));
+    }
+
+    void nexthop_end(struct rtnexthop *rtnh) {
+        if ((rtnh == nullptr) || !_ok) return;
+        rtnh->rtnh_len = tail() - reinterpret_cast<char *>(rtnh);
+    }
+
+    /* False if any of the writes did not fit in the buffer */
+    bool ok() const { return _ok; }
+
+    struct nlmsghdr *msg() const { return _nlh; }
+
+    size_t len() const { return _ok ? _nlh->nlmsg_len : 0; }
+
+    size_t capacity() const { return _max_len; }
+
+private:
+    char *tail() const {
+        return reinterpret_cast<char *>(_nlh) + NLMSG_ALIGN(_nlh->nlmsg_len);
+    }
+
+    struct nlmsghdr *_nlh;
+    size_t _max_len;
+    bool _ok;
+};
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_async.h
+ */
+
+#ifndef __NETLINK_ASYNC_H
+#define __NETLINK_ASYNC_H
+
+
+#include "netlink_tools.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max. number of requests sent and not yet acknowledged per VRF and socket type */
+#define NL_ASYNC_MAX_OUTSTANDING 64
+
+/* Time after which a request that is not acknowledged is failed with ETIMEDOUT */
+#define NL_ASYNC_ACK_TIMEOUT_MS 5000
+
+/**
+ * Completion callback of an asynchronous request
+ *
+ * @param context caller context given with the request
+ * @param error_code 0 on success otherwise the errno returned by the kernel
+ *                   (or ETIMEDOUT/EIO when there is no response for the request)
+ */
+typedef void (*nl_async_done_fn) (void *context, int error_code);
+
+/**
+ * @brief Start the netlink writer thread, it is also started on the first submit
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nl_async_init (void);
+
+/**
+ * @brief Queue a request to be sent to the kernel from the writer thread.
+ *        The message is copied so the caller buffer can be reused once the function
+ *        returns. Requests are sent in the order of submission per VRF and socket type.
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] type netlink socket type
+ * @param[in] m request message, NLM_F_ACK is always set by the engine
+ * @param[in] done completion callback (can be NULL), called from the writer thread
+ *            and it should not block or wait on the async engine.
+ * @param[in] context caller context given back in the callback
+ *
+ * @return STD_ERR_OK if the request is queued otherwise error code
+ */
+t_std_error nl_async_submit (const char *vrf_name, nas_nl_sock_TYPES type, struct nlmsghdr *m,
+                             nl_async_done_fn done, void *context);
+
+/**
+ * @brief Wait until all the submitted requests are completed
+ *
+ * @warning should not be called from a completion callback
+ */
+void nl_async_flush (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_capture.h
+ */
+
+/*
+ * Capture of the netlink datagrams received on the event sockets (events and dumps)
+ * for offline replay. The capture is a pcap file (nanosecond timestamps) with the
+ * LINKTYPE_NETLINK framing used by nlmon - every record starts with the 16 byte Linux
+ * cooked header followed by the datagram as received. The link layer address of the
+ * cooked header carries the socket type (2 bytes), the VRF-id the datagram is processed
+ * in (2 bytes, VRF-ids are below NAS_MAX_VRF_ID) and the NSID of the
+ * NETLINK_LISTEN_ALL_NSID control message (4 bytes, NL_CAPTURE_NSID_NONE if the datagram
+ * has none), all in network byte order. The file can be opened with wireshark/tcpdump.
+ */
+
+#ifndef __NETLINK_CAPTURE_H
+#define __NETLINK_CAPTURE_H
+
+
+#include "netlink_tools.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max. length of a captured datagram */
+#define NL_CAPTURE_SNAPLEN (256*1024)
+
+/* Max. socket fd that can be captured */
+#define NL_CAPTURE_MAX_SOCKS 4096
+
+#define NL_CAPTURE_LINKTYPE_NETLINK 253
+#define NL_CAPTURE_ARPHRD_NETLINK 824
+
+/* Socket type of the records that do not carry one (e.g. captured on nlmon) */
+#define NL_CAPTURE_SOCK_T_UNKNOWN nas_nl_sock_T_MAX
+
+/* NSID of the datagrams received without one - from the namespace of the socket
+ * (NETNSA_NSID_NOT_ASSIGNED) */
+#define NL_CAPTURE_NSID_NONE (-1)
+
+/* Captured datagram */
+typedef struct {
+    uint64_t ts_nsec;               /* receive time, realtime clock */
+    nas_nl_sock_TYPES sock_type;
+    int32_t nsid;                   /* NSID of the datagram or NL_CAPTURE_NSID_NONE */
+    uint32_t vrf_id;                /* VRF the datagram was processed in */
+    uint32_t len;
+    char *data;                     /* valid until the next read */
+} nl_capture_rec_t;
+
+typedef struct nl_capture_reader_s nl_capture_reader_t;
+
+/**
+ * @brief Start capturing the datagrams of the event sockets into the file,
+ *        the file is overwritten
+ *
+ * @param[in] path capture file
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nl_capture_start (const char *path);
+
+/**
+ * @brief Stop the capture, the buffered records are written and the file closed
+ */
+void nl_capture_stop (void);
+
+/**
+ * @brief Start the capture if the netlink config has a capture file, called once by the event thread
+ */
+void nl_capture_init (void);
+
+/**
+ * @brief Capture the datagrams received on the event socket
+ *
+ * @param[in] sock event socket
+ * @param[in] type socket type recorded with the datagrams
+ */
+void nl_capture_sock_add (int sock, nas_nl_sock_TYPES type);
+
+/**
+ * @brief Stop capturing the socket, called before the socket is closed
+ *
+ * @param[in] sock event socket
+ */
+void nl_capture_sock_del (int sock);
+
+/**
+ * @brief Write the received datagram if the capture is on and the socket is captured
+ *
+ * @param[in] sock socket the datagram is received on
+ * @param[in] nsid NSID of the control message of the datagram, NL_CAPTURE_NSID_NONE if none
+ * @param[in] vrf_id VRF-id the datagram is processed in (mapped from the NSID or of the socket)
+ * @param[in] buff datagram
+ * @param[in] len length of the datagram
+ */
+void nl_capture_write (int sock, int nsid, uint32_t vrf_id, const void *buff, size_t len);
+
+/**
+ * @brief Open the capture file for reading
+ *
+ * @param[in] path capture file
+ *
+ * @return reader or NULL if the file can not be opened or is not a netlink capture
+ */
+nl_capture_reader_t *nl_capture_open (const char *path);
+
+/**
+ * @brief Read the next datagram of the capture
+ *
+ * @param[in] reader capture reader
+ * @param[out] rec filled with the datagram
+ *
+ * @return true if a datagram is read, false at the end of the capture
+ */
+bool nl_capture_read (nl_capture_reader_t *reader, nl_capture_rec_t *rec);
+
+void nl_capture_close (nl_capture_reader_t *reader);
+
+/* Replay results */
+typedef struct {
+    uint64_t datagrams;
+    uint64_t msgs;
+    uint64_t elapsed_usec;
+} nl_replay_stats_t;
+
+/**
+ * @brief Replay the capture through the event dispatch (get_netlink_data) - the datagrams
+ *        are parsed, translated and published as if received from the kernel.
+ *        Serialized with the event thread, can be run in a process without it.
+ *
+ * @param[in] path capture file
+ * @param[in] paced true to keep the captured inter-arrival times, false to replay
+ *            as fast as possible (throughput measurement)
+ * @param[out] stats filled with the replay results, can be NULL
+ *
+ * @return STD_ERR_OK if the capture is replayed otherwise error code
+ */
+t_std_error os_nl_replay (const char *path, bool paced, nl_replay_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_dispatch.h
+ */
+
+/*
+ * Dispatch of the netlink event messages to a pool of worker threads. The event
+ * thread only reads the sockets, the messages are copied and queued on a lane
+ * (worker) chosen by the key of the message, so the events of a key are processed
+ * in the order received while the events of different keys are processed in parallel:
+ *   - routes by (VRF, family, table, prefix)
+ *   - neighbors by (ifindex, IP address)
+ *   - MDB entries by bridge
+ *   - links, addresses and netconf on the interface lane (worker 0). The
+ *     interface translation (os_interface_to_object) resolves the master and parent
+ *     interfaces from the cache and updates the bridge/bond DBs, and the addresses
+ *     are translated with the interface cache - so they are kept serialized as
+ *     processed by the event thread before.
+ * Without workers (the default) the messages are processed inline by the caller.
+ *
+ * The messages are classified when received: links and addresses (oper-state, LAG
+ * membership) are queued with the high priority, routes, neighbors and MDB with the
+ * low priority. A worker takes all its high priority events before the low priority
+ * ones, and checks again after every dispatch_low_weight low priority events,
+ * so a route churn does not delay the link events. The time the events wait in the
+ * queues is measured per lane and priority.
+ *
+ * While the events are queued on a lane (the worker is behind, or for the coalescing
+ * window) a new event of a link, address, route or neighbor supersedes the queued one of
+ * the same object, and the delete of a route whose create is still queued drops both.
+ * Under load the number of the published events goes down to the number of the objects
+ * changed, the state published for every object is the latest one.
+ *
+ * The lanes are bounded by dispatch_max_queued events (superseded ones are not
+ * counted, so the events of the objects already queued always fit). When a lane is
+ * full the overload policy decides, instead of the kernel dropping at random on the
+ * socket buffer overflow:
+ *   - coalesce: the event thread waits for room, the kernel socket buffer takes the
+ *     burst and the queued events keep being coalesced
+ *   - shed: the low priority events are dropped, the high priority ones wait for room
+ *   - resync: the events are dropped
+ * The tables of the sockets with the dropped events are resynced (nl_dispatch_dropped)
+ * once the lanes are back under the half of their bound (nl_dispatch_overloaded).
+ */
+
+#ifndef __NETLINK_DISPATCH_H
+#define __NETLINK_DISPATCH_H
+
+
+#include "netlink_tools.h"
+#include "nas_os_nl_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Lane of the link, address and netconf messages */
+#define NL_DISPATCH_LANE_INTF 0
+
+typedef enum {
+    NL_DISPATCH_PRIO_HIGH = 0,      /* link, address */
+    NL_DISPATCH_PRIO_LOW,           /* route, neighbor, MDB, netconf */
+    NL_DISPATCH_PRIO_MAX
+} nl_dispatch_prio_t;
+
+/**
+ * @brief Start the workers of the netlink config, called once by the event thread
+ *
+ * @param[in] process handler of the messages, called from the workers
+ *
+ * @return STD_ERR_OK if successful otherwise error code, the messages are
+ *         processed inline if the workers can not be started
+ */
+t_std_error nl_dispatch_init (fun_process_nl_message process);
+
+/**
+ * @brief Queue the message on the lane of its key, or process it inline if there
+ *        are no workers. Has the signature of the event handlers so it can be given
+ *        to netlink_tools_receive_events and netlink_tools_process_socket directly.
+ *
+ * @param[in] sock socket the message is received on
+ * @param[in] rt_msg_type message type
+ * @param[in] hdr message, copied before queuing
+ * @param[in] context VRF name (can be NULL), copied before queuing
+ * @param[in] vrf_id VRF-id
+ *
+ * @return false if the message is not an rtnetlink message, true otherwise
+ */
+bool nl_dispatch_msg (int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id);
+
+/**
+ * @brief Queue the entry of a table dump as nl_dispatch_msg does, unless the object
+ *        had an event since the dump fence of the VRF started. The dump is read on its
+ *        own socket, its entries can be received after the later events of the objects.
+ *        The objects are known by their coalesce keys (links, addresses, routes and
+ *        neighbors), the other entries are always queued.
+ *
+ * @param[in] sock event socket of the table
+ * @param[in] rt_msg_type message type
+ * @param[in] hdr message, copied before queuing
+ * @param[in] context VRF name (can be NULL), copied before queuing
+ * @param[in] vrf_id VRF-id
+ *
+ * @return false if the message is not an rtnetlink message, true otherwise
+ */
+bool nl_dispatch_dump_msg (int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id);
+
+/**
+ * @brief Start recording the objects with events of the VRF, called before the dump
+ *        request is sent. The fences of the dumps of a VRF running at the same time
+ *        are counted, the objects are recorded until the last one is stopped.
+ *
+ * @param[in] vrf_id VRF-id
+ */
+void nl_dispatch_fence_start (uint32_t vrf_id);
+
+/**
+ * @brief Stop the dump fence of the VRF, called once the entries of the dump are queued
+ *
+ * @param[in] vrf_id VRF-id
+ */
+void nl_dispatch_fence_stop (uint32_t vrf_id);
+
+/**
+ * @brief Wait until the messages queued so far are processed, called before the
+ *        state updated by the workers (e.g. the resync shadow) is used
+ *
+ * @warning should not be called from a worker
+ */
+void nl_dispatch_drain (void);
+
+/**
+ * @brief Wait until the messages queued on the lane so far are processed, the other
+ *        lanes are not waited for
+ *
+ * @param[in] lane lane, nothing to wait for if there is no such lane
+ *
+ * @warning should not be called from a worker
+ */
+void nl_dispatch_drain_lane (size_t lane);
+
+/**
+ * @brief Number of the workers, 0 if the messages are processed inline
+ */
+size_t nl_dispatch_workers (void);
+
+typedef struct {
+    uint64_t queued;                /* events queued on the lanes */
+    uint64_t coalesced;             /* queued events superseded by a later one */
+    uint64_t cancelled;             /* route create and delete pairs dropped */
+    uint64_t pending;               /* events queued and not yet processed */
+    uint64_t dropped;               /* events dropped on the full lanes */
+    uint64_t fenced;                /* dumped entries dropped, older than an event */
+} nl_dispatch_stats_t;
+
+/**
+ * @brief Get the counters of the dispatch
+ *
+ * @param[out] stats filled with the counters
+ */
+void nl_dispatch_stats_get (nl_dispatch_stats_t *stats);
+
+typedef struct {
+    uint64_t events;                /* events processed */
+    uint64_t total_usec;            /* time the events waited in the queue */
+    uint64_t max_usec;
+    uint64_t depth;                 /* events queued */
+    uint64_t max_depth;
+} nl_dispatch_latency_t;
+
+typedef struct {
+    nl_dispatch_latency_t latency[NL_DISPATCH_PRIO_MAX];
+    uint64_t overloads;             /* times the lane got full */
+    uint64_t dropped;               /* events dropped by the overload policy */
+    uint64_t blocked;               /* times the event thread waited for room */
+} nl_dispatch_lane_stats_t;
+
+/**
+ * @brief Get the queue latency counters of a lane
+ *
+ * @param[in] lane lane, lower than nl_dispatch_workers
+ * @param[out] stats filled with the counters
+ *
+ * @return false if there is no such lane
+ */
+bool nl_dispatch_lane_stats_get (size_t lane, nl_dispatch_lane_stats_t *stats);
+
+/**
+ * @brief Check and clear the events dropped from the socket, called by the event
+ *        thread to resync the table of the socket
+ *
+ * @param[in] sock event socket
+ *
+ * @return true if events of the socket are dropped since the last call
+ */
+bool nl_dispatch_dropped (int sock);
+
+/**
+ * @brief Check if events of any socket are dropped and not yet taken by
+ *        nl_dispatch_dropped, the sockets are looked at only then
+ *
+ * @return true if there are sockets with dropped events
+ */
+bool nl_dispatch_dropped_any (void);
+
+/**
+ * @brief Check if a lane got full and is not yet drained back under the half of its
+ *        bound (low-water mark), the tables with the dropped events are resynced only
+ *        once all the lanes are back under it
+ *
+ * @return true if a lane is overloaded
+ */
+bool nl_dispatch_overloaded (void);
+
+/**
+ * @brief Priority of the message type
+ */
+nl_dispatch_prio_t nl_dispatch_prio (int rt_msg_type);
+
+/**
+ * @brief Lane of the message
+ *
+ * @param[in] rt_msg_type message type
+ * @param[in] hdr message
+ * @param[in] vrf_id VRF-id
+ * @param[in] workers number of the workers
+ *
+ * @return lane, lower than workers
+ */
+size_t nl_dispatch_lane (int rt_msg_type, struct nlmsghdr *hdr, uint32_t vrf_id, size_t workers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
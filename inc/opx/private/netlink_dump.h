@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_dump.h
+ */
+
+/*
+ * Scheduler of the initial table dumps (startup and VRF create). The dumps of a VRF
+ * and the dumps of different VRFs run concurrently on a pool of dump threads, each
+ * dump on its own request socket, instead of one after another on the event sockets.
+ * The link dump of a VRF runs first, the other dumps of the VRF (addresses, neighbors,
+ * routes, netconf) are started once the links are processed - so the interfaces they refer
+ * to are known when they are translated. A dump interrupted by a change in the table
+ * is restarted, the dumped entries are processed by the usual handler (given the
+ * event socket of the table).
+ */
+
+#ifndef __NETLINK_DUMP_H
+#define __NETLINK_DUMP_H
+
+
+#include "netlink_tools.h"
+#include "nas_os_nl_config.h"
+#include "std_error_codes.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max. number of the restarts of an interrupted dump */
+#define NL_DUMP_MAX_RETRY 3
+
+/* Send the dump request, e.g. nl_request_existing_routes */
+typedef bool (*nl_dump_request_fn) (int sock, int family, int req_id);
+
+/* Called when a dump fails, the table is to be resynced */
+typedef void (*nl_dump_failed_fn) (const char *vrf_name, nas_nl_sock_TYPES type);
+
+typedef struct {
+    nas_nl_sock_TYPES type;         /* type of the request socket */
+    int evt_sock;                   /* event socket of the table, given to the handler */
+    bool link;                      /* link dump, done before the other dumps of the VRF */
+    nl_dump_request_fn request;
+    int family;
+} nl_dump_t;
+
+typedef struct {
+    uint64_t vrfs;                  /* VRFs dumped */
+    uint64_t dumps;                 /* dumps completed */
+    uint64_t retries;               /* interrupted dumps restarted */
+    uint64_t failed;
+    uint64_t pending;               /* dumps queued or running */
+    uint64_t max_vrf_usec;          /* longest time to dump a VRF */
+} nl_dump_stats_t;
+
+/**
+ * @brief Start the dump threads of the netlink config
+ *
+ * @param[in] process handler of the dumped entries, called from the dump threads
+ * @param[in] failed called when a dump can not be completed
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nl_dump_init (fun_process_nl_message process, nl_dump_failed_fn failed);
+
+/**
+ * @brief Schedule the dumps of the VRF
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] vrf_id VRF-id
+ * @param[in] dumps dumps of the VRF, copied
+ * @param[in] count number of the dumps
+ *
+ * @return false if there are no dump threads, the caller dumps the tables itself
+ */
+bool nl_dump_vrf (const char *vrf_name, uint32_t vrf_id, const nl_dump_t *dumps, size_t count);
+
+/**
+ * @brief Drop the queued dumps of the VRF and wait for the running ones, called
+ *        before the event sockets of the VRF are closed
+ *
+ * @param[in] vrf_name VRF name
+ */
+void nl_dump_cancel (const char *vrf_name);
+
+/**
+ * @brief Wait until the scheduled dumps are done
+ */
+void nl_dump_wait (void);
+
+/**
+ * @brief Get the counters of the dumps
+ *
+ * @param[out] stats filled with the counters
+ */
+void nl_dump_stats_get (nl_dump_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
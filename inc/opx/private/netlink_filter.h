@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_filter.h
+ */
+
+#ifndef __NETLINK_FILTER_H
+#define __NETLINK_FILTER_H
+
+
+#include "netlink_tools.h"
+
+#include <linux/filter.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max. number of instructions of a compiled netlink socket filter */
+#define NL_FILTER_MAX_INSNS 128
+
+typedef enum {
+    NL_FILTER_OP_EQ=0,      /* field is equal to the value */
+    NL_FILTER_OP_NE,        /* field is not equal to the value */
+    NL_FILTER_OP_SET,       /* any of the bits in the value is set in the field */
+    NL_FILTER_OP_NO_ATTR,   /* attribute of type value is not present after the offset */
+} nl_filter_op_t;
+
+/* Condition on a field of the netlink message, the offset is from the start of the
+ * netlink header and the field is in host byte order as sent by the kernel */
+typedef struct {
+    uint16_t offset;
+    uint8_t size;           /* 1, 2 or 4 bytes - not used for NL_FILTER_OP_NO_ATTR */
+    nl_filter_op_t op;
+    uint32_t value;
+} nl_filter_cond_t;
+
+/* Message is dropped when all the conditions of the rule match */
+typedef struct {
+    const nl_filter_cond_t *conds;
+    size_t count;
+} nl_filter_rule_t;
+
+/**
+ * Compile the drop rules for the given message types into a classic BPF socket filter.
+ * Messages of other types, multi-part (dump) messages and the messages that do not
+ * match any rule are accepted.
+ *
+ * @param msg_types message types the rules apply to
+ * @param n_types number of message types
+ * @param rules drop rules
+ * @param n_rules number of rules
+ * @param prog output program with room for NL_FILTER_MAX_INSNS instructions
+ * @param prog_len output number of instructions
+ * @return true if the program is compiled
+ */
+bool nl_filter_compile(const uint16_t *msg_types, size_t n_types, const nl_filter_rule_t *rules,
+                       size_t n_rules, struct sock_filter *prog, size_t *prog_len);
+
+/**
+ * Attach the filter for the events that are never published for the socket type.
+ * The socket keeps working without a filter if the attach fails.
+ *
+ * @param sock event socket
+ * @param type netlink socket type
+ * @return STD_ERR_OK if a filter is attached or not needed for the type otherwise error code
+ */
+t_std_error nl_filter_attach(int sock, nas_nl_sock_TYPES type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_mock.h
+ */
+
+/*
+ * Software netlink transport for the unit tests and the benchmarks of the write path -
+ * the requests never reach the kernel (no root, no kernel variance). The request socket
+ * is one end of a unix datagram socket pair, the mock answers every request on the
+ * other end the way the kernel does: an ACK (or error) when NLM_F_ACK is set or the
+ * request fails, the request itself when NLM_F_ECHO is set, NLMSG_DONE for a dump.
+ * The responses are read by the usual receive path (netlink_tools_process_socket).
+ */
+
+#ifndef __NETLINK_MOCK_H
+#define __NETLINK_MOCK_H
+
+
+#include "netlink_transport.h"
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max. number of error injection rules */
+#define NL_MOCK_MAX_RULES 16
+/* Max. number of idle mock sockets kept for reuse */
+#define NL_MOCK_MAX_IDLE_SOCKS 8
+/* First ifindex given to the links created through the mock (echoed RTM_NEWLINK) */
+#define NL_MOCK_FIRST_IFINDEX 100000
+
+/* Called for every request sent through the mock, returns the error (errno) to answer
+ * with or 0 for success. Can be used to capture or check the requests. */
+typedef int (*nl_mock_request_fn)(const struct nlmsghdr *req, void *context);
+
+typedef struct {
+    uint64_t requests;
+    uint64_t acks;
+    uint64_t errors;
+    uint64_t echoes;
+    uint64_t dumps;
+    uint64_t bytes;             /* request bytes */
+} nl_mock_stats_t;
+
+/**
+ * @brief Send the netlink requests through the mock instead of the kernel
+ */
+void nl_mock_enable (void);
+
+/**
+ * @brief Send the netlink requests to the kernel again, the idle mock sockets are closed
+ */
+void nl_mock_disable (void);
+
+/**
+ * @brief Set the request handler, NULL to answer every request with success
+ */
+void nl_mock_set_handler (nl_mock_request_fn fn, void *context);
+
+/**
+ * @brief Delay every send by the given time to model the kernel processing time
+ *
+ * @param[in] usec delay in micro seconds, 0 for no delay
+ */
+void nl_mock_set_latency (uint32_t usec);
+
+/**
+ * @brief Fail the next requests of the given type that have all the given flags set,
+ *        checked before the request handler
+ *
+ * @param[in] msg_type request type (RTM_NEWROUTE...)
+ * @param[in] flags request flags that must be set (e.g. NLM_F_EXCL), 0 for any
+ * @param[in] error error (errno) to answer with (EEXIST, ENOENT...)
+ * @param[in] count number of requests to fail
+ *
+ * @return STD_ERR_OK if successful otherwise error code (no free rule)
+ */
+t_std_error nl_mock_inject_error (uint16_t msg_type, uint16_t flags, int error, uint32_t count);
+
+/**
+ * @brief Remove the handler, the error rules and the latency and reset the statistics
+ */
+void nl_mock_reset (void);
+
+void nl_mock_stats_get (nl_mock_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_nsid.h
+ */
+
+/*
+ * Map of the NSIDs to the VRFs. The event sockets of the default namespace listen to all
+ * the namespaces (NETLINK_LISTEN_ALL_NSID), the NSID of an event received from a VRF
+ * namespace is the id the default namespace has for it. When the NSID listener is enabled
+ * the VRFs are not given their own event sockets, their events are received by the sockets
+ * of the default VRF and the NSID is mapped to the VRF-id and name here.
+ */
+
+#ifndef __NETLINK_NSID_H
+#define __NETLINK_NSID_H
+
+
+#include "std_error_codes.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint64_t vrfs;                  /* VRFs mapped */
+    uint64_t unmapped;              /* datagrams dropped, NSID not mapped to a VRF */
+} nl_nsid_stats_t;
+
+/* Called for each mapped VRF */
+typedef void (*nl_nsid_vrf_fn) (int nsid, uint32_t vrf_id, const char *vrf_name, void *context);
+
+/**
+ * @brief Check if the VRF events are received by the listeners of the default VRF
+ *
+ * @return true if enabled by the netlink config (nsid_listener)
+ */
+bool nl_nsid_enabled (void);
+
+/**
+ * @brief Get the NSID of the VRF namespace (allocated if the namespace has none yet)
+ *        and map it to the VRF
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] vrf_id VRF-id
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nl_nsid_vrf_add (const char *vrf_name, uint32_t vrf_id);
+
+/**
+ * @brief Remove the map of the VRF
+ *
+ * @param[in] vrf_name VRF name
+ * @param[out] vrf_id VRF-id of the removed map, can be NULL
+ *
+ * @return false if the VRF is not mapped
+ */
+bool nl_nsid_vrf_del (const char *vrf_name, uint32_t *vrf_id);
+
+/**
+ * @brief Get the VRF of the NSID, called for every event datagram with an NSID
+ *
+ * @param[in] nsid NSID of the datagram
+ * @param[out] vrf_id VRF-id
+ * @param[out] vrf_name buffer filled with the VRF name
+ * @param[in] len length of the buffer
+ *
+ * @return false if the NSID is not mapped, the datagram is dropped
+ */
+bool nl_nsid_vrf_get (int nsid, uint32_t *vrf_id, char *vrf_name, size_t len);
+
+/**
+ * @brief Call fn for each mapped VRF, without the lock of the map
+ *
+ * @param[in] fn called for each VRF
+ * @param[in] context passed to fn
+ */
+void nl_nsid_vrf_walk (nl_nsid_vrf_fn fn, void *context);
+
+/**
+ * @brief Get the counters of the map
+ *
+ * @param[out] stats filled with the counters
+ */
+void nl_nsid_stats_get (nl_nsid_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_publish.h
+ */
+
+/*
+ * Batched publish of the objects translated from the netlink events. The objects are
+ * collected per event class and a batch is published from the publisher thread when
+ * it has the max. number of objects or when its oldest object reaches the deadline.
+ * The translation (event thread or dispatch workers) is not held up by the CPS send.
+ * The objects of a class are published in the order added, the classes are chosen so
+ * that the events of an object are always in the same class. The interface objects
+ * (link state) are not held for the deadline, they are published right away after the
+ * objects of the other classes held when they were added. An object held in a batch is
+ * replaced by a later object of the same key (e.g. route prefix, neighbor address), only
+ * the last state is published - a flapping route or neighbor is published once per batch
+ * instead of once per event.
+ */
+
+#ifndef __NETLINK_PUBLISH_H
+#define __NETLINK_PUBLISH_H
+
+
+#include "cps_api_events.h"
+#include "nas_os_nl_config.h"
+#include "std_error_codes.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max. number of objects waiting to be published, the translation waits above it */
+#define NL_PUBLISH_MAX_QUEUED (64*1024)
+
+typedef enum {
+    NL_PUBLISH_CLASS_INTF = 0,      /* link, address, netconf - not held, flush the held batches */
+    NL_PUBLISH_CLASS_ROUTE,
+    NL_PUBLISH_CLASS_NEIGH,
+    NL_PUBLISH_CLASS_MAX
+} nl_publish_class_t;
+
+/* Max. length of the key of an object */
+#define NL_PUBLISH_MAX_KEY_LEN 64
+
+/* Publish the object and delete it, e.g. net_publish_event */
+typedef cps_api_return_code_t (*nl_publish_fn) (cps_api_object_t obj);
+
+/* Fill the key of the object (at most len bytes), return the key length or 0 if the
+ * object is not replaced by a later one */
+typedef size_t (*nl_publish_key_fn) (nl_publish_class_t cls, cps_api_object_t obj,
+                                     void *key, size_t len);
+
+/* Delete an object replaced before it is published, e.g. cps_api_object_delete */
+typedef void (*nl_publish_free_fn) (cps_api_object_t obj);
+
+typedef struct {
+    uint64_t objects;               /* objects published */
+    uint64_t batches;
+    uint64_t failed;                /* objects failed to publish */
+    uint64_t max_batch;
+    uint64_t queued;                /* objects waiting to be published */
+    uint64_t max_queued;
+    uint64_t blocked;               /* times the translation waited for the publisher */
+    uint64_t coalesced;             /* objects replaced by a later one of the same key */
+} nl_publish_stats_t;
+
+/**
+ * @brief Start the publisher thread if batching is set by the netlink config
+ *
+ * @param[in] publish function the batched objects are published with
+ * @param[in] key function the key of the objects is taken with, NULL to publish
+ *            every object
+ * @param[in] free_fn function the replaced objects are deleted with
+ *
+ * @return STD_ERR_OK if successful otherwise error code, the objects are
+ *         published without batching if the thread can not be started
+ */
+t_std_error nl_publish_init (nl_publish_fn publish, nl_publish_key_fn key,
+                             nl_publish_free_fn free_fn);
+
+/**
+ * @brief true if the objects are batched
+ */
+bool nl_publish_batching (void);
+
+/**
+ * @brief Add the object to the batch of its class, the object is owned and
+ *        deleted by the batcher. It replaces the object of the same key held
+ *        in the batch, at the place of the replaced object.
+ *
+ * @param[in] cls event class
+ * @param[in] obj object to publish, allocated (not on a caller buffer)
+ */
+void nl_publish_add (nl_publish_class_t cls, cps_api_object_t obj);
+
+/**
+ * @brief Publish the batched objects and wait until they are published
+ *
+ * @warning should not be called from the publish function
+ */
+void nl_publish_flush (void);
+
+/**
+ * @brief Get the counters of the batched publish
+ *
+ * @param[out] stats filled with the counters
+ */
+void nl_publish_stats_get (nl_publish_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_rcvbuf.h
+ */
+
+#ifndef __NETLINK_RCVBUF_H
+#define __NETLINK_RCVBUF_H
+
+
+#include "netlink_tools.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initial receive buffer size of the event sockets - 4MB */
+#define NL_RCVBUF_START_LEN (4*1024*1024)
+
+/* Buffer is doubled when the queued events go above this percentage of the buffer */
+#define NL_RCVBUF_GROW_THRESHOLD_PCT 50
+
+/* Buffer is halved when the queued events stayed below this percentage of the buffer
+ * for NL_RCVBUF_SHRINK_IDLE_SEC */
+#define NL_RCVBUF_SHRINK_THRESHOLD_PCT 10
+#define NL_RCVBUF_SHRINK_IDLE_SEC 300
+
+/* Interval to check the idle sockets for shrinking the buffer */
+#define NL_RCVBUF_CHECK_INTERVAL_SEC 60
+
+/**
+ * @brief Start the adaptive receive buffer sizing for the event socket,
+ *        the buffer is set to NL_RCVBUF_START_LEN (or max_len if smaller)
+ *
+ * @param[in] sock event socket
+ * @param[in] max_len max. receive buffer size for the socket
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ *
+ * @warning This code can only be used from one thread - it is not thread safe
+ */
+t_std_error nas_nl_rcvbuf_init (int sock, size_t max_len);
+
+/**
+ * @brief Stop the adaptive receive buffer sizing for the socket
+ *
+ * @param[in] sock event socket
+ *
+ * @warning This code can only be used from one thread - it is not thread safe
+ */
+void nas_nl_rcvbuf_deinit (int sock);
+
+/**
+ * @brief Sample the receive queue of the socket and grow or shrink the buffer,
+ *        called before reading the events and on the idle check interval.
+ *        The gauges in the netlink stats of the socket are updated.
+ *
+ * @param[in] sock event socket
+ * @param[in] overflow true if the read failed with ENOBUFS
+ *
+ * @warning This code can only be used from one thread - it is not thread safe
+ */
+void nas_nl_rcvbuf_update (int sock, bool overflow);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_resync.h
+ */
+
+#ifndef __NETLINK_RESYNC_H
+#define __NETLINK_RESYNC_H
+
+
+#include "netlink_tools.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max. number of times a table is dumped again when the dump is interrupted */
+#define NL_RESYNC_MAX_RETRY 3
+
+/**
+ * Track the route, neighbor or address message that is published in the shadow of
+ * the VRF, the shadow is the last published state used for the resync diff.
+ * Delete messages remove the entry. Other messages are ignored.
+ *
+ * @param vrf_id VRF-id of the message
+ * @param nh netlink message
+ */
+void nl_resync_shadow_update(uint32_t vrf_id, struct nlmsghdr *nh);
+
+/**
+ * Remove the shadow of the VRF, called when the VRF is deleted
+ *
+ * @param vrf_id VRF-id
+ */
+void nl_resync_shadow_clear(uint32_t vrf_id);
+
+/**
+ * Dump the tables of the socket type again for the VRF after lost events (ENOBUFS) or an
+ * interrupted dump and publish only the differences - the new and changed entries are
+ * given to the handler as they are dumped and the delete is synthesized for the entries
+ * that are not present anymore. Links are compared against the interface cache
+ * (default VRF only), routes, neighbors and addresses against the shadow.
+ *
+ * This code can only be used from the event thread.
+ *
+ * @param vrf_name VRF name
+ * @param vrf_id VRF-id
+ * @param type event socket type
+ * @param evt_sock event socket - given to the handler for the stats
+ * @param handler event handler that publishes the message
+ * @return true if resynced, false if the type is not supported or the dump failed
+ */
+bool nl_resync_table(const char *vrf_name, uint32_t vrf_id, nas_nl_sock_TYPES type,
+                     int evt_sock, fun_process_nl_message handler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
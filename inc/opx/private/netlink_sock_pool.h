@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_sock_pool.h
+ */
+
+#ifndef __NETLINK_SOCK_POOL_H
+#define __NETLINK_SOCK_POOL_H
+
+
+#include "netlink_tools.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Max. number of idle request sockets cached per VRF and socket type */
+#define NL_REQ_SOCK_POOL_MAX_IDLE 4
+
+/**
+ * @brief Enable the request socket pool for the given VRF, called when
+ *        the netlink event sockets are created for the VRF
+ *
+ * @param[in] vrf_name VRF name
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nas_nl_req_sock_pool_init (const char *vrf_name);
+
+/**
+ * @brief Close all the idle request sockets of the given VRF, called when
+ *        the netlink event sockets of the VRF are deleted. Sockets that are
+ *        in use are closed when they are given back to the pool.
+ *
+ * @param[in] vrf_name VRF name
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nas_nl_req_sock_pool_deinit (const char *vrf_name);
+
+/**
+ * @brief Get a request (unbound) netlink socket for the given VRF and type,
+ *        the socket is owned by the caller until nas_nl_req_sock_put is called.
+ *        If the pool is not enabled for the VRF, a new socket is created.
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] type netlink socket type
+ *
+ * @return socket fd if successful otherwise -1
+ */
+int nas_nl_req_sock_get (const char *vrf_name, nas_nl_sock_TYPES type);
+
+/**
+ * @brief Give back the request socket taken with nas_nl_req_sock_get
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] type netlink socket type
+ * @param[in] sock socket fd
+ * @param[in] sock_err true if the socket could have unread data or is in error,
+ *            the socket is closed instead of being reused.
+ */
+void nas_nl_req_sock_put (const char *vrf_name, nas_nl_sock_TYPES type, int sock, bool sock_err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
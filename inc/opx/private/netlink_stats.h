@@ -34,6 +34,8 @@ typedef struct {
     uint32_t num_bulk_events_rcvd;
     uint32_t max_events_rcvd_in_bulk;
     uint32_t min_events_rcvd_in_bulk;
+    uint32_t num_batch_reads;
+    uint32_t max_datagrams_in_batch;
     uint32_t num_add_events;
     uint32_t num_del_events;
     uint32_t num_get_events;
@@ -46,6 +48,11 @@ typedef struct {
     uint32_t num_add_events_pub_failed;
     uint32_t num_del_events_pub_failed;
     uint32_t num_get_events_pub_failed;
+    uint32_t rcvbuf_len;
+    uint32_t peak_rcvq_len;
+    uint32_t num_drops;
+    uint32_t num_rcvbuf_grow;
+    uint32_t num_rcvbuf_shrink;
 } nas_nl_stats_desc_t;
 
 /**
@@ -104,6 +111,18 @@ t_std_error nas_nl_stats_reset (int sock);
  */
 t_std_error nas_nl_stats_update (int sock, uint32_t bulk_msg_count);
 
+/**
+ * @brief Update the netlink batch receive stats for the given socket
+ *
+ * @param[in] sock socket id
+ * @param[in] datagram_count number of datagrams read in one system call
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ *
+ * @warning This code can only be used from one thread - it is not thread safe
+ */
+t_std_error nas_nl_stats_update_batch (int sock, uint32_t datagram_count);
+
 /**
  * @brief Update the netlink event stats for specific netlink message type
  *
@@ -153,6 +172,32 @@ t_std_error nas_nl_stats_update_pub_msg (int sock, int rt_msg_type);
  */
 t_std_error nas_nl_stats_update_pub_msg_failed (int sock, int rt_msg_type);
 
+/**
+ * @brief Update the receive queue gauges for the given socket
+ *
+ * @param[in] sock socket id
+ * @param[in] rcvbuf_len current receive buffer size
+ * @param[in] rcvq_len bytes queued in the socket
+ * @param[in] drops events dropped by the kernel since the last update
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ *
+ * @warning This code can only be used from one thread - it is not thread safe
+ */
+t_std_error nas_nl_stats_update_rcvq (int sock, uint32_t rcvbuf_len, uint32_t rcvq_len, uint32_t drops);
+
+/**
+ * @brief Update the receive buffer resize stats for the given socket
+ *
+ * @param[in] sock socket id
+ * @param[in] grow true if the buffer is grown, false if shrunk
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ *
+ * @warning This code can only be used from one thread - it is not thread safe
+ */
+t_std_error nas_nl_stats_update_rcvbuf_resize (int sock, bool grow);
+
 #ifdef __cplusplus
 }
 #endif
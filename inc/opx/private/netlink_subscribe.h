@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_subscribe.h
+ */
+
+/*
+ * Event subscription profiles. A profile gives the event classes (links, addresses,
+ * routes, neighbors, netconf, MDB) received per VRF and per address family. The event
+ * sockets join only the multicast groups of the profile, the groups are added and
+ * dropped (NETLINK_ADD_MEMBERSHIP/NETLINK_DROP_MEMBERSHIP) on the open sockets when the
+ * profile changes. Events of the classes not in the profile (e.g. already queued on the
+ * socket, or of a family sharing the group) are dropped before they are translated.
+ *
+ * The classes without a family (links, and the neighbor and MDB groups shared by the
+ * families) are received if the class is in the profile of either family.
+ *
+ * The VRFs without a profile set have the default profile, all the classes less the
+ * ones given by the netlink config (subscribe_off).
+ */
+
+#ifndef __NETLINK_SUBSCRIBE_H
+#define __NETLINK_SUBSCRIBE_H
+
+
+#include "netlink_tools.h"
+#include "std_error_codes.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Event classes of a profile */
+#define NL_SUBSCRIBE_LINK       (1 << 0)
+#define NL_SUBSCRIBE_ADDR       (1 << 1)
+#define NL_SUBSCRIBE_ROUTE      (1 << 2)
+#define NL_SUBSCRIBE_NEIGH      (1 << 3)
+#define NL_SUBSCRIBE_NETCONF    (1 << 4)
+#define NL_SUBSCRIBE_MDB        (1 << 5)
+#define NL_SUBSCRIBE_ALL        0x3f
+
+/**
+ * @brief Set the event classes of the VRF for the family, the memberships of the open
+ *        event sockets are updated by the caller (os_nl_subscribe_set)
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] family AF_INET or AF_INET6
+ * @param[in] events NL_SUBSCRIBE_xxx classes
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nl_subscribe_set (const char *vrf_name, int family, uint32_t events);
+
+/**
+ * @brief Get the event classes of the VRF for the family
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] family AF_INET or AF_INET6
+ *
+ * @return NL_SUBSCRIBE_xxx classes, the default profile if none is set for the VRF
+ */
+uint32_t nl_subscribe_get (const char *vrf_name, int family);
+
+/**
+ * @brief Remove the profile of the VRF, the VRF is given the default profile. Called
+ *        when the event sockets of the VRF are deleted
+ *
+ * @param[in] vrf_name VRF name
+ */
+void nl_subscribe_clear (const char *vrf_name);
+
+/**
+ * @brief Get the multicast groups of the socket type in the profile of the VRF
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] type event socket type
+ *
+ * @return groups, bit (1 << RTNLGRP_xxx) for each group
+ */
+uint64_t nl_subscribe_groups (const char *vrf_name, nas_nl_sock_TYPES type);
+
+/**
+ * @brief Join the given groups of the socket type and leave the others
+ *
+ * @param[in] sock event socket
+ * @param[in] type event socket type
+ * @param[in] groups groups to be joined, as given by nl_subscribe_groups
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nl_subscribe_sock_apply (int sock, nas_nl_sock_TYPES type, uint64_t groups);
+
+/**
+ * @brief Check if the event is in the profile of the VRF, called for every event
+ *        before it is translated
+ *
+ * @param[in] vrf_name VRF name, the default VRF if NULL
+ * @param[in] rt_msg_type message type
+ * @param[in] hdr message
+ *
+ * @return false if the event is to be dropped
+ */
+bool nl_subscribe_wanted (const char *vrf_name, int rt_msg_type, struct nlmsghdr *hdr);
+
+/**
+ * @brief Change the profile of the VRF and update the memberships of its event sockets,
+ *        the sockets are not recreated
+ *
+ * @param[in] vrf_name VRF name
+ * @param[in] family AF_INET or AF_INET6
+ * @param[in] events NL_SUBSCRIBE_xxx classes
+ *
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error os_nl_subscribe_set (const char *vrf_name, int family, uint32_t events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
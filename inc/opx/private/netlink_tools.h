@@ -31,6 +31,8 @@
 #include "nas_vrf_utils.h"
 
 #include <stddef.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 #include <stdbool.h>
 
@@ -56,6 +58,14 @@ extern "C" {
 
 #define NL_SCRATCH_BUFFER_LEN (1*1024*1024) /* Scratch buffer size - 1MB */
 
+/* Min. buffer size for reading the responses of requests and dumps, the kernel builds the dump
+ * datagrams to fit the largest read buffer seen on the socket but no bigger than 32KB
+ * unless a single message is bigger than that */
+#define NL_RECV_MIN_BUFFER_LEN (64*1024)
+
+/* Max. wait for the next response datagram of a request or a dump */
+#define NL_RECV_TIMEOUT_SEC 5
+
 /* Netlink socket buffer size for netconf events - 1MB */
 #define NL_NETCONF_SOCKET_BUFFER_LEN (1*1024*1024)
 /* @@TODO looks like the macro SOL_NETLINK is not present in linux/socket.h,
@@ -95,13 +105,158 @@ bool netlink_tools_process_socket(int sock, fun_process_nl_message handlers,
 void netlink_tools_receive_event(int sock,fun_process_nl_message handlers,
         void * context, char * scratch_buff, size_t scratch_buff_len,int *error_code, uint32_t vrf_id);
 
+/**
+ * Process the event messages of a datagram already read (e.g. from a capture) as
+ * netlink_tools_receive_event does. Returns the number of messages given to the handler.
+ */
+size_t netlink_tools_process_datagram(int sock, fun_process_nl_message handlers,
+        void * context, char * buff, int len, int *error_code, uint32_t vrf_id);
+
+/**
+ * Process an event datagram already received on the socket as netlink_tools_receive_events
+ * does for each datagram it reads - a truncated datagram is dropped and the VRF is taken
+ * from the NSID of msg (control message) for the listeners of the default VRF.
+ * The stats of the socket are not updated. Returns the number of messages given to the handler.
+ */
+size_t netlink_tools_process_event_datagram(int sock, fun_process_nl_message handlers,
+        void * context, struct msghdr *msg, char *buff, int len, int *error_code, uint32_t vrf_id);
+
+/* Number of datagrams read in one call by netlink_tools_receive_events */
+#define NL_EVENT_RING_DEPTH 32
+/* Buffer size for each datagram in the receive ring, the kernel builds the
+ * event messages with the exact size so an event never gets close to this */
+#define NL_EVENT_RING_BUFF_LEN (64*1024)
+/* Control message buffer size for each datagram in the receive ring */
+#define NL_EVENT_RING_CMSG_LEN 32
+
+/* Pre-allocated buffers for receiving multiple datagrams with one system call */
+typedef struct {
+    size_t depth;
+    size_t buff_len;
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    struct sockaddr_nl *addrs;
+    char *cmsg;
+    char *buffs;
+} nl_event_ring_t;
+
+nl_event_ring_t *nl_event_ring_create(size_t depth, size_t buff_len);
+
+void nl_event_ring_destroy(nl_event_ring_t *ring);
+
+/**
+ * Handle the netlink events - reads all the datagrams queued on the socket (up to the
+ * ring depth) with one system call and process them in order. Doesn't wait if there is
+ * no event. Returns the number of datagrams read.
+ */
+size_t netlink_tools_receive_events(int sock, fun_process_nl_message handlers,
+        void * context, nl_event_ring_t *ring, int *error_code, uint32_t vrf_id);
+
 bool nl_send_request(int sock, int type, int flags, int seq, void * req, size_t len );
 
 bool nl_send_nlmsg(int sock, struct nlmsghdr *m);
 
+/**
+ * Enable strict checking of the dump requests on the socket, the kernel then applies the
+ * filters given in the dump request header and attributes (see standard_netlink_requests.h).
+ * The dump requests sent on the socket should carry the full family header.
+ *
+ * @param sock request socket
+ * @return true if enabled, false if not supported by the kernel - the filters
+ *         are ignored by the kernel and the dump returns the whole table
+ */
+bool nl_sock_set_strict_check(int sock);
+
+/**
+ * Get the sequence number for a new request, unique within the process
+ */
+int nl_get_next_seq(void);
+
 t_std_error nl_do_set_request(const char *vrf_name, nas_nl_sock_TYPES type,struct nlmsghdr *m,
                               void *buff, size_t bufflen);
 
+/**
+ * Send the request with NLM_F_ECHO and wait for the ACK, the messages echoed by the kernel
+ * for the request (sent before the ACK) are given to func.
+ *
+ * @param vrf_name VRF of the request socket
+ * @param type socket type
+ * @param m request, NLM_F_ACK and NLM_F_ECHO are added
+ * @param buff scratch buffer for the response (can be the request buffer)
+ * @param bufflen size of buff
+ * @param func called for each echoed message
+ * @param context passed to func
+ * @return STD_ERR_OK if successful otherwise error code
+ */
+t_std_error nl_do_set_request_echo(const char *vrf_name, nas_nl_sock_TYPES type, struct nlmsghdr *m,
+                                   void *buff, size_t bufflen, fun_process_nl_message func, void *context);
+
+/* Link created by a RTM_NEWLINK request */
+typedef struct {
+    hal_ifindex_t ifindex;
+    bool echoed;                /* filled from the link echoed by the kernel, flags/mtu/mac are valid */
+    unsigned int flags;
+    uint32_t mtu;
+    hal_mac_addr_t mac;
+} nl_link_echo_t;
+
+/**
+ * Create the link and return the link echoed by the kernel (ifindex, flags, MTU and MAC),
+ * no name lookup is needed after the create. On kernels that do not echo the created
+ * link only the ifindex is filled, from the IFLA_IFNAME of the request. A link that
+ * already exists (EEXIST) is not an error, only its ifindex is filled.
+ *
+ * @param vrf_name VRF of the request socket
+ * @param m RTM_NEWLINK request with IFLA_IFNAME
+ * @param buff scratch buffer for the response (can be the request buffer)
+ * @param bufflen size of buff
+ * @param link filled with the created link
+ * @return STD_ERR_OK if the link is created and its ifindex found otherwise error code
+ */
+t_std_error nl_do_link_create_request(const char *vrf_name, struct nlmsghdr *m, void *buff, size_t bufflen,
+                                      nl_link_echo_t *link);
+
+/* Max. number of requests sent in one sendmsg by the batch request */
+#define NL_BATCH_MAX_MSGS 256
+/* Max. number of bytes sent in one sendmsg by the batch request,
+ * has to be less than the netlink socket send buffer size */
+#define NL_BATCH_MAX_SEND_LEN (64*1024)
+/* Receive buffer memory taken by one ACK, kernel skb overhead included. The ACKs of a
+ * batch are limited to the receive buffer of the socket, ACKs above it would be dropped */
+#define NL_BATCH_ACK_MEM 2048
+/* Receive buffer of the request sockets - ACKs of a full batch and the requests echoed
+ * by their error ACKs */
+#define NL_BATCH_RCVBUF_LEN ((NL_BATCH_MAX_MSGS * NL_BATCH_ACK_MEM) + NL_BATCH_MAX_SEND_LEN)
+/* Error code of a batch request before its ACK is received */
+#define NL_BATCH_ERR_PENDING (-1)
+
+typedef struct {
+    struct nlmsghdr *msg;   /* request built by the caller */
+    void *context;          /* caller object associated with the request */
+    int error_code;         /* result - 0 on success otherwise the errno returned by the kernel */
+} nl_batch_req_t;
+
+/**
+ * Send a batch of pre-built requests in as few sendmsg calls as possible and
+ * collect the ACK for each of them. NLM_F_ACK and the sequence number of every
+ * request are set by this function, only the nlmsg_len bytes of a request are read.
+ * The result of each request is returned in its error_code so that the caller can
+ * handle the partial failures. A batch with an ACK that does not fit in buff fails,
+ * its requests without an ACK get EIO.
+ *
+ * @param vrf_name VRF name
+ * @param type netlink socket type
+ * @param reqs requests to send - processed by the kernel in the given order
+ * @param count number of requests
+ * @param buff scratch buffer used to receive the ACKs
+ * @param bufflen scratch buffer length
+ * @param failed_count if not NULL, filled with the number of failed requests
+ *
+ * @return STD_ERR_OK if all the requests are successful otherwise the error of the first failed request
+ */
+t_std_error nl_do_batch_request(const char *vrf_name, nas_nl_sock_TYPES type, nl_batch_req_t *reqs,
+                                size_t count, void *buff, size_t bufflen, size_t *failed_count);
+
 void nas_os_pack_nl_hdr(struct nlmsghdr *nlh, __u16 msg_type, __u16 nl_flags);
 
 void nas_os_pack_if_hdr(struct ifinfomsg *ifmsg, unsigned char ifi_family,
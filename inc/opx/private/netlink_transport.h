@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_transport.h
+ */
+
+/*
+ * Transport of the netlink requests (nl_do_set_request, nl_do_batch_request and the async
+ * requests) - where the request sockets come from and how the requests are sent. The
+ * responses are always read from the request socket with recvmsg, so a transport gives
+ * out sockets that it can write the responses to. The kernel transport (request socket
+ * pool) is used unless another one is installed, e.g. the mock transport (netlink_mock.h).
+ */
+
+#ifndef __NETLINK_TRANSPORT_H
+#define __NETLINK_TRANSPORT_H
+
+
+#include "netlink_tools.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *name;
+    /* Get a request socket, same contract as nas_nl_req_sock_get */
+    int (*sock_get)(const char *vrf_name, nas_nl_sock_TYPES type);
+    /* Give back the request socket, same contract as nas_nl_req_sock_put */
+    void (*sock_put)(const char *vrf_name, nas_nl_sock_TYPES type, int sock, bool sock_err);
+    /* Send the request(s), same contract as sendmsg */
+    ssize_t (*send)(int sock, const struct msghdr *msg, int flags);
+} nl_transport_t;
+
+/**
+ * @brief Install the transport of the requests, NULL restores the kernel transport.
+ *        To be called when no request is in progress.
+ *
+ * @param[in] transport transport, must stay valid until it is replaced
+ */
+void nl_transport_set (const nl_transport_t *transport);
+
+/**
+ * @brief Check if the requests go to the kernel (io_uring send/receive can be used)
+ */
+bool nl_transport_is_kernel (void);
+
+int nl_transport_sock_get (const char *vrf_name, nas_nl_sock_TYPES type);
+
+void nl_transport_sock_put (const char *vrf_name, nas_nl_sock_TYPES type, int sock, bool sock_err);
+
+ssize_t nl_transport_send (int sock, const struct msghdr *msg, int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_uring.h
+ */
+
+#ifndef __NETLINK_URING_H
+#define __NETLINK_URING_H
+
+
+#include "netlink_tools.h"
+
+#include <sys/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Check if the io_uring backend is selected by the netlink config and supported
+ * by the kernel, evaluated once per process
+ *
+ * @return true if io_uring is used for the requests and the event sockets
+ */
+bool nl_uring_enabled(void);
+
+/* Submission queue size of the event ring */
+#define NL_URING_EVENT_ENTRIES 256
+/* Max. number of event sockets on the event ring */
+#define NL_URING_MAX_SOCKS 1024
+/* Buffers provided to the receives of the event sockets - a buffer holds one datagram
+ * with its address and control message */
+#define NL_URING_EVENT_BUFFS 128
+#define NL_URING_EVENT_BUFF_LEN (32*1024)
+/* Completions of one wait - a datagram per buffer and a stopped receive per socket */
+#define NL_URING_MAX_EVENTS (NL_URING_EVENT_BUFFS + NL_URING_MAX_SOCKS)
+
+/* Datagram received on an event socket, or its receive that stopped */
+typedef struct {
+    void *context;          /* context given with the socket to nl_uring_event_add */
+    int sock;
+    int res;                /* length of the datagram, -errno if the receive stopped */
+    char *buff;             /* datagram, NULL if the receive stopped */
+    struct msghdr msg;      /* flags and control message of the datagram */
+    int bid;                /* buffer of the datagram, -1 if none */
+} nl_uring_event_t;
+
+/**
+ * Create the event ring - called once from the event thread, the only thread that
+ * waits on the ring. Datagrams are received only while the event thread waits.
+ *
+ * @return true if successful, false to use the epoll/recvmmsg path
+ */
+bool nl_uring_event_init(void);
+
+/**
+ * Add the event socket to the ring, a multishot receive is kept pending on the socket.
+ * Can be called from any thread, the receive is submitted by the next wait.
+ *
+ * @param sock event socket
+ * @param context given back with the datagrams of the socket
+ * @return true if successful
+ */
+bool nl_uring_event_add(int sock, void *context);
+
+/**
+ * Remove the event socket from the ring, its receive is cancelled and its datagrams
+ * are dropped from now on. Can be called from any thread, before the socket is closed.
+ *
+ * @param sock event socket
+ */
+void nl_uring_event_del(int sock);
+
+/**
+ * Submit the pending receives and wait for the datagrams of all the sockets with one
+ * system call. The buffers of the events are held until nl_uring_event_done.
+ *
+ * This code can only be used from the event thread.
+ *
+ * @param events filled with the datagrams, in the order received per socket
+ * @param max_events size of events, NL_URING_MAX_EVENTS to get all the completions
+ * @param timeout_msec max. time to wait
+ * @return number of events, 0 on timeout
+ */
+size_t nl_uring_event_wait(nl_uring_event_t *events, size_t max_events, unsigned int timeout_msec);
+
+/**
+ * Give the buffers of the events processed back to the ring
+ *
+ * This code can only be used from the event thread.
+ *
+ * @param events events returned by the last wait
+ * @param count number of events
+ */
+void nl_uring_event_done(const nl_uring_event_t *events, size_t count);
+
+/**
+ * Send the request and receive the first datagram of the response with one
+ * system call, the receive is bounded by NL_RECV_TIMEOUT_SEC.
+ * Uses a ring of the calling thread.
+ *
+ * @param sock request socket
+ * @param send_msg request
+ * @param recv_msg buffer for the response
+ * @param recv_flags flags of the receive (MSG_TRUNC to get the length of a truncated datagram)
+ * @param recv_len filled with the length of the datagram
+ * @return true if sent and received, false with errno set otherwise -
+ *         ENOSYS if io_uring can not be used and the classic path should be used
+ */
+bool nl_uring_send_recv(int sock, struct msghdr *send_msg, struct msghdr *recv_msg, int recv_flags,
+                        int *recv_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
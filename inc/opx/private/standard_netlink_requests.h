@@ -22,9 +22,17 @@
 #define STANDARD_NETLINK_REQUESTS_H_
 
 #include "netlink_tools.h"
+#include "nas_nlmsg.h"
 #include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+#include <linux/if_addr.h>
+#include <stdint.h>
 #include <string.h>
 
+/* Max. size of the filtered dump requests */
+#define NL_DUMP_REQ_BUFFER_LEN 128
+
 /**
  * A extremely common function to return all instances of a given type
  * @param sock is the socket on which to send the request
@@ -42,4 +50,99 @@ static inline bool nl_route_send_get_all(int sock, int type, int family, int seq
             seq,&rtm,sizeof(rtm));
 }
 
+/*
+ * Filtered dump requests - the kernel applies the filters only on the sockets with
+ * strict checking enabled (nl_sock_set_strict_check) and ignores them otherwise,
+ * so the caller still has to filter the response when the strict check is not supported.
+ * A zero value for any of the filter fields means no filter.
+ */
+typedef struct {
+    int family;
+    uint32_t table;
+    uint8_t protocol;
+    uint8_t type;
+    uint32_t oif;
+} nl_route_dump_filter_t;
+
+/**
+ * Send a route dump request with the filters in the rtmsg header and the attributes
+ * @param sock is the socket on which to send the request
+ * @param filter is the route dump filter
+ * @param seq is the request id sequence that will be expected in the response
+ * @return true of successfully sent the message
+ */
+static inline bool nl_route_send_dump(int sock, const nl_route_dump_filter_t *filter, int seq) {
+    char buff[NL_DUMP_REQ_BUFFER_LEN];
+    memset(buff, 0, sizeof(buff));
+
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buff;
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    nlh->nlmsg_type = RTM_GETROUTE;
+    nlh->nlmsg_flags = NLM_F_DUMP | NLM_F_REQUEST;
+    nlh->nlmsg_seq = seq;
+
+    struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA(nlh);
+    rtm->rtm_family = filter->family;
+    rtm->rtm_protocol = filter->protocol;
+    rtm->rtm_type = filter->type;
+    if (filter->table != 0) {
+        /* Table ids above 255 are given only in the attribute */
+        rtm->rtm_table = (filter->table < 256) ? filter->table : RT_TABLE_UNSPEC;
+        nlmsg_add_attr(nlh, sizeof(buff), RTA_TABLE, &filter->table, sizeof(filter->table));
+    }
+    if (filter->oif != 0) {
+        nlmsg_add_attr(nlh, sizeof(buff), RTA_OIF, &filter->oif, sizeof(filter->oif));
+    }
+    return nl_send_nlmsg(sock, nlh);
+}
+
+/**
+ * Send a neighbor dump request filtered on the interface and (or) the master interface
+ * @param sock is the socket on which to send the request
+ * @param family is the neighbor family AF_INET, AF_INET6 or AF_BRIDGE
+ * @param if_index is the interface index of the neighbors (0 for all)
+ * @param master_index is the master (bridge/VRF) interface index of the neighbors (0 for all)
+ * @param seq is the request id sequence that will be expected in the response
+ * @return true of successfully sent the message
+ */
+static inline bool nl_neigh_send_dump(int sock, int family, uint32_t if_index,
+                                      uint32_t master_index, int seq) {
+    char buff[NL_DUMP_REQ_BUFFER_LEN];
+    memset(buff, 0, sizeof(buff));
+
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buff;
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct ndmsg));
+    nlh->nlmsg_type = RTM_GETNEIGH;
+    nlh->nlmsg_flags = NLM_F_DUMP | NLM_F_REQUEST;
+    nlh->nlmsg_seq = seq;
+
+    struct ndmsg *ndm = (struct ndmsg *)NLMSG_DATA(nlh);
+    ndm->ndm_family = family;
+    if (if_index != 0) {
+        nlmsg_add_attr(nlh, sizeof(buff), NDA_IFINDEX, &if_index, sizeof(if_index));
+    }
+    if (master_index != 0) {
+        nlmsg_add_attr(nlh, sizeof(buff), NDA_MASTER, &master_index, sizeof(master_index));
+    }
+    return nl_send_nlmsg(sock, nlh);
+}
+
+/**
+ * Send an address dump request filtered on the interface
+ * @param sock is the socket on which to send the request
+ * @param family is the address family AF_INET or AF_INET6
+ * @param if_index is the interface index of the addresses (0 for all)
+ * @param seq is the request id sequence that will be expected in the response
+ * @return true of successfully sent the message
+ */
+static inline bool nl_addr_send_dump(int sock, int family, uint32_t if_index, int seq) {
+    struct ifaddrmsg ifa;
+    memset(&ifa, 0, sizeof(ifa));
+    ifa.ifa_family = family;
+    ifa.ifa_index = if_index;
+
+    return nl_send_request(sock, RTM_GETADDR, NLM_F_DUMP | NLM_F_REQUEST,
+            seq, &ifa, sizeof(ifa));
+}
+
 #endif /* STANDARD_NETLINK_REQUESTS_H_ */
@@ -48,12 +48,37 @@
 #include <unistd.h>
 
 typedef struct {
-    int family;
+    nl_route_dump_filter_t dump;
+    /* Kernel applies the dump filter (strict check enabled on the socket) */
+    bool kernel_filter;
+    cps_api_object_list_t list;
 } route_filter_t;
 
 #define NAS_RT_V4_PREFIX_LEN              (8 * HAL_INET4_LEN)
 #define NAS_RT_V6_PREFIX_LEN              (8 * HAL_INET6_LEN)
 
+/* Route attributes consumed by nl_to_route_info */
+static const nla_select_t nl_route_attr_sel[] = {
+    { RTA_DST, HAL_INET4_LEN },
+    { RTA_GATEWAY, HAL_INET4_LEN },
+    { RTA_OIF, sizeof(uint32_t) },
+    { RTA_MULTIPATH, 0 },
+};
+
+/* Attributes of a next hop in RTA_MULTIPATH */
+static const nla_select_t nl_route_nh_attr_sel[] = {
+    { RTA_GATEWAY, HAL_INET4_LEN },
+};
+
+/* Attributes consumed by the user space route dump filter */
+static const nla_select_t nl_route_filter_attr_sel[] = {
+    { RTA_TABLE, sizeof(uint32_t) },
+    { RTA_OIF, sizeof(uint32_t) },
+    { RTA_MULTIPATH, 0 },
+};
+
+#define NL_ATTR_SEL_COUNT(sel) (sizeof(sel)/sizeof(*(sel)))
+
 bool nas_rt_is_reserved_intf(char *intf_name) {
 
     if (intf_name == NULL)
@@ -229,10 +254,10 @@ bool nl_to_route_info(int rt_msg_type, struct nlmsghdr *hdr, cps_api_object_t ob
     int attr_len = nlmsg_attrlen(hdr,sizeof(*rtmsg));
     struct nlattr *head = nlmsg_attrdata(hdr, sizeof(struct rtmsg));
 
-    struct nlattr *attrs[__IFLA_MAX];
-    memset(attrs,0,sizeof(attrs));
+    struct nlattr *attrs[__RTA_MAX];
 
-    if (nla_parse(attrs,__IFLA_MAX,head,attr_len)!=0) {
+    if (nla_parse_selected(attrs,__RTA_MAX,nl_route_attr_sel,NL_ATTR_SEL_COUNT(nl_route_attr_sel),
+                           head,attr_len)!=0) {
         EV_LOGGING(NETLINK,ERR,"NL-ROUTE-PARSE","Failed to parse attributes");
         return false;
     }
@@ -409,8 +434,8 @@ bool nl_to_route_info(int rt_msg_type, struct nlmsghdr *hdr, cps_api_object_t ob
             }
 
             struct nlattr *nhattr[__RTA_MAX];
-            memset(nhattr,0,sizeof(nhattr));
-            nhrt_parse(nhattr,__IFLA_MAX,rtnh);
+            nla_parse_selected(nhattr,__RTA_MAX,nl_route_nh_attr_sel,NL_ATTR_SEL_COUNT(nl_route_nh_attr_sel),
+                               (struct nlattr*)RTNH_DATA(rtnh),rtnh_attr_len(rtnh));
             if (nhattr[RTA_GATEWAY]) {
                 ids[2] = BASE_ROUTE_OBJ_ENTRY_NH_LIST_NH_ADDR;
                 rc = cps_api_object_e_add(obj, ids, ids_len, cps_api_object_ATTR_T_BIN,
@@ -451,17 +476,60 @@ bool nl_to_route_info(int rt_msg_type, struct nlmsghdr *hdr, cps_api_object_t ob
     return true;
 }
 
+/* Filter the dumped route in user space when the kernel does not support the strict check */
+static bool nl_route_dump_filter_match(const nl_route_dump_filter_t *filter, struct nlmsghdr *nh) {
+    struct rtmsg *rtmsg = (struct rtmsg *)NLMSG_DATA(nh);
+
+    if(nh->nlmsg_len < NLMSG_LENGTH(sizeof(*rtmsg)))
+        return false;
+
+    if ((filter->family != AF_UNSPEC) && (rtmsg->rtm_family != filter->family)) return false;
+    if ((filter->protocol != 0) && (rtmsg->rtm_protocol != filter->protocol)) return false;
+    if ((filter->type != 0) && (rtmsg->rtm_type != filter->type)) return false;
+    if ((filter->table == 0) && (filter->oif == 0)) return true;
+
+    struct nlattr *attrs[__RTA_MAX];
+    if (nla_parse_selected(attrs,__RTA_MAX,nl_route_filter_attr_sel,NL_ATTR_SEL_COUNT(nl_route_filter_attr_sel),
+                           nlmsg_attrdata(nh, sizeof(struct rtmsg)),nlmsg_attrlen(nh,sizeof(*rtmsg)))!=0) {
+        return false;
+    }
+    if (filter->table != 0) {
+        uint32_t table = (attrs[RTA_TABLE] != NULL) ? *(uint32_t *)nla_data(attrs[RTA_TABLE]) :
+                         rtmsg->rtm_table;
+        if (table != filter->table) return false;
+    }
+    if (filter->oif != 0) {
+        if ((attrs[RTA_OIF] != NULL) && (*(uint32_t *)nla_data(attrs[RTA_OIF]) == filter->oif)) {
+            return true;
+        }
+        if (attrs[RTA_MULTIPATH] == NULL) return false;
+
+        struct rtnexthop * rtnh = (struct rtnexthop * )nla_data(attrs[RTA_MULTIPATH]);
+        int remaining = nla_len(attrs[RTA_MULTIPATH]);
+        while (RTNH_OK(rtnh, remaining)) {
+            if ((uint32_t)rtnh->rtnh_ifindex == filter->oif) return true;
+            rtnh = rtnh_next(rtnh,&remaining);
+        }
+        return false;
+    }
+    return true;
+}
+
 static bool process_route_and_add_to_list(int sock, int rt_msg_type, struct nlmsghdr *nh,
         void *context, uint32_t vrf_id) {
-    cps_api_object_list_t *list = (cps_api_object_list_t*) context;
+    route_filter_t *filter = (route_filter_t*) context;
+
+    if (!filter->kernel_filter && !nl_route_dump_filter_match(&filter->dump, nh)) {
+        return true;
+    }
     cps_api_object_t obj=cps_api_object_create();
 
-    if (!cps_api_object_list_append(*list,obj)) {
+    if (!cps_api_object_list_append(filter->list,obj)) {
         cps_api_object_delete(obj);
         return false;
     }
 
-    if (!nl_to_route_info(nh->nlmsg_type,nh,obj,context, NAS_DEFAULT_VRF_ID)) {
+    if (!nl_to_route_info(nh->nlmsg_type,nh,obj,context, vrf_id)) {
         return false;
     }
     return true;
@@ -471,16 +539,23 @@ bool nl_request_existing_routes(int sock, int family, int req_id) {
     return nl_route_send_get_all(sock,RTM_GETROUTE,family,req_id);
 }
 
-bool read_all_routes(cps_api_object_list_t list, route_filter_t *filter) {
-    int sock = nas_nl_sock_create(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, false);
+bool read_all_routes(cps_api_object_list_t list, route_filter_t *filter, uint32_t vrf_id) {
+    const char *vrf_name = nas_os_get_vrf_name(vrf_id);
+    if (vrf_name == NULL) return false;
+
+    int sock = nas_nl_sock_create(vrf_name, nas_nl_sock_T_ROUTE, false);
     const int RANDOM_REQ_ID = 0x101;
     if (sock==-1) return false;
-    bool rc = nl_request_existing_routes(sock,filter->family, RANDOM_REQ_ID);
+
+    filter->list = list;
+    /* Let the kernel return only the routes matching the filter */
+    filter->kernel_filter = nl_sock_set_strict_check(sock);
+    bool rc = nl_route_send_dump(sock, &filter->dump, RANDOM_REQ_ID);
 
     if (rc) {
         char buff[1024];
-        rc = netlink_tools_process_socket(sock,process_route_and_add_to_list,&list,
-                buff,sizeof(buff),&RANDOM_REQ_ID,NULL, NL_DEFAULT_VRF_ID);
+        rc = netlink_tools_process_socket(sock,process_route_and_add_to_list,filter,
+                buff,sizeof(buff),&RANDOM_REQ_ID,NULL, vrf_id);
     }
     close(sock);
     return rc;
@@ -498,8 +573,20 @@ static cps_api_return_code_t db_read_function (void * context, cps_api_get_param
 
     route_filter_t rf;
     memset(&rf,0,sizeof(rf));
-    //!TODO need to handle the filter requests (using the received key)
-    read_all_routes(param->list,&rf);
+    uint32_t vrf_id = NAS_DEFAULT_VRF_ID;
+
+    cps_api_object_t filt = cps_api_object_list_get(param->filters,key_ix);
+    if (filt != NULL) {
+        cps_api_object_attr_t attr = cps_api_object_attr_get(filt, cps_api_if_ROUTE_A_FAMILY);
+        if (attr != NULL) rf.dump.family = cps_api_object_attr_data_u32(attr);
+        attr = cps_api_object_attr_get(filt, cps_api_if_ROUTE_A_PROTOCOL);
+        if (attr != NULL) rf.dump.protocol = cps_api_object_attr_data_u32(attr);
+        attr = cps_api_object_attr_get(filt, cps_api_if_ROUTE_A_NH_IFINDEX);
+        if (attr != NULL) rf.dump.oif = cps_api_object_attr_data_u32(attr);
+        attr = cps_api_object_attr_get(filt, cps_api_if_ROUTE_A_VRF);
+        if (attr != NULL) vrf_id = cps_api_object_attr_data_u32(attr);
+    }
+    read_all_routes(param->list,&rf,vrf_id);
 
     return rc;
 }
@@ -48,7 +48,7 @@
 
 #define MAC_STRING_LEN 20
 char *nl_neigh_state_to_str (int state) {
-    static char str[18];
+    static __thread char str[18];
         if (state == NUD_INCOMPLETE)
             snprintf (str, sizeof(str), "Incomplete");
         else if (state == NUD_REACHABLE)
@@ -72,12 +72,7 @@ char *nl_neigh_state_to_str (int state) {
 }
 
 bool nl_neigh_get_all_request(int sock, int family,int req_id) {
-    struct ifinfomsg ifm;
-    memset(&ifm,0,sizeof(ifm));
-    ifm.ifi_family = family;
-    return nl_send_request(sock,RTM_GETNEIGH,
-            NLM_F_ROOT| NLM_F_DUMP|NLM_F_REQUEST,
-            req_id,&ifm,sizeof(ifm));
+    return nl_neigh_send_dump(sock, family, 0, 0, req_id);
 }
 
 bool nl_to_neigh_info(int rt_msg_type, struct nlmsghdr *hdr, cps_api_object_t obj, void *context, uint32_t vrf_id) {
@@ -269,10 +264,23 @@ bool nl_to_neigh_info(int rt_msg_type, struct nlmsghdr *hdr, cps_api_object_t ob
     return true;
 }
 
+typedef struct {
+    cps_api_object_list_t list;
+    uint32_t if_index;
+    /* Kernel applies the interface filter (strict check enabled on the socket) */
+    bool kernel_filter;
+} neigh_filter_t;
+
 static bool process_neigh_and_add_to_list(int sock, int rt_msg_type, struct nlmsghdr *nh, void *context, uint32_t vrf_id) {
-    cps_api_object_list_t *list = (cps_api_object_list_t*) context;
+    neigh_filter_t *filter = (neigh_filter_t*) context;
+    struct ndmsg *ndmsg = (struct ndmsg *)NLMSG_DATA(nh);
+
+    if (!filter->kernel_filter && (filter->if_index != 0) &&
+        ((nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ndmsg))) || (ndmsg->ndm_ifindex != (int)filter->if_index))) {
+        return true;
+    }
     cps_api_object_t obj=cps_api_object_create();
-    if (!cps_api_object_list_append(*list,obj)) {
+    if (!cps_api_object_list_append(filter->list,obj)) {
         cps_api_object_delete(obj);
         return false;
     }
@@ -282,24 +290,36 @@ static bool process_neigh_and_add_to_list(int sock, int rt_msg_type, struct nlms
     return true;
 }
 
-static bool read_all_neighbours(cps_api_object_list_t list, uint32_t vrf_id) {
-    int sock = nas_nl_sock_create(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI,false);
+static bool read_all_neighbours(cps_api_object_list_t list, uint32_t vrf_id, int family, uint32_t if_index) {
+    const char *vrf_name = nas_os_get_vrf_name(vrf_id);
+    if (vrf_name == NULL) return false;
+
+    int sock = nas_nl_sock_create(vrf_name, nas_nl_sock_T_NEI,false);
     if (sock<0) return false;
 
-    bool rc = false;
+    /* Let the kernel return only the neighbors of the interface */
+    neigh_filter_t filter = { list, if_index, nl_sock_set_strict_check(sock) };
+    bool rc = true;
     int RANDOM_ID=21323;
-    if (nl_neigh_get_all_request(sock,AF_INET,RANDOM_ID)) {
-        char buff[1024];
-        rc = netlink_tools_process_socket(sock,
-                process_neigh_and_add_to_list,&list,
-                buff,sizeof(buff),&RANDOM_ID,NULL, vrf_id);
+    if (family != AF_INET6) {
+        rc = false;
+        if (nl_neigh_send_dump(sock,AF_INET,if_index,0,RANDOM_ID)) {
+            char buff[1024];
+            rc = netlink_tools_process_socket(sock,
+                    process_neigh_and_add_to_list,&filter,
+                    buff,sizeof(buff),&RANDOM_ID,NULL, vrf_id);
+        }
     }
 
-    if (rc && nl_neigh_get_all_request(sock,AF_INET6,++RANDOM_ID)) {
-        char buff[1024];
-        rc = netlink_tools_process_socket(sock,
-                process_neigh_and_add_to_list,&list,
-                buff,sizeof(buff),&RANDOM_ID,NULL, vrf_id);
+    ++RANDOM_ID;
+    if (rc && (family != AF_INET)) {
+        rc = false;
+        if (nl_neigh_send_dump(sock,AF_INET6,if_index,0,RANDOM_ID)) {
+            char buff[1024];
+            rc = netlink_tools_process_socket(sock,
+                    process_neigh_and_add_to_list,&filter,
+                    buff,sizeof(buff),&RANDOM_ID,NULL, vrf_id);
+        }
     }
 
     close(sock);
@@ -317,8 +337,20 @@ static cps_api_return_code_t db_read_function (void * context, cps_api_get_param
         return cps_api_ret_code_OK;
     }
 
-    /* @@TODO Use the appropriate vrf-id to read the neighbors from non-default VRF context */
-    read_all_neighbours(param->list, NL_DEFAULT_VRF_ID);
+    int family = AF_UNSPEC;
+    uint32_t if_index = 0;
+    uint32_t vrf_id = NAS_DEFAULT_VRF_ID;
+    cps_api_object_t filt = cps_api_object_list_get(param->filters,key_ix);
+    if (filt != NULL) {
+        cps_api_object_attr_t attr = cps_api_object_attr_get(filt, cps_api_if_NEIGH_A_FAMILY);
+        if (attr != NULL) family = cps_api_object_attr_data_u32(attr);
+        attr = cps_api_object_attr_get(filt, cps_api_if_NEIGH_A_IFINDEX);
+        if (attr != NULL) if_index = cps_api_object_attr_data_u32(attr);
+        attr = cps_api_object_attr_get(filt, cps_api_if_NEIGH_A_VRF);
+        if (attr != NULL) vrf_id = cps_api_object_attr_data_u32(attr);
+    }
+
+    read_all_neighbours(param->list, vrf_id, family, if_index);
 
     return rc;
 }
@@ -26,6 +26,7 @@
 
 #include "netlink_tools.h"
 #include "nas_nlmsg.h"
+#include "nas_nlattr_parser.h"
 #include "nas_nlmsg_object_utils.h"
 #include "nas_os_int_utils.h"
 #include "nas_os_interface.h"
@@ -74,6 +75,24 @@
 #define NAS_LINK_MTU_HDR_SIZE 32
 #define NL_MSG_INTF_BUFF_LEN 2048
 
+/* Link attributes consumed by os_interface_to_object and the interface type handlers */
+typedef nas_nl::attr_parser<__IFLA_MAX,
+                            nas_nl::sel<IFLA_ADDRESS, sizeof(hal_mac_addr_t)>,
+                            nas_nl::sel<IFLA_IFNAME, 1>,
+                            nas_nl::sel<IFLA_MTU, sizeof(uint32_t)>,
+                            nas_nl::sel<IFLA_LINK, sizeof(uint32_t)>,
+                            nas_nl::sel<IFLA_MASTER, sizeof(uint32_t)>,
+                            nas_nl::sel<IFLA_PROTINFO>,
+                            nas_nl::sel<IFLA_LINKINFO>> if_attr_parser;
+
+typedef nas_nl::attr_parser<IFLA_INFO_MAX,
+                            nas_nl::sel<IFLA_INFO_KIND, 1>,
+                            nas_nl::sel<IFLA_INFO_DATA>> if_linkinfo_parser;
+
+/* Bridge membership check only needs the master */
+typedef nas_nl::attr_parser<__IFLA_MAX,
+                            nas_nl::sel<IFLA_MASTER, sizeof(uint32_t)>> if_master_parser;
+
 /*
  * API to mask *any* interface publish event.
  * e.g admin-state in case of LAG member port add
@@ -184,9 +203,7 @@ static bool get_if_detail_from_netlink (int sock, int rt_msg_type, struct nlmsgh
     int nla_len = nlmsg_attrlen(hdr,sizeof(*ifmsg));
     struct nlattr *head = nlmsg_attrdata(hdr, sizeof(struct ifinfomsg));
 
-    memset(details->_attrs,0,sizeof(details->_attrs));
-
-    if (nla_parse(details->_attrs,__IFLA_MAX,head,nla_len)!=0) {
+    if (if_master_parser::parse(details->_attrs,head,nla_len)!=0) {
         EV_LOGGING(NAS_OS, ERR,"NL-PARSE","Failed to parse attributes");
         return false;
     }
@@ -316,17 +333,18 @@ t_std_error os_interface_to_object (int rt_msg_type, struct nlmsghdr *hdr, cps_a
     int nla_len = nlmsg_attrlen(hdr,sizeof(*ifmsg));
     struct nlattr *head = nlmsg_attrdata(hdr, sizeof(struct ifinfomsg));
 
-    memset(details._attrs,0,sizeof(details._attrs));
-    memset(details._linkinfo,0,sizeof(details._linkinfo));
     details._info_kind = nullptr;
 
-    if (nla_parse(details._attrs,__IFLA_MAX,head,nla_len)!=0) {
-        EV_LOGGING(NAS_OS,ERR,"NL-PARSE","Failed to parse attributes");
-        return STD_ERR(INTERFACE, FAIL, 0);
+    /* Attributes that are too short are dropped (left NULL), the rest of the event is handled */
+    if (if_attr_parser::parse(details._attrs,head,nla_len)!=0) {
+        EV_LOGGING(NAS_OS,INFO,"NL-PARSE","Short attributes ignored ifindex %d", ifmsg->ifi_index);
     }
 
     if (details._attrs[IFLA_LINKINFO]) {
-        nla_parse_nested(details._linkinfo,IFLA_INFO_MAX,details._attrs[IFLA_LINKINFO]);
+        if_linkinfo_parser::parse_nested(details._linkinfo,details._attrs[IFLA_LINKINFO]);
+    } else {
+        details._linkinfo[IFLA_INFO_KIND] = nullptr;
+        details._linkinfo[IFLA_INFO_DATA] = nullptr;
     }
 
     if (details._attrs[IFLA_LINKINFO] != nullptr && details._linkinfo[IFLA_INFO_KIND]!=nullptr) {
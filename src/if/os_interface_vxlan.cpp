@@ -28,6 +28,7 @@
 #include "dell-base-if.h"
 #include "ds_api_linux_interface.h"
 #include "nas_nlmsg.h"
+#include "nas_nlmsg_builder.h"
 #include "netlink_tools.h"
 #include "nas_os_vxlan.h"
 #include <net/if.h>
@@ -132,18 +133,21 @@ bool INTERFACE::os_interface_vxlan_attrs_handler(if_details *details, cps_api_ob
     return true;
 }
 
-#define NL_MSG_BUFF 4096
-
 static const uint32_t default_vxlan_mac_ageing = 5400;
 
-t_std_error nas_os_create_vxlan_interface(cps_api_object_t obj){
-    char buff[NL_MSG_BUFF];
-    memset(buff,0,sizeof(nlmsghdr)+sizeof(ifinfomsg));
+/* Worst case size of the VXLAN create request */
+typedef nas_nl::msg_size<struct ifinfomsg,
+                         nas_nl::attr_len<IFNAMSIZ>,
+                         nas_nl::nest<nas_nl::attr_len<sizeof("vxlan")>,
+                                      nas_nl::nest<nas_nl::attr<uint32_t>,
+                                                   nas_nl::attr<struct in6_addr>,
+                                                   nas_nl::attr<uint32_t>,
+                                                   nas_nl::attr<uint16_t>>>> vxlan_create_msg_size;
 
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),
-            sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),
-            sizeof(struct ifinfomsg));
+t_std_error nas_os_create_vxlan_interface(cps_api_object_t obj){
+    nas_nl::msg_buffer<vxlan_create_msg_size::value> buff;
+    nas_nl::msg_builder req(buff, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL));
+    struct ifinfomsg *ifmsg = req.family_header<struct ifinfomsg>();
 
     cps_api_object_attr_t name_attr = cps_api_get_key_data(obj, IF_INTERFACES_INTERFACE_NAME);
     cps_api_object_attr_t vni_attr = cps_api_object_attr_get(obj, DELL_IF_IF_INTERFACES_INTERFACE_VNI);
@@ -170,35 +174,38 @@ t_std_error nas_os_create_vxlan_interface(cps_api_object_t obj){
         flags |= IFF_UP;
     }
 
-    nas_os_pack_nl_hdr(nlh, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL));
-    nas_os_pack_if_hdr(ifmsg, AF_PACKET, flags , if_index);
-
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_IFNAME, vxlan_name, (strlen(vxlan_name)+1));
-    struct nlattr *attr_nh = nlmsg_nested_start(nlh, sizeof(buff));
-    attr_nh->nla_len = 0;
-    attr_nh->nla_type = IFLA_LINKINFO;
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_INFO_KIND, info_kind, (strlen(info_kind)+1));
+    if (ifmsg != nullptr) {
+        nas_os_pack_if_hdr(ifmsg, AF_PACKET, flags , if_index);
+    }
 
+    req.put_str(IFLA_IFNAME, vxlan_name);
+    struct nlattr *attr_nh = req.nest_start(IFLA_LINKINFO);
+    req.put_str(IFLA_INFO_KIND, info_kind);
 
-    struct nlattr *attr_nh_data = nlmsg_nested_start(nlh, sizeof(buff));
-    attr_nh_data->nla_len = 0;
-    attr_nh_data->nla_type = IFLA_INFO_DATA;
+    struct nlattr *attr_nh_data = req.nest_start(IFLA_INFO_DATA);
 
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_VXLAN_ID,&vxlan_id, sizeof(vxlan_id));
+    req.put(IFLA_VXLAN_ID, vxlan_id);
     if(ip.af_index == AF_INET){
         memcpy(&ip.u.ipv4,cps_api_object_attr_data_bin(ip_attr),sizeof(ip.u.ipv4));
-        nlmsg_add_attr(nlh,sizeof(buff),IFLA_VXLAN_LOCAL,&ip.u.ipv4, sizeof(ip.u.ipv4));
+        req.put(IFLA_VXLAN_LOCAL, ip.u.ipv4);
     }else{
         memcpy(&ip.u.ipv6,cps_api_object_attr_data_bin(ip_attr),sizeof(ip.u.ipv6));
-        nlmsg_add_attr(nlh,sizeof(buff),IFLA_VXLAN_LOCAL6,&ip.u.ipv6, sizeof(ip.u.ipv6));
+        req.put(IFLA_VXLAN_LOCAL6, ip.u.ipv6);
     }
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_VXLAN_AGEING, &default_vxlan_mac_ageing, sizeof(uint32_t));
+    req.put(IFLA_VXLAN_AGEING, default_vxlan_mac_ageing);
     static const uint16_t dst_port = ntohs(4789);
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_VXLAN_PORT,&dst_port, sizeof(dst_port));
-    nlmsg_nested_end(nlh,attr_nh_data);
-    nlmsg_nested_end(nlh,attr_nh);
+    req.put(IFLA_VXLAN_PORT, dst_port);
+    req.nest_end(attr_nh_data);
+    req.nest_end(attr_nh);
+
+    if (!req.ok()) {
+        EV_LOGGING(NAS_OS, ERR, "NAS-OS-VXLAN", "Vxlan interface %s request exceeds %lu bytes",
+                   vxlan_name, req.capacity());
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK) {
+    nl_link_echo_t link;
+    if(nl_do_link_create_request(NL_DEFAULT_VRF_NAME, req.msg(), buff.data, buff.size, &link) != STD_ERR_OK) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS-VXLAN", "Vxlan interface creation failed in kernel");
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
@@ -209,14 +216,7 @@ t_std_error nas_os_create_vxlan_interface(cps_api_object_t obj){
     if (nas_os_interface_ipv6_config_handle(vxlan_name, false) == false) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS-VXLAN", "Failed: To disable ipv6 on sub interface (%s)", vxlan_name);
     }
-    hal_ifindex_t vxlan_index=0;
-
-    if((vxlan_index = cps_api_interface_name_to_if_index(vxlan_name)) == 0) {
-        EV_LOGGING(NAS_OS, ERR, "NAS-OS-VXLAN", "Error finding the ifindex of vxlan");
-        return (STD_ERR(NAS_OS,FAIL, 0));
-    }
-
-    cps_api_object_attr_add_u32(obj,DELL_BASE_IF_CMN_IF_INTERFACES_INTERFACE_IF_INDEX,vxlan_index);
+    cps_api_object_attr_add_u32(obj,DELL_BASE_IF_CMN_IF_INTERFACES_INTERFACE_IF_INDEX,link.ifindex);
 
     return STD_ERR_OK;
 
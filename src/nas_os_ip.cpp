@@ -812,26 +812,19 @@ cps_api_return_code_t nas_os_ip_addr_read_function (uint32_t ip_family, void *co
 
             memset(buff, 0, NL_MSG_BUFFER_LEN);
 
-            struct ifaddrmsg ifaddr;
-            memset(&ifaddr,0,sizeof(ifaddrmsg));
-
-            ifaddr.ifa_family = ip_family;
-            ifaddr.ifa_index = if_index;
-
             ip_info.ip_family = ip_family;
             ip_info.if_index = if_index;
-            /* TODO - Even after giving the filter NLM_F_MATCH  for family and interface index.
-             * net link returns for all interfcaes in family. Filter is done in software now.
-             * Revisit codein new linux version */
+            /* The kernel filters the dump on the interface index only with the strict check,
+             * older kernels return all the interfaces in the family so filter in software too */
             if ((if_name_attr != NULL) || (if_index_attr != NULL))
                 ip_info.filter_if_index = true;
+            nl_sock_set_strict_check(sock);
 
             ip_info.param = param;
 
             int seq = (int)std_get_uptime(NULL);
 
-            if (nl_send_request(sock, RTM_GETADDR, (NLM_F_REQUEST | NLM_F_ACK | NLM_F_MATCH),
-                                seq, &ifaddr, sizeof(ifaddrmsg))) {
+            if (nl_addr_send_dump(sock, ip_family, if_index, seq)) {
                 netlink_tools_process_socket(sock, nl_get_nas_os_ip_info,
                                              (void *)&ip_info, buff, NL_MSG_BUFFER_LEN, &seq, NULL, vrf_id);
             }
@@ -28,6 +28,7 @@
 #include "standard_netlink_requests.h"
 #include "std_error_codes.h"
 #include "netlink_tools.h"
+#include "netlink_async.h"
 #include "nas_os_l3.h"
 #include "event_log.h"
 #include "cps_api_operation.h"
@@ -51,15 +52,19 @@
 #include <linux/netlink.h>
 #include <sys/socket.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
 
-/* To support the IPv6 route with 256 NHs - 8K buffer is required */
-#define NL_RT_MSG_BUFFER_LEN  8192 /* Buffer len to update the route to kernel */
+#define MAX_NL_NH_ECMP_COUNT  256
+/* Buffer len to update the route to kernel - worst case is the IPv6 route with
+ * MAX_NL_NH_ECMP_COUNT NHs in RTA_MULTIPATH (rtnexthop and RTA_GATEWAY per NH) */
+#define NL_RT_MSG_BUFFER_LEN  (NLMSG_SPACE(sizeof(struct rtmsg)) + RTA_SPACE(HAL_INET6_LEN) + \
+                               RTA_LENGTH(0) + (MAX_NL_NH_ECMP_COUNT * \
+                               (RTNH_ALIGN(sizeof(struct rtnexthop)) + RTA_SPACE(HAL_INET6_LEN))))
 #define NL_RT_RMSG_BUFFER_LEN 1024 /* Buffer len to receive reply for the route from kernel */
 #define NL_RT_NBR_MSG_BUFFER_LEN 1024 /* Buffer len to update the neighbor to kernel */
-#define MAX_NL_NH_ECMP_COUNT  256
 #define MAC_STRING_LEN 20
 
 static char *nl_neigh_op_to_str (nas_rt_msg_type m_type) {
@@ -558,13 +563,16 @@ static t_std_error nas_os_publish_route_nexthop (int rt_msg_type, cps_api_object
 
 /* Ensure for any changes made to nas_os_update_route() related to netlink route
  * processing, nas_os_update_route_nexthop() has to be updated accordingly.
+ *
+ * Build the request of the route in buff. The leaked routes are only published (local
+ * is set, there is no request), repeat_delete is set for the IPv6 deletes that are
+ * repeated for each nexthop.
  */
-cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type m_type)
+static cps_api_return_code_t nas_os_route_msg_build (cps_api_object_t obj, nas_rt_msg_type m_type,
+                                                     char *buff, size_t len, bool *local,
+                                                     bool *repeat_delete)
 {
-    static char buff[NL_RT_MSG_BUFFER_LEN], buff1[NL_RT_RMSG_BUFFER_LEN]; // Allocate from DS
     char            addr_str[INET6_ADDRSTRLEN];
-    int         nhm_count = 0;
-    bool        repeat_delete = false;
 
     memset(buff,0,sizeof(struct nlmsghdr));
 
@@ -584,6 +592,10 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
 
     uint32_t nhc = 0;
     if (nh_count != CPS_API_ATTR_NULL) nhc = cps_api_object_attr_data_u32(nh_count);
+    if (nhc > MAX_NL_NH_ECMP_COUNT) {
+        EV_LOGGING(NAS_OS, ERR, "ROUTE-UPD", "NH count %d exceeds the max. %d", nhc, MAX_NL_NH_ECMP_COUNT);
+        return cps_api_ret_code_ERR;
+    }
 
     /* Check whether route and NH are in the different VRF, if yes, it's leaked route,
      * do local publish to handle it in the NAS-L3 for NPU programming only. */
@@ -595,7 +607,8 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
                                  obj, ((m_type == NAS_RT_SET) ? true : false));
             nas_os_publish_leaked_route((m_type == NAS_RT_DEL)?RTM_DELROUTE:RTM_NEWROUTE,
                                         obj, false);
-            return STD_ERR_OK;
+            *local = true;
+            return cps_api_ret_code_OK;
         }
     }
     uint32_t spl_nh_type = 0;
@@ -613,8 +626,8 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
     }
 
     struct nlmsghdr *nlh = (struct nlmsghdr *)
-                         nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct rtmsg * rm = (struct rtmsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct rtmsg));
+                         nlmsg_reserve((struct nlmsghdr *)buff,len,sizeof(struct nlmsghdr));
+    struct rtmsg * rm = (struct rtmsg *) nlmsg_reserve(nlh,len,sizeof(struct rtmsg));
     memset(rm, 0, sizeof(struct rtmsg));
 
     uint16_t flags = nas_os_get_nl_flags(m_type,true);
@@ -665,7 +678,7 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
     rm->rtm_family = (unsigned char) cps_api_object_attr_data_u32(af);
 
     uint32_t addr_len = (rm->rtm_family == AF_INET)?HAL_INET4_LEN:HAL_INET6_LEN;
-    nlmsg_add_attr(nlh,sizeof(buff),RTA_DST,cps_api_object_attr_data_bin(prefix),addr_len);
+    nlmsg_add_attr(nlh,len,RTA_DST,cps_api_object_attr_data_bin(prefix),addr_len);
 
     EV_LOGGING (NAS_OS,INFO, "ROUTE-UPD","VRF:%s NH count:%d family:%s msg:%s for prefix:%s len:%d proto:%d scope:%d type:%d",
                 (vrf_name ? vrf_name : ""), nhc,
@@ -681,7 +694,7 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
         const int ids_len = sizeof(ids)/sizeof(*ids);
         cps_api_object_attr_t gw = cps_api_object_e_get(obj,ids,ids_len);
         if (gw != CPS_API_ATTR_NULL) {
-            nlmsg_add_attr(nlh,sizeof(buff),RTA_GATEWAY,cps_api_object_attr_data_bin(gw),addr_len);
+            nlmsg_add_attr(nlh,len,RTA_GATEWAY,cps_api_object_attr_data_bin(gw),addr_len);
             rm->rtm_scope = RT_SCOPE_UNIVERSE; // set scope to universe when gateway is specified
             ids[2] = BASE_ROUTE_OBJ_ENTRY_NH_LIST_FLAGS;
             cps_api_object_attr_t nh_flags_attr = cps_api_object_e_get(obj,ids,ids_len);
@@ -729,7 +742,7 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
 
             EV_LOGGING(NAS_OS, INFO,"ROUTE-UPD","out-intf: %d scope:%d",
                    (int)cps_api_object_attr_data_u32(gwix), rm->rtm_scope);
-            nas_nl_add_attr_int(nlh,sizeof(buff),RTA_OIF,gwix);
+            nas_nl_add_attr_int(nlh,len,RTA_OIF,gwix);
         } else {
             ids[2] = BASE_ROUTE_OBJ_ENTRY_NH_LIST_IFNAME;
             cps_api_object_attr_t gw_if_name = cps_api_object_e_get(obj,ids,ids_len);
@@ -781,22 +794,22 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
 
                 EV_LOGGING(NAS_OS,INFO,"ROUTE-UPD","out-intf: %s(%d)",
                            intf_ctrl.if_name, intf_ctrl.if_index);
-                nlmsg_add_attr(nlh,sizeof(buff),RTA_OIF,&(intf_ctrl.if_index), sizeof(intf_ctrl.if_index));
+                nlmsg_add_attr(nlh,len,RTA_OIF,&(intf_ctrl.if_index), sizeof(intf_ctrl.if_index));
             }
         }
         ids[2] = BASE_ROUTE_OBJ_ENTRY_NH_LIST_WEIGHT;
         cps_api_object_attr_t weight = cps_api_object_e_get(obj,ids,ids_len);
-        if (weight != CPS_API_ATTR_NULL) nas_nl_add_attr_int(nlh,sizeof(buff),RTA_PRIORITY,weight);
+        if (weight != CPS_API_ATTR_NULL) nas_nl_add_attr_int(nlh,len,RTA_PRIORITY,weight);
 
     } else if (nhc > 1){
-        struct nlattr * attr_nh = nlmsg_nested_start(nlh, sizeof(buff));
+        struct nlattr * attr_nh = nlmsg_nested_start(nlh, len);
 
         attr_nh->nla_len = 0;
         attr_nh->nla_type = RTA_MULTIPATH;
         size_t ix = 0;
         for (ix = 0; ix < nhc ; ++ix) {
             struct rtnexthop * rtnh =
-                (struct rtnexthop * )nlmsg_reserve(nlh,sizeof(buff), sizeof(struct rtnexthop));
+                (struct rtnexthop * )nlmsg_reserve(nlh,len, sizeof(struct rtnexthop));
             memset(rtnh,0,sizeof(*rtnh));
 
             cps_api_attr_id_t ids[3] = { BASE_ROUTE_OBJ_ENTRY_NH_LIST,
@@ -804,7 +817,7 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
             const int ids_len = sizeof(ids)/sizeof(*ids);
             cps_api_object_attr_t attr = cps_api_object_e_get(obj,ids,ids_len);
             if (attr != CPS_API_ATTR_NULL) {
-                nlmsg_add_attr(nlh,sizeof(buff),RTA_GATEWAY,
+                nlmsg_add_attr(nlh,len,RTA_GATEWAY,
                                cps_api_object_attr_data_bin(attr),addr_len);
                 rm->rtm_scope = RT_SCOPE_UNIVERSE; // set scope to universe when gateway is specified
                 ids[2] = BASE_ROUTE_OBJ_ENTRY_NH_LIST_FLAGS;
@@ -885,74 +898,121 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
          * v6 routes in kernel until the kernel is fixed for removing all
          * nexthops with just one route delete
          */
-        repeat_delete = true;
-        nhm_count = MAX_NL_NH_ECMP_COUNT;
+        *repeat_delete = true;
     }
+    return cps_api_ret_code_OK;
+}
 
-    t_std_error rc;
-    int err_code;
+/* State of a route request across the requests sent again for its result */
+typedef struct {
+    bool repeat_delete;
+    int nhm_count;
+    bool replace;               /* sent again as a replace, its result is only logged */
+} nas_os_route_req_state_t;
 
-    do  {
+static void nas_os_route_req_state_init (nas_os_route_req_state_t *state, bool repeat_delete)
+{
+    state->repeat_delete = repeat_delete;
+    state->nhm_count = (repeat_delete ? MAX_NL_NH_ECMP_COUNT : 0);
+    state->replace = false;
+}
+
+/* Handle the result rc of the route request already sent, returns true if the request
+ * (nlh, updated) is to be sent again and its result handled the same way. The IPv6
+ * deletes are sent again until the route is removed.
+ */
+static bool nas_os_route_msg_step (cps_api_object_t obj, struct nlmsghdr *nlh,
+                                   nas_os_route_req_state_t *state, t_std_error *rc)
+{
+    struct rtmsg *rm = (struct rtmsg *)NLMSG_DATA(nlh);
+    int err_code = STD_ERR_EXT_PRIV (*rc);
 
-        uint16_t rt_flags = nlh->nlmsg_flags;
-        rc = nl_do_set_request((vrf_name ? vrf_name : NAS_DEFAULT_VRF_NAME), nas_nl_sock_T_ROUTE,nlh,buff1,sizeof(buff1));
-        nhm_count--;
-        err_code = STD_ERR_EXT_PRIV (rc);
-        EV_LOGGING(NAS_OS, INFO,"ROUE_UPD","Netlink error_code %d flags:0x%x", err_code, rt_flags);
+    if (state->replace) {
+        EV_LOGGING(NAS_OS, INFO,"ROUE_UPD","Route replace - Netlink error_code %d", err_code);
+        *rc = STD_ERR_OK;
+        return false;
+    }
+
+    state->nhm_count--;
+    EV_LOGGING(NAS_OS, INFO,"ROUE_UPD","Netlink error_code %d flags:0x%x", err_code, nlh->nlmsg_flags);
+    /*
+     * Return success if the error is exist, in case of addition, or
+     * no-exist, in case of deletion. This is because, kernel might have
+     * deleted the route entries (when interface goes down) but has not sent netlink
+     * events for those routes and RTM is trying to delete after that.
+     * Similarly, during ip address configuration, kernel may add the routes
+     * before RTM tries to configure kernel.
+     *
+     */
+    if(err_code == ESRCH || err_code == EEXIST ) {
+        EV_LOGGING(NAS_OS, INFO,"ROUTE-UPD","No such process or Entry already exists, error_code= %d",err_code);
         /*
-         * Return success if the error is exist, in case of addition, or
-         * no-exist, in case of deletion. This is because, kernel might have
-         * deleted the route entries (when interface goes down) but has not sent netlink
-         * events for those routes and RTM is trying to delete after that.
-         * Similarly, during ip address configuration, kernel may add the routes
-         * before RTM tries to configure kernel.
-         *
+         * Kernel may or may not have the routes but NAS routing needs to be informed
+         * as is from kernel netlink to program NPU for the route addition/deletion to
+         * ensure stale routes are cleaned
          */
-        if(err_code == ESRCH || err_code == EEXIST ) {
-            EV_LOGGING(NAS_OS, INFO,"ROUTE-UPD","No such process or Entry already exists, error_code= %d",err_code);
-            /*
-             * Kernel may or may not have the routes but NAS routing needs to be informed
-             * as is from kernel netlink to program NPU for the route addition/deletion to
-             * ensure stale routes are cleaned
-             */
-            if(err_code == ESRCH) {
-                nas_os_publish_route(RTM_DELROUTE, obj, false);
-            } else {
-                nas_os_publish_route(RTM_NEWROUTE, obj, false);
-                /* If the route already exists, replace the route
-                 * since there can be a NH difference (NH with IP or NH with interface) for a route.
-                 * For example, if we configure the IP on the oper. down interface,
-                 * kernel generates the connected route and NAS-L3 programs that route
-                 * into the HW, but RTM wont download that route if the interface is oper. down.
-                 * When the same route is reachable via some next-hop IP, RTM would program
-                 * with op - create and kernel is throwing EEXIST error though there is a difference
-                 * in the NH i.e connected route with link down (oper. down) created
-                 * from oper. down in kernel and route with NH IP (programmed by RTM).
-                 * To overcome this kernel limitation, replacing the route given by RTM
-                 * for IPv4 route. Note: IPv6 route case, we dont get the EEXIST
-                 * error. */
-                if (rm->rtm_family == AF_INET) {
-                    nlh->nlmsg_flags &= ~NLM_F_EXCL;
-                    nlh->nlmsg_flags |= NLM_F_REPLACE;
-                    rc = nl_do_set_request((vrf_name ? vrf_name : NAS_DEFAULT_VRF_NAME),
-                                           nas_nl_sock_T_ROUTE,nlh,buff1,sizeof(buff1));
-                    err_code = STD_ERR_EXT_PRIV (rc);
-                    EV_LOGGING(NAS_OS, INFO,"ROUE_UPD","Route replace - Netlink error_code %d",
-                               err_code);
-                }
-            }
-
-            rc = STD_ERR_OK;
-            repeat_delete = false;
-        } else if (repeat_delete && (err_code == ENOENT)) {
-            rc = STD_ERR_OK;
-            repeat_delete = false;
+        *rc = STD_ERR_OK;
+        state->repeat_delete = false;
+        if(err_code == ESRCH) {
+            nas_os_publish_route(RTM_DELROUTE, obj, false);
+            return false;
         }
+        nas_os_publish_route(RTM_NEWROUTE, obj, false);
+        /* If the route already exists, replace the route
+         * since there can be a NH difference (NH with IP or NH with interface) for a route.
+         * For example, if we configure the IP on the oper. down interface,
+         * kernel generates the connected route and NAS-L3 programs that route
+         * into the HW, but RTM wont download that route if the interface is oper. down.
+         * When the same route is reachable via some next-hop IP, RTM would program
+         * with op - create and kernel is throwing EEXIST error though there is a difference
+         * in the NH i.e connected route with link down (oper. down) created
+         * from oper. down in kernel and route with NH IP (programmed by RTM).
+         * To overcome this kernel limitation, replacing the route given by RTM
+         * for IPv4 route. Note: IPv6 route case, we dont get the EEXIST
+         * error. */
+        if (rm->rtm_family != AF_INET) return false;
+        nlh->nlmsg_flags &= ~NLM_F_EXCL;
+        nlh->nlmsg_flags |= NLM_F_REPLACE;
+        state->replace = true;
+        return true;
+    } else if (state->repeat_delete && (err_code == ENOENT)) {
+        *rc = STD_ERR_OK;
+        state->repeat_delete = false;
+    }
 
-    } while ((repeat_delete == true) && (nhm_count > 0));
+    return (state->repeat_delete && (state->nhm_count > 0));
+}
 
+/* Handle the result of the route request, rc is the result of the request already sent */
+static t_std_error nas_os_route_msg_result (cps_api_object_t obj, struct nlmsghdr *nlh,
+                                            bool repeat_delete, t_std_error rc)
+{
+    char buff1[NL_RT_RMSG_BUFFER_LEN];
+    const char *vrf_name = cps_api_object_get_data(obj,BASE_ROUTE_OBJ_VRF_NAME);
+    nas_os_route_req_state_t state;
+
+    nas_os_route_req_state_init(&state, repeat_delete);
+    while (nas_os_route_msg_step(obj, nlh, &state, &rc)) {
+        rc = nl_do_set_request((vrf_name ? vrf_name : NAS_DEFAULT_VRF_NAME), nas_nl_sock_T_ROUTE,
+                               nlh,buff1,sizeof(buff1));
+    }
     return rc;
+}
 
+cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type m_type)
+{
+    char buff[NL_RT_MSG_BUFFER_LEN], buff1[NL_RT_RMSG_BUFFER_LEN];
+    bool local = false;
+    bool repeat_delete = false;
+
+    cps_api_return_code_t ret = nas_os_route_msg_build(obj, m_type, buff, sizeof(buff), &local, &repeat_delete);
+    if ((ret != cps_api_ret_code_OK) || local) return ret;
+
+    const char *vrf_name = cps_api_object_get_data(obj,BASE_ROUTE_OBJ_VRF_NAME);
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buff;
+    t_std_error rc = nl_do_set_request((vrf_name ? vrf_name : NAS_DEFAULT_VRF_NAME), nas_nl_sock_T_ROUTE,
+                                       nlh,buff1,sizeof(buff1));
+    return nas_os_route_msg_result(obj, nlh, repeat_delete, rc);
 }
 
 /* This function is used to process the config for route nexthop append/delete.
@@ -961,7 +1021,7 @@ cps_api_return_code_t nas_os_update_route (cps_api_object_t obj, nas_rt_msg_type
  */
 t_std_error nas_os_update_route_nexthop (cps_api_object_t obj)
 {
-    static char buff[NL_RT_MSG_BUFFER_LEN], buff1[NL_RT_RMSG_BUFFER_LEN]; // Allocate from DS
+    char buff[NL_RT_MSG_BUFFER_LEN], buff1[NL_RT_RMSG_BUFFER_LEN];
     char        addr_str[INET6_ADDRSTRLEN];
     uint32_t    nhc = 0;
     int         op = 0;
@@ -1000,6 +1060,10 @@ t_std_error nas_os_update_route_nexthop (cps_api_object_t obj)
     }
 
     nhc = cps_api_object_attr_data_u32(nh_count);
+    if (nhc > MAX_NL_NH_ECMP_COUNT) {
+        EV_LOGGING(NAS_OS, ERR, "ROUTE-NH-UPD", "NH count %d exceeds the max. %d", nhc, MAX_NL_NH_ECMP_COUNT);
+        return (STD_ERR(NAS_OS, FAIL, 0));
+    }
 
     struct nlmsghdr *nlh = (struct nlmsghdr *)
                          nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
@@ -1260,9 +1324,10 @@ t_std_error nas_os_del_route (cps_api_object_t obj)
     return STD_ERR_OK;
 }
 
-cps_api_return_code_t nas_os_update_neighbor(cps_api_object_t obj, nas_rt_msg_type m_type)
+/* Build the request of the neighbor in buff */
+static cps_api_return_code_t nas_os_neigh_msg_build(cps_api_object_t obj, nas_rt_msg_type m_type,
+                                                    char *buff, size_t len)
 {
-    char buff[NL_RT_NBR_MSG_BUFFER_LEN];
     hal_mac_addr_t mac_addr;
     char            addr_str[INET6_ADDRSTRLEN];
     memset(buff,0,sizeof(struct nlmsghdr));
@@ -1285,8 +1350,8 @@ cps_api_return_code_t nas_os_update_neighbor(cps_api_object_t obj, nas_rt_msg_ty
     }
 
     struct nlmsghdr *nlh = (struct nlmsghdr *)
-                         nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ndmsg * ndm = (struct ndmsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ndmsg));
+                         nlmsg_reserve((struct nlmsghdr *)buff,len,sizeof(struct nlmsghdr));
+    struct ndmsg * ndm = (struct ndmsg *) nlmsg_reserve(nlh,len,sizeof(struct ndmsg));
     memset(ndm, 0, sizeof(struct ndmsg));
 
     if (if_index != CPS_API_ATTR_NULL) {
@@ -1369,21 +1434,19 @@ cps_api_return_code_t nas_os_update_neighbor(cps_api_object_t obj, nas_rt_msg_ty
     ndm->ndm_type = RTN_UNICAST;
 
     uint32_t addr_len = (ndm->ndm_family == AF_INET)?HAL_INET4_LEN:HAL_INET6_LEN;
-    nlmsg_add_attr(nlh,sizeof(buff),NDA_DST,cps_api_object_attr_data_bin(ip),addr_len);
+    nlmsg_add_attr(nlh,len,NDA_DST,cps_api_object_attr_data_bin(ip),addr_len);
 
     /* Dont set the MAC for ARP resolve case */
     if (!(ndm->ndm_flags & NTF_USE) && (mac != CPS_API_ATTR_NULL)) {
         std_string_to_mac(&mac_addr,cps_api_object_attr_data_bin(mac),
                           cps_api_object_attr_len(mac));
-        nlmsg_add_attr(nlh,sizeof(buff),NDA_LLADDR, &mac_addr, HAL_MAC_ADDR_LEN);
+        nlmsg_add_attr(nlh,len,NDA_LLADDR, &mac_addr, HAL_MAC_ADDR_LEN);
     }
 
-    t_std_error rc = nl_do_set_request((vrf_name ? vrf_name : NAS_DEFAULT_VRF_NAME), nas_nl_sock_T_NEI,nlh,buff,sizeof(buff));
-    int err_code = STD_ERR_EXT_PRIV (rc);
     char mac_buff[MAC_STRING_LEN];
     memset(mac_buff, '\0', sizeof(mac_buff));
     std_mac_to_string((const hal_mac_addr_t *)mac_addr ,mac_buff,sizeof(mac_buff));
-    EV_LOGGING(NAS_OS, INFO,"NEIGH-UPD","Operation:%s(%d) VRF:%s family:%s NH:%s MAC:%s out-intf:%d state:%s(0x%x) rc:%d",
+    EV_LOGGING(NAS_OS, INFO,"NEIGH-UPD","Operation:%s(%d) VRF:%s family:%s NH:%s MAC:%s out-intf:%d state:%s(0x%x)",
                nl_neigh_op_to_str(m_type), m_type,
                (vrf_name ? vrf_name : ""),
                ((ndm->ndm_family == AF_INET) ? "IPv4" : "IPv6"),
@@ -1391,10 +1454,35 @@ cps_api_return_code_t nas_os_update_neighbor(cps_api_object_t obj, nas_rt_msg_ty
                 (inet_ntop(ndm->ndm_family, cps_api_object_attr_data_bin(ip), addr_str, INET_ADDRSTRLEN)) :
                 (inet_ntop(ndm->ndm_family, cps_api_object_attr_data_bin(ip), addr_str, INET6_ADDRSTRLEN))),
                mac_buff, ndm->ndm_ifindex,
-               ((ndm->ndm_state == NUD_PERMANENT) ? "Static" : "Dynamic"), ndm->ndm_state, err_code);
+               ((ndm->ndm_state == NUD_PERMANENT) ? "Static" : "Dynamic"), ndm->ndm_state);
+    return cps_api_ret_code_OK;
+}
+
+/* Handle the result of the neighbor request, rc is the result of the request already sent */
+static t_std_error nas_os_neigh_msg_result(cps_api_object_t obj, struct nlmsghdr *nlh, t_std_error rc)
+{
+    const char *vrf_name = cps_api_object_get_data(obj,BASE_ROUTE_OBJ_VRF_NAME);
+    struct ndmsg *ndm = (struct ndmsg *)NLMSG_DATA(nlh);
+    EV_LOGGING(NAS_OS, INFO,"NEIGH-UPD","VRF:%s family:%s out-intf:%d type:%d rc:%d",
+               (vrf_name ? vrf_name : ""), ((ndm->ndm_family == AF_INET) ? "IPv4" : "IPv6"),
+               ndm->ndm_ifindex, nlh->nlmsg_type, STD_ERR_EXT_PRIV (rc));
     return rc;
 }
 
+cps_api_return_code_t nas_os_update_neighbor(cps_api_object_t obj, nas_rt_msg_type m_type)
+{
+    char buff[NL_RT_NBR_MSG_BUFFER_LEN], buff1[NL_RT_RMSG_BUFFER_LEN];
+
+    cps_api_return_code_t ret = nas_os_neigh_msg_build(obj, m_type, buff, sizeof(buff));
+    if (ret != cps_api_ret_code_OK) return ret;
+
+    const char *vrf_name = cps_api_object_get_data(obj,BASE_ROUTE_OBJ_VRF_NAME);
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buff;
+    t_std_error rc = nl_do_set_request((vrf_name ? vrf_name : NAS_DEFAULT_VRF_NAME), nas_nl_sock_T_NEI,nlh,
+                                       buff1,sizeof(buff1));
+    return nas_os_neigh_msg_result(obj, nlh, rc);
+}
+
 t_std_error nas_os_add_neighbor (cps_api_object_t obj)
 {
 
@@ -1458,6 +1546,296 @@ t_std_error nas_os_set_neighbor_state (cps_api_object_t obj)
     return STD_ERR_OK;
 }
 
+/* Lists of routes and neighbors - the requests of the objects are built one after the
+ * other and sent in batches (nl_do_batch_request), the result of each request is then
+ * handled as for a single object. A batch has the requests of one VRF, and for the routes
+ * at most one request of a route since the result of a route can send it again.
+ */
+typedef struct {
+    char msgs[NL_BATCH_MAX_SEND_LEN];       /* requests of the batch, at aligned offsets - a
+                                             * request (NL_RT_MSG_BUFFER_LEN) always fits */
+    nl_batch_req_t reqs[NL_BATCH_MAX_MSGS];
+    size_t obj_ix[NL_BATCH_MAX_MSGS];       /* object of each request in the list */
+    bool repeat_delete[NL_BATCH_MAX_MSGS];  /* route requests only */
+    size_t count;
+    size_t used;
+    const char *vrf_name;
+    cps_api_object_list_t objs;
+    nas_nl_sock_TYPES sock_type;
+    char *ack;                              /* ACKs carry back the failed requests */
+    size_t ack_len;
+    t_std_error *results;
+    t_std_error rc;                         /* result of the first failed object */
+} nas_os_l3_batch_t;
+
+static void nas_os_l3_batch_result (nas_os_l3_batch_t *batch, size_t ix, t_std_error rc)
+{
+    if (batch->results != NULL) batch->results[ix] = rc;
+    if ((rc != STD_ERR_OK) && (batch->rc == STD_ERR_OK)) batch->rc = rc;
+}
+
+static void nas_os_l3_batch_send (nas_os_l3_batch_t *batch)
+{
+    if (batch->count == 0) return;
+
+    nl_do_batch_request(batch->vrf_name, batch->sock_type, batch->reqs, batch->count,
+                        batch->ack, batch->ack_len, NULL);
+    size_t ix = 0;
+    for ( ; ix < batch->count; ++ix) {
+        int err_code = batch->reqs[ix].error_code;
+        t_std_error rc = (err_code == 0) ? STD_ERR_OK : STD_ERR(ROUTE,FAIL,err_code);
+        cps_api_object_t obj = cps_api_object_list_get(batch->objs, batch->obj_ix[ix]);
+        rc = (batch->sock_type == nas_nl_sock_T_NEI) ?
+            nas_os_neigh_msg_result(obj, batch->reqs[ix].msg, rc) :
+            nas_os_route_msg_result(obj, batch->reqs[ix].msg, batch->repeat_delete[ix], rc);
+        nas_os_l3_batch_result(batch, batch->obj_ix[ix], rc);
+    }
+    batch->count = 0;
+    batch->used = 0;
+}
+
+/* Requests of the same route - the destination is the first attribute */
+static bool nas_os_route_msg_same (struct nlmsghdr *nlh1, struct nlmsghdr *nlh2)
+{
+    struct rtmsg *rm1 = (struct rtmsg *)NLMSG_DATA(nlh1);
+    struct rtmsg *rm2 = (struct rtmsg *)NLMSG_DATA(nlh2);
+    if ((rm1->rtm_family != rm2->rtm_family) || (rm1->rtm_dst_len != rm2->rtm_dst_len) ||
+        (rm1->rtm_table != rm2->rtm_table)) {
+        return false;
+    }
+    struct rtattr *dst1 = RTM_RTA(rm1);
+    struct rtattr *dst2 = RTM_RTA(rm2);
+    return ((dst1->rta_len == dst2->rta_len) &&
+            (memcmp(RTA_DATA(dst1), RTA_DATA(dst2), RTA_PAYLOAD(dst1)) == 0));
+}
+
+static t_std_error nas_os_l3_update_list (cps_api_object_list_t objs, nas_rt_msg_type m_type,
+                                          nas_nl_sock_TYPES sock_type, t_std_error *results)
+{
+    size_t msg_len = (sock_type == nas_nl_sock_T_NEI) ? NL_RT_NBR_MSG_BUFFER_LEN : NL_RT_MSG_BUFFER_LEN;
+    nas_os_l3_batch_t *batch = (nas_os_l3_batch_t *)calloc(1, sizeof(nas_os_l3_batch_t));
+    char *buff = (char *)malloc(msg_len);
+    char *ack = (char *)malloc(msg_len + NL_RT_RMSG_BUFFER_LEN);
+    if ((batch == NULL) || (buff == NULL) || (ack == NULL)) {
+        EV_LOGGING(NAS_OS, ERR, "L3-LIST", "Failed to allocate the batch");
+        free(batch);
+        free(buff);
+        free(ack);
+        return STD_ERR(NAS_OS, FAIL, 0);
+    }
+    batch->objs = objs;
+    batch->sock_type = sock_type;
+    batch->ack = ack;
+    batch->ack_len = msg_len + NL_RT_RMSG_BUFFER_LEN;
+    batch->results = results;
+    batch->rc = STD_ERR_OK;
+
+    size_t count = cps_api_object_list_size(objs);
+    size_t ix = 0;
+    for ( ; ix < count; ++ix) {
+        cps_api_object_t obj = cps_api_object_list_get(objs, ix);
+        const char *vrf_name = cps_api_object_get_data(obj,BASE_ROUTE_OBJ_VRF_NAME);
+        if (vrf_name == NULL) vrf_name = NAS_DEFAULT_VRF_NAME;
+        bool local = false;
+        bool repeat_delete = false;
+
+        memset(buff,0,sizeof(struct nlmsghdr));
+        cps_api_return_code_t ret = (sock_type == nas_nl_sock_T_NEI) ?
+            nas_os_neigh_msg_build(obj, m_type, buff, msg_len) :
+            nas_os_route_msg_build(obj, m_type, buff, msg_len, &local, &repeat_delete);
+        if (ret != cps_api_ret_code_OK) {
+            nas_os_l3_batch_result(batch, ix, STD_ERR(NAS_OS, FAIL, 0));
+            continue;
+        }
+        if (local) {
+            /* Published in the order of the list */
+            nas_os_l3_batch_send(batch);
+            nas_os_l3_batch_result(batch, ix, STD_ERR_OK);
+            continue;
+        }
+
+        struct nlmsghdr *nlh = (struct nlmsghdr *)buff;
+        bool flush = ((batch->count == NL_BATCH_MAX_MSGS) ||
+                      ((batch->used + NLMSG_ALIGN(nlh->nlmsg_len)) > sizeof(batch->msgs)) ||
+                      ((batch->count > 0) && (strncmp(batch->vrf_name, vrf_name, NAS_VRF_NAME_SZ) != 0)));
+        size_t req_ix = 0;
+        for ( ; !flush && (sock_type == nas_nl_sock_T_ROUTE) && (req_ix < batch->count); ++req_ix) {
+            flush = nas_os_route_msg_same(batch->reqs[req_ix].msg, nlh);
+        }
+        if (flush) nas_os_l3_batch_send(batch);
+
+        struct nlmsghdr *req = (struct nlmsghdr *)(batch->msgs + batch->used);
+        memcpy(req, nlh, nlh->nlmsg_len);
+        batch->used += NLMSG_ALIGN(nlh->nlmsg_len);
+        batch->reqs[batch->count].msg = req;
+        batch->obj_ix[batch->count] = ix;
+        batch->repeat_delete[batch->count] = repeat_delete;
+        batch->vrf_name = vrf_name;
+        ++batch->count;
+    }
+    nas_os_l3_batch_send(batch);
+
+    t_std_error rc = batch->rc;
+    free(batch);
+    free(buff);
+    free(ack);
+    return rc;
+}
+
+static t_std_error nas_os_update_route_list (cps_api_object_list_t objs, nas_rt_msg_type m_type,
+                                             t_std_error *results)
+{
+    return nas_os_l3_update_list(objs, m_type, nas_nl_sock_T_ROUTE, results);
+}
+
+static t_std_error nas_os_update_neighbor_list (cps_api_object_list_t objs, nas_rt_msg_type m_type,
+                                                t_std_error *results)
+{
+    return nas_os_l3_update_list(objs, m_type, nas_nl_sock_T_NEI, results);
+}
+
+t_std_error nas_os_add_route_list (cps_api_object_list_t objs, t_std_error *results)
+{
+    return nas_os_update_route_list(objs, NAS_RT_ADD, results);
+}
+
+t_std_error nas_os_set_route_list (cps_api_object_list_t objs, t_std_error *results)
+{
+    return nas_os_update_route_list(objs, NAS_RT_SET, results);
+}
+
+t_std_error nas_os_del_route_list (cps_api_object_list_t objs, t_std_error *results)
+{
+    return nas_os_update_route_list(objs, NAS_RT_DEL, results);
+}
+
+t_std_error nas_os_add_neighbor_list (cps_api_object_list_t objs, t_std_error *results)
+{
+    return nas_os_update_neighbor_list(objs, NAS_RT_ADD, results);
+}
+
+t_std_error nas_os_set_neighbor_list (cps_api_object_list_t objs, t_std_error *results)
+{
+    return nas_os_update_neighbor_list(objs, NAS_RT_SET, results);
+}
+
+t_std_error nas_os_del_neighbor_list (cps_api_object_list_t objs, t_std_error *results)
+{
+    return nas_os_update_neighbor_list(objs, NAS_RT_DEL, results);
+}
+
+/* Asynchronous route and neighbor writes - the request is sent from the netlink writer
+ * thread and its result handled there as for a single object, a route request that is
+ * to be sent again for its result is submitted again before the caller is called back.
+ */
+typedef struct {
+    cps_api_object_t obj;                   /* copy of the object, the result can publish it */
+    nas_nl_sock_TYPES sock_type;
+    nas_os_route_req_state_t state;         /* route requests only */
+    nas_os_async_done_fn done;
+    void *context;
+    char msg[];
+} nas_os_l3_async_req_t;
+
+static void nas_os_l3_async_req_free (nas_os_l3_async_req_t *req)
+{
+    if (req->obj != NULL) cps_api_object_delete(req->obj);
+    free(req);
+}
+
+static void nas_os_l3_async_done (void *context, int error_code)
+{
+    nas_os_l3_async_req_t *req = (nas_os_l3_async_req_t *)context;
+    struct nlmsghdr *nlh = (struct nlmsghdr *)req->msg;
+    t_std_error rc = (error_code == 0) ? STD_ERR_OK : STD_ERR(ROUTE,FAIL,error_code);
+
+    if (req->sock_type == nas_nl_sock_T_NEI) {
+        rc = nas_os_neigh_msg_result(req->obj, nlh, rc);
+    } else if (nas_os_route_msg_step(req->obj, nlh, &req->state, &rc)) {
+        const char *vrf_name = cps_api_object_get_data(req->obj,BASE_ROUTE_OBJ_VRF_NAME);
+        rc = nl_async_submit((vrf_name ? vrf_name : NAS_DEFAULT_VRF_NAME), nas_nl_sock_T_ROUTE,
+                             nlh, nas_os_l3_async_done, req);
+        if (rc == STD_ERR_OK) return;
+    }
+
+    if (req->done != NULL) req->done(req->context, rc);
+    nas_os_l3_async_req_free(req);
+}
+
+static t_std_error nas_os_l3_update_async (cps_api_object_t obj, nas_rt_msg_type m_type,
+                                           nas_nl_sock_TYPES sock_type, nas_os_async_done_fn done,
+                                           void *context)
+{
+    size_t msg_len = (sock_type == nas_nl_sock_T_NEI) ? NL_RT_NBR_MSG_BUFFER_LEN : NL_RT_MSG_BUFFER_LEN;
+    nas_os_l3_async_req_t *req = (nas_os_l3_async_req_t *)calloc(1, sizeof(nas_os_l3_async_req_t) + msg_len);
+    if (req == NULL) {
+        EV_LOGGING(NAS_OS, ERR, "L3-ASYNC", "Failed to allocate the request");
+        return STD_ERR(NAS_OS, FAIL, 0);
+    }
+    req->obj = cps_api_object_create();
+    if ((req->obj == NULL) || !cps_api_object_clone(req->obj, obj)) {
+        EV_LOGGING(NAS_OS, ERR, "L3-ASYNC", "Failed to copy the object");
+        nas_os_l3_async_req_free(req);
+        return STD_ERR(NAS_OS, FAIL, 0);
+    }
+    req->sock_type = sock_type;
+    req->done = done;
+    req->context = context;
+
+    bool local = false;
+    bool repeat_delete = false;
+    cps_api_return_code_t ret = (sock_type == nas_nl_sock_T_NEI) ?
+        nas_os_neigh_msg_build(req->obj, m_type, req->msg, msg_len) :
+        nas_os_route_msg_build(req->obj, m_type, req->msg, msg_len, &local, &repeat_delete);
+    if ((ret != cps_api_ret_code_OK) || local) {
+        nas_os_l3_async_req_free(req);
+        if (ret != cps_api_ret_code_OK) return STD_ERR(NAS_OS, FAIL, 0);
+        /* Nothing to write to the kernel */
+        if (done != NULL) done(context, STD_ERR_OK);
+        return STD_ERR_OK;
+    }
+    nas_os_route_req_state_init(&req->state, repeat_delete);
+
+    const char *vrf_name = cps_api_object_get_data(req->obj,BASE_ROUTE_OBJ_VRF_NAME);
+    t_std_error rc = nl_async_submit((vrf_name ? vrf_name : NAS_DEFAULT_VRF_NAME), sock_type,
+                                     (struct nlmsghdr *)req->msg, nas_os_l3_async_done, req);
+    if (rc != STD_ERR_OK) {
+        EV_LOGGING(NAS_OS, ERR, "L3-ASYNC", "Failed to submit the request");
+        nas_os_l3_async_req_free(req);
+    }
+    return rc;
+}
+
+t_std_error nas_os_add_route_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context)
+{
+    return nas_os_l3_update_async(obj, NAS_RT_ADD, nas_nl_sock_T_ROUTE, done, context);
+}
+
+t_std_error nas_os_set_route_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context)
+{
+    return nas_os_l3_update_async(obj, NAS_RT_SET, nas_nl_sock_T_ROUTE, done, context);
+}
+
+t_std_error nas_os_del_route_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context)
+{
+    return nas_os_l3_update_async(obj, NAS_RT_DEL, nas_nl_sock_T_ROUTE, done, context);
+}
+
+t_std_error nas_os_add_neighbor_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context)
+{
+    return nas_os_l3_update_async(obj, NAS_RT_ADD, nas_nl_sock_T_NEI, done, context);
+}
+
+t_std_error nas_os_set_neighbor_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context)
+{
+    return nas_os_l3_update_async(obj, NAS_RT_SET, nas_nl_sock_T_NEI, done, context);
+}
+
+t_std_error nas_os_del_neighbor_async (cps_api_object_t obj, nas_os_async_done_fn done, void *context)
+{
+    return nas_os_l3_update_async(obj, NAS_RT_DEL, nas_nl_sock_T_NEI, done, context);
+}
+
 t_std_error nas_os_add_vrf (cps_api_object_t obj)
 {
     if (nas_os_update_vrf(obj, NAS_RT_ADD) != STD_ERR_OK) {
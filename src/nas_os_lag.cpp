@@ -15,7 +15,7 @@
  */
 
 /*
- * filename: nas_os_lag.c
+ * filename: nas_os_lag.cpp
  */
 
 #include "event_log.h"
@@ -30,6 +30,7 @@
 #include "cps_api_object_attr.h"
 #include "netlink_tools.h"
 #include "nas_nlmsg.h"
+#include "nas_nlmsg_builder.h"
 #include "cps_api_object_key.h"
 #include "ds_api_linux_interface.h"
 #include "hal_if_mapping.h"
@@ -41,9 +42,21 @@
 #include <string.h>
 #include <net/if.h>
 
-#define NL_MSG_BUFF 4096
 //Link detect in 100 msec by kernel
 #define BOND_MIIMON 100
+
+/* Worst case size of the dummy interface create request */
+typedef nas_nl::msg_size<struct ifinfomsg,
+                         nas_nl::attr_len<IFNAMSIZ>,
+                         nas_nl::nest<nas_nl::attr_len<sizeof("dummy")>>> dummy_create_msg_size;
+/* Worst case size of the LAG create request */
+typedef nas_nl::msg_size<struct ifinfomsg,
+                         nas_nl::attr_len<IFNAMSIZ>,
+                         nas_nl::nest<nas_nl::attr_len<sizeof("bond")>,
+                                      nas_nl::nest<nas_nl::attr<int>>>> lag_create_msg_size;
+/* Worst case size of the LAG member (master) request */
+typedef nas_nl::msg_size<struct ifinfomsg, nas_nl::attr<int>> lag_member_msg_size;
+
 const static int MAX_CPS_MSG_BUFF=4096;
 static t_std_error nas_os_delete_dummy(const char *dummy_intf)
 {
@@ -61,31 +74,30 @@ static t_std_error nas_os_delete_dummy(const char *dummy_intf)
 }
 static t_std_error nas_os_create_dummy(const char *dummy_intf)
 {
-    char buff[NL_MSG_BUFF];
+    nas_nl::msg_buffer<dummy_create_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL));
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
+    if (ifmsg == nullptr) return (STD_ERR(NAS_OS,FAIL, 0));
     hal_ifindex_t if_index = 0;
     const char *info_kind = "dummy";
 
-    memset(buff,0,NL_MSG_BUFF);
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),
-            sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),
-            sizeof(struct ifinfomsg));
-
     EV_LOGGING(NAS_OS, INFO, "NAS-OS-LAG", "Create Dummy intf name %s in Kernel",dummy_intf);
 
     unsigned int flags = (IFF_BROADCAST | IFF_NOARP);
     flags &= ~IFF_UP;
 
-    nas_os_pack_nl_hdr(nlh, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL));
     nas_os_pack_if_hdr(ifmsg, AF_PACKET, flags, if_index);
 
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_IFNAME, dummy_intf, (strlen(dummy_intf)+1));
-    struct nlattr *attr_nh = nlmsg_nested_start(nlh, sizeof(buff));
-    attr_nh->nla_len = 0;
-    attr_nh->nla_type = IFLA_LINKINFO;
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_INFO_KIND, info_kind, (strlen(info_kind)+1));
-    nlmsg_nested_end(nlh,attr_nh);
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK) {
+    nl_req.put_str(IFLA_IFNAME, dummy_intf);
+    struct nlattr *attr_nh = nl_req.nest_start(IFLA_LINKINFO);
+    nl_req.put_str(IFLA_INFO_KIND, info_kind);
+    nl_req.nest_end(attr_nh);
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS, ERR, "NAS-OS-LAG", "Dummy %s request exceeds %lu bytes",
+                   dummy_intf, nl_req.capacity());
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nl_req.msg(),buff.data,buff.size) != STD_ERR_OK) {
         EV_LOGGING(NAS_OS, ERR,  "NAS-OS-LAG", "Failure to create DUMMY in kernel");
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
@@ -142,55 +154,49 @@ static t_std_error nas_add_del_dummy_to_lag(hal_ifindex_t if_index, bool add) {
 
 t_std_error nas_os_create_lag(cps_api_object_t obj, hal_ifindex_t *lag_index)
 {
-    char buff[NL_MSG_BUFF];
+    nas_nl::msg_buffer<lag_create_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL));
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
     hal_ifindex_t if_index = 0;
     const char *info_kind = "bond";
 
-    memset(buff,0,NL_MSG_BUFF);
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),
-            sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),
-            sizeof(struct ifinfomsg));
-
     cps_api_object_attr_t lag_attr = cps_api_get_key_data(obj, IF_INTERFACES_INTERFACE_NAME);
-    if(lag_attr == CPS_API_ATTR_NULL) {
+    if((lag_attr == CPS_API_ATTR_NULL) || (ifmsg == nullptr)) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS-LAG",
                 "Missing Lag Intf name for adding to kernel");
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
 
-    const char *lag_name = cps_api_object_attr_data_bin(lag_attr);
+    const char *lag_name = (const char *)cps_api_object_attr_data_bin(lag_attr);
 
     EV_LOGGING(NAS_OS, INFO, "NAS-OS-LAG",
             "Create LAG name %s in Kernel",lag_name);
 
-    nas_os_pack_nl_hdr(nlh, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL));
     nas_os_pack_if_hdr(ifmsg, AF_PACKET, (IFF_BROADCAST | IFF_MULTICAST), if_index);
 
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_IFNAME, lag_name, (strlen(lag_name)+1));
-    struct nlattr *attr_nh = nlmsg_nested_start(nlh, sizeof(buff));
-    attr_nh->nla_len = 0;
-    attr_nh->nla_type = IFLA_LINKINFO;
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_INFO_KIND, info_kind, (strlen(info_kind)+1));
+    nl_req.put_str(IFLA_IFNAME, lag_name);
+    struct nlattr *attr_nh = nl_req.nest_start(IFLA_LINKINFO);
+    nl_req.put_str(IFLA_INFO_KIND, info_kind);
 
     //Nested BOND info IFLA_INFO_DATA
-    struct nlattr *attr_nh_data = nlmsg_nested_start(nlh, sizeof(buff));
-    attr_nh_data->nla_len = 0;
-    attr_nh_data->nla_type = IFLA_INFO_DATA;
+    struct nlattr *attr_nh_data = nl_req.nest_start(IFLA_INFO_DATA);
     int miimon= BOND_MIIMON;
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_BOND_MIIMON,&miimon, sizeof(miimon));
-    nlmsg_nested_end(nlh,attr_nh_data);
-    nlmsg_nested_end(nlh,attr_nh);
+    nl_req.put(IFLA_BOND_MIIMON, miimon);
+    nl_req.nest_end(attr_nh_data);
+    nl_req.nest_end(attr_nh);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK) {
-        EV_LOGGING(NAS_OS, ERR, "NAS-OS-LAG", "Failure to create LAG in kernel");
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS, ERR, "NAS-OS-LAG", "LAG %s request exceeds %lu bytes",
+                   lag_name, nl_req.capacity());
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
 
-    if((*lag_index = cps_api_interface_name_to_if_index(lag_name)) == 0) {
-        EV_LOGGING(NAS_OS, ERR, "NAS-OS-LAG", "Error finding the ifindex of lag");
+    nl_link_echo_t link;
+    if(nl_do_link_create_request(NL_DEFAULT_VRF_NAME, nl_req.msg(), buff.data, buff.size, &link) != STD_ERR_OK) {
+        EV_LOGGING(NAS_OS, ERR, "NAS-OS-LAG", "Failure to create LAG in kernel");
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
+    *lag_index = link.ifindex;
     if (nas_add_del_dummy_to_lag(*lag_index, true) != STD_ERR_OK) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS-LAG", "Error adding dummy to the lag");
         return (STD_ERR(NAS_OS,FAIL, 0));
@@ -240,20 +246,17 @@ t_std_error nas_os_delete_lag(cps_api_object_t obj)
 
 t_std_error nas_os_process_ports(hal_ifindex_t lag_index,hal_ifindex_t if_index)
 {
-    char buff[NL_MSG_BUFF];
-    memset(buff,0,sizeof(buff));
-
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),
-            sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),
-            sizeof(struct ifinfomsg));
+    nas_nl::msg_buffer<lag_member_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_SETLINK, NLM_F_REQUEST);
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
+    if (ifmsg == nullptr) return (STD_ERR(NAS_OS,FAIL, 0));
 
-    nas_os_pack_nl_hdr(nlh, RTM_SETLINK, NLM_F_REQUEST);
     ifmsg->ifi_family = AF_PACKET;
     ifmsg->ifi_index = if_index;
 
-    nlmsg_add_attr(nlh,sizeof(buff), IFLA_MASTER, &lag_index, sizeof(int));
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK) {
+    nl_req.put(IFLA_MASTER, lag_index);
+    if(!nl_req.ok() ||
+       (nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nl_req.msg(),buff.data,buff.size) != STD_ERR_OK)) {
         EV_LOGGING(NAS_OS, ERR,"NAS-OS-LAG",
                 "Failure Add/Dell interface in kernel for LAG");
         return (STD_ERR(NAS_OS,FAIL, 0));
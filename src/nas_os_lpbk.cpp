@@ -92,13 +92,13 @@ t_std_error nas_os_lpbk_create(cps_api_object_t obj)
     nlmsg_add_attr(nlh, sizeof(buff), IFLA_INFO_KIND, info_kind, (strlen(info_kind) + NULL_BYTE));
     nlmsg_nested_end(nlh, attr_nh);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT, nlh, buff, sizeof(buff)) != STD_ERR_OK) {
+    nl_link_echo_t link;
+    if(nl_do_link_create_request(NL_DEFAULT_VRF_NAME, nlh, buff, sizeof(buff), &link) != STD_ERR_OK) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS-LPBK", "Failure creating loopback (%s) in kernel", lpbk_name);
         return (STD_ERR(NAS_OS, FAIL, 0));
     } else {
         /* add interface index */
-        hal_ifindex_t ifix = cps_api_interface_name_to_if_index(lpbk_name);
-        cps_api_object_attr_add_u32(obj, DELL_BASE_IF_CMN_IF_INTERFACES_INTERFACE_IF_INDEX, ifix);
+        cps_api_object_attr_add_u32(obj, DELL_BASE_IF_CMN_IF_INTERFACES_INTERFACE_IF_INDEX, link.ifindex);
     }
 
     return STD_ERR_OK;
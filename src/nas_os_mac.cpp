@@ -19,7 +19,10 @@
 #include "event_log.h"
 #include "std_error_codes.h"
 #include "nas_nlmsg.h"
+#include "nas_nlmsg_builder.h"
 #include "netlink_tools.h"
+#include "netlink_async.h"
+#include "nas_linux_l2.h"
 #include "nas_os_vlan_utils.h"
 #include "std_mac_utils.h"
 #include "nas_os_if_priv.h"
@@ -28,6 +31,7 @@
 #include "nas_os_if_conversion_utils.h"
 #include "std_thread_tools.h"
 #include "std_socket_tools.h"
+#include "std_utils.h"
 
 #include <string>
 #include <netinet/in.h>
@@ -41,10 +45,18 @@
 #include <sstream>
 #include <vector>
 #include <chrono>
+#include <algorithm>
 
 
-#define NL_MSG_BUFF_LEN 4096
+/* Worst case size of the bridge port learning request */
+typedef nas_nl::msg_size<struct ifinfomsg,
+                         nas_nl::nest<nas_nl::attr<uint8_t>>> mac_learning_msg_size;
+/* Worst case size of the FDB entry request */
+typedef nas_nl::msg_size<struct ndmsg,
+                         nas_nl::attr<hal_mac_addr_t>,
+                         nas_nl::attr_len<HAL_INET6_LEN>> mac_msg_size;
 #define MAC_STRING_LEN 20
+#define MAC_ACK_BUFFER_LEN 1024 /* Buffer len to receive the ACK of the FDB entry request */
 
 static std_rw_lock_t static_mac_lock = PTHREAD_RWLOCK_INITIALIZER;
 static std_rw_lock_t dynamic_mac_lock = PTHREAD_RWLOCK_INITIALIZER;
@@ -74,26 +86,26 @@ static void nas_os_mac_write_pending_mac_if(hal_ifindex_t *ifindex) {
 }
 
 static bool nas_os_update_mac_learning(hal_ifindex_t ifindex, bool enable){
-    char buff[NL_MSG_BUFF_LEN];
-    memset(buff,0,sizeof(nlmsghdr));
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ifinfomsg));
-
-    nlh->nlmsg_pid = 0 ;
-    nlh->nlmsg_seq = 0 ;
-    nlh->nlmsg_flags = NLM_F_REQUEST;
-    nlh->nlmsg_type = RTM_SETLINK ;
+    nas_nl::msg_buffer<mac_learning_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_SETLINK, NLM_F_REQUEST);
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
+    if (ifmsg == nullptr) return false;
+
     ifmsg->ifi_family = PF_BRIDGE;
     ifmsg->ifi_index = ifindex;
 
-    struct nlattr *mac_attr = nlmsg_nested_start(nlh, sizeof(buff));
-    mac_attr->nla_len = 0;
-    mac_attr->nla_type = IFLA_PROTINFO | NLA_F_NESTED;
+    struct nlattr *mac_attr = nl_req.nest_start(IFLA_PROTINFO | NLA_F_NESTED);
     uint8_t learning = (uint8_t)enable;
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_BRPORT_LEARNING,(void *)&learning,sizeof(uint8_t));
-    nlmsg_nested_end(nlh, mac_attr);
+    nl_req.put(IFLA_BRPORT_LEARNING, learning);
+    nl_req.nest_end(mac_attr);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh, buff, sizeof(buff)) != STD_ERR_OK){
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS,ERR,"NAS-L2-MAC","MAC learning request of interface %d exceeds %lu bytes",
+                   ifindex, nl_req.capacity());
+        return false;
+    }
+
+    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nl_req.msg(), buff.data, buff.size) != STD_ERR_OK){
         EV_LOG(ERR,NAS_OS,0,"NAS-L2-MAC","Failed to set mac learn mode to %d for interface %d "
                 "in Kernel",enable,ifindex);
         return false;
@@ -153,12 +165,10 @@ t_std_error nas_os_handle_mac_port_chg(const char *vlan_name, const char *mac_st
         cfg_mbr_if_index = itr->second;
     }
 
-    char buff[NL_MSG_BUFF_LEN];
-    memset(buff,0,sizeof(nlmsghdr));
-
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ndmsg *req = (struct ndmsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ndmsg));
-    memset(req, 0, sizeof(struct ndmsg));
+    nas_nl::msg_buffer<mac_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_NEWNEIGH, NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_APPEND);
+    struct ndmsg *req = nl_req.family_header<struct ndmsg>();
+    if (req == nullptr) return STD_ERR(L2MAC,FAIL,0);
 
     req->ndm_family = PF_BRIDGE;
     req->ndm_state =  NUD_REACHABLE;
@@ -171,14 +181,14 @@ t_std_error nas_os_handle_mac_port_chg(const char *vlan_name, const char *mac_st
 
     req->ndm_ifindex = cfg_mbr_if_index;
 
-    nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
-
-    nlh->nlmsg_flags |= NLM_F_CREATE | NLM_F_APPEND;
-    nlh->nlmsg_type = RTM_NEWNEIGH;
-
-    nlmsg_add_attr(nlh,sizeof(buff), NDA_LLADDR, mac, sizeof(hal_mac_addr_t));
+    nl_req.put(NDA_LLADDR, mac, sizeof(hal_mac_addr_t));
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS,ERR,"L2-MAC-CHG","Port-chg request of MAC VLAN:%s MAC:%s exceeds %lu bytes",
+                   vlan_name, mac_str, nl_req.capacity());
+        return STD_ERR(L2MAC,FAIL,0);
+    }
     t_std_error rc;
-    rc = nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI,nlh, buff, sizeof(buff));
+    rc = nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI,nl_req.msg(), buff.data, buff.size);
     int err_code = STD_ERR_EXT_PRIV (rc);
     if(err_code != 0){
         EV_LOGGING(NAS_OS,DEBUG,"L2-MAC-CHG", "FAILED Port-chg for MAC VLAN:%s MAC:%s cfg:%d chg-mbr:%d",
@@ -271,7 +281,18 @@ static bool nas_os_special_mac (const hal_mac_addr_t *mac_addr) {
    return false;
 }
 
-t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
+/* Request of an FDB entry, with what is needed to handle its result */
+typedef struct {
+    nas_nl::msg_buffer<mac_msg_size::value> buff;
+    std::string key;
+    char mac[MAC_STRING_LEN];
+    hal_ifindex_t ifindex;
+    cps_api_operation_types_t op;
+    bool dynamic;   /* dynamic entry, cached when it can not be programmed */
+} nas_os_mac_req_t;
+
+/* Build the request of the FDB entry, the static entries are cached here */
+static t_std_error nas_os_mac_msg_build(cps_api_object_t obj, nas_os_mac_req_t &mreq){
 
     cps_api_object_attr_t ifindex_attr = cps_api_object_attr_get(obj,BASE_MAC_TABLE_IFINDEX);
     cps_api_object_attr_t mac_attr = cps_api_object_attr_get(obj,BASE_MAC_TABLE_MAC_ADDRESS);
@@ -339,11 +360,10 @@ t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
         return STD_ERR(L2MAC,PARAM,0);
     }
 
-    char buff[NL_MSG_BUFF_LEN];
-    memset(buff,0,sizeof(nlmsghdr));
-
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ndmsg *req = (struct ndmsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ndmsg));
+    nas_nl::msg_builder nl_req(mreq.buff, 0, NLM_F_REQUEST | NLM_F_ACK);
+    struct nlmsghdr *nlh = nl_req.msg();
+    struct ndmsg *req = nl_req.family_header<struct ndmsg>();
+    if (req == nullptr) return STD_ERR(L2MAC,FAIL,0);
 
     bool is_static = false;
     /* If it's a self static MAC, dont add static flag
@@ -354,7 +374,6 @@ t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
         }
     }
 
-    nlh->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
     std::string s;
     hal_mac_addr_t *mac_addr = (hal_mac_addr_t*)cps_api_object_attr_data_bin(mac_attr);
 
@@ -377,7 +396,7 @@ t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
     }
 
     req->ndm_ifindex = ifindex;
-    nlmsg_add_attr(nlh,sizeof(buff),NDA_LLADDR,(void *)cps_api_object_attr_data_bin(mac_attr),sizeof(hal_mac_addr_t));
+    nl_req.put(NDA_LLADDR,cps_api_object_attr_data_bin(mac_attr),sizeof(hal_mac_addr_t));
     char mac_buff[MAC_STRING_LEN];
     std_mac_to_string(mac_addr,mac_buff,sizeof(mac_buff));
     std::string key = std::to_string(ifindex)+"."+std::string(mac_buff);
@@ -394,7 +413,7 @@ t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
     } else if (remote_mac) {
         uint32_t addr_len = (af_index == AF_INET)?HAL_INET4_LEN:HAL_INET6_LEN;
         if (ip_addr_attr) {
-            nlmsg_add_attr(nlh,sizeof(buff),NDA_DST,cps_api_object_attr_data_bin(ip_addr_attr),addr_len);
+            nl_req.put(NDA_DST,cps_api_object_attr_data_bin(ip_addr_attr),addr_len);
             EV_LOGGING(NAS_OS,INFO,"NAS-L2-MAC"," remote IP is 0x%x  state 0x%x flags 0x%x",
                 *(uint32_t *)cps_api_object_attr_data_bin(ip_addr_attr), req->ndm_state, req->ndm_flags);
         }
@@ -434,6 +453,12 @@ t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
         return STD_ERR(L2MAC,PARAM,0);
     }
 
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS,ERR,"NAS-L2-MAC","Request of mac address entry %s on ifindex %d exceeds %lu bytes",
+                   mac_buff, ifindex, nl_req.capacity());
+        return STD_ERR(L2MAC,FAIL,0);
+    }
+
     if (is_static) {
         /*
          * In case of static mac, when mac is programmed in the kernel expectation is that mac
@@ -458,15 +483,32 @@ t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
             "cps operation %d flags 0x%x state 0x%x NLM flag 0x%x type:%d in Kernel",s.c_str(),
             std_mac_to_string(mac_addr,mac_buff,sizeof(mac_buff)),
             req->ndm_ifindex,op, req->ndm_flags, req->ndm_state, nlh->nlmsg_flags, nlh->nlmsg_type);
-    t_std_error rc;
-    rc = nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI,nlh, buff, sizeof(buff));
+
+    mreq.key = key;
+    safestrncpy(mreq.mac, mac_buff, sizeof(mreq.mac));
+    mreq.ifindex = ifindex;
+    mreq.op = op;
+    mreq.dynamic = (!is_static && !age_out_disable && !self_mac);
+    return STD_ERR_OK;
+}
+
+/* Handle the result of the request of the FDB entry, rc is the result of the request
+ * already sent */
+static t_std_error nas_os_mac_msg_result(nas_os_mac_req_t &mreq, t_std_error rc){
+    struct nlmsghdr *nlh = (struct nlmsghdr *)mreq.buff.data;
+    struct ndmsg *req = (struct ndmsg *)NLMSG_DATA(nlh);
+    const std::string &key = mreq.key;
+    hal_ifindex_t ifindex = mreq.ifindex;
+    cps_api_operation_types_t op = mreq.op;
+    const char *s = (op == cps_api_oper_DELETE) ? "delete" : "set or create";
+
     int err_code = STD_ERR_EXT_PRIV (rc);
     if(err_code != 0){
         EV_LOGGING(NAS_OS,DEBUG,"NAS-L2-MAC","Failed to %s mac address entry %s for Interface %d flags %d state %d Error code %d "
-                "with cps operation %d in Kernel",s.c_str(),std_mac_to_string(mac_addr,mac_buff,sizeof(mac_buff)),
+                "with cps operation %d in Kernel",s,mreq.mac,
                 ifindex, req->ndm_flags, req->ndm_state, err_code, op);
 
-        if(!is_static && !age_out_disable && !self_mac){
+        if(mreq.dynamic){
             /*
              * When mac programmed to kernel is dynamic, kernel will reject the mac programming
              * if stp state of the interface the mac being programmed to is not learning or forwarding.
@@ -491,11 +533,95 @@ t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
         return STD_ERR_OK;
     }
     EV_LOGGING(NAS_OS,INFO,"NAS-L2-MAC","%sd mac address entry %s for Interface %d with"
-            "cps operation %d in Kernel",s.c_str(),std_mac_to_string(mac_addr,mac_buff,sizeof(mac_buff)),
+            "cps operation %d in Kernel",s,mreq.mac,
             req->ndm_ifindex,op);
     return STD_ERR_OK;
 }
 
+t_std_error nas_os_mac_update_entry(cps_api_object_t obj){
+    nas_os_mac_req_t mreq;
+    t_std_error rc = nas_os_mac_msg_build(obj, mreq);
+    if (rc != STD_ERR_OK) return rc;
+
+    /* Reply is received in a separate buffer, the request is used for the result */
+    char buff[MAC_ACK_BUFFER_LEN];
+    rc = nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI,(struct nlmsghdr *)mreq.buff.data,
+                           buff, sizeof(buff));
+    return nas_os_mac_msg_result(mreq, rc);
+}
+
+t_std_error nas_os_mac_update_entry_list(cps_api_object_list_t objs, t_std_error *results){
+    size_t count = cps_api_object_list_size(objs);
+    t_std_error first_rc = STD_ERR_OK;
+    auto set_result = [&](size_t ix, t_std_error rc) {
+        if (results != nullptr) results[ix] = rc;
+        if ((rc != STD_ERR_OK) && (first_rc == STD_ERR_OK)) first_rc = rc;
+    };
+
+    /* Entries are programmed in batches of requests (nl_do_batch_request), the results
+     * are handled in the order of the list as for a single entry */
+    std::vector<nas_os_mac_req_t> mreqs(std::min(count, (size_t)NL_BATCH_MAX_MSGS));
+    std::vector<nl_batch_req_t> reqs(mreqs.size());
+    std::vector<size_t> obj_ix(mreqs.size());
+    char buff[MAC_ACK_BUFFER_LEN];
+    size_t ix = 0;
+    while (ix < count) {
+        size_t batched = 0;
+        for ( ; (ix < count) && (batched < mreqs.size()); ++ix) {
+            t_std_error rc = nas_os_mac_msg_build(cps_api_object_list_get(objs, ix), mreqs[batched]);
+            if (rc != STD_ERR_OK) {
+                set_result(ix, rc);
+                continue;
+            }
+            reqs[batched].msg = (struct nlmsghdr *)mreqs[batched].buff.data;
+            obj_ix[batched++] = ix;
+        }
+        if (batched == 0) break;
+
+        nl_do_batch_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI, reqs.data(), batched,
+                            buff, sizeof(buff), nullptr);
+        for (size_t req_ix = 0; req_ix < batched; ++req_ix) {
+            int err_code = reqs[req_ix].error_code;
+            t_std_error rc = (err_code == 0) ? STD_ERR_OK : STD_ERR(L2MAC,FAIL,err_code);
+            set_result(obj_ix[req_ix], nas_os_mac_msg_result(mreqs[req_ix], rc));
+        }
+    }
+    return first_rc;
+}
+
+/* Asynchronous FDB entry request, the result is handled from the netlink writer thread */
+typedef struct {
+    nas_os_mac_req_t mreq;
+    nas_os_async_done_fn done;
+    void *context;
+} nas_os_mac_async_req_t;
+
+static void nas_os_mac_async_done(void *context, int error_code){
+    nas_os_mac_async_req_t *req = (nas_os_mac_async_req_t *)context;
+    t_std_error rc = (error_code == 0) ? STD_ERR_OK : STD_ERR(L2MAC,FAIL,error_code);
+    rc = nas_os_mac_msg_result(req->mreq, rc);
+    if (req->done != nullptr) req->done(req->context, rc);
+    delete req;
+}
+
+t_std_error nas_os_mac_update_entry_async(cps_api_object_t obj, nas_os_async_done_fn done, void *context){
+    nas_os_mac_async_req_t *req = new nas_os_mac_async_req_t;
+    t_std_error rc = nas_os_mac_msg_build(obj, req->mreq);
+    if (rc != STD_ERR_OK) {
+        delete req;
+        return rc;
+    }
+    req->done = done;
+    req->context = context;
+    rc = nl_async_submit(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI, (struct nlmsghdr *)req->mreq.buff.data,
+                         nas_os_mac_async_done, req);
+    if (rc != STD_ERR_OK) {
+        EV_LOGGING(NAS_OS,ERR,"NAS-L2-MAC","Failed to submit the mac address entry %s",req->mreq.mac);
+        delete req;
+    }
+    return rc;
+}
+
 }
 
 
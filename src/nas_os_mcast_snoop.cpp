@@ -22,6 +22,7 @@
 #include "ds_api_linux_interface.h"
 #include "event_log.h"
 #include "nas_nlmsg.h"
+#include "nas_nlattr_parser.h"
 #include "hal_if_mapping.h"
 #include "nas_os_mcast_snoop.h"
 #include "std_utils.h"
@@ -166,12 +167,18 @@ static bool _get_ifname(uint32_t ifindex, char *if_name, unsigned int len) {
     return true;
 }
 
+/* MDB and router port containers of the MDB events, the other attributes are skipped */
+typedef nas_nl::attr_parser<__MDBA_MAX,
+                            nas_nl::sel<MDBA_MDB>,
+                            nas_nl::sel<MDBA_ROUTER>> mdb_attr_parser;
+
 bool nl_to_mcast_snoop_info(int sock, int msg_type, struct nlmsghdr *hdr, void *context) {
     struct nlattr *nest_attr;
+    int nest_len;
     struct nlattr *info_attr;
     struct br_mdb_entry *br_entry;
     struct br_port_msg *brp_msg = (struct br_port_msg *)NLMSG_DATA(hdr);
-    static char netlink_buf[MAX_NETLINK_BUF];
+    static __thread char netlink_buf[MAX_NETLINK_BUF];
 
     EV_LOGGING(NETLINK_MCAST_SNOOP,DEBUG,"NAS-LINUX-MCAST-SNOOP", "message type %d Family %d VLAN ifindex %d ", msg_type, brp_msg->family, brp_msg->ifindex);
 
@@ -192,13 +199,14 @@ bool nl_to_mcast_snoop_info(int sock, int msg_type, struct nlmsghdr *hdr, void *
     }
     EV_LOGGING(NETLINK_MCAST_SNOOP,DEBUG,"NAS-LINUX-MCAST-SNOOP", "VLAN name (%s) ID (%d)",  intf_ctrl.if_name, intf_ctrl.vlan_id);
 
-    int attrlen = nlmsg_attrlen(hdr,sizeof(struct br_port_msg));
-    struct nlattr *attr = nlmsg_attrdata(hdr, sizeof(struct br_port_msg));
+    struct nlattr *attrs[__MDBA_MAX];
+    mdb_attr_parser::parse_msg(attrs, hdr, sizeof(struct br_port_msg));
 
-    while (nla_ok(attr, attrlen)) {
-        int attr_type = nla_type(attr);
+    for (int attr_type : { MDBA_MDB, MDBA_ROUTER }) {
+        struct nlattr *attr = attrs[attr_type];
+        if (attr == nullptr) continue;
         if (attr_type == MDBA_MDB) {
-            nla_for_each_nested(nest_attr, attr, attrlen) {
+            nla_for_each_nested(nest_attr, attr, nest_len) {
                 if (nla_type(nest_attr) == MDBA_MDB_ENTRY) {
                     info_attr = (nlattr*)nla_data(nest_attr);
                     if (nla_type(info_attr) == MDBA_MDB_ENTRY_INFO) {
@@ -231,7 +239,7 @@ bool nl_to_mcast_snoop_info(int sock, int msg_type, struct nlmsghdr *hdr, void *
             }
         }
         else if (attr_type == MDBA_ROUTER) {
-            nla_for_each_nested(nest_attr, attr, attrlen) {
+            nla_for_each_nested(nest_attr, attr, nest_len) {
                 if (nla_type(nest_attr) == MDBA_ROUTER_PORT) {
                      uint32_t ifindex = *((uint32_t *)(nla_data(nest_attr)));
 
@@ -270,8 +278,6 @@ bool nl_to_mcast_snoop_info(int sock, int msg_type, struct nlmsghdr *hdr, void *
                  }
              }
         }
-
-        attr = nla_next(attr, &attrlen);
     }
 
     return true;
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: nas_os_nl_config.cpp
+ */
+
+#include "nas_os_nl_config.h"
+#include "std_utils.h"
+#include "event_log.h"
+
+#include <string.h>
+#include <mutex>
+
+static std::mutex _config_mutex;
+static nas_os_nl_config_t _config;
+static bool _config_set = false;
+
+extern "C" void nas_os_nl_config_default (nas_os_nl_config_t *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->dispatch_coalesce = true;
+    cfg->dispatch_low_weight = NL_DISPATCH_DEFAULT_LOW_WEIGHT;
+    cfg->dispatch_max_queued = NL_DISPATCH_DEFAULT_MAX_QUEUED;
+    cfg->dispatch_overload = NL_DISPATCH_OVERLOAD_SHED;
+    cfg->dump_threads = NL_DUMP_DEFAULT_THREADS;
+    cfg->publish_deadline_usec = NL_PUBLISH_DEFAULT_DEADLINE_USEC;
+}
+
+extern "C" t_std_error nas_os_nl_config_set (const nas_os_nl_config_t *cfg) {
+    if ((cfg == nullptr) || (cfg->dispatch_overload >= NL_DISPATCH_OVERLOAD_MAX)) {
+        EV_LOGGING(NETLINK, ERR, "NL-CONFIG", "Invalid netlink configuration");
+        return STD_ERR(NAS_OS, PARAM, 0);
+    }
+
+    std::lock_guard<std::mutex> lock(_config_mutex);
+    _config = *cfg;
+    safestrncpy(_config.capture_path, cfg->capture_path, sizeof(_config.capture_path));
+    safestrncpy(_config.subscribe_off, cfg->subscribe_off, sizeof(_config.subscribe_off));
+    if (_config.dispatch_workers > NL_DISPATCH_MAX_WORKERS) _config.dispatch_workers = NL_DISPATCH_MAX_WORKERS;
+    if (_config.dispatch_window_usec > NL_DISPATCH_MAX_WINDOW_USEC) {
+        _config.dispatch_window_usec = NL_DISPATCH_MAX_WINDOW_USEC;
+    }
+    if (_config.dispatch_low_weight == 0) _config.dispatch_low_weight = NL_DISPATCH_DEFAULT_LOW_WEIGHT;
+    if (_config.dispatch_max_queued == 0) _config.dispatch_max_queued = NL_DISPATCH_DEFAULT_MAX_QUEUED;
+    if (_config.dump_threads > NL_DUMP_MAX_THREADS) _config.dump_threads = NL_DUMP_MAX_THREADS;
+    if (_config.publish_batch > NL_PUBLISH_MAX_BATCH) _config.publish_batch = NL_PUBLISH_MAX_BATCH;
+    if (_config.publish_deadline_usec > NL_PUBLISH_MAX_DEADLINE_USEC) {
+        _config.publish_deadline_usec = NL_PUBLISH_MAX_DEADLINE_USEC;
+    }
+    _config_set = true;
+
+    EV_LOGGING(NETLINK, INFO, "NL-CONFIG", "Netlink config dispatch workers:%lu dump threads:%lu publish batch:%lu "
+               "nsid listener:%d io_uring:%d", _config.dispatch_workers, _config.dump_threads,
+               _config.publish_batch, _config.nsid_listener, _config.io_uring);
+    return STD_ERR_OK;
+}
+
+extern "C" void nas_os_nl_config_get (nas_os_nl_config_t *cfg) {
+    std::lock_guard<std::mutex> lock(_config_mutex);
+    if (!_config_set) {
+        nas_os_nl_config_default(cfg);
+        return;
+    }
+    *cfg = _config;
+}
@@ -26,6 +26,8 @@
 #include "std_error_codes.h"
 #include "nas_nlmsg.h"
 #include "netlink_tools.h"
+#include "netlink_async.h"
+#include "nas_linux_l2.h"
 #include "nas_os_vlan_utils.h"
 #include "nas_os_if_priv.h"
 #include "nas_os_if_conversion_utils.h"
@@ -72,15 +74,24 @@ static bool _is_untagged_member_of_vlan(hal_ifindex_t ifindex, hal_vlan_id_t vla
 
 }
 
-t_std_error nl_int_update_stp_state(cps_api_object_t obj){
-    std::lock_guard<std::mutex> lock(_if_stp_mutex);
+/* Request of the STP state of an interface, with what is needed to handle its result */
+typedef struct {
+    char buff[NL_MSG_BUFF_LEN];
+    hal_ifindex_t vlan_ifindex;
+    hal_vlan_id_t vlan_id;
+    uint8_t state;
+} nas_os_stp_req_t;
+
+/* Build the request of the STP state, skip is set when the state is not to be written to
+ * the kernel. Called with the STP state lock held. */
+static t_std_error nas_os_stp_msg_build(cps_api_object_t obj, nas_os_stp_req_t &sreq, bool *skip){
+    *skip = true;
     cps_api_object_attr_t ifindex = cps_api_object_attr_get(obj,BASE_STG_ENTRY_INTF_IF_INDEX_IFINDEX);
     cps_api_object_attr_t stp_state = cps_api_object_attr_get(obj,BASE_STG_ENTRY_INTF_STATE);
     cps_api_object_attr_t vlan_id_attr = cps_api_object_attr_get(obj,BASE_STG_ENTRY_VLAN);
     cps_api_object_attr_t os_update_attr = cps_api_object_attr_get(obj,BASE_STG_ENTRY_INTF_IF);
     cps_api_object_attr_t if_name_attr = cps_api_object_attr_get(obj,BASE_STG_ENTRY_INTF_IF_NAME);
 
-
     if(ifindex == NULL || stp_state == NULL){
         EV_LOG(ERR,NAS_L2,0,"NAS-LINUX-STG","Ifindex/STP state/VLAN Id Missing for updating STP kernel state");
         return STD_ERR(STG,PARAM,0);
@@ -136,10 +147,11 @@ t_std_error nl_int_update_stp_state(cps_api_object_t obj){
 
     }
 
-    char buff[NL_MSG_BUFF_LEN];
-    memset(buff,0,sizeof(buff));
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ifinfomsg));
+    char *buff = sreq.buff;
+    const size_t buff_len = sizeof(sreq.buff);
+    memset(buff,0,buff_len);
+    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,buff_len,sizeof(struct nlmsghdr));
+    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,buff_len,sizeof(struct ifinfomsg));
 
     nlh->nlmsg_pid = 0 ;
     nlh->nlmsg_seq = 0 ;
@@ -149,24 +161,34 @@ t_std_error nl_int_update_stp_state(cps_api_object_t obj){
     ifmsg->ifi_family = AF_BRIDGE;
     ifmsg->ifi_index = vlan_ifindex;
 
-    struct nlattr *stp_attr = nlmsg_nested_start(nlh, sizeof(buff));
+    struct nlattr *stp_attr = nlmsg_nested_start(nlh, buff_len);
     stp_attr->nla_len = 0;
     stp_attr->nla_type = IFLA_PROTINFO | NLA_F_NESTED;
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_BRPORT_STATE,(void *)&state,sizeof(uint8_t));
+    nlmsg_add_attr(nlh,buff_len,IFLA_BRPORT_STATE,(void *)&state,sizeof(uint8_t));
     nlmsg_nested_end(nlh, stp_attr);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh, buff, sizeof(buff)) != STD_ERR_OK){
+    sreq.vlan_ifindex = vlan_ifindex;
+    sreq.vlan_id = vlan_id;
+    sreq.state = state;
+    *skip = false;
+    return STD_ERR_OK;
+}
+
+/* Handle the result of the STP state request, rc is the result of the request already
+ * sent. Called with the STP state lock held. */
+static t_std_error nas_os_stp_msg_result(nas_os_stp_req_t &sreq, t_std_error rc){
+    hal_ifindex_t vlan_ifindex = sreq.vlan_ifindex;
+    hal_vlan_id_t vlan_id = sreq.vlan_id;
+    uint8_t state = sreq.state;
+
+    if(rc != STD_ERR_OK){
         EV_LOG(ERR,NAS_L2,0,"NAS_LINUX-STG","Failed to updated STP State to %d for Interface %d "
                 "in Kernel",state,vlan_ifindex);
         return STD_ERR(STG,FAIL,0);
     }
 
     EV_LOGGING(NAS_OS,DEBUG,"NAS-STG","Updating the state tp %d for port %d in vlan %d",state,vlan_ifindex,vlan_id);
-    if(state_it == _if_stp_state->end()){
-        _if_stp_state->insert({vlan_ifindex,state});
-    }else{
-        state_it->second = state;
-    }
+    (*_if_stp_state)[vlan_ifindex] = state;
     /*
      * When STP state of a port changes to forwarding, check if the querier status is enabled for the bridge for which state
      * is being programmed. If it is enabled then disable/enable the querier status to start sending queries again. This is
@@ -184,4 +206,62 @@ t_std_error nl_int_update_stp_state(cps_api_object_t obj){
     return STD_ERR_OK;
 }
 
+t_std_error nl_int_update_stp_state(cps_api_object_t obj){
+    std::lock_guard<std::mutex> lock(_if_stp_mutex);
+    nas_os_stp_req_t sreq;
+    bool skip = false;
+    t_std_error rc = nas_os_stp_msg_build(obj, sreq, &skip);
+    if ((rc != STD_ERR_OK) || skip) return rc;
+
+    rc = nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT, (struct nlmsghdr *)sreq.buff,
+                           sreq.buff, sizeof(sreq.buff));
+    return nas_os_stp_msg_result(sreq, rc);
+}
+
+/* Asynchronous STP state request, the result is handled from the netlink writer thread */
+typedef struct {
+    nas_os_stp_req_t sreq;
+    nas_os_async_done_fn done;
+    void *context;
+} nas_os_stp_async_req_t;
+
+static void nas_os_stp_async_done(void *context, int error_code){
+    nas_os_stp_async_req_t *req = (nas_os_stp_async_req_t *)context;
+    t_std_error rc = (error_code == 0) ? STD_ERR_OK : STD_ERR(STG,FAIL,error_code);
+    {
+        std::lock_guard<std::mutex> lock(_if_stp_mutex);
+        rc = nas_os_stp_msg_result(req->sreq, rc);
+    }
+    if (req->done != nullptr) req->done(req->context, rc);
+    delete req;
+}
+
+t_std_error nl_int_update_stp_state_async(cps_api_object_t obj, nas_os_async_done_fn done, void *context){
+    nas_os_stp_async_req_t *req = new nas_os_stp_async_req_t;
+    bool skip = false;
+    t_std_error rc;
+    {
+        std::lock_guard<std::mutex> lock(_if_stp_mutex);
+        rc = nas_os_stp_msg_build(obj, req->sreq, &skip);
+    }
+    if ((rc != STD_ERR_OK) || skip) {
+        delete req;
+        /* Nothing to write to the kernel */
+        if ((rc == STD_ERR_OK) && (done != nullptr)) done(context, STD_ERR_OK);
+        return rc;
+    }
+    req->done = done;
+    req->context = context;
+    /* Requests of the interface sockets are sent in order, the state cache is updated
+     * with the results in the same order */
+    rc = nl_async_submit(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT, (struct nlmsghdr *)req->sreq.buff,
+                         nas_os_stp_async_done, req);
+    if (rc != STD_ERR_OK) {
+        EV_LOG(ERR,NAS_L2,0,"NAS_LINUX-STG","Failed to submit the STP State %d for Interface %d",
+                req->sreq.state,req->sreq.vlan_ifindex);
+        delete req;
+    }
+    return rc;
+}
+
 }
@@ -30,6 +30,7 @@
 #include "dell-interface.h"
 #include "netlink_tools.h"
 #include "nas_nlmsg.h"
+#include "nas_nlmsg_builder.h"
 #include "ds_api_linux_interface.h"
 #include "nas_os_int_utils.h"
 #include "nas_os_if_priv.h"
@@ -205,18 +206,31 @@ t_std_error nas_os_delete_subinterface (cps_api_object_t obj) {
     return STD_ERR_OK;
 }
 
-#define NL_MSG_BUFFER_LEN 4096
+/* Worst case size of the bridge create request */
+typedef nas_nl::msg_size<struct ifinfomsg,
+                         nas_nl::attr_len<IFNAMSIZ>,
+                         nas_nl::attr<hal_mac_addr_t>,
+                         nas_nl::attr<int>,
+                         nas_nl::nest<nas_nl::attr_len<sizeof("bridge")>>> bridge_create_msg_size;
+/* Worst case size of the tagged interface create request */
+typedef nas_nl::msg_size<struct ifinfomsg,
+                         nas_nl::attr_len<IFNAMSIZ>,
+                         nas_nl::attr<int>,
+                         nas_nl::nest<nas_nl::attr_len<sizeof("vlan")>,
+                                      nas_nl::nest<nas_nl::attr<int>>>> vlan_create_msg_size;
+/* Worst case size of the bridge membership (master) request */
+typedef nas_nl::msg_size<struct ifinfomsg,
+                         nas_nl::attr<int>,
+                         nas_nl::attr<int>> vlan_master_msg_size;
 
 t_std_error nas_os_create_bridge(cps_api_object_t obj, hal_ifindex_t *br_index)
 {
-    char buff[NL_MSG_BUFFER_LEN];
+    nas_nl::msg_buffer<bridge_create_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL));
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
     hal_ifindex_t if_index = 0;
     const char *info_kind = "bridge";
-
-    memset(buff,0,NL_MSG_BUFFER_LEN);
-
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ifinfomsg));
+    if (ifmsg == nullptr) return (STD_ERR(NAS_OS,FAIL, 0));
 
     cps_api_object_attr_t vlan_name_attr = cps_api_get_key_data(obj, IF_INTERFACES_INTERFACE_NAME);
     if(vlan_name_attr == CPS_API_ATTR_NULL) {
@@ -237,7 +251,6 @@ t_std_error nas_os_create_bridge(cps_api_object_t obj, hal_ifindex_t *br_index)
 
     EV_LOG(INFO, NAS_OS, ev_log_s_MINOR, "NAS-OS", "ADD Bridge name %s ",
            br_name);
-    nas_os_pack_nl_hdr(nlh, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL));
 
     /* @TODO : Setting promisc mode to lift IP packets for now.
      *         Revisit when we get more details..
@@ -250,7 +263,7 @@ t_std_error nas_os_create_bridge(cps_api_object_t obj, hal_ifindex_t *br_index)
     nas_os_pack_if_hdr(ifmsg, AF_BRIDGE, flags, if_index);
 
     //Add the interface name
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_IFNAME, br_name, (strlen(br_name)+1));
+    nl_req.put_str(IFLA_IFNAME, br_name);
 
     //Add MAC if already sent
     cps_api_object_attr_t mac_attr = cps_api_object_attr_get(obj,DELL_IF_IF_INTERFACES_INTERFACE_PHYS_ADDRESS);
@@ -259,7 +272,7 @@ t_std_error nas_os_create_bridge(cps_api_object_t obj, hal_ifindex_t *br_index)
         hal_mac_addr_t mac_addr;
         void *addr = cps_api_object_attr_data_bin(mac_attr);
         if (std_string_to_mac(&mac_addr, (const char *)addr, sizeof(mac_addr))) {
-            nlmsg_add_attr(nlh, sizeof(buff), IFLA_ADDRESS, &mac_addr , sizeof(hal_mac_addr_t));
+            nl_req.put(IFLA_ADDRESS, mac_addr);
             EV_LOG(INFO, NAS_OS, ev_log_s_MAJOR, "NAS-OS", "Setting mac address %s in vlan interface %s ",
                     (const char *)addr, br_name);
         }
@@ -269,26 +282,28 @@ t_std_error nas_os_create_bridge(cps_api_object_t obj, hal_ifindex_t *br_index)
     auto mtu_attr = cps_api_object_attr_get(obj, DELL_IF_IF_INTERFACES_INTERFACE_MTU);
     if (mtu_attr != nullptr) {
         int mtu = (int)cps_api_object_attr_data_uint(mtu_attr) - NAS_LINK_MTU_HDR_SIZE;
-        nlmsg_add_attr(nlh, sizeof(buff), IFLA_MTU, &mtu , sizeof(mtu));
+        nl_req.put(IFLA_MTU, mtu);
     }
 
     //Add the info_kind to indicate bridge
-    struct nlattr *attr_nh = nlmsg_nested_start(nlh, sizeof(buff));
-    attr_nh->nla_len = 0;
-    attr_nh->nla_type = IFLA_LINKINFO;
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_INFO_KIND, info_kind, (strlen(info_kind)+1));
-    nlmsg_nested_end(nlh,attr_nh);
+    struct nlattr *attr_nh = nl_req.nest_start(IFLA_LINKINFO);
+    nl_req.put_str(IFLA_INFO_KIND, info_kind);
+    nl_req.nest_end(attr_nh);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK) {
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS, ERR, "NAS-OS", "Bridge %s request exceeds %lu bytes",
+                   br_name, nl_req.capacity());
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+
+    nl_link_echo_t link;
+    if(nl_do_link_create_request(NL_DEFAULT_VRF_NAME, nl_req.msg(), buff.data, buff.size, &link) != STD_ERR_OK) {
         EV_LOG(ERR, NAS_OS, ev_log_s_CRITICAL, "NAS-OS", "Failure adding Vlan %s to kernel",
                br_name);
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
     //return the kernel index to caller, used by caller in case of ADD VLAN
-    if((*br_index = cps_api_interface_name_to_if_index(br_name)) == 0) {
-        EV_LOG(ERR, NAS_OS, ev_log_s_CRITICAL, "NAS-OS", "Error finding the ifindex of bridge");
-        return (STD_ERR(NAS_OS,FAIL, 0));
-    }
+    *br_index = link.ifindex;
     nas_os_set_bridge_default_mac_ageing(*br_index);
     return STD_ERR_OK;
 }
@@ -333,26 +348,28 @@ t_std_error nas_os_del_vlan(cps_api_object_t obj)
 
 static t_std_error nas_os_add_vlan_in_br(int vlan_index, int if_index, int br_index)
 {
-    char buff[NL_MSG_BUFFER_LEN];
-    memset(buff,0,sizeof(buff));
-
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ifinfomsg));
-
-    //nlmsg_len is updated in reserve api's above ..
-    nas_os_pack_nl_hdr(nlh, RTM_SETLINK, NLM_F_REQUEST);
+    nas_nl::msg_buffer<vlan_master_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_SETLINK, NLM_F_REQUEST);
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
+    if (ifmsg == nullptr) return (STD_ERR(NAS_OS,FAIL, 0));
 
     nas_os_pack_if_hdr(ifmsg, AF_UNSPEC, 0, vlan_index);
 
     EV_LOG(INFO, NAS_OS, ev_log_s_MINOR, "NAS-OS", "Vlan I/F index %d Bridge %d port %d ",
            ifmsg->ifi_index, br_index, if_index);
 
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_MASTER, &br_index, sizeof(int));
+    nl_req.put(IFLA_MASTER, br_index);
     // TODO check if if_index needs to be sent for adding member
     // This may not be even applicable for vxlan type of interface
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_LINK, &if_index, sizeof(int));
+    nl_req.put(IFLA_LINK, if_index);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK) {
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS, ERR, "NAS-OS", "Bridge %d member request exceeds %lu bytes",
+                   br_index, nl_req.capacity());
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+
+    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nl_req.msg(),buff.data,buff.size) != STD_ERR_OK) {
         EV_LOG(ERR, NAS_OS, ev_log_s_CRITICAL, "NAS-OS", "Failure adding port to bridge in kernel");
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
@@ -433,14 +450,10 @@ t_std_error nas_os_add_intf_to_bridge(cps_api_object_t obj)
 
 static t_std_error nas_os_add_tag_port_to_os(int vlan_id, const char *vlan_name, int port_index, const char * phy_if_name, int *vlan_index)
 {
-    char buff[NL_MSG_BUFFER_LEN];
-
-    memset(buff,0,sizeof(buff));
-
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ifinfomsg));
-
-    nas_os_pack_nl_hdr(nlh, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL));
+    nas_nl::msg_buffer<vlan_create_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL));
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
+    if (ifmsg == nullptr) return (STD_ERR(NAS_OS,FAIL, 0));
 
     db_interface_state_t astate;
     db_interface_operational_state_t ostate;
@@ -463,35 +476,38 @@ static t_std_error nas_os_add_tag_port_to_os(int vlan_id, const char *vlan_name,
     EV_LOGGING(NAS_OS, INFO, "NAS-OS", "Add tagged Vlan Name %s Vlan Id %d for port %d",
            vlan_name, vlan_id, port_index);
 
-    nlmsg_add_attr(nlh,sizeof(buff), IFLA_IFNAME, vlan_name, (strlen(vlan_name)+1));
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_LINK, &port_index, sizeof(int));
+    nl_req.put_str(IFLA_IFNAME, vlan_name);
+    nl_req.put(IFLA_LINK, port_index);
 
     /* VLAN info is set of nested attributes
      * IFLA_LINK_INFO(IFLA_INFO_KIND, IFLA_INFO_DATA(IFLA_VLAN_ID))*/
-    struct nlattr *attr_nh = nlmsg_nested_start(nlh, sizeof(buff));
-    attr_nh->nla_len = 0;
-    attr_nh->nla_type = IFLA_LINKINFO;
+    struct nlattr *attr_nh = nl_req.nest_start(IFLA_LINKINFO);
 
     const char *info_kind = "vlan";
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_INFO_KIND, info_kind, (strlen(info_kind)+1));
+    nl_req.put_str(IFLA_INFO_KIND, info_kind);
 
     if(vlan_id != 0) {
-        struct nlattr *attr_nh_data = nlmsg_nested_start(nlh, sizeof(buff));
-        attr_nh_data->nla_len = 0;
-        attr_nh_data->nla_type = IFLA_INFO_DATA;
+        struct nlattr *attr_nh_data = nl_req.nest_start(IFLA_INFO_DATA);
 
-        nlmsg_add_attr(nlh,sizeof(buff),IFLA_VLAN_ID, &vlan_id, sizeof(int));
+        nl_req.put(IFLA_VLAN_ID, vlan_id);
 
-        nlmsg_nested_end(nlh,attr_nh_data);
+        nl_req.nest_end(attr_nh_data);
     }
     //End of IFLA_LINK_INFO
-    nlmsg_nested_end(nlh,attr_nh);
+    nl_req.nest_end(attr_nh);
+
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS, ERR, "NAS-OS", "Tagged intf %s request exceeds %lu bytes",
+                   vlan_name, nl_req.capacity());
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK ||
-        (*vlan_index = cps_api_interface_name_to_if_index(vlan_name)) == 0) {
+    nl_link_echo_t link;
+    if(nl_do_link_create_request(NL_DEFAULT_VRF_NAME, nl_req.msg(), buff.data, buff.size, &link) != STD_ERR_OK) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS", "Failed to add tagged intf %s in kernel", vlan_name);
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
+    *vlan_index = link.ifindex;
     return STD_ERR_OK;
 }
 
@@ -585,14 +601,10 @@ t_std_error nas_os_create_subinterface(cps_api_object_t obj) {
 static t_std_error nas_os_add_t_port_to_os(int vlan_id, const char *vlan_name, int port_index, int *vlan_index)
 
 {
-    char buff[NL_MSG_BUFFER_LEN];
-
-    memset(buff,0,sizeof(buff));
-
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ifinfomsg));
-
-    nas_os_pack_nl_hdr(nlh, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL));
+    nas_nl::msg_buffer<vlan_create_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_NEWLINK, (NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL));
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
+    if (ifmsg == nullptr) return (STD_ERR(NAS_OS,FAIL, 0));
 
     db_interface_state_t astate;
     db_interface_operational_state_t ostate;
@@ -618,35 +630,38 @@ static t_std_error nas_os_add_t_port_to_os(int vlan_id, const char *vlan_name, i
     EV_LOG(INFO, NAS_OS, ev_log_s_MINOR, "NAS-OS", "Add tagged Vlan Name %s Vlan Id %d for port %d",
            vlan_name, vlan_id, port_index);
 
-    nlmsg_add_attr(nlh,sizeof(buff), IFLA_IFNAME, vlan_name, (strlen(vlan_name)+1));
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_LINK, &port_index, sizeof(int));
+    nl_req.put_str(IFLA_IFNAME, vlan_name);
+    nl_req.put(IFLA_LINK, port_index);
 
     /* VLAN info is set of nested attributes
      * IFLA_LINK_INFO(IFLA_INFO_KIND, IFLA_INFO_DATA(IFLA_VLAN_ID))*/
-    struct nlattr *attr_nh = nlmsg_nested_start(nlh, sizeof(buff));
-    attr_nh->nla_len = 0;
-    attr_nh->nla_type = IFLA_LINKINFO;
+    struct nlattr *attr_nh = nl_req.nest_start(IFLA_LINKINFO);
 
     const char *info_kind = "vlan";
-    nlmsg_add_attr(nlh,sizeof(buff),IFLA_INFO_KIND, info_kind, (strlen(info_kind)+1));
+    nl_req.put_str(IFLA_INFO_KIND, info_kind);
 
     if(vlan_id != 0) {
-        struct nlattr *attr_nh_data = nlmsg_nested_start(nlh, sizeof(buff));
-        attr_nh_data->nla_len = 0;
-        attr_nh_data->nla_type = IFLA_INFO_DATA;
+        struct nlattr *attr_nh_data = nl_req.nest_start(IFLA_INFO_DATA);
 
-        nlmsg_add_attr(nlh,sizeof(buff),IFLA_VLAN_ID, &vlan_id, sizeof(int));
+        nl_req.put(IFLA_VLAN_ID, vlan_id);
 
-        nlmsg_nested_end(nlh,attr_nh_data);
+        nl_req.nest_end(attr_nh_data);
     }
     //End of IFLA_LINK_INFO
-    nlmsg_nested_end(nlh,attr_nh);
+    nl_req.nest_end(attr_nh);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK ||
-        (*vlan_index = cps_api_interface_name_to_if_index(vlan_name)) == 0) {
+    if (!nl_req.ok()) {
+        EV_LOGGING(NAS_OS, ERR, "NAS-OS", "Tagged intf %s request exceeds %lu bytes",
+                   vlan_name, nl_req.capacity());
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+
+    nl_link_echo_t link;
+    if(nl_do_link_create_request(NL_DEFAULT_VRF_NAME, nl_req.msg(), buff.data, buff.size, &link) != STD_ERR_OK) {
         EV_LOGGING(NAS_OS, DEBUG, "NAS-OS", "Failed to add tagged intf %s in kernel", vlan_name);
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
+    *vlan_index = link.ifindex;
     return STD_ERR_OK;
 }
 
@@ -681,9 +696,6 @@ t_std_error nas_os_ut_port_to_vlan(hal_ifindex_t port_index, hal_ifindex_t br_in
 
 t_std_error nas_os_add_port_to_vlan(cps_api_object_t obj, hal_ifindex_t *vlan_index)
 {
-    char buff[NL_MSG_BUFFER_LEN];
-    memset(buff,0,sizeof(buff));
-
     EV_LOG(INFO, NAS_OS, ev_log_s_MINOR, "NAS-OS", "ADD Port to Vlan");
 
     cps_api_object_attr_t vlan_index_attr = cps_api_object_attr_get(obj, DELL_BASE_IF_CMN_IF_INTERFACES_INTERFACE_IF_INDEX);
@@ -759,13 +771,11 @@ t_std_error nas_os_add_port_to_vlan(cps_api_object_t obj, hal_ifindex_t *vlan_in
 
 t_std_error nas_os_change_master(hal_ifindex_t port_index, hal_vlan_id_t vlan_id, hal_ifindex_t m_index)
 {
-    char buff[NL_MSG_BUFFER_LEN];
-    memset(buff,0,sizeof(buff));
+    nas_nl::msg_buffer<vlan_master_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_SETLINK, NLM_F_REQUEST);
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
 
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ifinfomsg));
-
-    if(port_index == 0) {
+    if((port_index == 0) || (ifmsg == nullptr)) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS", "Invalid vlan interface index for deletion");
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
@@ -778,7 +788,6 @@ t_std_error nas_os_change_master(hal_ifindex_t port_index, hal_vlan_id_t vlan_id
         }
     }
 
-    nas_os_pack_nl_hdr(nlh, RTM_SETLINK, NLM_F_REQUEST);
     nas_os_pack_if_hdr(ifmsg, AF_UNSPEC, 0, port_index);
 
     EV_LOGGING(NAS_OS, INFO, "NAS-OS", "Del i/f %d from bridge", port_index);
@@ -788,9 +797,10 @@ t_std_error nas_os_change_master(hal_ifindex_t port_index, hal_vlan_id_t vlan_id
      * update it to new master
      */
 
-    nlmsg_add_attr(nlh, sizeof(buff),IFLA_MASTER, &m_index, sizeof(int));
+    nl_req.put(IFLA_MASTER, m_index);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK) {
+    if(!nl_req.ok() ||
+       (nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nl_req.msg(),buff.data,buff.size) != STD_ERR_OK)) {
         EV_LOG(ERR, NAS_OS, ev_log_s_CRITICAL, "NAS-OS", "Failure deleting port from bridge in kernel");
            return (STD_ERR(NAS_OS,FAIL, 0));
     }
@@ -802,28 +812,25 @@ t_std_error nas_os_change_master(hal_ifindex_t port_index, hal_vlan_id_t vlan_id
 
 static t_std_error nas_os_set_master(hal_ifindex_t if_index, hal_vlan_id_t vlan_id)
 {
-    char buff[NL_MSG_BUFFER_LEN];
-    memset(buff,0,sizeof(buff));
-
-    struct nlmsghdr *nlh = (struct nlmsghdr *) nlmsg_reserve((struct nlmsghdr *)buff,sizeof(buff),sizeof(struct nlmsghdr));
-    struct ifinfomsg *ifmsg = (struct ifinfomsg *) nlmsg_reserve(nlh,sizeof(buff),sizeof(struct ifinfomsg));
+    nas_nl::msg_buffer<vlan_master_msg_size::value> buff;
+    nas_nl::msg_builder nl_req(buff, RTM_SETLINK, (NLM_F_REQUEST | NLM_F_ACK));
+    struct ifinfomsg *ifmsg = nl_req.family_header<struct ifinfomsg>();
 
-    if(if_index == 0) {
+    if((if_index == 0) || (ifmsg == nullptr)) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS", "Invalid vlan interface index for deletion");
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
 
-    nas_os_pack_nl_hdr(nlh, RTM_SETLINK, (NLM_F_REQUEST | NLM_F_ACK));
-
     nas_os_pack_if_hdr(ifmsg, AF_UNSPEC, 0, if_index);
 
     EV_LOGGING(NAS_OS, INFO , "NAS-OS", "Del i/f %d from bridge",
             if_index);
     int master_index = vlan_id;
 
-    nlmsg_add_attr(nlh, sizeof(buff),IFLA_MASTER, &master_index, sizeof(int));
+    nl_req.put(IFLA_MASTER, master_index);
 
-    if(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nlh,buff,sizeof(buff)) != STD_ERR_OK) {
+    if(!nl_req.ok() ||
+       (nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT,nl_req.msg(),buff.data,buff.size) != STD_ERR_OK)) {
         EV_LOGGING(NAS_OS, ERR, "NAS-OS", "Failure setting master %d for  port %d  in kernel",
            master_index, if_index);
            return (STD_ERR(NAS_OS,FAIL, 0));
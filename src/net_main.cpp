@@ -51,8 +51,21 @@
 #include "dell-base-l2-mac.h"
 #include "nas_nlmsg_object_utils.h"
 #include "netlink_stats.h"
+#include "netlink_sock_pool.h"
+#include "netlink_resync.h"
+#include "netlink_rcvbuf.h"
+#include "netlink_uring.h"
+#include "netlink_dispatch.h"
+#include "netlink_publish.h"
+#include "netlink_dump.h"
+#include "netlink_nsid.h"
+#include "netlink_subscribe.h"
+#include "netlink_capture.h"
+#include "standard_netlink_requests.h"
 #include "nas_os_vlan_utils.h"
 #include "nas_switch.h"
+#include "dell-base-routing.h"
+#include "os-routing-events.h"
 
 #include <limits.h>
 #include <unistd.h>
@@ -60,7 +73,6 @@
 #include <sstream>
 
 #include <netinet/in.h>
-#include <ifaddrs.h>
 #include <netdb.h>
 #include <stdio.h>
 #include <sys/types.h>
@@ -69,8 +81,11 @@
 
 #include <sys/socket.h>
 #include <linux/rtnetlink.h>
+#include <sys/epoll.h>
+#include <atomic>
 #include <map>
 #include <mutex>
+#include <vector>
 
 /*
  * Global variables
@@ -82,9 +97,19 @@ typedef struct _nlm_sock_info {
     nas_nl_sock_TYPES sock_type;
     char vrf_name[NAS_VRF_NAME_SZ+1];
     uint32_t vrf_id;
+    bool resync_pending; /* Events lost or dump interrupted, resync the tables of the socket */
+    int sock;
+    bool deleted;        /* Socket closed, freed by the event thread */
+    uint64_t groups;     /* Multicast groups joined, of the subscription profile */
+    uint64_t rcvbuf_wait; /* Event ring wait the receive queue was last sampled in */
 }nlm_sock_info;
 
-static auto nlm_sockets = new std::map<int, nlm_sock_info>;
+/* Event sockets, the socket info is the data of the epoll registration of the socket
+ * (the context of its receive on the event ring) */
+static auto nlm_sockets = new std::map<int, nlm_sock_info *>;
+/* Socket info of the deleted sockets, the event thread can still hold them from the
+ * last wait - freed by the event thread before the next wait */
+static auto nlm_sockets_retired = new std::vector<nlm_sock_info *>;
 
 static INTERFACE *g_if_db;
 INTERFACE *os_get_if_db_hdlr() {
@@ -106,22 +131,32 @@ extern "C" {
 /*
  * Pthread variables
  */
-static uint64_t                     _local_event_count = 0;
+static std::atomic<uint64_t>        _local_event_count(0);
 static std_thread_create_param_t      _net_main_thr;
 static cps_api_event_service_handle_t         _handle;
 
 /* This size should be increased incase the no. of path for a route increased beyond 128 */
 const static int MAX_CPS_MSG_SIZE=12000;
 
-static fd_set read_fds;
-static int max_fd = -1;
+/* Event sockets are registered once on the epoll fd, created with the first socket */
+static int _nl_epoll_fd = -1;
 static std::mutex _nl_sock_mutex;
+/* Event sockets are received with io_uring instead of epoll */
+static bool _nl_uring_events = false;
+/* Set with the resync_pending of a socket, the sockets are looked at only then.
+ * Protected by _nl_sock_mutex */
+static bool _nl_resync_marked = false;
+
+/* Min. interval between the resyncs of the events dropped by the dispatch overload
+ * policy, the event loop wakes up at this interval while such a resync is deferred */
+#define NL_RESYNC_DROPPED_INTERVAL_MSEC 1000
+/* Event thread only */
+static uint64_t _nl_resync_dropped_last = 0;
+static bool _nl_resync_deferred = false;
 /*
  * Functions
  */
 
-#define KN_DEBUG(x,...) EV_LOG_TRACE (ev_log_t_NETLINK,0,"NL-DBG",x, ##__VA_ARGS__)
-
 static t_std_error nas_os_create_publish_handle() {
     if (_handle != nullptr)
         return STD_ERR_OK;
@@ -151,6 +186,73 @@ cps_api_return_code_t net_publish_event(cps_api_object_t msg) {
     return rc;
 }
 
+/* Publish the translated event, the object is on the translation buffer and is
+ * copied when the events are batched */
+static cps_api_return_code_t nl_publish_event(nl_publish_class_t cls, cps_api_object_t obj) {
+    if (nl_publish_batching()) {
+        cps_api_object_t copy = cps_api_object_create();
+        if ((copy != nullptr) && cps_api_object_clone(copy, obj)) {
+            cps_api_object_delete(obj);
+            nl_publish_add(cls, copy);
+            return cps_api_ret_code_OK;
+        }
+        if (copy != nullptr) cps_api_object_delete(copy);
+    }
+    return net_publish_event(obj);
+}
+
+/* Append the attribute (length and data) to the publish key, a missing attribute is
+ * appended with length 0 */
+static bool nl_publish_key_add(cps_api_object_t obj, cps_api_attr_id_t id, char *key,
+                               size_t len, size_t &off) {
+    cps_api_object_attr_t attr = cps_api_object_attr_get(obj, id);
+    uint16_t attr_len = (attr != nullptr) ? cps_api_object_attr_len(attr) : 0;
+    if ((off + sizeof(attr_len) + attr_len) > len) return false;
+    memcpy(key + off, &attr_len, sizeof(attr_len));
+    off += sizeof(attr_len);
+    if (attr_len != 0) {
+        memcpy(key + off, cps_api_object_attr_data_bin(attr), attr_len);
+        off += attr_len;
+    }
+    return true;
+}
+
+/* Key of the route and neighbor objects held for publish, a later event of the same
+ * route (VRF, prefix) or neighbor (VRF, address, interface) replaces the held one.
+ * IPv6 route events are not replaced - the kernel notifies the next hops of a multipath
+ * route one event each. */
+static size_t nl_publish_obj_key(nl_publish_class_t cls, cps_api_object_t obj, void *key, size_t len) {
+    static const cps_api_attr_id_t route_key[] = {
+        BASE_ROUTE_OBJ_ENTRY_VRF_ID, BASE_ROUTE_OBJ_ENTRY_AF, BASE_ROUTE_OBJ_ENTRY_ROUTE_PREFIX,
+        BASE_ROUTE_OBJ_ENTRY_PREFIX_LEN, BASE_ROUTE_OBJ_ENTRY_SPECIAL_NEXT_HOP };
+    static const cps_api_attr_id_t neigh_key[] = {
+        OS_RE_BASE_ROUTE_OBJ_NBR_VRF_ID, BASE_ROUTE_OBJ_NBR_AF, BASE_ROUTE_OBJ_NBR_ADDRESS,
+        BASE_ROUTE_OBJ_NBR_IFINDEX, BASE_ROUTE_OBJ_NBR_MAC_ADDR };
+    const cps_api_attr_id_t *ids = nullptr;
+    size_t count = 0;
+
+    if (cls == NL_PUBLISH_CLASS_ROUTE) {
+        cps_api_object_attr_t af = cps_api_object_attr_get(obj, BASE_ROUTE_OBJ_ENTRY_AF);
+        if ((af == nullptr) || (cps_api_object_attr_data_u32(af) != AF_INET)) return 0;
+        ids = route_key;
+        count = sizeof(route_key)/sizeof(route_key[0]);
+    } else if (cls == NL_PUBLISH_CLASS_NEIGH) {
+        ids = neigh_key;
+        /* The MAC address is the state of an IP neighbor, it is the key of a bridge entry */
+        cps_api_object_attr_t af = cps_api_object_attr_get(obj, BASE_ROUTE_OBJ_NBR_AF);
+        bool bridge = (af != nullptr) && (cps_api_object_attr_data_u32(af) == AF_BRIDGE);
+        count = sizeof(neigh_key)/sizeof(neigh_key[0]) - (bridge ? 0 : 1);
+    } else {
+        return 0;
+    }
+
+    size_t off = 0;
+    for (size_t ix = 0; ix < count; ++ix) {
+        if (!nl_publish_key_add(obj, ids[ix], (char *)key, len, off)) return 0;
+    }
+    return off;
+}
+
 void cps_api_event_count_clear(void) {
     _local_event_count = 0;
 }
@@ -197,14 +299,18 @@ unsigned int rta_add_name( struct nlattr* rtatp,cps_api_object_t obj, uint32_t a
     return len;
 }
 
+/* Called from the event dispatch workers, the translation buffer is per thread */
 static bool get_netlink_data(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *data, uint32_t vrf_id) {
-    static char buff[MAX_CPS_MSG_SIZE];
+    static __thread char buff[MAX_CPS_MSG_SIZE];
 
     cps_api_object_t obj = cps_api_object_init(buff,sizeof(buff));
 
     if (rt_msg_type < RTM_BASE)
         return false;
 
+    /* Events left out of the subscription profile of the VRF */
+    if (!nl_subscribe_wanted((const char *)data, rt_msg_type, hdr)) return true;
+
     EV_LOGGING(NETLINK,INFO,"NL_EVT","VRF name:%s id:%d sock:%d msg_type:%d(%s) ",
                (char*) (data ? data : ""), vrf_id, sock, rt_msg_type,
                ((rt_msg_type <= RTM_SETLINK) ? "Link" : ((rt_msg_type <= RTM_GETADDR) ? "Addr" :
@@ -219,7 +325,7 @@ static bool get_netlink_data(int sock, int rt_msg_type, struct nlmsghdr *hdr, vo
         nas_nl_stats_update_tot_msg (sock, rt_msg_type);
         if (os_interface_to_object(rt_msg_type, hdr,obj, &evt_publish, vrf_id) == STD_ERR_OK && evt_publish) {
             nas_nl_stats_update_pub_msg (sock, rt_msg_type);
-            if (net_publish_event(obj) != cps_api_ret_code_OK) {
+            if (nl_publish_event(NL_PUBLISH_CLASS_INTF, obj) != cps_api_ret_code_OK) {
                 nas_nl_stats_update_pub_msg_failed (sock, rt_msg_type);
             }
         } else {
@@ -234,8 +340,9 @@ static bool get_netlink_data(int sock, int rt_msg_type, struct nlmsghdr *hdr, vo
     if (rt_msg_type <= RTM_GETADDR) {
         nas_nl_stats_update_tot_msg (sock, rt_msg_type);
         if (nl_get_ip_info(rt_msg_type,hdr,obj,data, vrf_id, cps_api_qualifier_OBSERVED)) {
+            nl_resync_shadow_update(vrf_id, hdr);
             nas_nl_stats_update_pub_msg (sock, rt_msg_type);
-            if (net_publish_event(obj) != cps_api_ret_code_OK) {
+            if (nl_publish_event(NL_PUBLISH_CLASS_INTF, obj) != cps_api_ret_code_OK) {
                 nas_nl_stats_update_pub_msg_failed (sock, rt_msg_type);
             }
         } else {
@@ -250,8 +357,9 @@ static bool get_netlink_data(int sock, int rt_msg_type, struct nlmsghdr *hdr, vo
     if (rt_msg_type <= RTM_GETROUTE) {
         nas_nl_stats_update_tot_msg (sock, rt_msg_type);
         if (nl_to_route_info(rt_msg_type,hdr, obj, data, vrf_id)) {
+            nl_resync_shadow_update(vrf_id, hdr);
             nas_nl_stats_update_pub_msg (sock, rt_msg_type);
-            if (net_publish_event(obj) != cps_api_ret_code_OK) {
+            if (nl_publish_event(NL_PUBLISH_CLASS_ROUTE, obj) != cps_api_ret_code_OK) {
                 nas_nl_stats_update_pub_msg_failed (sock, rt_msg_type);
             }
         } else {
@@ -266,8 +374,9 @@ static bool get_netlink_data(int sock, int rt_msg_type, struct nlmsghdr *hdr, vo
     if (rt_msg_type <= RTM_GETNEIGH) {
         nas_nl_stats_update_tot_msg (sock, rt_msg_type);
         if (nl_to_neigh_info(rt_msg_type, hdr,obj,data, vrf_id)) {
+            nl_resync_shadow_update(vrf_id, hdr);
             nas_nl_stats_update_pub_msg (sock, rt_msg_type);
-            if (net_publish_event(obj) != cps_api_ret_code_OK) {
+            if (nl_publish_event(NL_PUBLISH_CLASS_NEIGH, obj) != cps_api_ret_code_OK) {
                 nas_nl_stats_update_pub_msg_failed (sock, rt_msg_type);
             }
         } else {
@@ -282,7 +391,7 @@ static bool get_netlink_data(int sock, int rt_msg_type, struct nlmsghdr *hdr, vo
         nas_nl_stats_update_tot_msg (sock, rt_msg_type);
         if (nl_get_ip_netconf_info(rt_msg_type,hdr, obj, data, vrf_id)) {
             nas_nl_stats_update_pub_msg (sock, rt_msg_type);
-            if (net_publish_event(obj) != cps_api_ret_code_OK) {
+            if (nl_publish_event(NL_PUBLISH_CLASS_INTF, obj) != cps_api_ret_code_OK) {
                 nas_nl_stats_update_pub_msg_failed (sock, rt_msg_type);
             }
         } else {
@@ -304,91 +413,41 @@ static bool get_netlink_data(int sock, int rt_msg_type, struct nlmsghdr *hdr, vo
     return false;
 }
 
-static void publish_existing()
-{
-    struct ifaddrs *if_addr, *ifa;
-    int    family, s;
-    char   name[NI_MAXHOST];
-
-
-
-    if(getifaddrs(&if_addr) == -1) {
-        return;
-    }
-
-    for (ifa = if_addr; ifa; ifa = ifa->ifa_next)
-    {
-        if(ifa->ifa_addr == NULL)
-            continue;
-
-        family = ifa->ifa_addr->sa_family;
-
-        if (family == AF_INET || family == AF_INET6)
-        {
-            KN_DEBUG("%s - family: %d%s, flags 0x%x",
-                ifa->ifa_name, family,
-                (family == AF_INET)?"(AF_INET)":
-                (family == AF_INET6)?"(AF_INET6)":"", ifa->ifa_flags);
-
-            s = getnameinfo(ifa->ifa_addr,
-                            (family == AF_INET)? sizeof(struct sockaddr_in):
-                                                 sizeof(struct sockaddr_in6),
-                            name, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
-
-            if (!s)
-                KN_DEBUG("  Address %s", name);
-            else
-                KN_DEBUG("  get name failed");
-
-            s = getnameinfo(ifa->ifa_netmask,
-                            (family == AF_INET)? sizeof(struct sockaddr_in):
-                                                 sizeof(struct sockaddr_in6),
-                            name, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
-            if (!s)
-                KN_DEBUG("  Mask %s strlen %d", name, (int)strlen(name));
-            else
-                KN_DEBUG("  get name failed");
-
-
-            cps_api_object_t obj = cps_api_object_create();
-            cps_api_object_attr_add(obj,cps_api_if_ADDR_A_NAME,
-                    ifa->ifa_name,strlen(ifa->ifa_name)+1);
-
-            if (family == AF_INET) {
-                hal_ip_addr_t ip;
-                std_ip_from_inet(&ip,&(((struct sockaddr_in *)ifa->ifa_addr)->sin_addr));
-                cps_api_object_attr_add(obj,cps_api_if_ADDR_A_IF_ADDR,
-                                    &ip,sizeof(ip));
-
-                std_ip_from_inet(&ip,&(((struct sockaddr_in *)ifa->ifa_netmask)->sin_addr));
-                cps_api_object_attr_add(obj,cps_api_if_ADDR_A_IF_MASK,
-                                    &ip,sizeof(ip));
-            }
-            else {
-                hal_ip_addr_t ip;
-                std_ip_from_inet6(&ip,&(((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr));
-                cps_api_object_attr_add(obj,cps_api_if_ADDR_A_IF_ADDR,
-                                    &ip,sizeof(ip));
-                std_ip_from_inet6(&ip,&(((struct sockaddr_in6 *)ifa->ifa_netmask)->sin6_addr));
-                cps_api_object_attr_add(obj,cps_api_if_ADDR_A_IF_MASK,
-                                    &ip,sizeof(ip));
-            }
-            cps_api_key_init(cps_api_object_key(obj),cps_api_qualifier_TARGET,
-                    cps_api_obj_cat_INTERFACE,cps_api_int_obj_INTERFACE_ADDR,0);
-            net_publish_event(obj);
-
+static char   buf[NL_SCRATCH_BUFFER_LEN];
+/* Receive ring for the events, used only from the event thread */
+static nl_event_ring_t *evt_ring = nullptr;
+
+/* Max. number of ready sockets returned by one epoll wait */
+#define NL_EPOLL_MAX_EVENTS 64
+
+/* Register the event socket on the epoll fd, called with _nl_sock_mutex held */
+static bool nl_epoll_add(nlm_sock_info *info) {
+    if (_nl_epoll_fd == -1) {
+        _nl_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (_nl_epoll_fd == -1) {
+            EV_LOGGING(NETLINK,ERR,"NL_SOCK","Failed to create the epoll fd errno %d", errno);
+            return false;
         }
     }
-
-    freeifaddrs(if_addr);
-    return;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = info;
+    if (epoll_ctl(_nl_epoll_fd, EPOLL_CTL_ADD, info->sock, &ev) != 0) {
+        EV_LOGGING(NETLINK,ERR,"NL_SOCK","Failed to add sock %d to the epoll fd errno %d", info->sock, errno);
+        return false;
+    }
+    return true;
 }
 
-static char   buf[NL_SCRATCH_BUFFER_LEN];
-
-static inline void add_fd_set(int fd, fd_set &fdset, int &max_fd) {
-    FD_SET(fd, &fdset);
-    if (fd>max_fd) max_fd = fd;
+/* Free the socket info of the deleted sockets, called by the event thread before the
+ * wait - no event returned by the previous wait refers to them anymore */
+static void nl_free_retired_socks() {
+    std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+    for (auto info : *nlm_sockets_retired) {
+        delete info;
+    }
+    nlm_sockets_retired->clear();
 }
 
 struct nl_event_desc {
@@ -397,70 +456,145 @@ struct nl_event_desc {
 } ;
 
 static bool trigger_route(int sock, int reqid, char* vrf_name, uint32_t vrf_id);
+static bool trigger_interface(int sock, int reqid, char* vrf_name, uint32_t vrf_id);
 static bool trigger_neighbour(int sock, int reqid, char* vrf_name, uint32_t vrf_id);
 static bool trigger_netconf(int sock, int reqid, char* vrf_name, uint32_t vrf_id);
 static bool trigger_mcast_snoop(int sock, int reqid, char* vrf_name, uint32_t vrf_id);
 
 static auto nlm_handlers = new std::map<nas_nl_sock_TYPES,nl_event_desc >{
-    { nas_nl_sock_T_ROUTE , { get_netlink_data, &trigger_route} } ,
-    { nas_nl_sock_T_INT ,{ get_netlink_data, nl_interface_get_request} },
-    { nas_nl_sock_T_NEI ,{ get_netlink_data,&trigger_neighbour } },
-    { nas_nl_sock_T_NETCONF ,{ get_netlink_data, &trigger_netconf } },
-    { nas_nl_sock_T_MCAST_SNOOP , { get_netlink_data, &trigger_mcast_snoop} }
+    { nas_nl_sock_T_ROUTE , { nl_dispatch_msg, &trigger_route} } ,
+    { nas_nl_sock_T_INT ,{ nl_dispatch_msg, &trigger_interface} },
+    { nas_nl_sock_T_NEI ,{ nl_dispatch_msg,&trigger_neighbour } },
+    { nas_nl_sock_T_NETCONF ,{ nl_dispatch_msg, &trigger_netconf } },
+    { nas_nl_sock_T_MCAST_SNOOP , { nl_dispatch_msg, &trigger_mcast_snoop} }
 };
 
+/* Resync the tables of the socket from the event loop, called with _nl_sock_mutex held */
+static void nl_resync_mark(nlm_sock_info &info) {
+    info.resync_pending = true;
+    _nl_resync_marked = true;
+}
+
+/* Process the response of the dump requested on the event socket, the entries already
+ * published are resynced if the dump is interrupted by a change in the table */
+static void nl_process_existing(int sock, nas_nl_sock_TYPES type, int reqid, char* vrf_name, uint32_t vrf_id) {
+    int err = 0;
+    if (!netlink_tools_process_socket(sock,nlm_handlers->at(type).process,
+                vrf_name,buf,sizeof(buf),&reqid,&err,vrf_id) && (err == EINTR)) {
+        auto it = nlm_sockets->find(sock);
+        if (it != nlm_sockets->end()) nl_resync_mark(*it->second);
+        EV_LOGGING(NETLINK,INFO,"NL-RESYNC","Dump interrupted VRF:%s sock:%d type:%d",
+                   vrf_name, sock, type);
+    }
+}
+
 static bool trigger_route(int sock, int reqid, char* vrf_name, uint32_t vrf_id) {
     if (nl_request_existing_routes(sock,AF_INET,++reqid)) {
-        netlink_tools_process_socket(sock,nlm_handlers->at(nas_nl_sock_T_ROUTE).process,
-                vrf_name,buf,sizeof(buf),&reqid,NULL,vrf_id);
+        nl_process_existing(sock,nas_nl_sock_T_ROUTE,reqid,vrf_name,vrf_id);
     }
 
     if (nl_request_existing_routes(sock,AF_INET6,++reqid)) {
-        netlink_tools_process_socket(sock,nlm_handlers->at(nas_nl_sock_T_ROUTE).process,
-                vrf_name,buf,sizeof(buf),&reqid,NULL,vrf_id);
+        nl_process_existing(sock,nas_nl_sock_T_ROUTE,reqid,vrf_name,vrf_id);
+    }
+    return true;
+}
+
+/* Links first, then the addresses on them */
+static bool trigger_interface(int sock, int reqid, char* vrf_name, uint32_t vrf_id) {
+    if (nl_interface_get_request(sock,++reqid,vrf_name,vrf_id)) {
+        nl_process_existing(sock,nas_nl_sock_T_INT,reqid,vrf_name,vrf_id);
+    }
+
+    if (nl_addr_send_dump(sock,AF_INET,0,++reqid)) {
+        nl_process_existing(sock,nas_nl_sock_T_INT,reqid,vrf_name,vrf_id);
+    }
+
+    if (nl_addr_send_dump(sock,AF_INET6,0,++reqid)) {
+        nl_process_existing(sock,nas_nl_sock_T_INT,reqid,vrf_name,vrf_id);
     }
     return true;
 }
 
 static bool trigger_mcast_snoop(int sock, int reqid, char* vrf_name, uint32_t vrf_id) {
     if (nl_request_existing_routes(sock,AF_INET,++reqid)) {
-        netlink_tools_process_socket(sock,nlm_handlers->at(nas_nl_sock_T_MCAST_SNOOP).process,
-                vrf_name,buf,sizeof(buf),&reqid,NULL,vrf_id);
+        nl_process_existing(sock,nas_nl_sock_T_MCAST_SNOOP,reqid,vrf_name,vrf_id);
     }
 
     if (nl_request_existing_routes(sock,AF_INET6,++reqid)) {
-        netlink_tools_process_socket(sock,nlm_handlers->at(nas_nl_sock_T_MCAST_SNOOP).process,
-                vrf_name,buf,sizeof(buf),&reqid,NULL,vrf_id);
+        nl_process_existing(sock,nas_nl_sock_T_MCAST_SNOOP,reqid,vrf_name,vrf_id);
     }
     return true;
 }
 
 static bool trigger_neighbour(int sock, int reqid, char* vrf_name, uint32_t vrf_id) {
     if (nl_neigh_get_all_request(sock,AF_INET,++reqid)) {
-        netlink_tools_process_socket(sock,nlm_handlers->at(nas_nl_sock_T_NEI).process,
-                vrf_name,buf,sizeof(buf),&reqid,NULL,vrf_id);
+        nl_process_existing(sock,nas_nl_sock_T_NEI,reqid,vrf_name,vrf_id);
     }
 
     if (nl_neigh_get_all_request(sock,AF_INET6,++reqid)) {
-        netlink_tools_process_socket(sock,nlm_handlers->at(nas_nl_sock_T_NEI).process,
-                vrf_name,buf,sizeof(buf),&reqid,NULL,vrf_id);
+        nl_process_existing(sock,nas_nl_sock_T_NEI,reqid,vrf_name,vrf_id);
     }
     return true;
 }
 
 static bool trigger_netconf(int sock, int reqid, char* vrf_name, uint32_t vrf_id) {
     if (nl_netconf_get_all_request(sock,AF_INET,++reqid)) {
-        netlink_tools_process_socket(sock,nlm_handlers->at(nas_nl_sock_T_NETCONF).process,
-                vrf_name,buf,sizeof(buf),&reqid,NULL,vrf_id);
+        nl_process_existing(sock,nas_nl_sock_T_NETCONF,reqid,vrf_name,vrf_id);
     }
     if (nl_netconf_get_all_request(sock,AF_INET6,++reqid)) {
-        netlink_tools_process_socket(sock,nlm_handlers->at(nas_nl_sock_T_NETCONF).process,
-                vrf_name,buf,sizeof(buf),&reqid,NULL,vrf_id);
+        nl_process_existing(sock,nas_nl_sock_T_NETCONF,reqid,vrf_name,vrf_id);
     }
 
     return true;
 }
 
+/* Link dump of the scheduler, the VRF is given by the request socket */
+static bool nl_link_dump_request(int sock, int family, int req_id) {
+    return nl_interface_get_request(sock, req_id, NULL, 0);
+}
+
+/* Addresses of all the interfaces of the VRF */
+static bool nl_addr_dump_request(int sock, int family, int req_id) {
+    return nl_addr_send_dump(sock, family, 0, req_id);
+}
+
+/* Handler of the entries dumped by the dump threads - dispatched to the workers, or
+ * serialized with the event thread when the messages are processed inline. The entries
+ * of the objects with later events are dropped (dump fence) */
+static bool nl_dump_handler(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    if (nl_dispatch_workers() != 0) {
+        return nl_dispatch_dump_msg(sock, rt_msg_type, hdr, context, vrf_id);
+    }
+    std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+    return nl_dispatch_dump_msg(sock, rt_msg_type, hdr, context, vrf_id);
+}
+
+/* Resync the table of the VRF with the event loop, the table of a VRF mapped by its
+ * NSID is resynced with the listener of the default VRF. Called with _nl_sock_mutex held */
+static void nl_resync_vrf_table(const char *vrf_name, nas_nl_sock_TYPES type) {
+    bool found = false;
+    for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+        if ((it->second->sock_type == type) &&
+            (strncmp(vrf_name, it->second->vrf_name, NAS_VRF_NAME_SZ) == 0)) {
+            nl_resync_mark(*it->second);
+            found = true;
+        }
+    }
+    if (found || !nl_nsid_enabled()) return;
+    for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+        if ((it->second->sock_type == type) &&
+            (strncmp(NL_DEFAULT_VRF_NAME, it->second->vrf_name, NAS_VRF_NAME_SZ) == 0)) {
+            nl_resync_mark(*it->second);
+        }
+    }
+}
+
+/* Resync the table of the failed dump */
+static void nl_dump_table_failed(const char *vrf_name, nas_nl_sock_TYPES type) {
+    std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+    nl_resync_vrf_table(vrf_name, type);
+}
+
 
 void os_debug_nl_stats_reset () {
     std::lock_guard<std::mutex> lock(_nl_sock_mutex);
@@ -469,45 +603,343 @@ void os_debug_nl_stats_reset () {
     }
 }
 
+/* Max. receive buffer size of the event socket, the buffer grows up to this size
+ * on demand - the fixed size the socket was given before */
+static size_t nl_rcvbuf_max_len(nas_nl_sock_TYPES type) {
+    return ((type == nas_nl_sock_T_ROUTE) ? NL_ROUTE_SOCKET_BUFFER_LEN :
+            (type == nas_nl_sock_T_INT) ? NL_INTF_SOCKET_BUFFER_LEN :
+            (type == nas_nl_sock_T_NEI) ? NL_NEIGH_SOCKET_BUFFER_LEN :
+            (type == nas_nl_sock_T_NETCONF) ? NL_NETCONF_SOCKET_BUFFER_LEN : 0);
+}
+
 void os_debug_nl_stats_print () {
     printf("\r\n NETLINK STATS INFORMATION scratch buf-size: %d\r\n",
            NL_SCRATCH_BUFFER_LEN);
 
+    if (nl_dispatch_workers() != 0) {
+        nl_dispatch_stats_t dstats;
+        nl_dispatch_stats_get(&dstats);
+        printf("\r\n Dispatch workers: %lu queued: %lu coalesced: %lu cancelled: %lu pending: %lu dropped: %lu"
+               " fenced: %lu\r\n",
+               nl_dispatch_workers(), dstats.queued, dstats.coalesced, dstats.cancelled, dstats.pending,
+               dstats.dropped, dstats.fenced);
+        nl_dispatch_lane_stats_t lstats;
+        for (size_t lane = 0; nl_dispatch_lane_stats_get(lane, &lstats); ++lane) {
+            printf(" Lane %lu overloads: %lu dropped: %lu blocked: %lu\r\n",
+                   lane, lstats.overloads, lstats.dropped, lstats.blocked);
+            for (size_t prio = 0; prio < NL_DISPATCH_PRIO_MAX; ++prio) {
+                const nl_dispatch_latency_t &lat = lstats.latency[prio];
+                printf(" Lane %lu %-4s events: %lu avg-usec: %lu max-usec: %lu depth: %lu max-depth: %lu\r\n",
+                       lane, (prio == NL_DISPATCH_PRIO_HIGH) ? "high" : "low", lat.events,
+                       (lat.events != 0) ? (lat.total_usec / lat.events) : 0, lat.max_usec,
+                       lat.depth, lat.max_depth);
+            }
+        }
+    }
+    if (nl_publish_batching()) {
+        nl_publish_stats_t pstats;
+        nl_publish_stats_get(&pstats);
+        printf("\r\n Publish batches: %lu objects: %lu failed: %lu max-batch: %lu queued: %lu max-queued: %lu blocked: %lu coalesced: %lu\r\n",
+               pstats.batches, pstats.objects, pstats.failed, pstats.max_batch,
+               pstats.queued, pstats.max_queued, pstats.blocked, pstats.coalesced);
+    }
+
+    nl_dump_stats_t dump_stats;
+    nl_dump_stats_get(&dump_stats);
+    printf("\r\n Dump VRFs: %lu dumps: %lu retries: %lu failed: %lu pending: %lu max-vrf-usec: %lu\r\n",
+           dump_stats.vrfs, dump_stats.dumps, dump_stats.retries, dump_stats.failed,
+           dump_stats.pending, dump_stats.max_vrf_usec);
+
+    if (nl_nsid_enabled()) {
+        nl_nsid_stats_t nsid_stats;
+        nl_nsid_stats_get(&nsid_stats);
+        printf("\r\n NSID listener VRFs: %lu unmapped: %lu\r\n", nsid_stats.vrfs, nsid_stats.unmapped);
+        nl_nsid_vrf_walk([](int nsid, uint32_t vrf_id, const char *vrf_name, void *context) {
+            printf(" NSID:%d VRF:%s id:%u\r\n", nsid, vrf_name, vrf_id);
+        }, nullptr);
+    }
+
     std::lock_guard<std::mutex> lock(_nl_sock_mutex);
     for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
-        printf("\r\n VRF:%s Socket type: %-10s sock-fd: %-10d socket-rx-buf-size: %-10d\r\n",
-               it->second.vrf_name,
-               ((it->second.sock_type == nas_nl_sock_T_ROUTE) ? "Route" :
-                (it->second.sock_type == nas_nl_sock_T_INT) ? "Intf" :
-                (it->second.sock_type == nas_nl_sock_T_NEI) ? "Nbr" : "NetConf"),
-               it->first,
-               ((it->second.sock_type == nas_nl_sock_T_ROUTE) ? NL_ROUTE_SOCKET_BUFFER_LEN :
-                (it->second.sock_type == nas_nl_sock_T_INT) ? NL_INTF_SOCKET_BUFFER_LEN :
-                (it->second.sock_type == nas_nl_sock_T_NEI) ? NL_NEIGH_SOCKET_BUFFER_LEN :
-                (it->second.sock_type == nas_nl_sock_T_NETCONF) ? NL_NETCONF_SOCKET_BUFFER_LEN: 0));
+        printf("\r\n VRF:%s Socket type: %-10s sock-fd: %-10d socket-rx-buf-max-size: %-10lu groups: 0x%lx\r\n",
+               it->second->vrf_name,
+               ((it->second->sock_type == nas_nl_sock_T_ROUTE) ? "Route" :
+                (it->second->sock_type == nas_nl_sock_T_INT) ? "Intf" :
+                (it->second->sock_type == nas_nl_sock_T_NEI) ? "Nbr" : "NetConf"),
+               it->first, nl_rcvbuf_max_len(it->second->sock_type),
+               it->second->groups);
         printf("\r=========================================================================\r\n");
 
         nas_nl_stats_print (it->first);
     }
 }
 
+/* VRF name of the captured datagram, the default VRF if there is no event socket or
+ * NSID map for it */
+static const char *nl_replay_vrf_name(uint32_t vrf_id) {
+    for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+        if (it->second->vrf_id == vrf_id) return it->second->vrf_name;
+    }
+    static char nsid_vrf_name[NAS_VRF_NAME_SZ + 1];
+    nsid_vrf_name[0] = '\0';
+    std::pair<uint32_t, char *> match(vrf_id, nsid_vrf_name);
+    nl_nsid_vrf_walk([](int nsid, uint32_t vrf_id, const char *vrf_name, void *context) {
+        auto match = (std::pair<uint32_t, char *> *)context;
+        if (match->first == vrf_id) safestrncpy(match->second, vrf_name, NAS_VRF_NAME_SZ + 1);
+    }, &match);
+    return (nsid_vrf_name[0] != '\0') ? nsid_vrf_name : NL_DEFAULT_VRF_NAME;
+}
+
+t_std_error os_nl_replay(const char *path, bool paced, nl_replay_stats_t *stats) {
+    nl_replay_stats_t _stats;
+    if (stats == nullptr) stats = &_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    /* Replay can be run without the event thread (e.g. from a test) */
+    if (nas_os_create_publish_handle() != STD_ERR_OK) {
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+    nl_dispatch_init(get_netlink_data);
+    nl_publish_init(net_publish_event, nl_publish_obj_key, cps_api_object_delete);
+    {
+        std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+        if (g_if_db == nullptr) g_if_db = new (std::nothrow) (INTERFACE);
+        if (g_if_bridge_db == nullptr) g_if_bridge_db = new (std::nothrow) (if_bridge);
+        if (g_if_bond_db == nullptr) g_if_bond_db = new (std::nothrow) (if_bond);
+        if ((g_if_db == nullptr) || (g_if_bridge_db == nullptr) || (g_if_bond_db == nullptr)) {
+            EV_LOGGING(NETLINK,ERR,"NL-REPLAY","Allocation failed for class objects...");
+            return (STD_ERR(NAS_OS,FAIL, 0));
+        }
+    }
+
+    nl_capture_reader_t *reader = nl_capture_open(path);
+    if (reader == nullptr) {
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+
+    nl_capture_rec_t rec;
+    uint64_t first_ts = 0;
+    uint64_t start = std_get_uptime(NULL);
+    while (nl_capture_read(reader, &rec)) {
+        if (paced) {
+            /* Keep the captured inter-arrival time of the datagrams */
+            if (stats->datagrams == 0) first_ts = rec.ts_nsec;
+            uint64_t due = (rec.ts_nsec > first_ts) ? ((rec.ts_nsec - first_ts) / 1000) : 0;
+            uint64_t now = std_get_uptime(NULL) - start;
+            if (due > now) usleep(due - now);
+        }
+        /* Serialized with the event thread like the datagrams read from the event sockets */
+        std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+        fn_nl_msg_handle process = nl_dispatch_msg;
+        auto it = nlm_handlers->find(rec.sock_type);
+        if (it != nlm_handlers->end()) process = it->second.process;
+
+        int err = 0;
+        stats->msgs += netlink_tools_process_datagram(-1, process, (void *)nl_replay_vrf_name(rec.vrf_id),
+                                                      rec.data, rec.len, &err, rec.vrf_id);
+        stats->datagrams++;
+    }
+    /* Replay is done when the dispatched messages are processed and published */
+    nl_dispatch_drain();
+    nl_publish_flush();
+    stats->elapsed_usec = std_get_uptime(NULL) - start;
+    nl_capture_close(reader);
+
+    EV_LOGGING(NETLINK,INFO,"NL-REPLAY","Replayed %s, datagrams:%lu msgs:%lu in %lu usec",
+               path, stats->datagrams, stats->msgs, stats->elapsed_usec);
+    return STD_ERR_OK;
+}
+
+void os_debug_nl_capture_start (const char *path) {
+    if (nl_capture_start(path) == STD_ERR_OK) {
+        printf("\r\n Capturing the netlink events into %s\r\n", path);
+    } else {
+        printf("\r\n Failed to start the capture into %s\r\n", path);
+    }
+}
+
+void os_debug_nl_capture_stop () {
+    nl_capture_stop();
+}
+
+void os_debug_nl_replay (const char *path, bool paced) {
+    nl_replay_stats_t stats;
+    if (os_nl_replay(path, paced, &stats) != STD_ERR_OK) {
+        printf("\r\n Failed to replay %s\r\n", path);
+        return;
+    }
+    printf("\r\n Replayed %s datagrams: %lu msgs: %lu elapsed: %lu usec",
+           path, stats.datagrams, stats.msgs, stats.elapsed_usec);
+    if (stats.elapsed_usec != 0) {
+        printf(" (%lu msgs/sec)", (stats.msgs * 1000000) / stats.elapsed_usec);
+    }
+    printf("\r\n");
+}
+
 void os_send_refresh(nas_nl_sock_TYPES type, char *vrf_name, uint32_t vrf_id) {
     int RANDOM_REQ_ID = (int)std_get_uptime(NULL);
 
     for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end(); ++it) {
-        if (((it->second).sock_type == type) &&
-            (strncmp(vrf_name, (it->second).vrf_name, NAS_VRF_NAME_SZ) == 0) &&
-            (nlm_handlers->at((it->second).sock_type).trigger!=NULL)) {
-            nlm_handlers->at((it->second).sock_type).trigger(it->first,RANDOM_REQ_ID, vrf_name, vrf_id);
+        if ((it->second->sock_type == type) &&
+            (strncmp(vrf_name, it->second->vrf_name, NAS_VRF_NAME_SZ) == 0) &&
+            (nlm_handlers->at(it->second->sock_type).trigger!=NULL)) {
+            nlm_handlers->at(it->second->sock_type).trigger(it->first,RANDOM_REQ_ID, vrf_name, vrf_id);
         }
     }
 }
 
+typedef struct {
+    nas_nl_sock_TYPES type;
+    int sock;
+    fn_nl_msg_handle process;
+} nl_nsid_resync_t;
+
+static void nl_add_dumps(std::vector<nl_dump_t> &dumps, const char *vrf_name, nas_nl_sock_TYPES type,
+                         int evt_sock);
+
+/* Resync the table of a VRF mapped by its NSID, its events are lost with the listener */
+static void nl_resync_nsid_vrf(int nsid, uint32_t vrf_id, const char *vrf_name, void *context) {
+    const nl_nsid_resync_t *resync = (const nl_nsid_resync_t *)context;
+    if (nl_resync_table(vrf_name, vrf_id, resync->type, resync->sock, resync->process)) return;
+
+    /* Publish the whole table again when it can not be compared */
+    std::vector<nl_dump_t> dumps;
+    nl_add_dumps(dumps, vrf_name, resync->type, resync->sock);
+    if (!nl_dump_vrf(vrf_name, vrf_id, dumps.data(), dumps.size())) {
+        EV_LOGGING(NETLINK,ERR,"NL-RESYNC","Failed to resync VRF:%s type:%d", vrf_name, resync->type);
+    }
+}
+
+/* Resync the tables of the sockets that lost events, the socket is drained first so
+ * that the events processed after the resync are newer than the dump */
+static void nl_resync_pending() {
+    _nl_resync_deferred = false;
+    if (nl_dispatch_dropped_any()) {
+        /* Events dropped by the dispatch overload policy. The tables are resynced once
+         * all the lanes are drained under their low-water mark and at most once per
+         * interval, a resync while the lanes are full would only add to the burst */
+        uint64_t now = std_get_uptime(NULL);
+        if (nl_dispatch_overloaded() ||
+            ((now - _nl_resync_dropped_last) < ((uint64_t)NL_RESYNC_DROPPED_INTERVAL_MSEC * 1000))) {
+            _nl_resync_deferred = true;
+        } else {
+            _nl_resync_dropped_last = now;
+            for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+                if (nl_dispatch_dropped(it->first)) nl_resync_mark(*it->second);
+            }
+        }
+    }
+    if (!_nl_resync_marked) return;
+    _nl_resync_marked = false;
+
+    for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+        if (!it->second->resync_pending || it->second->deleted) continue;
+        it->second->resync_pending = false;
+
+        const nl_event_desc &desc = nlm_handlers->at(it->second->sock_type);
+        int err = 0;
+        while (netlink_tools_receive_events(it->first,desc.process,it->second->vrf_name,evt_ring,
+                                            &err,it->second->vrf_id) == evt_ring->depth);
+        /* Shadow is updated by the workers, the dump is compared once they are done */
+        nl_dispatch_drain();
+
+        if (!nl_resync_table(it->second->vrf_name, it->second->vrf_id, it->second->sock_type,
+                             it->first, desc.process) && (desc.trigger != NULL)) {
+            /* Publish the whole table again when it can not be compared */
+            desc.trigger(it->first,(int)std_get_uptime(NULL),it->second->vrf_name,it->second->vrf_id);
+        }
+        if (nl_nsid_enabled() && (it->second->vrf_id == NL_DEFAULT_VRF_ID)) {
+            /* Listener of the default VRF receives the events of the mapped VRFs too */
+            nl_nsid_resync_t resync = { it->second->sock_type, it->first, desc.process };
+            nl_nsid_vrf_walk(nl_resync_nsid_vrf, &resync);
+        }
+    }
+}
+
+/* Check the receive error of the event socket, events are lost when the socket
+ * buffer overflows (ENOBUFS) */
+static void nl_check_receive_error(int sock, nlm_sock_info &info, int err) {
+    if (err == ENOBUFS) {
+        nas_nl_rcvbuf_update(sock, true);
+    }
+    if ((err == ENOBUFS) || (err == EINTR)) {
+        EV_LOGGING(NETLINK,ERR,"NL-RESYNC","Events lost VRF:%s sock:%d type:%d err:%d",
+                   info.vrf_name, sock, info.sock_type, err);
+        nl_resync_mark(info);
+    }
+}
+
+/* Shrink the receive buffers of the idle sockets */
+static void nl_rcvbuf_idle_check() {
+    for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+        nas_nl_rcvbuf_update(it->first, false);
+    }
+}
+
+/* Ready sockets are drained in two passes, the interface sockets first so that the link
+ * events are queued (and dispatched) ahead of the route and neighbor bursts */
+#define NL_EVENT_PASSES 2
+
+static bool nl_event_pass_skip(nas_nl_sock_TYPES sock_type, int pass) {
+    return ((sock_type == nas_nl_sock_T_INT) != (pass == 0));
+}
+
+/* Event loop of the io_uring backend - a multishot receive is kept on every event socket
+ * and the datagrams of all the sockets are received with one system call per wait. The
+ * datagrams are processed as read by the epoll loop, the interface sockets first */
+static void nl_uring_event_loop() {
+    static nl_uring_event_t events[NL_URING_MAX_EVENTS];
+    uint64_t wait = 0;
+    while (1) {
+        nl_free_retired_socks();
+        size_t count = nl_uring_event_wait(events, NL_URING_MAX_EVENTS,
+                                           _nl_resync_deferred ? NL_RESYNC_DROPPED_INTERVAL_MSEC :
+                                                                 (NL_RCVBUF_CHECK_INTERVAL_SEC * 1000));
+
+        std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+        if (count == 0) {
+            if (_nl_resync_deferred) nl_resync_pending();
+            else nl_rcvbuf_idle_check();
+            continue;
+        }
+        ++wait;
+        for (int pass = 0; pass < NL_EVENT_PASSES; ++pass) {
+            for (size_t ix = 0; ix < count; ++ix) {
+                nlm_sock_info *info = (nlm_sock_info *)events[ix].context;
+                /* Socket can be removed by the VRF delete after the wait */
+                if (info->deleted) continue;
+                if (nl_event_pass_skip(info->sock_type, pass)) continue;
+                int err = 0;
+                if (events[ix].buff == nullptr) {
+                    /* Receive stopped, it is submitted again by the next wait */
+                    err = -events[ix].res;
+                    EV_LOGGING(NETLINK,ERR,"NL-URING","Receive stopped sock:%d err:%d", info->sock, err);
+                } else {
+                    if (info->rcvbuf_wait != wait) {
+                        /* Sample the queue depth once per wait */
+                        info->rcvbuf_wait = wait;
+                        nas_nl_rcvbuf_update(info->sock, false);
+                    }
+                    size_t msg_count = netlink_tools_process_event_datagram(info->sock,
+                            nlm_handlers->at(info->sock_type).process, info->vrf_name, &events[ix].msg,
+                            events[ix].buff, events[ix].res, &err, info->vrf_id);
+                    nas_nl_stats_update(info->sock, msg_count);
+                }
+                nl_check_receive_error(info->sock, *info, err);
+            }
+        }
+        nl_uring_event_done(events, count);
+        nl_resync_pending();
+    }
+}
+
 int net_main() {
-    fd_set sel_fds;
+    struct epoll_event events[NL_EPOLL_MAX_EVENTS];
 
-    //Publish existing..
-    publish_existing();
+    nl_capture_init();
+    nl_dispatch_init(get_netlink_data);
+    nl_publish_init(net_publish_event, nl_publish_obj_key, cps_api_object_delete);
+    nl_dump_init(nl_dump_handler, nl_dump_table_failed);
 
     g_if_db = new (std::nothrow) (INTERFACE);
     g_if_bridge_db = new (std::nothrow) (if_bridge);
@@ -516,34 +948,65 @@ int net_main() {
     if(g_if_db == nullptr || g_if_bridge_db == nullptr || g_if_bridge_db == nullptr)
         EV_LOGGING(NETLINK,ERR,"INIT","Allocation failed for class objects...");
 
-    FD_ZERO(&read_fds);
+    evt_ring = nl_event_ring_create(NL_EVENT_RING_DEPTH, NL_EVENT_RING_BUFF_LEN);
+    if (evt_ring == nullptr) {
+        EV_LOGGING(NETLINK,ERR,"INIT","Allocation failed for the event receive ring");
+        return 0;
+    }
+
+    {
+        /* Event ring is created by the event thread, the epoll loop is used without it */
+        std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+        _nl_uring_events = nl_uring_event_init();
+    }
+
     /* Create netlink sockets for listening events from default VRF (namespace) */
     if (os_create_netlink_sock(NL_DEFAULT_VRF_NAME, NAS_DEFAULT_VRF_ID) != STD_ERR_OK) {
         os_del_netlink_sock(NL_DEFAULT_VRF_NAME);
         return 0;
     }
 
+    if (_nl_uring_events) {
+        nl_uring_event_loop();
+    }
+
     while (1) {
-        {
-            /* Take the lock and update the select fds from read fds */
-            std::lock_guard<std::mutex> lock(_nl_sock_mutex);
-            memcpy ((char *) &sel_fds, (char *) &read_fds, sizeof(fd_set));
-        }
-        if(select((max_fd+1), &sel_fds, NULL, NULL, NULL) <= 0)
+        nl_free_retired_socks();
+        /* Wake up periodically to shrink the receive buffers of the idle sockets, or
+         * for the deferred resync */
+        int nfds = epoll_wait(_nl_epoll_fd, events, NL_EPOLL_MAX_EVENTS,
+                              _nl_resync_deferred ? NL_RESYNC_DROPPED_INTERVAL_MSEC :
+                                                    (NL_RCVBUF_CHECK_INTERVAL_SEC * 1000));
+        if (nfds < 0)
             continue;
 
         std::lock_guard<std::mutex> lock(_nl_sock_mutex);
-        for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
-            if (FD_ISSET(it->first,&sel_fds)) {
-                netlink_tools_receive_event(it->first,nlm_handlers->at((it->second).sock_type).process,
-                                            (it->second).vrf_name,buf,sizeof(buf),NULL, (it->second).vrf_id);
+        if (nfds == 0) {
+            if (_nl_resync_deferred) nl_resync_pending();
+            else nl_rcvbuf_idle_check();
+            continue;
+        }
+        for (int pass = 0; pass < NL_EVENT_PASSES; ++pass) {
+            for (int ix = 0; ix < nfds; ++ix) {
+                nlm_sock_info *info = (nlm_sock_info *)events[ix].data.ptr;
+                /* Socket can be removed by the VRF delete after the wait */
+                if (info->deleted) continue;
+                if (nl_event_pass_skip(info->sock_type, pass)) continue;
+                int err = 0;
+                /* Sample the queue depth before draining it */
+                nas_nl_rcvbuf_update(info->sock, false);
+                netlink_tools_receive_events(info->sock,nlm_handlers->at(info->sock_type).process,
+                                             info->vrf_name,evt_ring,&err, info->vrf_id);
+                nl_check_receive_error(info->sock, *info, err);
             }
         }
+        nl_resync_pending();
     }
 
     /* deinit the netlink stats on exit */
     std::lock_guard<std::mutex> lock(_nl_sock_mutex);
     for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+        nas_nl_rcvbuf_deinit (it->first);
         nas_nl_stats_deinit (it->first);
     }
 
@@ -610,7 +1073,130 @@ bool os_nflog_enable ()
     return true;
 }
 
+/* Dumps of the tables given to the dump scheduler, the links are dumped first */
+static const struct {
+    nas_nl_sock_TYPES type;
+    bool link;
+    nl_dump_request_fn request;
+    int family;
+    uint32_t event;             /* class of the subscription profile */
+} _nl_dump_list[] = {
+    { nas_nl_sock_T_INT, true, nl_link_dump_request, AF_PACKET, NL_SUBSCRIBE_LINK },
+    { nas_nl_sock_T_INT, false, nl_addr_dump_request, AF_INET, NL_SUBSCRIBE_ADDR },
+    { nas_nl_sock_T_INT, false, nl_addr_dump_request, AF_INET6, NL_SUBSCRIBE_ADDR },
+    { nas_nl_sock_T_NEI, false, nl_neigh_get_all_request, AF_INET, NL_SUBSCRIBE_NEIGH },
+    { nas_nl_sock_T_NEI, false, nl_neigh_get_all_request, AF_INET6, NL_SUBSCRIBE_NEIGH },
+    { nas_nl_sock_T_ROUTE, false, nl_request_existing_routes, AF_INET, NL_SUBSCRIBE_ROUTE },
+    { nas_nl_sock_T_ROUTE, false, nl_request_existing_routes, AF_INET6, NL_SUBSCRIBE_ROUTE },
+    { nas_nl_sock_T_NETCONF, false, nl_netconf_get_all_request, AF_INET, NL_SUBSCRIBE_NETCONF },
+    { nas_nl_sock_T_NETCONF, false, nl_netconf_get_all_request, AF_INET6, NL_SUBSCRIBE_NETCONF },
+};
+
+/* Add the dumps of the table of the event socket, the classes left out of the
+ * subscription profile of the VRF are not dumped */
+static void nl_add_dumps(std::vector<nl_dump_t> &dumps, const char *vrf_name, nas_nl_sock_TYPES type,
+                         int evt_sock) {
+    for (auto &entry : _nl_dump_list) {
+        if (entry.type != type) continue;
+        if ((nl_subscribe_get(vrf_name, entry.family) & entry.event) == 0) continue;
+        dumps.push_back({entry.type, evt_sock, entry.link, entry.request, entry.family});
+    }
+}
+
+/* Groups of the event socket, the listener of the default VRF joins the groups of the
+ * VRFs mapped by their NSID too. Called with _nl_sock_mutex held */
+static uint64_t nl_sock_groups(const nlm_sock_info &info) {
+    uint64_t groups = nl_subscribe_groups(info.vrf_name, info.sock_type);
+    if (!nl_nsid_enabled() || (strncmp(info.vrf_name, NL_DEFAULT_VRF_NAME, NAS_VRF_NAME_SZ) != 0)) {
+        return groups;
+    }
+    std::pair<nas_nl_sock_TYPES, uint64_t> nsid_groups(info.sock_type, groups);
+    nl_nsid_vrf_walk([](int nsid, uint32_t vrf_id, const char *vrf_name, void *context) {
+        auto nsid_groups = (std::pair<nas_nl_sock_TYPES, uint64_t> *)context;
+        nsid_groups->second |= nl_subscribe_groups(vrf_name, nsid_groups->first);
+    }, &nsid_groups);
+    return nsid_groups.second;
+}
+
+/* Join and leave the groups of the event sockets as their profiles give, the sockets
+ * are not recreated. Called with _nl_sock_mutex held */
+static void nl_subscribe_refresh() {
+    for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+        nlm_sock_info &info = *it->second;
+        uint64_t groups = nl_sock_groups(info);
+        if (groups == info.groups) continue;
+        if (nl_subscribe_sock_apply(it->first, info.sock_type, groups) != STD_ERR_OK) {
+            /* Memberships are unknown, applied again on the next change */
+            groups = ~0ULL;
+        }
+        EV_LOGGING(NETLINK,INFO,"NL-SUBSCRIBE","VRF:%s sock:%d type:%d groups:0x%lx->0x%lx",
+                   info.vrf_name, it->first, info.sock_type, info.groups, groups);
+        info.groups = groups;
+    }
+}
+
+/* Event socket of the classes of the subscription profile */
+static const struct {
+    uint32_t event;
+    nas_nl_sock_TYPES type;
+} _nl_subscribe_socks[] = {
+    { NL_SUBSCRIBE_LINK, nas_nl_sock_T_INT },
+    { NL_SUBSCRIBE_ADDR, nas_nl_sock_T_INT },
+    { NL_SUBSCRIBE_ROUTE, nas_nl_sock_T_ROUTE },
+    { NL_SUBSCRIBE_NEIGH, nas_nl_sock_T_NEI },
+    { NL_SUBSCRIBE_NETCONF, nas_nl_sock_T_NETCONF },
+    { NL_SUBSCRIBE_MDB, nas_nl_sock_T_MCAST_SNOOP },
+};
+
+t_std_error os_nl_subscribe_set(const char *vrf_name, int family, uint32_t events) {
+    uint32_t added = events & ~nl_subscribe_get(vrf_name, family);
+    t_std_error rc = nl_subscribe_set(vrf_name, family, events);
+    if (rc != STD_ERR_OK) return rc;
+
+    std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+    nl_subscribe_refresh();
+    /* Events of the classes added were dropped, their tables are resynced */
+    for (auto &entry : _nl_subscribe_socks) {
+        if (added & entry.event) nl_resync_vrf_table(vrf_name, entry.type);
+    }
+    return STD_ERR_OK;
+}
+
+/* Schedule the dumps of the tables of the VRF, the dumped entries are handled as the
+ * events of the sockets of the listener VRF (the VRF itself or the default VRF listening
+ * to all the NSIDs). Called with _nl_sock_mutex held */
+static bool nl_schedule_dumps(const char *vrf_name, uint32_t vrf_id, const char *listener_vrf) {
+    std::vector<nl_dump_t> dumps;
+    for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
+        if (strncmp(listener_vrf, it->second->vrf_name, NAS_VRF_NAME_SZ) != 0) continue;
+        nl_add_dumps(dumps, vrf_name, it->second->sock_type, it->first);
+    }
+    return nl_dump_vrf(vrf_name, vrf_id, dumps.data(), dumps.size());
+}
+
+/* Map the NSID of the VRF instead of creating its event sockets, used once the listeners
+ * of the default VRF and the dump threads are up - otherwise (e.g. the management VRF
+ * created before the event thread) the VRF gets its own sockets */
+static bool nl_nsid_vrf_listen(const char *vrf_name, uint32_t vrf_id) {
+    if (!nl_nsid_enabled() || (strncmp(vrf_name, NL_DEFAULT_VRF_NAME, NAS_VRF_NAME_SZ) == 0)) {
+        return false;
+    }
+    if (nl_nsid_vrf_add(vrf_name, vrf_id) != STD_ERR_OK) return false;
+
+    std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+    if (nl_schedule_dumps(vrf_name, vrf_id, NL_DEFAULT_VRF_NAME)) {
+        /* Listeners join the groups of the profile of the VRF */
+        nl_subscribe_refresh();
+        return true;
+    }
+    nl_nsid_vrf_del(vrf_name, nullptr);
+    return false;
+}
+
 void os_refresh_netlink_info(const char *vrf_name, uint32_t vrf_id) {
+    /* Dumped concurrently by the dump threads if they are running */
+    if (nl_schedule_dumps(vrf_name, vrf_id, vrf_name)) return;
+
     nas_nl_sock_TYPES _refresh_list[] = {
             nas_nl_sock_T_INT,
             nas_nl_sock_T_NEI,
@@ -624,8 +1210,23 @@ void os_refresh_netlink_info(const char *vrf_name, uint32_t vrf_id) {
     }
 }
 
+/* Remove the event socket added by os_create_netlink_sock and close it, called with
+ * _nl_sock_mutex held. The socket info is retired, the event thread can hold it from
+ * its last wait */
+static void nl_sock_unregister(nlm_sock_info *info) {
+    if (_nl_epoll_fd != -1) epoll_ctl(_nl_epoll_fd, EPOLL_CTL_DEL, info->sock, NULL);
+    nl_uring_event_del(info->sock);
+    nl_capture_sock_del(info->sock);
+    nas_nl_rcvbuf_deinit(info->sock);
+    nas_nl_stats_deinit(info->sock);
+    nlm_sockets->erase(info->sock);
+    close(info->sock);
+    info->deleted = true;
+    nlm_sockets_retired->push_back(info);
+}
+
 t_std_error os_create_netlink_sock(const char *vrf_name, uint32_t vrf_id) {
-    nlm_sock_info sock_info;
+    int socks[nas_nl_sock_T_MAX];
     size_t ix = nas_nl_sock_T_ROUTE;
     /* Incase of mgmt VRF, before NAS process spawns
      * the NAS-linux thread, NAS-linux is handling the mgmt VRF creation
@@ -638,10 +1239,19 @@ t_std_error os_create_netlink_sock(const char *vrf_name, uint32_t vrf_id) {
         return (STD_ERR(NAS_OS,FAIL, 0));
     }
 
-    /* Take the lock to update the read_fds */
-    std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+    /* Keep the request sockets open for the set requests in this VRF */
+    nas_nl_req_sock_pool_init(vrf_name);
 
+    /* Events of the VRF are received by the listeners of the default VRF */
+    if (nl_nsid_vrf_listen(vrf_name, vrf_id)) {
+        EV_LOGGING(NETLINK,INFO,"NL_SOCK","VRF:%s id:%u listened by NSID", vrf_name, vrf_id);
+        return STD_ERR_OK;
+    }
+
+    /* Create the sockets without the lock, the event dispatch is not held up
+     * by the namespace switch and the socket setup */
     for ( ; ix < (size_t)nas_nl_sock_T_MAX; ++ix ) {
+        socks[ix] = -1;
         if ((ix == nas_nl_sock_T_ROUTE) && (nas_switch_get_os_event_flag() == false)) {
             EV_LOGGING(NETLINK,INFO,"NL_SOCK","Skip Initializing route socket for VRF:%s ",vrf_name);
             continue;
@@ -650,25 +1260,66 @@ t_std_error os_create_netlink_sock(const char *vrf_name, uint32_t vrf_id) {
             EV_LOGGING(NETLINK,INFO,"NL_SOCK","Skip Initializing snoop mcast socket for VRF:%s" ,vrf_name);
             continue;
         }
-        int sock = nas_nl_sock_create(vrf_name, (nas_nl_sock_TYPES)(ix),true);
-        if(sock == -1) {
+        socks[ix] = nas_nl_sock_create(vrf_name, (nas_nl_sock_TYPES)(ix),true);
+        if(socks[ix] == -1) {
             EV_LOGGING(NETLINK,ERR,"NL_SOCK","Failed to initialize sockets for VRF:%s "
                        "sock-id:%lu err-no:%d",vrf_name, ix, errno);
+            while (ix-- > nas_nl_sock_T_ROUTE) {
+                if (socks[ix] != -1) close(socks[ix]);
+            }
+            nas_nl_req_sock_pool_deinit(vrf_name);
             return (STD_ERR(NAS_OS,FAIL, 0));
         }
         EV_LOGGING(NETLINK, INFO, "NL_SOCK","Socket: VRF:%s id:%lu, sock-fd:%d",
-                   vrf_name, ix, sock);
+                   vrf_name, ix, socks[ix]);
+    }
+
+    /* Take the lock to add the sockets to the event loop */
+    std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+    std::vector<nlm_sock_info *> added;
+    /* On failure the sockets already added are removed and the others closed */
+    auto unwind = [&](size_t from) {
+        for (auto info : added) {
+            nl_sock_unregister(info);
+        }
+        for ( ; from < (size_t)nas_nl_sock_T_MAX; ++from) {
+            if (socks[from] != -1) close(socks[from]);
+        }
+        nas_nl_req_sock_pool_deinit(vrf_name);
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    };
+
+    for (ix = nas_nl_sock_T_ROUTE; ix < (size_t)nas_nl_sock_T_MAX; ++ix ) {
+        int sock = socks[ix];
+        if (sock == -1) continue;
         /* Fill netlink socket information */
-        memset(&sock_info, 0, sizeof(sock_info));
-        sock_info.sock_type = (nas_nl_sock_TYPES)(ix);
-        safestrncpy(sock_info.vrf_name, vrf_name, sizeof(sock_info.vrf_name));
-        sock_info.vrf_id = vrf_id;
+        nlm_sock_info *sock_info = new (std::nothrow) nlm_sock_info;
+        if (sock_info == nullptr) {
+            EV_LOGGING(NETLINK,ERR,"NL_SOCK","Allocation failed for the socket info VRF:%s", vrf_name);
+            return unwind(ix);
+        }
+        memset(sock_info, 0, sizeof(*sock_info));
+        sock_info->sock_type = (nas_nl_sock_TYPES)(ix);
+        safestrncpy(sock_info->vrf_name, vrf_name, sizeof(sock_info->vrf_name));
+        sock_info->vrf_id = vrf_id;
+        sock_info->sock = sock;
+        sock_info->groups = nl_subscribe_groups(vrf_name, sock_info->sock_type);
         nlm_sockets->insert(std::make_pair(sock, sock_info));
-
-        /* Add socket fds into select read_fds for listening events from
-         * the particular VRF */
-        add_fd_set(sock,read_fds,max_fd);
+        added.push_back(sock_info);
+        nl_capture_sock_add(sock, sock_info->sock_type);
+
+        /* Register the socket once for listening events from the particular VRF */
+        if (!(_nl_uring_events ? nl_uring_event_add(sock, sock_info) : nl_epoll_add(sock_info))) {
+            EV_LOGGING(NETLINK,ERR,"NL_SOCK","Failed to register the socket VRF:%s sock-id:%lu",
+                       vrf_name, ix);
+            return unwind(ix + 1);
+        }
         nas_nl_stats_init (sock);
+        size_t max_len = nl_rcvbuf_max_len(sock_info->sock_type);
+        if (max_len != 0) {
+            /* Start with a small receive buffer and grow on demand */
+            nas_nl_rcvbuf_init (sock, max_len);
+        }
     }
 
     os_refresh_netlink_info(vrf_name, vrf_id);
@@ -676,30 +1327,60 @@ t_std_error os_create_netlink_sock(const char *vrf_name, uint32_t vrf_id) {
 }
 
 t_std_error os_del_netlink_sock(const char *vrf_name) {
-    /* Take the lock to update the read_fds */
+    /* Dumps of the VRF refer to its event sockets, done before the sockets are closed */
+    nl_dump_cancel(vrf_name);
+    nas_nl_req_sock_pool_deinit(vrf_name);
+
+    uint32_t nsid_vrf_id = 0;
+    bool nsid_mapped = false;
+    {
+        /* Take the lock to remove the sockets from the event loop, no more events of
+         * the VRF are queued after this */
+        std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+        nsid_mapped = nl_nsid_vrf_del(vrf_name, &nsid_vrf_id);
+        if (nsid_mapped) {
+            /* Events of the VRF are dropped from now on */
+            nl_subscribe_refresh();
+        }
+        for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end(); ++it) {
+            if (strncmp(vrf_name, it->second->vrf_name, NAS_VRF_NAME_SZ) != 0) continue;
+            if (_nl_epoll_fd != -1) epoll_ctl(_nl_epoll_fd, EPOLL_CTL_DEL, it->first, NULL);
+            nl_uring_event_del(it->first);
+            /* Event thread can hold the socket info from its last wait */
+            it->second->deleted = true;
+        }
+    }
+
+    /* Wait for the queued events before the stats and the shadow of the VRF are removed,
+     * without the lock so that the event thread keeps reading the other VRFs */
+    nl_dispatch_drain();
+
     std::lock_guard<std::mutex> lock(_nl_sock_mutex);
+    if (nsid_mapped) nl_resync_shadow_clear(nsid_vrf_id);
 
     for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end();) {
-        EV_LOGGING(NETLINK,DEBUG,"NL_SOCK","Existig VRF:%s id:%d sock:%d", it->second.vrf_name, it->second.vrf_id, it->first);
-        if (strncmp(vrf_name, it->second.vrf_name, NAS_VRF_NAME_SZ) == 0) {
+        EV_LOGGING(NETLINK,DEBUG,"NL_SOCK","Existig VRF:%s id:%d sock:%d", it->second->vrf_name, it->second->vrf_id, it->first);
+        /* Sockets of the VRF created again meanwhile are kept */
+        if (it->second->deleted && (strncmp(vrf_name, it->second->vrf_name, NAS_VRF_NAME_SZ) == 0)) {
+            nl_capture_sock_del(it->first);
+            nas_nl_rcvbuf_deinit(it->first);
             nas_nl_stats_deinit(it->first);
+            nl_resync_shadow_clear(it->second->vrf_id);
             EV_LOGGING(NETLINK,INFO,"NL_SOCK","Closing VRF:%s id:%d sock:%d",
-                       it->second.vrf_name, it->second.vrf_id, it->first);
+                       it->second->vrf_name, it->second->vrf_id, it->first);
             close(it->first);
-            auto del_it = it;
-            it++;
-            nlm_sockets->erase(del_it->first);
+            nlm_sockets_retired->push_back(it->second);
+            it = nlm_sockets->erase(it);
         } else {
             it++;
         }
     }
-    /* Reset max_fd and read fds and fill based on available sockets */
-    max_fd = -1;
-    FD_ZERO(&read_fds);
-    for ( auto it = nlm_sockets->begin(); it != nlm_sockets->end() ; ++it) {
-        EV_LOGGING(NETLINK,DEBUG,"NL_SOCK","New VRF:%s sock:%d", it->second.vrf_name, it->first);
-        add_fd_set( it->first,read_fds,max_fd);
+    /* Profile of the VRF goes with it, unless the VRF was created again meanwhile */
+    bool recreated = false;
+    for (auto &sock : *nlm_sockets) {
+        if (strncmp(vrf_name, sock.second->vrf_name, NAS_VRF_NAME_SZ) == 0) recreated = true;
     }
+    if (!recreated) nl_subscribe_clear(vrf_name);
 
     return STD_ERR_OK;
 }
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_async.cpp
+ */
+
+/*
+ * Asynchronous netlink write engine - the requests are queued by the callers
+ * and sent from the writer thread, which keeps a window of requests waiting
+ * for the ACK per VRF and socket type and calls the completion callbacks.
+ */
+
+#include "netlink_async.h"
+#include "netlink_transport.h"
+#include "nas_os_async.h"
+#include "std_thread_tools.h"
+#include "std_time_tools.h"
+#include "event_log.h"
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define NL_ASYNC_RECV_BUFF_LEN (64*1024)
+#define NL_ASYNC_POLL_TIMEOUT_MS 1000
+
+typedef struct {
+    std::vector<char> msg;
+    nl_async_done_fn done;
+    void *context;
+    uint64_t sent_time;
+} nl_async_req_t;
+
+typedef struct {
+    std::string vrf_name;
+    nas_nl_sock_TYPES type;
+    int sock;
+    std::deque<nl_async_req_t> pending;
+    std::map<uint32_t, nl_async_req_t> outstanding;
+} nl_async_chan_t;
+
+typedef struct {
+    nl_async_done_fn done;
+    void *context;
+    int error_code;
+} nl_async_result_t;
+
+typedef std::pair<std::string, int> nl_async_chan_key_t;
+
+static std::mutex _async_mutex;
+static std::condition_variable _async_idle;
+static bool _async_started = false;
+static size_t _async_busy = 0; //requests submitted and not completed
+static int _async_wake_fd[2] = {-1, -1};
+static std_thread_create_param_t _async_thr;
+
+//Requests per VRF and socket type, channels are only removed by the writer thread
+static auto nl_async_chans = new std::map<nl_async_chan_key_t, nl_async_chan_t>;
+
+static void nl_async_complete(std::vector<nl_async_result_t> &results) {
+    for (auto &res : results) {
+        if (res.done != nullptr) res.done(res.context, res.error_code);
+    }
+    if (results.empty()) return;
+
+    std::lock_guard<std::mutex> lock(_async_mutex);
+    _async_busy -= results.size();
+    if (_async_busy == 0) _async_idle.notify_all();
+    results.clear();
+}
+
+/* Fail all the requests waiting for the ACK and drop the socket since
+ * it can still get responses for them */
+static void nl_async_chan_reset(nl_async_chan_t &chan, int error_code,
+                                std::vector<nl_async_result_t> &results) {
+    for (auto &it : chan.outstanding) {
+        results.push_back({it.second.done, it.second.context, error_code});
+    }
+    chan.outstanding.clear();
+    nl_transport_sock_put(chan.vrf_name.c_str(), chan.type, chan.sock, true);
+    chan.sock = -1;
+}
+
+static void nl_async_recv_acks(nl_async_chan_t &chan, std::vector<nl_async_result_t> &results) {
+    static char buff[NL_ASYNC_RECV_BUFF_LEN];
+
+    while (chan.sock != -1) {
+        int len = recv(chan.sock, buff, sizeof(buff), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) return;
+            EV_LOGGING(NETLINK, ERR, "NL-ASYNC", "VRF:%s sock %d, recv failed errno %d",
+                       chan.vrf_name.c_str(), chan.sock, errno);
+            nl_async_chan_reset(chan, EIO, results);
+            return;
+        }
+        struct nlmsghdr *nh = (struct nlmsghdr *)buff;
+        for ( ; NLMSG_OK (nh, len); nh = NLMSG_NEXT (nh, len)) {
+            if (nh->nlmsg_type != NLMSG_ERROR) continue;
+
+            auto it = chan.outstanding.find(nh->nlmsg_seq);
+            if (it == chan.outstanding.end()) continue;
+
+            struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA (nh);
+            if (err->error != 0) {
+                EV_LOGGING(NETLINK, INFO, "NL-ASYNC", "VRF:%s msg_type %d seq %u error %d",
+                           chan.vrf_name.c_str(), err->msg.nlmsg_type, nh->nlmsg_seq, err->error);
+            }
+            results.push_back({it->second.done, it->second.context, -(err->error)});
+            chan.outstanding.erase(it);
+        }
+    }
+}
+
+static void nl_async_check_timeout(nl_async_chan_t &chan, std::vector<nl_async_result_t> &results) {
+    if (chan.outstanding.empty()) return;
+
+    uint64_t now = std_get_uptime(NULL);
+    for (auto &it : chan.outstanding) {
+        if ((now - it.second.sent_time) > ((uint64_t)NL_ASYNC_ACK_TIMEOUT_MS * 1000)) {
+            EV_LOGGING(NETLINK, ERR, "NL-ASYNC", "VRF:%s sock %d, %lu requests timed out",
+                       chan.vrf_name.c_str(), chan.sock, chan.outstanding.size());
+            nl_async_chan_reset(chan, ETIMEDOUT, results);
+            return;
+        }
+    }
+}
+
+/* Send the pending requests that fit in the window of the channel */
+static void nl_async_send(nl_async_chan_t &chan, std::vector<nl_async_result_t> &results) {
+    while (true) {
+        nl_async_req_t req;
+        {
+            std::lock_guard<std::mutex> lock(_async_mutex);
+            if (chan.pending.empty() || (chan.outstanding.size() >= NL_ASYNC_MAX_OUTSTANDING)) {
+                break;
+            }
+            req = std::move(chan.pending.front());
+            chan.pending.pop_front();
+        }
+        if (chan.sock == -1) {
+            chan.sock = nl_transport_sock_get(chan.vrf_name.c_str(), chan.type);
+        }
+        struct nlmsghdr *m = (struct nlmsghdr *)req.msg.data();
+        m->nlmsg_seq = nl_get_next_seq();
+        errno = 0;
+        if ((chan.sock == -1) || !nl_send_nlmsg(chan.sock, m)) {
+            int error_code = (errno != 0) ? errno : EIO;
+            EV_LOGGING(NETLINK, ERR, "NL-ASYNC", "VRF:%s, failed to send msg_type %d errno %d",
+                       chan.vrf_name.c_str(), m->nlmsg_type, error_code);
+            results.push_back({req.done, req.context, error_code});
+            if (chan.sock != -1) nl_async_chan_reset(chan, EIO, results);
+            continue;
+        }
+        req.sent_time = std_get_uptime(NULL);
+        uint32_t seq = m->nlmsg_seq;
+        chan.outstanding.insert(std::make_pair(seq, std::move(req)));
+    }
+}
+
+static void nl_async_main(void) {
+    std::vector<nl_async_result_t> results;
+    std::vector<struct pollfd> fds;
+    std::vector<nl_async_chan_t*> fd_chans;
+
+    while (true) {
+        fds.clear();
+        fd_chans.clear();
+        fds.push_back({_async_wake_fd[0], POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lock(_async_mutex);
+            for (auto it = nl_async_chans->begin(); it != nl_async_chans->end(); ) {
+                nl_async_chan_t &chan = it->second;
+                if (chan.outstanding.empty() && chan.pending.empty()) {
+                    /* Give back the socket of the idle channel */
+                    nl_transport_sock_put(chan.vrf_name.c_str(), chan.type, chan.sock, false);
+                    it = nl_async_chans->erase(it);
+                    continue;
+                }
+                if (chan.sock != -1 && !chan.outstanding.empty()) {
+                    fds.push_back({chan.sock, POLLIN, 0});
+                    fd_chans.push_back(&chan);
+                }
+                ++it;
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), NL_ASYNC_POLL_TIMEOUT_MS) < 0 && errno != EINTR) {
+            EV_LOGGING(NETLINK, ERR, "NL-ASYNC", "poll failed errno %d", errno);
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char wake_buff[256];
+            while (read(_async_wake_fd[0], wake_buff, sizeof(wake_buff)) == sizeof(wake_buff));
+        }
+        for (size_t ix = 1; ix < fds.size(); ++ix) {
+            if (fds[ix].revents != 0) nl_async_recv_acks(*fd_chans[ix-1], results);
+            nl_async_check_timeout(*fd_chans[ix-1], results);
+        }
+        nl_async_complete(results);
+
+        /* The channels are only removed from this thread so the iteration is safe
+         * while the submitters add new channels and requests under the lock */
+        std::vector<nl_async_chan_t*> chans;
+        {
+            std::lock_guard<std::mutex> lock(_async_mutex);
+            for (auto &it : *nl_async_chans) chans.push_back(&it.second);
+        }
+        for (auto chan : chans) {
+            nl_async_send(*chan, results);
+            /* ACKs of the requests are normally ready as soon as they are sent */
+            nl_async_recv_acks(*chan, results);
+        }
+        nl_async_complete(results);
+    }
+}
+
+extern "C" t_std_error nl_async_init (void) {
+    std::lock_guard<std::mutex> lock(_async_mutex);
+    if (_async_started) return STD_ERR_OK;
+
+    if (pipe(_async_wake_fd) != 0) {
+        EV_LOGGING(NETLINK, ERR, "NL-ASYNC", "Failed to create the wake up pipe errno %d", errno);
+        return STD_ERR(NAS_OS, FAIL, errno);
+    }
+    /* Writer thread only drains the pipe and the submitters never block on it */
+    for (int ix = 0; ix < 2; ++ix) {
+        int flags = fcntl(_async_wake_fd[ix], F_GETFL, 0);
+        fcntl(_async_wake_fd[ix], F_SETFL, flags | O_NONBLOCK);
+    }
+
+    std_thread_init_struct(&_async_thr);
+    _async_thr.name = "nas-os-nl-async";
+    _async_thr.thread_function = (std_thread_function_t)nl_async_main;
+    t_std_error rc = std_thread_create(&_async_thr);
+    if (rc != STD_ERR_OK) {
+        EV_LOGGING(NETLINK, ERR, "NL-ASYNC", "Failed to create the netlink writer thread");
+        close(_async_wake_fd[0]);
+        close(_async_wake_fd[1]);
+        return rc;
+    }
+    _async_started = true;
+    return STD_ERR_OK;
+}
+
+extern "C" t_std_error nl_async_submit (const char *vrf_name, nas_nl_sock_TYPES type, struct nlmsghdr *m,
+                                        nl_async_done_fn done, void *context) {
+    if ((m == nullptr) || (type >= nas_nl_sock_T_MAX)) return STD_ERR(NAS_OS, PARAM, 0);
+
+    t_std_error rc = nl_async_init();
+    if (rc != STD_ERR_OK) return rc;
+
+    nl_async_req_t req;
+    req.msg.assign((char *)m, (char *)m + m->nlmsg_len);
+    ((struct nlmsghdr *)req.msg.data())->nlmsg_flags |= NLM_F_ACK;
+    req.done = done;
+    req.context = context;
+    req.sent_time = 0;
+
+    std::string vrf((vrf_name == nullptr) ? NL_DEFAULT_VRF_NAME : vrf_name);
+    {
+        std::lock_guard<std::mutex> lock(_async_mutex);
+        auto it = nl_async_chans->find(std::make_pair(vrf, (int)type));
+        if (it == nl_async_chans->end()) {
+            nl_async_chan_t chan;
+            chan.vrf_name = vrf;
+            chan.type = type;
+            chan.sock = -1;
+            it = nl_async_chans->insert(std::make_pair(std::make_pair(vrf, (int)type),
+                                                       std::move(chan))).first;
+        }
+        it->second.pending.push_back(std::move(req));
+        ++_async_busy;
+    }
+
+    char wake = 1;
+    if (write(_async_wake_fd[1], &wake, sizeof(wake)) < 0 && errno != EAGAIN) {
+        EV_LOGGING(NETLINK, ERR, "NL-ASYNC", "Failed to wake up the writer thread errno %d", errno);
+    }
+    return STD_ERR_OK;
+}
+
+extern "C" void nl_async_flush (void) {
+    std::unique_lock<std::mutex> lock(_async_mutex);
+    _async_idle.wait(lock, [] { return _async_busy == 0; });
+}
+
+extern "C" void nas_os_async_flush (void) {
+    nl_async_flush();
+}
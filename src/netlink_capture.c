@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_capture.c
+ */
+
+#include "netlink_capture.h"
+#include "event_log.h"
+#include "nas_os_nl_config.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+/* pcap file header, nanosecond timestamps */
+#define NL_PCAP_MAGIC_NSEC 0xa1b23c4d
+#define NL_PCAP_MAGIC_USEC 0xa1b2c3d4
+#define NL_PCAP_VERSION_MAJOR 2
+#define NL_PCAP_VERSION_MINOR 4
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t linktype;
+} nl_pcap_hdr_t;
+
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_frac;               /* nsec or usec, given by the magic */
+    uint32_t incl_len;
+    uint32_t orig_len;
+} nl_pcap_rec_hdr_t;
+
+/* Linux cooked header (LINKTYPE_LINUX_SLL) used by LINKTYPE_NETLINK, network byte order */
+typedef struct {
+    uint16_t pkttype;
+    uint16_t hatype;
+    uint16_t halen;
+    uint8_t addr[8];                /* socket type (2), VRF-id (2), NSID (4) */
+    uint16_t protocol;              /* netlink family */
+} nl_cooked_hdr_t;
+
+#define NL_COOKED_PKTTYPE_HOST 0
+
+/* Capture file, written by the threads reading the event sockets */
+static pthread_mutex_t nl_capture_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE *nl_capture_file = NULL;
+static volatile bool nl_capture_on = false;
+
+/* Socket type + 1 of the captured sockets, 0 if not captured */
+static uint8_t nl_capture_socks[NL_CAPTURE_MAX_SOCKS];
+
+t_std_error nl_capture_start (const char *path) {
+    nl_pcap_hdr_t hdr = {
+        .magic = NL_PCAP_MAGIC_NSEC,
+        .version_major = NL_PCAP_VERSION_MAJOR,
+        .version_minor = NL_PCAP_VERSION_MINOR,
+        .thiszone = 0,
+        .sigfigs = 0,
+        .snaplen = NL_CAPTURE_SNAPLEN,
+        .linktype = NL_CAPTURE_LINKTYPE_NETLINK,
+    };
+
+    pthread_mutex_lock(&nl_capture_mutex);
+    if (nl_capture_file != NULL) {
+        pthread_mutex_unlock(&nl_capture_mutex);
+        EV_LOGGING(NETLINK, ERR, "NL-CAPTURE", "Capture already running");
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+    FILE *file = fopen(path, "w");
+    if ((file == NULL) || (fwrite(&hdr, sizeof(hdr), 1, file) != 1)) {
+        EV_LOGGING(NETLINK, ERR, "NL-CAPTURE", "Failed to open the capture file %s errno %d", path, errno);
+        if (file != NULL) fclose(file);
+        pthread_mutex_unlock(&nl_capture_mutex);
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+    nl_capture_file = file;
+    nl_capture_on = true;
+    pthread_mutex_unlock(&nl_capture_mutex);
+
+    EV_LOGGING(NETLINK, INFO, "NL-CAPTURE", "Capturing the netlink events into %s", path);
+    return STD_ERR_OK;
+}
+
+void nl_capture_stop (void) {
+    pthread_mutex_lock(&nl_capture_mutex);
+    nl_capture_on = false;
+    if (nl_capture_file != NULL) {
+        fclose(nl_capture_file);
+        nl_capture_file = NULL;
+        EV_LOGGING(NETLINK, INFO, "NL-CAPTURE", "Capture stopped");
+    }
+    pthread_mutex_unlock(&nl_capture_mutex);
+}
+
+void nl_capture_init (void) {
+    nas_os_nl_config_t cfg;
+    nas_os_nl_config_get(&cfg);
+    if (cfg.capture_path[0] == '\0') return;
+    nl_capture_start(cfg.capture_path);
+}
+
+void nl_capture_sock_add (int sock, nas_nl_sock_TYPES type) {
+    if ((sock < 0) || (sock >= NL_CAPTURE_MAX_SOCKS)) return;
+    nl_capture_socks[sock] = (uint8_t)type + 1;
+}
+
+void nl_capture_sock_del (int sock) {
+    if ((sock < 0) || (sock >= NL_CAPTURE_MAX_SOCKS)) return;
+    nl_capture_socks[sock] = 0;
+}
+
+void nl_capture_write (int sock, int nsid, uint32_t vrf_id, const void *buff, size_t len) {
+    if (!nl_capture_on) return;
+    if ((sock < 0) || (sock >= NL_CAPTURE_MAX_SOCKS) || (nl_capture_socks[sock] == 0)) return;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    size_t incl_len = (len < NL_CAPTURE_SNAPLEN) ? len : NL_CAPTURE_SNAPLEN;
+    nl_pcap_rec_hdr_t rec = {
+        .ts_sec = (uint32_t)ts.tv_sec,
+        .ts_frac = (uint32_t)ts.tv_nsec,
+        .incl_len = (uint32_t)(sizeof(nl_cooked_hdr_t) + incl_len),
+        .orig_len = (uint32_t)(sizeof(nl_cooked_hdr_t) + len),
+    };
+    nl_cooked_hdr_t cooked;
+    memset(&cooked, 0, sizeof(cooked));
+    cooked.pkttype = htons(NL_COOKED_PKTTYPE_HOST);
+    cooked.hatype = htons(NL_CAPTURE_ARPHRD_NETLINK);
+    cooked.halen = htons(sizeof(cooked.addr));
+    uint16_t type = htons(nl_capture_socks[sock] - 1);
+    uint16_t vrf = htons((uint16_t)vrf_id);
+    uint32_t id = htonl((uint32_t)nsid);
+    memcpy(&cooked.addr[0], &type, sizeof(type));
+    memcpy(&cooked.addr[2], &vrf, sizeof(vrf));
+    memcpy(&cooked.addr[4], &id, sizeof(id));
+    cooked.protocol = htons(NETLINK_ROUTE);
+
+    pthread_mutex_lock(&nl_capture_mutex);
+    if (nl_capture_file != NULL) {
+        if ((fwrite(&rec, sizeof(rec), 1, nl_capture_file) != 1) ||
+            (fwrite(&cooked, sizeof(cooked), 1, nl_capture_file) != 1) ||
+            (fwrite(buff, incl_len, 1, nl_capture_file) != 1)) {
+            EV_LOGGING(NETLINK, ERR, "NL-CAPTURE", "Failed to write the capture errno %d, capture stopped", errno);
+            fclose(nl_capture_file);
+            nl_capture_file = NULL;
+            nl_capture_on = false;
+        }
+    }
+    pthread_mutex_unlock(&nl_capture_mutex);
+}
+
+struct nl_capture_reader_s {
+    FILE *file;
+    bool swapped;                   /* written with the other byte order */
+    bool nsec;
+    char *buff;
+    size_t buff_len;
+};
+
+static uint32_t nl_capture_u32(const nl_capture_reader_t *reader, uint32_t val) {
+    return reader->swapped ? __builtin_bswap32(val) : val;
+}
+
+nl_capture_reader_t *nl_capture_open (const char *path) {
+    nl_pcap_hdr_t hdr;
+    nl_capture_reader_t *reader = (nl_capture_reader_t *)calloc(1, sizeof(nl_capture_reader_t));
+    if (reader == NULL) return NULL;
+
+    reader->file = fopen(path, "r");
+    if ((reader->file == NULL) || (fread(&hdr, sizeof(hdr), 1, reader->file) != 1)) {
+        EV_LOGGING(NETLINK, ERR, "NL-CAPTURE", "Failed to read the capture file %s", path);
+        nl_capture_close(reader);
+        return NULL;
+    }
+    if ((hdr.magic == NL_PCAP_MAGIC_NSEC) || (hdr.magic == NL_PCAP_MAGIC_USEC)) {
+        reader->nsec = (hdr.magic == NL_PCAP_MAGIC_NSEC);
+    } else if ((hdr.magic == __builtin_bswap32(NL_PCAP_MAGIC_NSEC)) ||
+               (hdr.magic == __builtin_bswap32(NL_PCAP_MAGIC_USEC))) {
+        reader->swapped = true;
+        reader->nsec = (hdr.magic == __builtin_bswap32(NL_PCAP_MAGIC_NSEC));
+    } else {
+        EV_LOGGING(NETLINK, ERR, "NL-CAPTURE", "%s is not a pcap file", path);
+        nl_capture_close(reader);
+        return NULL;
+    }
+    if (nl_capture_u32(reader, hdr.linktype) != NL_CAPTURE_LINKTYPE_NETLINK) {
+        EV_LOGGING(NETLINK, ERR, "NL-CAPTURE", "%s is not a netlink capture, link type %u", path,
+                   nl_capture_u32(reader, hdr.linktype));
+        nl_capture_close(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+bool nl_capture_read (nl_capture_reader_t *reader, nl_capture_rec_t *rec) {
+    nl_pcap_rec_hdr_t hdr;
+    nl_cooked_hdr_t cooked;
+
+    while (fread(&hdr, sizeof(hdr), 1, reader->file) == 1) {
+        uint32_t incl_len = nl_capture_u32(reader, hdr.incl_len);
+        if (incl_len > (NL_CAPTURE_SNAPLEN + sizeof(cooked))) {
+            EV_LOGGING(NETLINK, ERR, "NL-CAPTURE", "Corrupted capture, record len %u", incl_len);
+            return false;
+        }
+        if (incl_len > reader->buff_len) {
+            char *buff = (char *)realloc(reader->buff, incl_len);
+            if (buff == NULL) return false;
+            reader->buff = buff;
+            reader->buff_len = incl_len;
+        }
+        if ((incl_len != 0) && (fread(reader->buff, incl_len, 1, reader->file) != 1)) return false;
+        /* Partial records (snaplen) can not be parsed */
+        if ((incl_len < sizeof(cooked)) || (incl_len != nl_capture_u32(reader, hdr.orig_len))) continue;
+
+        memcpy(&cooked, reader->buff, sizeof(cooked));
+        rec->sock_type = NL_CAPTURE_SOCK_T_UNKNOWN;
+        rec->nsid = NL_CAPTURE_NSID_NONE;
+        rec->vrf_id = NL_DEFAULT_VRF_ID;
+        if ((ntohs(cooked.hatype) == NL_CAPTURE_ARPHRD_NETLINK) && (ntohs(cooked.halen) == sizeof(cooked.addr))) {
+            uint16_t type;
+            uint16_t vrf;
+            uint32_t nsid;
+            memcpy(&type, &cooked.addr[0], sizeof(type));
+            memcpy(&vrf, &cooked.addr[2], sizeof(vrf));
+            memcpy(&nsid, &cooked.addr[4], sizeof(nsid));
+            if (ntohs(type) < nas_nl_sock_T_MAX) rec->sock_type = (nas_nl_sock_TYPES)ntohs(type);
+            rec->vrf_id = ntohs(vrf);
+            rec->nsid = (int32_t)ntohl(nsid);
+        }
+        uint32_t frac = nl_capture_u32(reader, hdr.ts_frac);
+        rec->ts_nsec = ((uint64_t)nl_capture_u32(reader, hdr.ts_sec) * 1000000000) +
+                       (reader->nsec ? frac : ((uint64_t)frac * 1000));
+        rec->len = incl_len - sizeof(cooked);
+        rec->data = reader->buff + sizeof(cooked);
+        return true;
+    }
+    return false;
+}
+
+void nl_capture_close (nl_capture_reader_t *reader) {
+    if (reader == NULL) return;
+    if (reader->file != NULL) fclose(reader->file);
+    free(reader->buff);
+    free(reader);
+}
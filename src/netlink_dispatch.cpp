@@ -0,0 +1,657 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_dispatch.cpp
+ */
+
+#include "netlink_dispatch.h"
+#include "nas_nlattr_parser.h"
+#include "std_thread_tools.h"
+#include "event_log.h"
+
+#include <linux/neighbour.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_bridge.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+typedef std::chrono::steady_clock nl_dispatch_clock;
+
+typedef struct {
+    int sock;
+    int rt_msg_type;
+    uint32_t vrf_id;
+    bool has_vrf_name;
+    bool superseded;                /* replaced by a later event of the key, not processed */
+    bool keyed;
+    nl_dispatch_prio_t prio;
+    nl_dispatch_clock::time_point queued_at;
+    std::string vrf_name;
+    std::string key;                /* object key if keyed */
+    std::vector<char> msg;
+} nl_dispatch_item_t;
+
+typedef struct {
+    size_t lane;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable space_cond;     /* event thread waits for room on a full lane */
+    std::condition_variable done_cond;      /* lane drain waits for the events taken */
+    uint64_t enqueued;                      /* events put on the queues */
+    uint64_t done;                          /* events taken and processed */
+    std::deque<nl_dispatch_item_t> queue[NL_DISPATCH_PRIO_MAX];
+    /* Queued events not superseded, the bound is on them */
+    size_t depth[NL_DISPATCH_PRIO_MAX];
+    bool overloaded;
+    /* Latest queued event of the object keys, the deque keeps the references valid
+     * on push_back - removed when the worker takes the event */
+    std::unordered_map<std::string, nl_dispatch_item_t *> latest;
+    nl_dispatch_lane_stats_t stats;
+    std_thread_create_param_t thr;
+} nl_dispatch_worker_t;
+
+static std::mutex _dispatch_mutex;
+static bool _dispatch_started = false;
+static fun_process_nl_message _dispatch_process = nullptr;
+static auto nl_dispatch_workers_list = new std::vector<nl_dispatch_worker_t *>;
+/* Number of the workers, set once they are started - the list is read without the lock */
+static std::atomic<size_t> _dispatch_workers(0);
+
+/* Messages queued and not yet processed, the drain waits for it to get to 0 */
+static std::atomic<size_t> _dispatch_pending(0);
+static std::mutex _drain_mutex;
+static std::condition_variable _drain_cond;
+
+static bool _dispatch_coalesce = true;
+static uint32_t _dispatch_window_usec = 0;
+static size_t _dispatch_low_weight = NL_DISPATCH_DEFAULT_LOW_WEIGHT;
+static std::atomic<uint64_t> _dispatch_queued(0);
+static std::atomic<uint64_t> _dispatch_coalesced(0);
+static std::atomic<uint64_t> _dispatch_cancelled(0);
+static std::atomic<uint64_t> _dispatch_dropped(0);
+
+static size_t _dispatch_max_queued = NL_DISPATCH_DEFAULT_MAX_QUEUED;
+static nl_dispatch_overload_t _dispatch_overload = NL_DISPATCH_OVERLOAD_SHED;
+static const char *_dispatch_overload_names[] = { "coalesce", "shed", "resync" };
+
+/* Event sockets with the events dropped on the full lanes, their tables are resynced */
+static std::mutex _dropped_mutex;
+static auto nl_dispatch_dropped_socks = new std::unordered_set<int>;
+/* Set while nl_dispatch_dropped_socks is not empty, checked by the event thread on
+ * every wakeup without the lock */
+static std::atomic<bool> _dropped_any(false);
+/* Lanes that got full and are not yet back under the half of their bound */
+static std::atomic<size_t> _overloaded_lanes(0);
+
+/* Dump fence of a VRF - the objects with events since the first running dump of the VRF
+ * started, their dumped entries are older than the events and are dropped */
+typedef struct {
+    size_t dumps;
+    std::unordered_set<std::string> keys;
+} nl_dispatch_fence_t;
+
+/* Held across the check (or record) of the key and the queuing of the message so that
+ * an event and a dumped entry of an object are queued in the order they are checked */
+static std::mutex _fence_mutex;
+static auto nl_dispatch_fences = new std::unordered_map<uint32_t, nl_dispatch_fence_t>;
+static std::atomic<size_t> _fences_active(0);
+static std::atomic<uint64_t> _dispatch_fenced(0);
+
+typedef nas_nl::attr_parser<__RTA_MAX,
+                            nas_nl::sel<RTA_DST>,
+                            nas_nl::sel<RTA_TABLE, sizeof(uint32_t)>> route_key_parser;
+
+typedef nas_nl::attr_parser<__NDA_MAX,
+                            nas_nl::sel<NDA_DST>,
+                            nas_nl::sel<NDA_LLADDR>> neigh_key_parser;
+
+/* Attributes of the object keys used for the coalescing */
+typedef nas_nl::attr_parser<__RTA_MAX,
+                            nas_nl::sel<RTA_DST>,
+                            nas_nl::sel<RTA_TABLE, sizeof(uint32_t)>,
+                            nas_nl::sel<RTA_PRIORITY, sizeof(uint32_t)>> route_obj_parser;
+
+typedef nas_nl::attr_parser<__NDA_MAX,
+                            nas_nl::sel<NDA_DST>,
+                            nas_nl::sel<NDA_LLADDR>,
+                            nas_nl::sel<NDA_VLAN, sizeof(uint16_t)>> neigh_obj_parser;
+
+typedef nas_nl::attr_parser<__IFA_MAX,
+                            nas_nl::sel<IFA_ADDRESS>,
+                            nas_nl::sel<IFA_LOCAL>> addr_obj_parser;
+
+/* FNV-1a, the key only has to spread the entries over the lanes */
+static uint32_t nl_dispatch_hash(uint32_t hash, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t ix = 0; ix < len; ++ix) {
+        hash ^= p[ix];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+#define NL_DISPATCH_HASH_INIT 2166136261u
+
+static bool nl_dispatch_route_key(struct nlmsghdr *hdr, uint32_t vrf_id, uint32_t *hash) {
+    if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct rtmsg))) return false;
+    struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA(hdr);
+    struct nlattr *attrs[__RTA_MAX];
+    route_key_parser::parse_msg(attrs, hdr, sizeof(struct rtmsg));
+
+    uint32_t table = rtm->rtm_table;
+    if (attrs[RTA_TABLE] != nullptr) table = *(uint32_t *)nla_data(attrs[RTA_TABLE]);
+
+    uint32_t h = nl_dispatch_hash(NL_DISPATCH_HASH_INIT, &vrf_id, sizeof(vrf_id));
+    h = nl_dispatch_hash(h, &rtm->rtm_family, sizeof(rtm->rtm_family));
+    h = nl_dispatch_hash(h, &rtm->rtm_dst_len, sizeof(rtm->rtm_dst_len));
+    h = nl_dispatch_hash(h, &table, sizeof(table));
+    if (attrs[RTA_DST] != nullptr) {
+        h = nl_dispatch_hash(h, nla_data(attrs[RTA_DST]), nla_len(attrs[RTA_DST]));
+    }
+    *hash = h;
+    return true;
+}
+
+static bool nl_dispatch_neigh_key(struct nlmsghdr *hdr, uint32_t vrf_id, uint32_t *hash) {
+    if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct ndmsg))) return false;
+    struct ndmsg *ndm = (struct ndmsg *)NLMSG_DATA(hdr);
+    struct nlattr *attrs[__NDA_MAX];
+    neigh_key_parser::parse_msg(attrs, hdr, sizeof(struct ndmsg));
+
+    uint32_t h = nl_dispatch_hash(NL_DISPATCH_HASH_INIT, &vrf_id, sizeof(vrf_id));
+    if (ndm->ndm_family == AF_BRIDGE) {
+        /* FDB entry moves between the bridge ports, keyed by the MAC only */
+        if (attrs[NDA_LLADDR] != nullptr) {
+            h = nl_dispatch_hash(h, nla_data(attrs[NDA_LLADDR]), nla_len(attrs[NDA_LLADDR]));
+        }
+    } else {
+        h = nl_dispatch_hash(h, &ndm->ndm_ifindex, sizeof(ndm->ndm_ifindex));
+        if (attrs[NDA_DST] != nullptr) {
+            h = nl_dispatch_hash(h, nla_data(attrs[NDA_DST]), nla_len(attrs[NDA_DST]));
+        }
+    }
+    *hash = h;
+    return true;
+}
+
+extern "C" size_t nl_dispatch_lane (int rt_msg_type, struct nlmsghdr *hdr, uint32_t vrf_id, size_t workers) {
+    if (workers <= 1) return NL_DISPATCH_LANE_INTF;
+
+    uint32_t hash = 0;
+    bool keyed = false;
+    if ((rt_msg_type >= RTM_NEWROUTE) && (rt_msg_type <= RTM_GETROUTE)) {
+        keyed = nl_dispatch_route_key(hdr, vrf_id, &hash);
+    } else if ((rt_msg_type >= RTM_NEWNEIGH) && (rt_msg_type <= RTM_GETNEIGH)) {
+        keyed = nl_dispatch_neigh_key(hdr, vrf_id, &hash);
+    } else if ((rt_msg_type >= RTM_NEWMDB) && (rt_msg_type <= RTM_GETMDB) &&
+               (hdr->nlmsg_len >= NLMSG_LENGTH(sizeof(struct br_port_msg)))) {
+        /* Entries of a bridge are kept in order */
+        struct br_port_msg *bpm = (struct br_port_msg *)NLMSG_DATA(hdr);
+        hash = nl_dispatch_hash(NL_DISPATCH_HASH_INIT, &vrf_id, sizeof(vrf_id));
+        hash = nl_dispatch_hash(hash, &bpm->ifindex, sizeof(bpm->ifindex));
+        keyed = true;
+    }
+    if (!keyed) return NL_DISPATCH_LANE_INTF;
+
+    /* Routes, neighbors and MDB are kept off the interface lane */
+    return 1 + (hash % (workers - 1));
+}
+
+extern "C" nl_dispatch_prio_t nl_dispatch_prio (int rt_msg_type) {
+    return (rt_msg_type <= RTM_GETADDR) ? NL_DISPATCH_PRIO_HIGH : NL_DISPATCH_PRIO_LOW;
+}
+
+static void nl_dispatch_key_add(std::string &key, const void *data, size_t len) {
+    key.append((const char *)data, len);
+}
+
+static void nl_dispatch_key_add_attr(std::string &key, struct nlattr *attr) {
+    uint16_t len = (attr != nullptr) ? nla_len(attr) : 0;
+    nl_dispatch_key_add(key, &len, sizeof(len));
+    if (len != 0) nl_dispatch_key_add(key, nla_data(attr), len);
+}
+
+/* Key of the object the event is for - the events of a key carry the whole state of
+ * the object so only the latest one has to be processed. Netconf and MDB (the entries
+ * are nested) are not coalesced. */
+static bool nl_dispatch_coalesce_key(int rt_msg_type, struct nlmsghdr *hdr, uint32_t vrf_id, std::string &key) {
+    uint8_t obj;
+    if ((rt_msg_type == RTM_NEWLINK) || (rt_msg_type == RTM_DELLINK)) {
+        if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifinfomsg))) return false;
+        struct ifinfomsg *ifm = (struct ifinfomsg *)NLMSG_DATA(hdr);
+        obj = RTM_NEWLINK;
+        nl_dispatch_key_add(key, &obj, sizeof(obj));
+        nl_dispatch_key_add(key, &vrf_id, sizeof(vrf_id));
+        nl_dispatch_key_add(key, &ifm->ifi_family, sizeof(ifm->ifi_family));
+        nl_dispatch_key_add(key, &ifm->ifi_index, sizeof(ifm->ifi_index));
+        return true;
+    }
+    if ((rt_msg_type == RTM_NEWADDR) || (rt_msg_type == RTM_DELADDR)) {
+        if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct ifaddrmsg))) return false;
+        struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(hdr);
+        struct nlattr *attrs[__IFA_MAX];
+        addr_obj_parser::parse_msg(attrs, hdr, sizeof(struct ifaddrmsg));
+        obj = RTM_NEWADDR;
+        nl_dispatch_key_add(key, &obj, sizeof(obj));
+        nl_dispatch_key_add(key, &vrf_id, sizeof(vrf_id));
+        nl_dispatch_key_add(key, &ifa->ifa_family, sizeof(ifa->ifa_family));
+        nl_dispatch_key_add(key, &ifa->ifa_prefixlen, sizeof(ifa->ifa_prefixlen));
+        nl_dispatch_key_add(key, &ifa->ifa_index, sizeof(ifa->ifa_index));
+        nl_dispatch_key_add_attr(key, attrs[IFA_ADDRESS]);
+        nl_dispatch_key_add_attr(key, attrs[IFA_LOCAL]);
+        return true;
+    }
+    if ((rt_msg_type == RTM_NEWROUTE) || (rt_msg_type == RTM_DELROUTE)) {
+        if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct rtmsg))) return false;
+        struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA(hdr);
+        struct nlattr *attrs[__RTA_MAX];
+        route_obj_parser::parse_msg(attrs, hdr, sizeof(struct rtmsg));
+        uint32_t table = rtm->rtm_table;
+        if (attrs[RTA_TABLE] != nullptr) table = *(uint32_t *)nla_data(attrs[RTA_TABLE]);
+        obj = RTM_NEWROUTE;
+        nl_dispatch_key_add(key, &obj, sizeof(obj));
+        nl_dispatch_key_add(key, &vrf_id, sizeof(vrf_id));
+        nl_dispatch_key_add(key, &rtm->rtm_family, sizeof(rtm->rtm_family));
+        nl_dispatch_key_add(key, &rtm->rtm_dst_len, sizeof(rtm->rtm_dst_len));
+        nl_dispatch_key_add(key, &rtm->rtm_tos, sizeof(rtm->rtm_tos));
+        nl_dispatch_key_add(key, &table, sizeof(table));
+        nl_dispatch_key_add_attr(key, attrs[RTA_DST]);
+        nl_dispatch_key_add_attr(key, attrs[RTA_PRIORITY]);
+        return true;
+    }
+    if ((rt_msg_type == RTM_NEWNEIGH) || (rt_msg_type == RTM_DELNEIGH)) {
+        if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct ndmsg))) return false;
+        struct ndmsg *ndm = (struct ndmsg *)NLMSG_DATA(hdr);
+        struct nlattr *attrs[__NDA_MAX];
+        neigh_obj_parser::parse_msg(attrs, hdr, sizeof(struct ndmsg));
+        uint8_t flags = ndm->ndm_flags & (NTF_SELF | NTF_MASTER);
+        obj = RTM_NEWNEIGH;
+        nl_dispatch_key_add(key, &obj, sizeof(obj));
+        nl_dispatch_key_add(key, &vrf_id, sizeof(vrf_id));
+        nl_dispatch_key_add(key, &ndm->ndm_family, sizeof(ndm->ndm_family));
+        nl_dispatch_key_add(key, &ndm->ndm_ifindex, sizeof(ndm->ndm_ifindex));
+        if (ndm->ndm_family == AF_BRIDGE) {
+            nl_dispatch_key_add(key, &flags, sizeof(flags));
+            nl_dispatch_key_add_attr(key, attrs[NDA_LLADDR]);
+            nl_dispatch_key_add_attr(key, attrs[NDA_VLAN]);
+        } else {
+            nl_dispatch_key_add_attr(key, attrs[NDA_DST]);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool nl_dispatch_is_del(int rt_msg_type) {
+    return ((rt_msg_type == RTM_DELLINK) || (rt_msg_type == RTM_DELADDR) ||
+            (rt_msg_type == RTM_DELROUTE) || (rt_msg_type == RTM_DELNEIGH));
+}
+
+/* Route add is published as a create (not as an update) unless it replaces a route */
+static bool nl_dispatch_is_route_create(const nl_dispatch_item_t &item) {
+    struct nlmsghdr *hdr = (struct nlmsghdr *)&item.msg[0];
+    return ((item.rt_msg_type == RTM_NEWROUTE) && !(hdr->nlmsg_flags & NLM_F_REPLACE));
+}
+
+/* Coalesce the event with the queued one of the same key, called with the worker lock.
+ * Returns true if the event is absorbed and must not be queued.
+ *   - add/update after add/update: the queued one is superseded, the route create
+ *     stays a create with the latest state
+ *   - delete after a route create: both are dropped, the route was never published
+ *   - delete after add/update: the queued one is superseded
+ *   - add after delete: both are kept, the delete is published first */
+static bool nl_dispatch_coalesce(nl_dispatch_worker_t *worker, const std::string &key, nl_dispatch_item_t &item) {
+    auto it = worker->latest.find(key);
+    if (it == worker->latest.end()) return false;
+    nl_dispatch_item_t *prev = it->second;
+    if (nl_dispatch_is_del(prev->rt_msg_type)) return false;
+
+    /* Superseded event has no room on the lane, the new one takes it */
+    worker->depth[prev->prio]--;
+    if (nl_dispatch_is_del(item.rt_msg_type) && nl_dispatch_is_route_create(*prev)) {
+        prev->superseded = true;
+        std::vector<char>().swap(prev->msg);
+        worker->latest.erase(it);
+        _dispatch_cancelled++;
+        return true;
+    }
+    if (!nl_dispatch_is_del(item.rt_msg_type) && nl_dispatch_is_route_create(*prev)) {
+        ((struct nlmsghdr *)&item.msg[0])->nlmsg_flags &= ~NLM_F_REPLACE;
+    }
+    prev->superseded = true;
+    std::vector<char>().swap(prev->msg);
+    _dispatch_coalesced++;
+    return false;
+}
+
+static void nl_dispatch_process(nl_dispatch_item_t &item) {
+    if (item.superseded) return;
+    struct nlmsghdr *hdr = (struct nlmsghdr *)&item.msg[0];
+    _dispatch_process(item.sock, item.rt_msg_type, hdr,
+                      item.has_vrf_name ? (void *)item.vrf_name.c_str() : nullptr, item.vrf_id);
+}
+
+/* Take up to max events of the priority, called with the worker lock */
+static void nl_dispatch_take(nl_dispatch_worker_t *worker, nl_dispatch_prio_t prio,
+                             std::vector<nl_dispatch_item_t> &batch, size_t max) {
+    std::deque<nl_dispatch_item_t> &queue = worker->queue[prio];
+    while (!queue.empty() && (batch.size() < max)) {
+        nl_dispatch_item_t &item = queue.front();
+        if (item.keyed) {
+            auto it = worker->latest.find(item.key);
+            if ((it != worker->latest.end()) && (it->second == &item)) worker->latest.erase(it);
+        }
+        if (!item.superseded) worker->depth[prio]--;
+        batch.push_back(std::move(item));
+        queue.pop_front();
+    }
+}
+
+static size_t nl_dispatch_depth(const nl_dispatch_worker_t *worker) {
+    return worker->depth[NL_DISPATCH_PRIO_HIGH] + worker->depth[NL_DISPATCH_PRIO_LOW];
+}
+
+/* Lane is back under the half of its bound, called with the worker lock */
+static void nl_dispatch_check_recovered(nl_dispatch_worker_t *worker) {
+    if (!worker->overloaded || (nl_dispatch_depth(worker) > (_dispatch_max_queued / 2))) return;
+    worker->overloaded = false;
+    _overloaded_lanes--;
+    EV_LOGGING(NETLINK, INFO, "NL-DISPATCH", "Lane %lu recovered from overload", worker->lane);
+}
+
+static void nl_dispatch_main(void *param) {
+    nl_dispatch_worker_t *worker = (nl_dispatch_worker_t *)param;
+    std::vector<nl_dispatch_item_t> batch;
+    nl_dispatch_prio_t prio;
+
+    while (1) {
+        {
+            std::unique_lock<std::mutex> lock(worker->mutex);
+            worker->cond.wait(lock, [worker] {
+                return (!worker->queue[NL_DISPATCH_PRIO_HIGH].empty() || !worker->queue[NL_DISPATCH_PRIO_LOW].empty());
+            });
+            if ((_dispatch_window_usec != 0) && worker->queue[NL_DISPATCH_PRIO_HIGH].empty()) {
+                /* Hold the first event for the window so that the later events of
+                 * the same objects are coalesced with it, cut short by a high
+                 * priority event */
+                worker->cond.wait_for(lock, std::chrono::microseconds(_dispatch_window_usec),
+                                      [worker] { return !worker->queue[NL_DISPATCH_PRIO_HIGH].empty(); });
+            }
+            /* All the high priority events are taken, the low priority ones up to
+             * the weight so that the high priority queue is checked again soon */
+            prio = NL_DISPATCH_PRIO_HIGH;
+            nl_dispatch_take(worker, prio, batch, SIZE_MAX);
+            if (batch.empty()) {
+                prio = NL_DISPATCH_PRIO_LOW;
+                nl_dispatch_take(worker, prio, batch, _dispatch_low_weight);
+            }
+            nl_dispatch_check_recovered(worker);
+        }
+        /* Event thread (or a dump thread) can be waiting for room with the coalesce policy */
+        worker->space_cond.notify_all();
+        size_t count = batch.size();
+        uint64_t total_usec = 0;
+        uint64_t max_usec = 0;
+        for (auto &item : batch) {
+            uint64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                                nl_dispatch_clock::now() - item.queued_at).count();
+            total_usec += usec;
+            if (usec > max_usec) max_usec = usec;
+            nl_dispatch_process(item);
+        }
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            nl_dispatch_latency_t &lat = worker->stats.latency[prio];
+            lat.events += count;
+            lat.total_usec += total_usec;
+            if (max_usec > lat.max_usec) lat.max_usec = max_usec;
+            worker->done += count;
+        }
+        worker->done_cond.notify_all();
+
+        if (_dispatch_pending.fetch_sub(count) == count) {
+            std::lock_guard<std::mutex> lock(_drain_mutex);
+            _drain_cond.notify_all();
+        }
+    }
+}
+
+extern "C" t_std_error nl_dispatch_init (fun_process_nl_message process) {
+    std::lock_guard<std::mutex> lock(_dispatch_mutex);
+    if (_dispatch_started) return STD_ERR_OK;
+    _dispatch_process = process;
+    _dispatch_started = true;
+
+    nas_os_nl_config_t cfg;
+    nas_os_nl_config_get(&cfg);
+    size_t workers = cfg.dispatch_workers;
+    _dispatch_coalesce = cfg.dispatch_coalesce;
+    _dispatch_window_usec = cfg.dispatch_window_usec;
+    _dispatch_low_weight = cfg.dispatch_low_weight;
+    _dispatch_max_queued = cfg.dispatch_max_queued;
+    _dispatch_overload = cfg.dispatch_overload;
+
+    for (size_t lane = 0; lane < workers; ++lane) {
+        nl_dispatch_worker_t *worker = new (std::nothrow) nl_dispatch_worker_t;
+        if (worker == nullptr) break;
+        memset(&worker->stats, 0, sizeof(worker->stats));
+        worker->lane = lane;
+        worker->enqueued = 0;
+        worker->done = 0;
+        memset(worker->depth, 0, sizeof(worker->depth));
+        worker->overloaded = false;
+        std_thread_init_struct(&worker->thr);
+        worker->thr.name = "nas-os-nl-dispatch";
+        worker->thr.thread_function = (std_thread_function_t)nl_dispatch_main;
+        worker->thr.param = worker;
+        if (std_thread_create(&worker->thr) != STD_ERR_OK) {
+            delete worker;
+            break;
+        }
+        nl_dispatch_workers_list->push_back(worker);
+    }
+    if (nl_dispatch_workers_list->size() != workers) {
+        /* Lanes are fixed once the messages are queued, run with the workers started */
+        EV_LOGGING(NETLINK, ERR, "NL-DISPATCH", "Started %lu of %lu workers",
+                   nl_dispatch_workers_list->size(), workers);
+    }
+    EV_LOGGING(NETLINK, INFO, "NL-DISPATCH", "Event dispatch workers:%lu coalesce:%d window:%u usec "
+               "max-queued:%lu overload:%s", nl_dispatch_workers_list->size(), _dispatch_coalesce,
+               _dispatch_window_usec, _dispatch_max_queued, _dispatch_overload_names[_dispatch_overload]);
+    _dispatch_workers = nl_dispatch_workers_list->size();
+    return (nl_dispatch_workers_list->size() == workers) ? STD_ERR_OK : STD_ERR(NAS_OS, FAIL, 0);
+}
+
+static bool nl_dispatch_queue (int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    size_t workers = _dispatch_workers;
+    if (workers == 0) {
+        return (_dispatch_process != nullptr) ? _dispatch_process(sock, rt_msg_type, hdr, context, vrf_id) : false;
+    }
+
+    nl_dispatch_item_t item;
+    item.sock = sock;
+    item.rt_msg_type = rt_msg_type;
+    item.vrf_id = vrf_id;
+    item.has_vrf_name = (context != nullptr);
+    item.superseded = false;
+    if (item.has_vrf_name) item.vrf_name = (const char *)context;
+    item.msg.assign((char *)hdr, (char *)hdr + hdr->nlmsg_len);
+
+    std::string key;
+    bool keyed = _dispatch_coalesce && nl_dispatch_coalesce_key(rt_msg_type, hdr, vrf_id, key);
+    /* Next hop appended to a multipath route only has the delta, it is not coalesced
+     * and the events of the route queued before it are not coalesced with the later ones */
+    bool append = (rt_msg_type == RTM_NEWROUTE) && (hdr->nlmsg_flags & NLM_F_APPEND);
+    item.keyed = keyed && !append;
+
+    /* Classified when received, the links and addresses are processed first */
+    nl_dispatch_prio_t prio = nl_dispatch_prio(rt_msg_type);
+    item.prio = prio;
+    size_t lane = nl_dispatch_lane(rt_msg_type, hdr, vrf_id, workers);
+    nl_dispatch_worker_t *worker = nl_dispatch_workers_list->at(lane);
+    {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        /* Superseded events stay queued (and pending) until the worker takes them */
+        if (item.keyed && nl_dispatch_coalesce(worker, key, item)) return true;
+        if (nl_dispatch_depth(worker) >= _dispatch_max_queued) {
+            if (!worker->overloaded) {
+                worker->overloaded = true;
+                _overloaded_lanes++;
+                worker->stats.overloads++;
+                EV_LOGGING(NETLINK, ERR, "NL-DISPATCH", "Lane %lu full with %lu events, overload policy %s",
+                           lane, nl_dispatch_depth(worker), _dispatch_overload_names[_dispatch_overload]);
+            }
+            if ((_dispatch_overload == NL_DISPATCH_OVERLOAD_RESYNC) ||
+                ((_dispatch_overload == NL_DISPATCH_OVERLOAD_SHED) && (prio == NL_DISPATCH_PRIO_LOW))) {
+                /* Dropped here rather than by the kernel, the table of the socket is
+                 * resynced once the lane has room */
+                worker->stats.dropped++;
+                _dispatch_dropped++;
+                if (sock >= 0) {
+                    std::lock_guard<std::mutex> dlock(_dropped_mutex);
+                    nl_dispatch_dropped_socks->insert(sock);
+                    _dropped_any = true;
+                }
+                return true;
+            }
+            /* Wait for the worker, the kernel socket buffer takes the burst meanwhile */
+            worker->stats.blocked++;
+            worker->space_cond.wait(lock, [worker] { return nl_dispatch_depth(worker) < _dispatch_max_queued; });
+        }
+        _dispatch_pending++;
+        _dispatch_queued++;
+        std::deque<nl_dispatch_item_t> &queue = worker->queue[prio];
+        if (keyed && append) worker->latest.erase(key);
+        if (item.keyed) item.key = key;
+        item.queued_at = nl_dispatch_clock::now();
+        queue.push_back(std::move(item));
+        worker->enqueued++;
+        if (queue.back().keyed) worker->latest[key] = &queue.back();
+        worker->depth[prio]++;
+        if (worker->depth[prio] > worker->stats.latency[prio].max_depth) {
+            worker->stats.latency[prio].max_depth = worker->depth[prio];
+        }
+    }
+    worker->cond.notify_one();
+    return true;
+}
+
+extern "C" bool nl_dispatch_msg (int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    if (rt_msg_type < RTM_BASE) return false;
+    if (_fences_active == 0) return nl_dispatch_queue(sock, rt_msg_type, hdr, context, vrf_id);
+
+    std::lock_guard<std::mutex> lock(_fence_mutex);
+    auto it = nl_dispatch_fences->find(vrf_id);
+    std::string key;
+    if ((it != nl_dispatch_fences->end()) && nl_dispatch_coalesce_key(rt_msg_type, hdr, vrf_id, key)) {
+        it->second.keys.insert(key);
+    }
+    return nl_dispatch_queue(sock, rt_msg_type, hdr, context, vrf_id);
+}
+
+extern "C" bool nl_dispatch_dump_msg (int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context,
+                                      uint32_t vrf_id) {
+    if (rt_msg_type < RTM_BASE) return false;
+
+    std::lock_guard<std::mutex> lock(_fence_mutex);
+    auto it = nl_dispatch_fences->find(vrf_id);
+    std::string key;
+    if ((it != nl_dispatch_fences->end()) && !it->second.keys.empty() &&
+        nl_dispatch_coalesce_key(rt_msg_type, hdr, vrf_id, key) && (it->second.keys.count(key) != 0)) {
+        /* Event of the object is queued already, the entry would bring back the older state */
+        _dispatch_fenced++;
+        return true;
+    }
+    return nl_dispatch_queue(sock, rt_msg_type, hdr, context, vrf_id);
+}
+
+extern "C" void nl_dispatch_fence_start (uint32_t vrf_id) {
+    std::lock_guard<std::mutex> lock(_fence_mutex);
+    nl_dispatch_fence_t &fence = (*nl_dispatch_fences)[vrf_id];
+    if (fence.dumps++ == 0) _fences_active++;
+}
+
+extern "C" void nl_dispatch_fence_stop (uint32_t vrf_id) {
+    std::lock_guard<std::mutex> lock(_fence_mutex);
+    auto it = nl_dispatch_fences->find(vrf_id);
+    if ((it == nl_dispatch_fences->end()) || (--it->second.dumps != 0)) return;
+    nl_dispatch_fences->erase(it);
+    _fences_active--;
+}
+
+extern "C" void nl_dispatch_drain (void) {
+    if (_dispatch_workers == 0) return;
+    std::unique_lock<std::mutex> lock(_drain_mutex);
+    _drain_cond.wait(lock, [] { return _dispatch_pending == 0; });
+}
+
+extern "C" void nl_dispatch_drain_lane (size_t lane) {
+    if (lane >= _dispatch_workers) return;
+    nl_dispatch_worker_t *worker = nl_dispatch_workers_list->at(lane);
+    std::unique_lock<std::mutex> lock(worker->mutex);
+    uint64_t target = worker->enqueued;
+    worker->done_cond.wait(lock, [worker, target] { return worker->done >= target; });
+}
+
+extern "C" size_t nl_dispatch_workers (void) {
+    return _dispatch_workers;
+}
+
+extern "C" bool nl_dispatch_lane_stats_get (size_t lane, nl_dispatch_lane_stats_t *stats) {
+    if (lane >= _dispatch_workers) return false;
+    nl_dispatch_worker_t *worker = nl_dispatch_workers_list->at(lane);
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    *stats = worker->stats;
+    for (size_t prio = 0; prio < NL_DISPATCH_PRIO_MAX; ++prio) {
+        stats->latency[prio].depth = worker->depth[prio];
+    }
+    return true;
+}
+
+extern "C" void nl_dispatch_stats_get (nl_dispatch_stats_t *stats) {
+    stats->queued = _dispatch_queued;
+    stats->coalesced = _dispatch_coalesced;
+    stats->cancelled = _dispatch_cancelled;
+    stats->pending = _dispatch_pending;
+    stats->dropped = _dispatch_dropped;
+    stats->fenced = _dispatch_fenced;
+}
+
+extern "C" bool nl_dispatch_dropped (int sock) {
+    std::lock_guard<std::mutex> lock(_dropped_mutex);
+    bool rc = (nl_dispatch_dropped_socks->erase(sock) != 0);
+    if (nl_dispatch_dropped_socks->empty()) _dropped_any = false;
+    return rc;
+}
+
+extern "C" bool nl_dispatch_dropped_any (void) {
+    return _dropped_any;
+}
+
+extern "C" bool nl_dispatch_overloaded (void) {
+    return (_overloaded_lanes != 0);
+}
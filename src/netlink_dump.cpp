@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_dump.cpp
+ */
+
+#include "netlink_dump.h"
+#include "netlink_dispatch.h"
+#include "std_thread_tools.h"
+#include "nas_os_nl_config.h"
+#include "event_log.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock nl_dump_clock;
+
+typedef struct {
+    std::string vrf_name;
+    uint32_t vrf_id;
+    std::atomic<bool> cancelled;    /* read by the dump threads without the lock */
+    size_t links;                   /* link dumps not done yet */
+    size_t running;                 /* dumps being run by the threads */
+    size_t remaining;               /* dumps not done yet, including the held ones */
+    std::vector<nl_dump_t> later;   /* held until the link dumps are done */
+    nl_dump_clock::time_point start;
+} nl_dump_vrf_t;
+
+typedef struct {
+    std::shared_ptr<nl_dump_vrf_t> vrf;
+    nl_dump_t dump;
+} nl_dump_task_t;
+
+typedef struct {
+    std::mutex mutex;
+    std::condition_variable cond;               /* dump threads wait for the tasks */
+    std::condition_variable done_cond;          /* cancel and wait wait for the dumps */
+} nl_dump_sync_t;
+
+/* Never destroyed, the dump threads wait on it until the process exits */
+static auto nl_dump_sync = new nl_dump_sync_t;
+static auto nl_dump_tasks = new std::deque<nl_dump_task_t>;
+/* VRFs with dumps not done yet */
+static auto nl_dump_vrfs = new std::list<std::shared_ptr<nl_dump_vrf_t>>;
+
+static bool _dump_started = false;
+static fun_process_nl_message _dump_process = nullptr;
+static nl_dump_failed_fn _dump_failed = nullptr;
+/* Number of the threads, set once they are started */
+static std::atomic<size_t> _dump_threads(0);
+static std::atomic<uint64_t> _dump_retries(0);
+static size_t _dump_pending = 0;
+static nl_dump_stats_t _dump_stats;
+
+/* Dumped entries are handed to the handler as received on the event socket */
+static bool nl_dump_process(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    const nl_dump_task_t *task = (const nl_dump_task_t *)context;
+    return _dump_process(task->dump.evt_sock, rt_msg_type, hdr,
+                         (void *)task->vrf->vrf_name.c_str(), vrf_id);
+}
+
+static bool nl_dump_run(const nl_dump_task_t &task) {
+    const nl_dump_vrf_t &vrf = *task.vrf;
+    int sock = nas_nl_sock_create(vrf.vrf_name.c_str(), task.dump.type, false);
+    if (sock == -1) {
+        EV_LOGGING(NETLINK, ERR, "NL-DUMP", "Failed to create the socket VRF:%s type:%d",
+                   vrf.vrf_name.c_str(), task.dump.type);
+        return false;
+    }
+
+    char buff[1024];
+    bool rc = false;
+    /* Dump is read on its own socket, the entries of the objects with events received on
+     * the event socket meanwhile are older than the events */
+    nl_dispatch_fence_start(vrf.vrf_id);
+    for (size_t retry = 0; retry <= NL_DUMP_MAX_RETRY; ++retry) {
+        int seq = nl_get_next_seq();
+        int error = 0;
+        if (!task.dump.request(sock, task.dump.family, seq)) break;
+        if (netlink_tools_process_socket(sock, nl_dump_process, (void *)&task, buff, sizeof(buff),
+                                         &seq, &error, vrf.vrf_id)) {
+            rc = true;
+            break;
+        }
+        if (error != EINTR) break;
+        /* Dump is interrupted by a change in the table, the entries given again are updates */
+        _dump_retries++;
+        EV_LOGGING(NETLINK, INFO, "NL-DUMP", "Dump interrupted VRF:%s type:%d family:%d retry:%lu",
+                   vrf.vrf_name.c_str(), task.dump.type, task.dump.family, retry);
+    }
+    nl_dispatch_fence_stop(vrf.vrf_id);
+    close(sock);
+    return rc;
+}
+
+/* Account the dump done, called with the lock */
+static void nl_dump_done(const nl_dump_task_t &task, bool rc) {
+    nl_dump_vrf_t &vrf = *task.vrf;
+    vrf.running--;
+    if (rc) {
+        _dump_stats.dumps++;
+    } else {
+        _dump_stats.failed++;
+    }
+    if (task.dump.link && (--vrf.links == 0)) {
+        /* Links are processed, the dumps referring to them can start */
+        for (auto &dump : vrf.later) {
+            nl_dump_tasks->push_back({task.vrf, dump});
+        }
+        vrf.later.clear();
+        nl_dump_sync->cond.notify_all();
+    }
+    --_dump_pending;
+    if ((--vrf.remaining == 0) && !vrf.cancelled) {
+        uint64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                            nl_dump_clock::now() - vrf.start).count();
+        if (usec > _dump_stats.max_vrf_usec) _dump_stats.max_vrf_usec = usec;
+        _dump_stats.vrfs++;
+        nl_dump_vrfs->remove(task.vrf);
+        EV_LOGGING(NETLINK, INFO, "NL-DUMP", "Dumps done VRF:%s in %lu usec", vrf.vrf_name.c_str(), usec);
+    }
+    nl_dump_sync->done_cond.notify_all();
+}
+
+static void nl_dump_main(void) {
+    std::unique_lock<std::mutex> lock(nl_dump_sync->mutex);
+
+    while (1) {
+        nl_dump_sync->cond.wait(lock, [] { return !nl_dump_tasks->empty(); });
+        nl_dump_task_t task = nl_dump_tasks->front();
+        nl_dump_tasks->pop_front();
+        task.vrf->running++;
+        lock.unlock();
+
+        bool rc = nl_dump_run(task);
+        if (task.dump.link) {
+            /* Links are on the interface lane when dispatched, wait until they are translated */
+            nl_dispatch_drain_lane(NL_DISPATCH_LANE_INTF);
+        }
+        if (!rc && !task.vrf->cancelled && (_dump_failed != nullptr)) {
+            EV_LOGGING(NETLINK, ERR, "NL-DUMP", "Dump failed VRF:%s type:%d family:%d",
+                       task.vrf->vrf_name.c_str(), task.dump.type, task.dump.family);
+            _dump_failed(task.vrf->vrf_name.c_str(), task.dump.type);
+        }
+
+        lock.lock();
+        nl_dump_done(task, rc);
+    }
+}
+
+extern "C" t_std_error nl_dump_init (fun_process_nl_message process, nl_dump_failed_fn failed) {
+    std::lock_guard<std::mutex> lock(nl_dump_sync->mutex);
+    if (_dump_started) return STD_ERR_OK;
+    _dump_started = true;
+    _dump_process = process;
+    _dump_failed = failed;
+    memset(&_dump_stats, 0, sizeof(_dump_stats));
+
+    nas_os_nl_config_t cfg;
+    nas_os_nl_config_get(&cfg);
+    size_t threads = cfg.dump_threads;
+
+    size_t started = 0;
+    for ( ; started < threads; ++started) {
+        std_thread_create_param_t *thr = new (std::nothrow) std_thread_create_param_t;
+        if (thr == nullptr) break;
+        std_thread_init_struct(thr);
+        thr->name = "nas-os-nl-dump";
+        thr->thread_function = (std_thread_function_t)nl_dump_main;
+        if (std_thread_create(thr) != STD_ERR_OK) {
+            delete thr;
+            break;
+        }
+    }
+    _dump_threads = started;
+    EV_LOGGING(NETLINK, INFO, "NL-DUMP", "Dump threads:%lu", started);
+    if (started != threads) {
+        EV_LOGGING(NETLINK, ERR, "NL-DUMP", "Started %lu of %lu dump threads", started, threads);
+        return STD_ERR(NAS_OS, FAIL, 0);
+    }
+    return STD_ERR_OK;
+}
+
+extern "C" bool nl_dump_vrf (const char *vrf_name, uint32_t vrf_id, const nl_dump_t *dumps, size_t count) {
+    if ((_dump_threads == 0) || (count == 0)) return false;
+
+    auto vrf = std::make_shared<nl_dump_vrf_t>();
+    vrf->vrf_name = vrf_name;
+    vrf->vrf_id = vrf_id;
+    vrf->cancelled = false;
+    vrf->links = 0;
+    vrf->running = 0;
+    vrf->remaining = count;
+    vrf->start = nl_dump_clock::now();
+
+    std::lock_guard<std::mutex> lock(nl_dump_sync->mutex);
+    for (size_t ix = 0; ix < count; ++ix) {
+        if (dumps[ix].link) {
+            vrf->links++;
+            nl_dump_tasks->push_back({vrf, dumps[ix]});
+        } else {
+            vrf->later.push_back(dumps[ix]);
+        }
+    }
+    if (vrf->links == 0) {
+        for (auto &dump : vrf->later) {
+            nl_dump_tasks->push_back({vrf, dump});
+        }
+        vrf->later.clear();
+    }
+    _dump_pending += count;
+    nl_dump_vrfs->push_back(vrf);
+    nl_dump_sync->cond.notify_all();
+    return true;
+}
+
+extern "C" void nl_dump_cancel (const char *vrf_name) {
+    std::unique_lock<std::mutex> lock(nl_dump_sync->mutex);
+    std::vector<std::shared_ptr<nl_dump_vrf_t>> cancelled;
+    for (auto &vrf : *nl_dump_vrfs) {
+        if (vrf->vrf_name != vrf_name) continue;
+        vrf->cancelled = true;
+        vrf->remaining -= vrf->later.size();
+        _dump_pending -= vrf->later.size();
+        vrf->later.clear();
+        cancelled.push_back(vrf);
+    }
+    if (cancelled.empty()) return;
+
+    for (auto it = nl_dump_tasks->begin(); it != nl_dump_tasks->end(); ) {
+        if (it->vrf->cancelled) {
+            it->vrf->remaining--;
+            _dump_pending--;
+            it = nl_dump_tasks->erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto &vrf : cancelled) {
+        /* Link dumps still running release the held dumps, they are cleared above */
+        nl_dump_sync->done_cond.wait(lock, [&vrf] { return vrf->running == 0; });
+        if (vrf->remaining == 0) nl_dump_vrfs->remove(vrf);
+    }
+    nl_dump_sync->done_cond.notify_all();
+    EV_LOGGING(NETLINK, INFO, "NL-DUMP", "Dumps cancelled VRF:%s", vrf_name);
+}
+
+extern "C" void nl_dump_wait (void) {
+    std::unique_lock<std::mutex> lock(nl_dump_sync->mutex);
+    nl_dump_sync->done_cond.wait(lock, [] { return _dump_pending == 0; });
+}
+
+extern "C" void nl_dump_stats_get (nl_dump_stats_t *stats) {
+    std::lock_guard<std::mutex> lock(nl_dump_sync->mutex);
+    *stats = _dump_stats;
+    stats->retries = _dump_retries;
+    stats->pending = _dump_pending;
+}
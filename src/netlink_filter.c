@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_filter.c
+ */
+
+/*
+ * Socket filters for the netlink event sockets, the kernel drops the events
+ * that are never published before queuing them on the socket.
+ */
+
+#include "netlink_filter.h"
+#include "event_log.h"
+
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#define NL_FILTER_ACCEPT 0xffffffff
+#define NL_FILTER_DROP 0
+
+#define NL_RTM_OFF(field) (NLMSG_HDRLEN + offsetof(struct rtmsg, field))
+#define NL_NDM_OFF(field) (NLMSG_HDRLEN + offsetof(struct ndmsg, field))
+#define NL_RTM_ATTR_OFF (NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(struct rtmsg)))
+
+#define NL_FILTER_RULE(c) { c, sizeof(c)/sizeof(c[0]) }
+
+typedef struct {
+    struct sock_filter *prog;
+    size_t len;
+    bool overflow;
+} nl_filter_prog_t;
+
+static size_t nl_filter_emit(nl_filter_prog_t *p, uint16_t code, uint8_t jt, uint8_t jf, uint32_t k) {
+    if (p->len >= NL_FILTER_MAX_INSNS) {
+        p->overflow = true;
+        return p->len;
+    }
+    struct sock_filter insn = BPF_JUMP(code, k, jt, jf);
+    p->prog[p->len] = insn;
+    return p->len++;
+}
+
+/* Point the true (or false) branch of the jump at index ix to the next instruction to emit */
+static void nl_filter_patch(nl_filter_prog_t *p, size_t ix, bool jt) {
+    if (p->overflow || ((p->len - ix - 1) > 0xff)) {
+        p->overflow = true;
+        return;
+    }
+    if (jt) p->prog[ix].jt = p->len - ix - 1;
+    else p->prog[ix].jf = p->len - ix - 1;
+}
+
+/* Absolute loads take the data in network byte order, the netlink fields are in host order */
+static uint32_t nl_filter_value(uint8_t size, uint32_t value) {
+    if (size == 2) return ntohs((uint16_t)value);
+    if (size == 4) return ntohl(value);
+    return value;
+}
+
+static uint16_t nl_filter_ld_size(uint8_t size) {
+    if (size == 2) return BPF_H;
+    if (size == 4) return BPF_W;
+    return BPF_B;
+}
+
+/* Emit the instructions for the condition, returns the index of the jump that has to be
+ * taken to the next rule when the condition does not match */
+static size_t nl_filter_emit_cond(nl_filter_prog_t *p, const nl_filter_cond_t *cond, bool *fail_jt) {
+    if (cond->op == NL_FILTER_OP_NO_ATTR) {
+        /* A = offset of the attribute after the given offset, 0 if not present */
+        nl_filter_emit(p, BPF_LD|BPF_IMM, 0, 0, cond->offset);
+        nl_filter_emit(p, BPF_LDX|BPF_IMM, 0, 0, cond->value);
+        nl_filter_emit(p, BPF_LD|BPF_W|BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_NLATTR);
+        *fail_jt = false;
+        return nl_filter_emit(p, BPF_JMP|BPF_JEQ|BPF_K, 0, 0, 0);
+    }
+
+    nl_filter_emit(p, BPF_LD|nl_filter_ld_size(cond->size)|BPF_ABS, 0, 0, cond->offset);
+    uint32_t value = nl_filter_value(cond->size, cond->value);
+    switch (cond->op) {
+        case NL_FILTER_OP_EQ:
+            *fail_jt = false;
+            return nl_filter_emit(p, BPF_JMP|BPF_JEQ|BPF_K, 0, 0, value);
+        case NL_FILTER_OP_NE:
+            *fail_jt = true;
+            return nl_filter_emit(p, BPF_JMP|BPF_JEQ|BPF_K, 0, 0, value);
+        default:
+            *fail_jt = false;
+            return nl_filter_emit(p, BPF_JMP|BPF_JSET|BPF_K, 0, 0, value);
+    }
+}
+
+bool nl_filter_compile(const uint16_t *msg_types, size_t n_types, const nl_filter_rule_t *rules,
+                       size_t n_rules, struct sock_filter *prog, size_t *prog_len) {
+    nl_filter_prog_t p = { prog, 0, false };
+    size_t type_jumps[n_types];
+    size_t ix = 0;
+
+    /* Accept the message types without rules */
+    nl_filter_emit(&p, BPF_LD|BPF_H|BPF_ABS, 0, 0, offsetof(struct nlmsghdr, nlmsg_type));
+    for ( ; ix < n_types; ++ix) {
+        type_jumps[ix] = nl_filter_emit(&p, BPF_JMP|BPF_JEQ|BPF_K, 0, 0, nl_filter_value(2, msg_types[ix]));
+    }
+    nl_filter_emit(&p, BPF_RET|BPF_K, 0, 0, NL_FILTER_ACCEPT);
+    for (ix = 0; ix < n_types; ++ix) {
+        nl_filter_patch(&p, type_jumps[ix], true);
+    }
+
+    /* Accept the dump responses, a datagram can have many of them and the filter
+     * only sees the first one */
+    nl_filter_emit(&p, BPF_LD|BPF_H|BPF_ABS, 0, 0, offsetof(struct nlmsghdr, nlmsg_flags));
+    nl_filter_emit(&p, BPF_JMP|BPF_JSET|BPF_K, 0, 1, nl_filter_value(2, NLM_F_MULTI));
+    nl_filter_emit(&p, BPF_RET|BPF_K, 0, 0, NL_FILTER_ACCEPT);
+
+    for (ix = 0; ix < n_rules; ++ix) {
+        size_t fail_jumps[rules[ix].count];
+        bool fail_jt[rules[ix].count];
+        size_t cx = 0;
+        for ( ; cx < rules[ix].count; ++cx) {
+            fail_jumps[cx] = nl_filter_emit_cond(&p, &rules[ix].conds[cx], &fail_jt[cx]);
+        }
+        nl_filter_emit(&p, BPF_RET|BPF_K, 0, 0, NL_FILTER_DROP);
+        for (cx = 0; cx < rules[ix].count; ++cx) {
+            nl_filter_patch(&p, fail_jumps[cx], fail_jt[cx]);
+        }
+    }
+    nl_filter_emit(&p, BPF_RET|BPF_K, 0, 0, NL_FILTER_ACCEPT);
+
+    if (p.overflow) return false;
+    *prog_len = p.len;
+    return true;
+}
+
+/*
+ * Route events ignored in nl_to_route_info
+ */
+static const nl_filter_cond_t rt_non_ip_family[] = {
+    { NL_RTM_OFF(rtm_family), 1, NL_FILTER_OP_NE, AF_INET },
+    { NL_RTM_OFF(rtm_family), 1, NL_FILTER_OP_NE, AF_INET6 },
+};
+static const nl_filter_cond_t rt_unspec_table[] = {
+    { NL_RTM_OFF(rtm_table), 1, NL_FILTER_OP_EQ, RT_TABLE_UNSPEC },
+};
+static const nl_filter_cond_t rt_unsupported_type[] = {
+    { NL_RTM_OFF(rtm_type), 1, NL_FILTER_OP_NE, RTN_UNICAST },
+    { NL_RTM_OFF(rtm_type), 1, NL_FILTER_OP_NE, RTN_LOCAL },
+    { NL_RTM_OFF(rtm_type), 1, NL_FILTER_OP_NE, RTN_BLACKHOLE },
+    { NL_RTM_OFF(rtm_type), 1, NL_FILTER_OP_NE, RTN_UNREACHABLE },
+    { NL_RTM_OFF(rtm_type), 1, NL_FILTER_OP_NE, RTN_PROHIBIT },
+};
+static const nl_filter_cond_t rt_v4_self_ip[] = {
+    { NL_RTM_OFF(rtm_type), 1, NL_FILTER_OP_EQ, RTN_LOCAL },
+    { NL_RTM_OFF(rtm_family), 1, NL_FILTER_OP_EQ, AF_INET },
+    { NL_RTM_OFF(rtm_dst_len), 1, NL_FILTER_OP_EQ, 32 },
+    { NL_RTM_OFF(rtm_protocol), 1, NL_FILTER_OP_EQ, RTPROT_KERNEL },
+    { NL_RTM_ATTR_OFF, 0, NL_FILTER_OP_NO_ATTR, RTA_GATEWAY },
+    { NL_RTM_ATTR_OFF, 0, NL_FILTER_OP_NO_ATTR, RTA_MULTIPATH },
+};
+static const nl_filter_cond_t rt_v6_self_ip[] = {
+    { NL_RTM_OFF(rtm_type), 1, NL_FILTER_OP_EQ, RTN_LOCAL },
+    { NL_RTM_OFF(rtm_family), 1, NL_FILTER_OP_EQ, AF_INET6 },
+    { NL_RTM_OFF(rtm_dst_len), 1, NL_FILTER_OP_EQ, 128 },
+    { NL_RTM_OFF(rtm_protocol), 1, NL_FILTER_OP_EQ, RTPROT_UNSPEC },
+    { NL_RTM_ATTR_OFF, 0, NL_FILTER_OP_NO_ATTR, RTA_GATEWAY },
+    { NL_RTM_ATTR_OFF, 0, NL_FILTER_OP_NO_ATTR, RTA_MULTIPATH },
+};
+static const nl_filter_cond_t rt_v6_cloned[] = {
+    { NL_RTM_OFF(rtm_family), 1, NL_FILTER_OP_EQ, AF_INET6 },
+    { NL_RTM_OFF(rtm_flags), 4, NL_FILTER_OP_SET, RTM_F_CLONED },
+};
+
+static const nl_filter_rule_t route_rules[] = {
+    NL_FILTER_RULE(rt_non_ip_family),
+    NL_FILTER_RULE(rt_unspec_table),
+    NL_FILTER_RULE(rt_unsupported_type),
+    NL_FILTER_RULE(rt_v4_self_ip),
+    NL_FILTER_RULE(rt_v6_self_ip),
+    NL_FILTER_RULE(rt_v6_cloned),
+};
+static const uint16_t route_msg_types[] = { RTM_NEWROUTE, RTM_DELROUTE };
+
+/*
+ * Neighbor events ignored in nl_to_neigh_info
+ */
+static const nl_filter_cond_t nbr_unsupported_family[] = {
+    { NL_NDM_OFF(ndm_family), 1, NL_FILTER_OP_NE, AF_INET },
+    { NL_NDM_OFF(ndm_family), 1, NL_FILTER_OP_NE, AF_INET6 },
+    { NL_NDM_OFF(ndm_family), 1, NL_FILTER_OP_NE, AF_BRIDGE },
+};
+static const nl_filter_cond_t nbr_probe[] = {
+    { NL_NDM_OFF(ndm_state), 2, NL_FILTER_OP_EQ, NUD_PROBE },
+};
+
+static const nl_filter_rule_t neigh_rules[] = {
+    NL_FILTER_RULE(nbr_unsupported_family),
+    NL_FILTER_RULE(nbr_probe),
+};
+static const uint16_t neigh_msg_types[] = { RTM_NEWNEIGH, RTM_DELNEIGH, RTM_GETNEIGH };
+
+t_std_error nl_filter_attach(int sock, nas_nl_sock_TYPES type) {
+    struct sock_filter insns[NL_FILTER_MAX_INSNS];
+    size_t len = 0;
+    bool rc = false;
+
+    switch (type) {
+        case nas_nl_sock_T_ROUTE:
+            rc = nl_filter_compile(route_msg_types, sizeof(route_msg_types)/sizeof(route_msg_types[0]),
+                                   route_rules, sizeof(route_rules)/sizeof(route_rules[0]), insns, &len);
+            break;
+        case nas_nl_sock_T_NEI:
+            rc = nl_filter_compile(neigh_msg_types, sizeof(neigh_msg_types)/sizeof(neigh_msg_types[0]),
+                                   neigh_rules, sizeof(neigh_rules)/sizeof(neigh_rules[0]), insns, &len);
+            break;
+        default:
+            return STD_ERR_OK;
+    }
+    if (!rc) {
+        EV_LOGGING(NETLINK, ERR, "NL-FILTER", "Failed to compile the filter for sock type %d", type);
+        return STD_ERR(NAS_OS, FAIL, 0);
+    }
+
+    struct sock_fprog fprog = { (unsigned short)len, insns };
+    if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) != 0) {
+        EV_LOGGING(NETLINK, ERR, "NL-FILTER", "Failed to attach the filter for sock %d type %d errno %d",
+                   sock, type, errno);
+        return STD_ERR(NAS_OS, FAIL, errno);
+    }
+    EV_LOGGING(NETLINK, INFO, "NL-FILTER", "Attached filter of %zu instructions to sock %d type %d",
+               len, sock, type);
+    return STD_ERR_OK;
+}
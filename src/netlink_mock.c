@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_mock.c
+ */
+
+#include "netlink_mock.h"
+#include "event_log.h"
+
+#include <linux/rtnetlink.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifndef NLM_F_CAPPED
+#define NLM_F_CAPPED    0x100
+#endif
+
+/* Max. socket fd that can be a mock socket */
+#define NL_MOCK_MAX_SOCKS 4096
+
+typedef struct {
+    uint16_t msg_type;
+    uint16_t flags;
+    int error;
+    uint32_t count;
+} nl_mock_rule_t;
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t max_len;
+} nl_mock_buff_t;
+
+static pthread_mutex_t nl_mock_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Peer socket + 1 of the mock sockets, 0 if not a mock socket */
+static int nl_mock_peers[NL_MOCK_MAX_SOCKS];
+static int nl_mock_idle[NL_MOCK_MAX_IDLE_SOCKS];
+static size_t nl_mock_idle_count = 0;
+
+static nl_mock_rule_t nl_mock_rules[NL_MOCK_MAX_RULES];
+static nl_mock_request_fn nl_mock_handler = NULL;
+static void *nl_mock_handler_ctx = NULL;
+static volatile uint32_t nl_mock_latency_usec = 0;
+static uint32_t nl_mock_ifindex = NL_MOCK_FIRST_IFINDEX;
+static nl_mock_stats_t nl_mock_stats;
+
+/* Request and response buffers, one per thread */
+static __thread nl_mock_buff_t nl_mock_req_buff;
+static __thread nl_mock_buff_t nl_mock_resp_buff;
+
+static char *nl_mock_buff_reserve(nl_mock_buff_t *buff, size_t len) {
+    if ((buff->len + len) > buff->max_len) {
+        size_t max_len = (buff->max_len == 0) ? NL_RECV_MIN_BUFFER_LEN : buff->max_len;
+        while (max_len < (buff->len + len)) max_len *= 2;
+        char *data = (char *)realloc(buff->data, max_len);
+        if (data == NULL) return NULL;
+        buff->data = data;
+        buff->max_len = max_len;
+    }
+    char *p = buff->data + buff->len;
+    buff->len += len;
+    return p;
+}
+
+static int nl_mock_peer_get(int sock) {
+    if ((sock < 0) || (sock >= NL_MOCK_MAX_SOCKS)) return -1;
+    return nl_mock_peers[sock] - 1;
+}
+
+static void nl_mock_sock_close(int sock) {
+    int peer = nl_mock_peer_get(sock);
+    if (peer >= 0) close(peer);
+    nl_mock_peers[sock] = 0;
+    close(sock);
+}
+
+static int nl_mock_sock_get(const char *vrf_name, nas_nl_sock_TYPES type) {
+    pthread_mutex_lock(&nl_mock_mutex);
+    if (nl_mock_idle_count > 0) {
+        int sock = nl_mock_idle[--nl_mock_idle_count];
+        pthread_mutex_unlock(&nl_mock_mutex);
+        return sock;
+    }
+    pthread_mutex_unlock(&nl_mock_mutex);
+
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        EV_LOGGING(NETLINK, ERR, "NL-MOCK", "Failed to create the mock socket errno %d", errno);
+        return -1;
+    }
+    if ((fds[0] >= NL_MOCK_MAX_SOCKS) || (fds[1] >= NL_MOCK_MAX_SOCKS)) {
+        close(fds[0]);
+        close(fds[1]);
+        errno = EMFILE;
+        return -1;
+    }
+    /* Same bound on the wait for the response as the kernel request sockets */
+    struct timeval tv = { NL_RECV_TIMEOUT_SEC, 0 };
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    nl_mock_peers[fds[0]] = fds[1] + 1;
+    return fds[0];
+}
+
+static void nl_mock_sock_put(const char *vrf_name, nas_nl_sock_TYPES type, int sock, bool sock_err) {
+    if (nl_mock_peer_get(sock) < 0) return;
+    pthread_mutex_lock(&nl_mock_mutex);
+    if (!sock_err && (nl_mock_idle_count < NL_MOCK_MAX_IDLE_SOCKS)) {
+        nl_mock_idle[nl_mock_idle_count++] = sock;
+        sock = -1;
+    }
+    pthread_mutex_unlock(&nl_mock_mutex);
+    if (sock != -1) nl_mock_sock_close(sock);
+}
+
+/* Error to answer the request with, from the injection rules or the handler */
+static int nl_mock_request_error(const struct nlmsghdr *req) {
+    int error = 0;
+    bool matched = false;
+    pthread_mutex_lock(&nl_mock_mutex);
+    size_t ix = 0;
+    for ( ; ix < NL_MOCK_MAX_RULES; ++ix) {
+        nl_mock_rule_t *rule = &nl_mock_rules[ix];
+        if ((rule->count == 0) || (rule->msg_type != req->nlmsg_type) ||
+            ((req->nlmsg_flags & rule->flags) != rule->flags)) continue;
+        --rule->count;
+        error = rule->error;
+        matched = true;
+        break;
+    }
+    nl_mock_request_fn fn = nl_mock_handler;
+    void *context = nl_mock_handler_ctx;
+    pthread_mutex_unlock(&nl_mock_mutex);
+
+    if (matched) return error;
+    return (fn != NULL) ? fn(req, context) : 0;
+}
+
+static bool nl_mock_reply(int peer, const char *data, size_t len) {
+    if (send(peer, data, len, MSG_DONTWAIT) != (ssize_t)len) {
+        EV_LOGGING(NETLINK, ERR, "NL-MOCK", "Failed to queue the response len %lu errno %d", len, errno);
+        return false;
+    }
+    return true;
+}
+
+/* Echo the request as the kernel would echo the new object, the created links get an ifindex */
+static void nl_mock_echo(int peer, const struct nlmsghdr *req) {
+    nl_mock_buff_t *buff = &nl_mock_resp_buff;
+    buff->len = 0;
+    struct nlmsghdr *nh = (struct nlmsghdr *)nl_mock_buff_reserve(buff, NLMSG_ALIGN(req->nlmsg_len));
+    if (nh == NULL) return;
+    memcpy(nh, req, req->nlmsg_len);
+    nh->nlmsg_flags = 0;
+    if ((nh->nlmsg_type == RTM_NEWLINK) && (nh->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifinfomsg)))) {
+        struct ifinfomsg *ifmsg = (struct ifinfomsg *)NLMSG_DATA(nh);
+        if (ifmsg->ifi_index == 0) ifmsg->ifi_index = __sync_fetch_and_add(&nl_mock_ifindex, 1);
+    }
+    if (nl_mock_reply(peer, buff->data, buff->len)) __sync_fetch_and_add(&nl_mock_stats.echoes, 1);
+}
+
+static ssize_t nl_mock_send(int sock, const struct msghdr *msg, int flags) {
+    int peer = nl_mock_peer_get(sock);
+    if (peer < 0) {
+        /* Not a mock socket, e.g. a dump request on an event socket */
+        return sendmsg(sock, msg, flags);
+    }
+
+    /* Requests of the batch are in separate iovecs, make them contiguous */
+    nl_mock_buff_t *req_buff = &nl_mock_req_buff;
+    req_buff->len = 0;
+    size_t ix = 0;
+    for ( ; ix < msg->msg_iovlen; ++ix) {
+        char *p = nl_mock_buff_reserve(req_buff, msg->msg_iov[ix].iov_len);
+        if (p == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        memcpy(p, msg->msg_iov[ix].iov_base, msg->msg_iov[ix].iov_len);
+    }
+    if (nl_mock_latency_usec != 0) usleep(nl_mock_latency_usec);
+
+    /* ACKs of all the requests are sent in one datagram after the echoes */
+    char acks[NL_BATCH_MAX_MSGS * NLMSG_SPACE(sizeof(struct nlmsgerr))];
+    size_t acks_len = 0;
+    int len = req_buff->len;
+    struct nlmsghdr *req = (struct nlmsghdr *)req_buff->data;
+    for ( ; NLMSG_OK(req, len); req = NLMSG_NEXT(req, len)) {
+        __sync_fetch_and_add(&nl_mock_stats.requests, 1);
+        __sync_fetch_and_add(&nl_mock_stats.bytes, req->nlmsg_len);
+
+        int error = nl_mock_request_error(req);
+        if ((error == 0) && (req->nlmsg_flags & NLM_F_ECHO)) {
+            nl_mock_echo(peer, req);
+        }
+
+        struct nlmsghdr *nh = (struct nlmsghdr *)(acks + acks_len);
+        if ((error == 0) && ((req->nlmsg_flags & NLM_F_DUMP) == NLM_F_DUMP)) {
+            /* Empty dump */
+            nh->nlmsg_len = NLMSG_LENGTH(sizeof(int));
+            nh->nlmsg_type = NLMSG_DONE;
+            nh->nlmsg_flags = NLM_F_MULTI;
+            *(int *)NLMSG_DATA(nh) = 0;
+            __sync_fetch_and_add(&nl_mock_stats.dumps, 1);
+        } else if ((error != 0) || (req->nlmsg_flags & NLM_F_ACK)) {
+            struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA(nh);
+            nh->nlmsg_len = NLMSG_LENGTH(sizeof(*err));
+            nh->nlmsg_type = NLMSG_ERROR;
+            nh->nlmsg_flags = NLM_F_CAPPED;
+            err->error = -error;
+            err->msg = *req;
+            __sync_fetch_and_add((error == 0) ? &nl_mock_stats.acks : &nl_mock_stats.errors, 1);
+        } else {
+            continue;
+        }
+        nh->nlmsg_seq = req->nlmsg_seq;
+        nh->nlmsg_pid = 0;
+        acks_len += NLMSG_ALIGN(nh->nlmsg_len);
+        if ((acks_len + NLMSG_SPACE(sizeof(struct nlmsgerr))) > sizeof(acks)) {
+            nl_mock_reply(peer, acks, acks_len);
+            acks_len = 0;
+        }
+    }
+    if ((acks_len != 0) && !nl_mock_reply(peer, acks, acks_len)) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    return req_buff->len;
+}
+
+static const nl_transport_t nl_mock_transport = {
+    .name = "mock",
+    .sock_get = nl_mock_sock_get,
+    .sock_put = nl_mock_sock_put,
+    .send = nl_mock_send,
+};
+
+void nl_mock_enable (void) {
+    nl_transport_set(&nl_mock_transport);
+}
+
+void nl_mock_disable (void) {
+    nl_transport_set(NULL);
+
+    pthread_mutex_lock(&nl_mock_mutex);
+    while (nl_mock_idle_count > 0) {
+        nl_mock_sock_close(nl_mock_idle[--nl_mock_idle_count]);
+    }
+    pthread_mutex_unlock(&nl_mock_mutex);
+}
+
+void nl_mock_set_handler (nl_mock_request_fn fn, void *context) {
+    pthread_mutex_lock(&nl_mock_mutex);
+    nl_mock_handler = fn;
+    nl_mock_handler_ctx = context;
+    pthread_mutex_unlock(&nl_mock_mutex);
+}
+
+void nl_mock_set_latency (uint32_t usec) {
+    nl_mock_latency_usec = usec;
+}
+
+t_std_error nl_mock_inject_error (uint16_t msg_type, uint16_t flags, int error, uint32_t count) {
+    t_std_error rc = STD_ERR(NAS_OS,FAIL, 0);
+    pthread_mutex_lock(&nl_mock_mutex);
+    size_t ix = 0;
+    for ( ; ix < NL_MOCK_MAX_RULES; ++ix) {
+        nl_mock_rule_t *rule = &nl_mock_rules[ix];
+        if (rule->count != 0) continue;
+        rule->msg_type = msg_type;
+        rule->flags = flags;
+        rule->error = error;
+        rule->count = count;
+        rc = STD_ERR_OK;
+        break;
+    }
+    pthread_mutex_unlock(&nl_mock_mutex);
+    return rc;
+}
+
+void nl_mock_reset (void) {
+    pthread_mutex_lock(&nl_mock_mutex);
+    memset(nl_mock_rules, 0, sizeof(nl_mock_rules));
+    memset(&nl_mock_stats, 0, sizeof(nl_mock_stats));
+    nl_mock_handler = NULL;
+    nl_mock_handler_ctx = NULL;
+    nl_mock_latency_usec = 0;
+    pthread_mutex_unlock(&nl_mock_mutex);
+}
+
+void nl_mock_stats_get (nl_mock_stats_t *stats) {
+    pthread_mutex_lock(&nl_mock_mutex);
+    *stats = nl_mock_stats;
+    pthread_mutex_unlock(&nl_mock_mutex);
+}
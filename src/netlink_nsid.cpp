@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_nsid.cpp
+ */
+
+#include "netlink_nsid.h"
+#include "netlink_tools.h"
+#include "nas_nlmsg.h"
+#include "nas_nlmsg_builder.h"
+#include "std_system.h"
+#include "nas_os_nl_config.h"
+#include "std_utils.h"
+#include "event_log.h"
+
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/net_namespace.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef struct {
+    uint32_t vrf_id;
+    std::string vrf_name;
+} nl_nsid_vrf_t;
+
+static std::mutex _nsid_mutex;
+static auto nl_nsid_vrfs = new std::map<int, nl_nsid_vrf_t>;
+static uint64_t _nsid_unmapped = 0;
+
+/* Replies are small, the ACK carries the request back */
+#define NL_NSID_REPLY_LEN 1024
+
+typedef nas_nl::msg_size<struct rtgenmsg, nas_nl::attr<uint32_t>, nas_nl::attr<int32_t>> nsid_msg_size;
+
+extern "C" bool nl_nsid_enabled (void) {
+    static const bool enabled = [] {
+        nas_os_nl_config_t cfg;
+        nas_os_nl_config_get(&cfg);
+        return cfg.nsid_listener;
+    }();
+    return enabled;
+}
+
+/* Open the namespace of the VRF, the thread enters it only for the open */
+static int nl_nsid_netns_open(const char *vrf_name) {
+    int netns_handle = 0;
+    if (std_sys_set_netns(vrf_name, &netns_handle) != STD_ERR_OK) {
+        EV_LOGGING(NETLINK, ERR, "NL-NSID", "Failed to enter the namespace of VRF:%s", vrf_name);
+        return -1;
+    }
+    int fd = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+    int err = errno;
+    std_sys_reset_netns(&netns_handle);
+    if (fd == -1) {
+        EV_LOGGING(NETLINK, ERR, "NL-NSID", "Failed to open the namespace of VRF:%s err:%d", vrf_name, err);
+    }
+    return fd;
+}
+
+static bool nl_nsid_reply(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    static const nla_select_t nsid_sel[] = { { NETNSA_NSID, sizeof(int32_t) } };
+    if ((rt_msg_type != RTM_NEWNSID) || (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct rtgenmsg)))) return true;
+
+    struct nlattr *attrs[NETNSA_MAX + 1];
+    nla_parse_selected(attrs, NETNSA_MAX + 1, nsid_sel, 1, nlmsg_attrdata(hdr, sizeof(struct rtgenmsg)),
+                       nlmsg_attrlen(hdr, sizeof(struct rtgenmsg)));
+    if (attrs[NETNSA_NSID] != NULL) *(int *)context = *(int32_t *)nla_data(attrs[NETNSA_NSID]);
+    return true;
+}
+
+/* Send RTM_GETNSID, or RTM_NEWNSID to allocate the NSID, for the namespace fd */
+static t_std_error nl_nsid_request(int type, int netns_fd, int *nsid) {
+    nas_nl::msg_buffer<nsid_msg_size::value> buff;
+    nas_nl::msg_builder req(buff, type, NLM_F_REQUEST | NLM_F_ACK);
+    struct rtgenmsg *gen = req.family_header<struct rtgenmsg>();
+    if (gen == nullptr) return STD_ERR(NAS_OS, FAIL, 0);
+    gen->rtgen_family = AF_UNSPEC;
+    req.put(NETNSA_FD, (uint32_t)netns_fd);
+    if (type == RTM_NEWNSID) req.put(NETNSA_NSID, (int32_t)NETNSA_NSID_NOT_ASSIGNED);
+    if (!req.ok()) return STD_ERR(NAS_OS, FAIL, 0);
+
+    char reply[NL_NSID_REPLY_LEN];
+    if (type == RTM_NEWNSID) {
+        return nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT, req.msg(), reply, sizeof(reply));
+    }
+    *nsid = NETNSA_NSID_NOT_ASSIGNED;
+    return nl_do_set_request_echo(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT, req.msg(), reply, sizeof(reply),
+                                  nl_nsid_reply, nsid);
+}
+
+/* NSID the default namespace has for the VRF namespace, allocated if there is none yet */
+static t_std_error nl_nsid_resolve(const char *vrf_name, int *nsid) {
+    int fd = nl_nsid_netns_open(vrf_name);
+    if (fd == -1) return STD_ERR(NAS_OS, FAIL, 0);
+
+    t_std_error rc = nl_nsid_request(RTM_GETNSID, fd, nsid);
+    if ((rc == STD_ERR_OK) && (*nsid == NETNSA_NSID_NOT_ASSIGNED)) {
+        /* Kernel assigns the NSID when it first reports an event of the namespace, assigned
+         * here so the first events are mapped too. The kernel can assign it in between
+         * (EEXIST), it is queried again either way */
+        nl_nsid_request(RTM_NEWNSID, fd, nsid);
+        rc = nl_nsid_request(RTM_GETNSID, fd, nsid);
+    }
+    close(fd);
+    if ((rc == STD_ERR_OK) && (*nsid == NETNSA_NSID_NOT_ASSIGNED)) rc = STD_ERR(NAS_OS, FAIL, 0);
+    return rc;
+}
+
+extern "C" t_std_error nl_nsid_vrf_add (const char *vrf_name, uint32_t vrf_id) {
+    int nsid = NETNSA_NSID_NOT_ASSIGNED;
+    if (nl_nsid_resolve(vrf_name, &nsid) != STD_ERR_OK) {
+        EV_LOGGING(NETLINK, ERR, "NL-NSID", "Failed to get the NSID of VRF:%s", vrf_name);
+        return STD_ERR(NAS_OS, FAIL, 0);
+    }
+
+    std::lock_guard<std::mutex> lock(_nsid_mutex);
+    auto it = nl_nsid_vrfs->find(nsid);
+    if ((it != nl_nsid_vrfs->end()) && (it->second.vrf_name != vrf_name)) {
+        EV_LOGGING(NETLINK, ERR, "NL-NSID", "NSID:%d of VRF:%s is mapped to VRF:%s",
+                   nsid, vrf_name, it->second.vrf_name.c_str());
+        return STD_ERR(NAS_OS, FAIL, 0);
+    }
+    (*nl_nsid_vrfs)[nsid] = { vrf_id, vrf_name };
+    EV_LOGGING(NETLINK, INFO, "NL-NSID", "NSID:%d mapped to VRF:%s id:%u", nsid, vrf_name, vrf_id);
+    return STD_ERR_OK;
+}
+
+extern "C" bool nl_nsid_vrf_del (const char *vrf_name, uint32_t *vrf_id) {
+    std::lock_guard<std::mutex> lock(_nsid_mutex);
+    for (auto it = nl_nsid_vrfs->begin(); it != nl_nsid_vrfs->end(); ++it) {
+        if (it->second.vrf_name != vrf_name) continue;
+        if (vrf_id != nullptr) *vrf_id = it->second.vrf_id;
+        EV_LOGGING(NETLINK, INFO, "NL-NSID", "NSID:%d unmapped from VRF:%s", it->first, vrf_name);
+        nl_nsid_vrfs->erase(it);
+        return true;
+    }
+    return false;
+}
+
+extern "C" bool nl_nsid_vrf_get (int nsid, uint32_t *vrf_id, char *vrf_name, size_t len) {
+    std::lock_guard<std::mutex> lock(_nsid_mutex);
+    auto it = nl_nsid_vrfs->find(nsid);
+    if (it == nl_nsid_vrfs->end()) {
+        /* Namespace not (or no longer) a VRF */
+        ++_nsid_unmapped;
+        return false;
+    }
+    *vrf_id = it->second.vrf_id;
+    /* Copied under the lock, the VRF can be removed once it is released */
+    safestrncpy(vrf_name, it->second.vrf_name.c_str(), len);
+    return true;
+}
+
+extern "C" void nl_nsid_vrf_walk (nl_nsid_vrf_fn fn, void *context) {
+    std::vector<std::pair<int, nl_nsid_vrf_t>> vrfs;
+    {
+        std::lock_guard<std::mutex> lock(_nsid_mutex);
+        vrfs.assign(nl_nsid_vrfs->begin(), nl_nsid_vrfs->end());
+    }
+    for (auto &vrf : vrfs) {
+        fn(vrf.first, vrf.second.vrf_id, vrf.second.vrf_name.c_str(), context);
+    }
+}
+
+extern "C" void nl_nsid_stats_get (nl_nsid_stats_t *stats) {
+    std::lock_guard<std::mutex> lock(_nsid_mutex);
+    stats->vrfs = nl_nsid_vrfs->size();
+    stats->unmapped = _nsid_unmapped;
+}
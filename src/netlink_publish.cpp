@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_publish.cpp
+ */
+
+#include "netlink_publish.h"
+#include "std_thread_tools.h"
+#include "nas_os_nl_config.h"
+#include "event_log.h"
+
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef std::chrono::steady_clock nl_publish_clock;
+
+typedef struct {
+    std::vector<cps_api_object_t> objs;
+    nl_publish_clock::time_point deadline;      /* of the oldest object */
+    std::unordered_map<std::string, size_t> index;  /* object of each key in objs */
+} nl_publish_batch_t;
+
+typedef struct {
+    std::mutex mutex;
+    std::condition_variable cond;               /* publisher waits for the batches */
+    std::condition_variable published_cond;     /* flush and the full queue wait for the publisher */
+} nl_publish_sync_t;
+
+/* Never destroyed, the publisher thread waits on it until the process exits */
+static auto nl_publish_sync = new nl_publish_sync_t;
+static bool _publish_started = false;
+static nl_publish_fn _publish_fn = nullptr;
+static nl_publish_key_fn _publish_key_fn = nullptr;
+static nl_publish_free_fn _publish_free_fn = nullptr;
+/* 0 if the objects are not batched, set once the publisher is started */
+static std::atomic<size_t> _publish_max_batch(0);
+static uint32_t _publish_deadline_usec = NL_PUBLISH_DEFAULT_DEADLINE_USEC;
+static std_thread_create_param_t _publish_thr;
+
+static nl_publish_batch_t _publish_batches[NL_PUBLISH_CLASS_MAX];
+/* Objects published ahead of the batches, in this order - the interface objects and the
+ * objects of the batches held when they were added */
+static std::vector<cps_api_object_t> _publish_ready;
+/* Objects added and not yet published, including the batch being published */
+static size_t _publish_queued = 0;
+static size_t _publish_flushing = 0;
+static nl_publish_stats_t _publish_stats;
+
+/* Batch is published when it is full, at its deadline or when flushed */
+static bool nl_publish_ready(const nl_publish_batch_t &batch, nl_publish_clock::time_point now) {
+    if (batch.objs.empty()) return false;
+    return ((batch.objs.size() >= _publish_max_batch) || (_publish_flushing != 0) || (now >= batch.deadline));
+}
+
+/* Objects of the batch are moved out to be published, the later objects of their
+ * keys start a new batch */
+static void nl_publish_take(nl_publish_batch_t &batch, std::vector<cps_api_object_t> &objs) {
+    objs.insert(objs.end(), batch.objs.begin(), batch.objs.end());
+    batch.objs.clear();
+    batch.index.clear();
+}
+
+static void nl_publish_main(void) {
+    std::vector<cps_api_object_t> objs;
+    std::unique_lock<std::mutex> lock(nl_publish_sync->mutex);
+
+    while (1) {
+        nl_publish_clock::time_point now = nl_publish_clock::now();
+        nl_publish_clock::time_point wake = nl_publish_clock::time_point::max();
+        /* Objects of the batches held before are ahead of the later ones of the batches */
+        objs.swap(_publish_ready);
+        for (size_t cls = 0; cls < NL_PUBLISH_CLASS_MAX; ++cls) {
+            nl_publish_batch_t &batch = _publish_batches[cls];
+            if (nl_publish_ready(batch, now)) {
+                nl_publish_take(batch, objs);
+            } else if (!batch.objs.empty() && (batch.deadline < wake)) {
+                wake = batch.deadline;
+            }
+        }
+        if (objs.empty()) {
+            if (wake == nl_publish_clock::time_point::max()) {
+                nl_publish_sync->cond.wait(lock);
+            } else {
+                nl_publish_sync->cond.wait_until(lock, wake);
+            }
+            continue;
+        }
+
+        /* CPS publishes one object per call, the batch is sent back to back without
+         * holding up the producers */
+        lock.unlock();
+        size_t failed = 0;
+        for (auto obj : objs) {
+            if (_publish_fn(obj) != cps_api_ret_code_OK) ++failed;
+        }
+        lock.lock();
+
+        _publish_stats.objects += objs.size();
+        _publish_stats.failed += failed;
+        _publish_stats.batches++;
+        if (objs.size() > _publish_stats.max_batch) _publish_stats.max_batch = objs.size();
+        _publish_queued -= objs.size();
+        objs.clear();
+        nl_publish_sync->published_cond.notify_all();
+    }
+}
+
+extern "C" t_std_error nl_publish_init (nl_publish_fn publish, nl_publish_key_fn key,
+                                        nl_publish_free_fn free_fn) {
+    std::lock_guard<std::mutex> lock(nl_publish_sync->mutex);
+    if (_publish_started) return STD_ERR_OK;
+    _publish_started = true;
+    _publish_fn = publish;
+    if (free_fn != nullptr) {
+        _publish_key_fn = key;
+        _publish_free_fn = free_fn;
+    }
+
+    nas_os_nl_config_t cfg;
+    nas_os_nl_config_get(&cfg);
+    size_t max_batch = cfg.publish_batch;
+    if (max_batch <= 1) return STD_ERR_OK;
+    _publish_deadline_usec = cfg.publish_deadline_usec;
+
+    std_thread_init_struct(&_publish_thr);
+    _publish_thr.name = "nas-os-nl-publish";
+    _publish_thr.thread_function = (std_thread_function_t)nl_publish_main;
+    if (std_thread_create(&_publish_thr) != STD_ERR_OK) {
+        EV_LOGGING(NETLINK, ERR, "NL-PUBLISH", "Failed to create the publisher thread");
+        return STD_ERR(NAS_OS, FAIL, 0);
+    }
+    _publish_max_batch = max_batch;
+    EV_LOGGING(NETLINK, INFO, "NL-PUBLISH", "Event publish batch:%lu deadline:%u usec",
+               max_batch, _publish_deadline_usec);
+    return STD_ERR_OK;
+}
+
+extern "C" bool nl_publish_batching (void) {
+    return (_publish_max_batch != 0);
+}
+
+extern "C" void nl_publish_add (nl_publish_class_t cls, cps_api_object_t obj) {
+    char key[NL_PUBLISH_MAX_KEY_LEN];
+    size_t key_len = 0;
+    if ((cls != NL_PUBLISH_CLASS_INTF) && (_publish_key_fn != nullptr)) {
+        key_len = _publish_key_fn(cls, obj, key, sizeof(key));
+        if (key_len > sizeof(key)) key_len = 0;
+    }
+
+    std::unique_lock<std::mutex> lock(nl_publish_sync->mutex);
+    if (key_len != 0) {
+        /* Only the last state of the object is published, it keeps the place of the
+         * first one so that the order with the other objects of the batch is kept */
+        nl_publish_batch_t &batch = _publish_batches[cls];
+        auto it = batch.index.find(std::string(key, key_len));
+        if (it != batch.index.end()) {
+            cps_api_object_t replaced = batch.objs[it->second];
+            batch.objs[it->second] = obj;
+            _publish_stats.coalesced++;
+            lock.unlock();
+            _publish_free_fn(replaced);
+            return;
+        }
+    }
+
+    /* Hold up the translation if the publisher can not keep up, the dispatch lanes
+     * fill up behind it and their overload policy applies */
+    if (_publish_queued >= NL_PUBLISH_MAX_QUEUED) {
+        _publish_stats.blocked++;
+        nl_publish_sync->published_cond.wait(lock, [] { return (_publish_queued < NL_PUBLISH_MAX_QUEUED); });
+    }
+
+    ++_publish_queued;
+    if (_publish_queued > _publish_stats.max_queued) _publish_stats.max_queued = _publish_queued;
+
+    if (cls == NL_PUBLISH_CLASS_INTF) {
+        /* Interface objects are not held for the deadline, the link state changes are
+         * published as soon as they are translated. The route and neighbor objects held
+         * were translated before, they are published ahead - e.g. a route over the link
+         * is not published after the link delete */
+        for (auto &held : _publish_batches) nl_publish_take(held, _publish_ready);
+        _publish_ready.push_back(obj);
+        nl_publish_sync->cond.notify_one();
+        return;
+    }
+
+    nl_publish_batch_t &batch = _publish_batches[cls];
+    if (batch.objs.empty()) {
+        batch.deadline = nl_publish_clock::now() + std::chrono::microseconds(_publish_deadline_usec);
+    }
+    if (key_len != 0) batch.index.emplace(std::string(key, key_len), batch.objs.size());
+    batch.objs.push_back(obj);
+    /* Publisher is woken up for a new deadline or a full batch */
+    if ((batch.objs.size() == 1) || (batch.objs.size() >= _publish_max_batch)) {
+        nl_publish_sync->cond.notify_one();
+    }
+}
+
+extern "C" void nl_publish_flush (void) {
+    if (!nl_publish_batching()) return;
+    std::unique_lock<std::mutex> lock(nl_publish_sync->mutex);
+    ++_publish_flushing;
+    nl_publish_sync->cond.notify_one();
+    nl_publish_sync->published_cond.wait(lock, [] { return (_publish_queued == 0); });
+    --_publish_flushing;
+}
+
+extern "C" void nl_publish_stats_get (nl_publish_stats_t *stats) {
+    std::lock_guard<std::mutex> lock(nl_publish_sync->mutex);
+    *stats = _publish_stats;
+    stats->queued = _publish_queued;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_rcvbuf.cpp
+ */
+
+/*
+ * Adaptive receive buffer sizing of the netlink event sockets - the buffer starts small,
+ * grows with the queued events and the drops and shrinks back after idle periods.
+ */
+
+#include "netlink_rcvbuf.h"
+#include "netlink_stats.h"
+#include "std_time_tools.h"
+#include "event_log.h"
+
+#include <linux/sock_diag.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <errno.h>
+
+#include <map>
+
+#ifndef SO_MEMINFO
+#define SO_MEMINFO 55
+#endif
+
+typedef struct {
+    size_t max_len;
+    size_t len;                 /* requested buffer size */
+    uint32_t drops;             /* socket drop counter at the last sample */
+    uint32_t window_peak;       /* max. queued bytes since the last resize or idle check */
+    uint64_t window_start;      /* uptime (usec) of the last resize */
+    bool meminfo;               /* SO_MEMINFO supported */
+} nl_rcvbuf_state_t;
+
+//Adaptive receive buffer state of the event sockets
+static auto nl_rcvbuf_states = new std::map<int, nl_rcvbuf_state_t>;
+
+static bool nl_rcvbuf_set(int sock, nl_rcvbuf_state_t &state, size_t len) {
+    int val = (int)len;
+    /* SO_RCVBUFFORCE goes above rmem_max, fall back to SO_RCVBUF without CAP_NET_ADMIN */
+    if ((setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &val, sizeof(val)) != 0) &&
+        (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &val, sizeof(val)) != 0)) {
+        EV_LOGGING(NETLINK, ERR, "NL-RCVBUF", "Failed to set the receive buffer %lu for sock %d errno %d",
+                   len, sock, errno);
+        return false;
+    }
+    state.len = len;
+    state.window_peak = 0;
+    state.window_start = std_get_uptime(NULL);
+    return true;
+}
+
+extern "C" t_std_error nas_nl_rcvbuf_init (int sock, size_t max_len) {
+    nl_rcvbuf_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.max_len = max_len;
+    state.meminfo = true;
+
+    if (!nl_rcvbuf_set(sock, state, (max_len < NL_RCVBUF_START_LEN) ? max_len : NL_RCVBUF_START_LEN)) {
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+    (*nl_rcvbuf_states)[sock] = state;
+    return STD_ERR_OK;
+}
+
+extern "C" void nas_nl_rcvbuf_deinit (int sock) {
+    nl_rcvbuf_states->erase(sock);
+}
+
+extern "C" void nas_nl_rcvbuf_update (int sock, bool overflow) {
+    auto it = nl_rcvbuf_states->find(sock);
+    if (it == nl_rcvbuf_states->end()) return;
+    nl_rcvbuf_state_t &state = it->second;
+
+    /* Queued bytes and the drops, both the queue and the buffer size are in
+     * the kernel accounting (the buffer is twice the requested size) */
+    uint32_t meminfo[SK_MEMINFO_VARS];
+    memset(meminfo, 0, sizeof(meminfo));
+    socklen_t len = sizeof(meminfo);
+    uint32_t rcvq = 0;
+    uint32_t drops = overflow ? 1 : 0;
+    if (state.meminfo) {
+        if (getsockopt(sock, SOL_SOCKET, SO_MEMINFO, meminfo, &len) == 0) {
+            rcvq = meminfo[SK_MEMINFO_RMEM_ALLOC];
+            drops = meminfo[SK_MEMINFO_DROPS] - state.drops;
+            state.drops = meminfo[SK_MEMINFO_DROPS];
+        } else {
+            EV_LOGGING(NETLINK, INFO, "NL-RCVBUF", "SO_MEMINFO not supported sock %d, resize on drops only",
+                       sock);
+            state.meminfo = false;
+        }
+    }
+    if (rcvq > state.window_peak) state.window_peak = rcvq;
+    size_t kernel_len = state.len * 2;
+
+    if ((drops != 0) || (overflow) ||
+        (rcvq > ((kernel_len * NL_RCVBUF_GROW_THRESHOLD_PCT) / 100))) {
+        if (state.len < state.max_len) {
+            size_t new_len = ((state.len * 2) < state.max_len) ? (state.len * 2) : state.max_len;
+            EV_LOGGING(NETLINK, INFO, "NL-RCVBUF", "Grow sock %d receive buffer %lu -> %lu queued:%u drops:%u",
+                       sock, state.len, new_len, rcvq, drops);
+            if (nl_rcvbuf_set(sock, state, new_len)) {
+                nas_nl_stats_update_rcvbuf_resize (sock, true);
+            }
+        }
+    } else if ((state.len > NL_RCVBUF_START_LEN) &&
+               ((std_get_uptime(NULL) - state.window_start) > ((uint64_t)NL_RCVBUF_SHRINK_IDLE_SEC * 1000000))) {
+        if (state.window_peak < ((kernel_len * NL_RCVBUF_SHRINK_THRESHOLD_PCT) / 100)) {
+            size_t new_len = ((state.len / 2) > NL_RCVBUF_START_LEN) ? (state.len / 2) : NL_RCVBUF_START_LEN;
+            EV_LOGGING(NETLINK, INFO, "NL-RCVBUF", "Shrink sock %d receive buffer %lu -> %lu peak:%u",
+                       sock, state.len, new_len, state.window_peak);
+            if (nl_rcvbuf_set(sock, state, new_len)) {
+                nas_nl_stats_update_rcvbuf_resize (sock, false);
+            }
+        } else {
+            /* Busy in this window, check again in the next one */
+            state.window_peak = 0;
+            state.window_start = std_get_uptime(NULL);
+        }
+    }
+    nas_nl_stats_update_rcvq (sock, state.len, rcvq, drops);
+}
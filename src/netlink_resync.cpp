@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_resync.cpp
+ */
+
+/*
+ * Resynchronization of a table of a VRF with the kernel after the events are lost,
+ * only the differences with the last published state are published again.
+ */
+
+#include "netlink_resync.h"
+#include "standard_netlink_requests.h"
+#include "ds_api_linux_interface.h"
+#include "ds_api_linux_neigh.h"
+#include "ds_api_linux_route.h"
+#include "os_if_utils.h"
+#include "nas_nlmsg.h"
+#include "nas_nlattr_parser.h"
+#include "event_log.h"
+
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+#include <linux/if_addr.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/* Tables kept in the shadow, first byte of the entry key */
+typedef enum {
+    NL_RESYNC_T_ROUTE=1,
+    NL_RESYNC_T_NEIGH,
+    NL_RESYNC_T_ADDR,
+} nl_resync_table_t;
+
+typedef struct {
+    size_t digest;      /* digest of the message without the volatile attributes */
+    std::string msg;    /* last published message, used to synthesize the delete */
+} nl_resync_entry_t;
+
+using nl_resync_shadow_t = std::unordered_map<std::string, nl_resync_entry_t>;
+
+static std::mutex _shadow_mutex;
+//VRF-id to the last published routes, neighbors and addresses
+static auto nl_resync_shadow = new std::map<uint32_t, nl_resync_shadow_t>;
+
+template <typename T>
+static void nl_resync_key_add(std::string &key, const T &val) {
+    key.append((const char *)&val, sizeof(val));
+}
+
+static void nl_resync_key_add_attr(std::string &key, struct nlattr *attr) {
+    uint16_t len = (attr != NULL) ? nla_len(attr) : 0;
+    nl_resync_key_add(key, len);
+    if (len != 0) key.append((const char *)nla_data(attr), len);
+}
+
+/* Digest of the family header and the attributes except the ones that change without
+ * a change in the entry (cache info, probe counters) */
+static size_t nl_resync_digest(struct nlmsghdr *nh, size_t hdr_len, const std::unordered_set<int> &skip) {
+    std::string val((const char *)NLMSG_DATA(nh), hdr_len);
+
+    int len = nlmsg_attrlen(nh, hdr_len);
+    struct nlattr *attr = nlmsg_attrdata(nh, hdr_len);
+    for ( ; nla_ok(attr, len); attr = nla_next(attr, &len)) {
+        if (skip.find(nla_type(attr)) != skip.end()) continue;
+        val.append((const char *)attr, NLA_ALIGN(attr->nla_len));
+    }
+    return std::hash<std::string>()(val);
+}
+
+/* Key attributes of the shadowed entries */
+typedef nas_nl::attr_parser<__RTA_MAX,
+                            nas_nl::sel<RTA_TABLE, sizeof(uint32_t)>,
+                            nas_nl::sel<RTA_PRIORITY, sizeof(uint32_t)>,
+                            nas_nl::sel<RTA_DST>> nl_resync_route_parser;
+
+typedef nas_nl::attr_parser<__NDA_MAX,
+                            nas_nl::sel<NDA_DST>,
+                            nas_nl::sel<NDA_LLADDR>,
+                            nas_nl::sel<NDA_VLAN>> nl_resync_neigh_parser;
+
+typedef nas_nl::attr_parser<__IFA_MAX,
+                            nas_nl::sel<IFA_LOCAL>,
+                            nas_nl::sel<IFA_ADDRESS>> nl_resync_addr_parser;
+
+/* Identity of the entry in the message, returns false for the messages not in the shadow */
+static bool nl_resync_key(struct nlmsghdr *nh, std::string &key, size_t *digest) {
+    switch (nh->nlmsg_type) {
+        case RTM_NEWROUTE:
+        case RTM_DELROUTE: {
+            struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA(nh);
+            if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*rtm))) return false;
+            struct nlattr *attrs[__RTA_MAX];
+            nl_resync_route_parser::parse_msg(attrs, nh, sizeof(*rtm));
+
+            uint32_t table = (attrs[RTA_TABLE] != NULL) ? *(uint32_t *)nla_data(attrs[RTA_TABLE]) :
+                             rtm->rtm_table;
+            uint32_t metric = (attrs[RTA_PRIORITY] != NULL) ? *(uint32_t *)nla_data(attrs[RTA_PRIORITY]) : 0;
+            key.push_back(NL_RESYNC_T_ROUTE);
+            nl_resync_key_add(key, rtm->rtm_family);
+            nl_resync_key_add(key, rtm->rtm_dst_len);
+            nl_resync_key_add(key, rtm->rtm_tos);
+            nl_resync_key_add(key, table);
+            nl_resync_key_add(key, metric);
+            nl_resync_key_add_attr(key, attrs[RTA_DST]);
+            if (digest) *digest = nl_resync_digest(nh, sizeof(*rtm), { RTA_CACHEINFO });
+            return true;
+        }
+        case RTM_NEWNEIGH:
+        case RTM_DELNEIGH: {
+            struct ndmsg *ndm = (struct ndmsg *)NLMSG_DATA(nh);
+            if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ndm))) return false;
+            struct nlattr *attrs[__NDA_MAX];
+            nl_resync_neigh_parser::parse_msg(attrs, nh, sizeof(*ndm));
+
+            key.push_back(NL_RESYNC_T_NEIGH);
+            nl_resync_key_add(key, ndm->ndm_family);
+            nl_resync_key_add(key, ndm->ndm_ifindex);
+            nl_resync_key_add_attr(key, attrs[NDA_DST]);
+            if (ndm->ndm_family == AF_BRIDGE) {
+                /* FDB entry is identified by the MAC and the VLAN */
+                nl_resync_key_add_attr(key, attrs[NDA_LLADDR]);
+                nl_resync_key_add_attr(key, attrs[NDA_VLAN]);
+            }
+            if (digest) *digest = nl_resync_digest(nh, sizeof(*ndm), { NDA_CACHEINFO, NDA_PROBES });
+            return true;
+        }
+        case RTM_NEWADDR:
+        case RTM_DELADDR: {
+            struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(nh);
+            if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifa))) return false;
+            struct nlattr *attrs[__IFA_MAX];
+            nl_resync_addr_parser::parse_msg(attrs, nh, sizeof(*ifa));
+
+            key.push_back(NL_RESYNC_T_ADDR);
+            nl_resync_key_add(key, ifa->ifa_family);
+            nl_resync_key_add(key, ifa->ifa_index);
+            nl_resync_key_add(key, ifa->ifa_prefixlen);
+            nl_resync_key_add_attr(key, attrs[IFA_LOCAL]);
+            nl_resync_key_add_attr(key, attrs[IFA_ADDRESS]);
+            if (digest) *digest = nl_resync_digest(nh, sizeof(*ifa), { IFA_CACHEINFO });
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool nl_resync_is_del(int rt_msg_type) {
+    return (rt_msg_type == RTM_DELROUTE) || (rt_msg_type == RTM_DELNEIGH) ||
+           (rt_msg_type == RTM_DELADDR);
+}
+
+extern "C" void nl_resync_shadow_update(uint32_t vrf_id, struct nlmsghdr *nh) {
+    std::string key;
+    size_t digest = 0;
+    if (!nl_resync_key(nh, key, &digest)) return;
+
+    std::lock_guard<std::mutex> lock(_shadow_mutex);
+    if (nl_resync_is_del(nh->nlmsg_type)) {
+        auto it = nl_resync_shadow->find(vrf_id);
+        if (it != nl_resync_shadow->end()) it->second.erase(key);
+        return;
+    }
+    nl_resync_entry_t &entry = (*nl_resync_shadow)[vrf_id][key];
+    entry.digest = digest;
+    entry.msg.assign((const char *)nh, nh->nlmsg_len);
+}
+
+extern "C" void nl_resync_shadow_clear(uint32_t vrf_id) {
+    std::lock_guard<std::mutex> lock(_shadow_mutex);
+    nl_resync_shadow->erase(vrf_id);
+}
+
+typedef struct {
+    const char *vrf_name;
+    int evt_sock;
+    fun_process_nl_message handler;
+    std::unordered_set<std::string> seen;
+    std::unordered_set<hal_ifindex_t> seen_links;
+    size_t changed;
+} nl_resync_ctx_t;
+
+/* Publish the dumped entry only if it is not in the shadow or changed since it was published */
+static bool nl_resync_process(int sock, int rt_msg_type, struct nlmsghdr *nh, void *context, uint32_t vrf_id) {
+    nl_resync_ctx_t *ctx = (nl_resync_ctx_t *)context;
+
+    if (rt_msg_type == RTM_NEWLINK) {
+        /* Interface cache publishes only the changes */
+        struct ifinfomsg *ifmsg = (struct ifinfomsg *)NLMSG_DATA(nh);
+        if (nh->nlmsg_len >= NLMSG_LENGTH(sizeof(*ifmsg))) {
+            ctx->seen_links.insert(ifmsg->ifi_index);
+        }
+        return ctx->handler(ctx->evt_sock, rt_msg_type, nh, (void *)ctx->vrf_name, vrf_id);
+    }
+
+    std::string key;
+    size_t digest = 0;
+    if (!nl_resync_key(nh, key, &digest)) return true;
+    ctx->seen.insert(key);
+
+    bool present = false;
+    {
+        std::lock_guard<std::mutex> lock(_shadow_mutex);
+        auto it = nl_resync_shadow->find(vrf_id);
+        if (it != nl_resync_shadow->end()) {
+            auto entry = it->second.find(key);
+            if (entry != it->second.end()) {
+                if (entry->second.digest == digest) return true;
+                present = true;
+            }
+        }
+    }
+    /* Publish the changed route as an update */
+    if (present && (rt_msg_type == RTM_NEWROUTE)) nh->nlmsg_flags |= NLM_F_REPLACE;
+    ++ctx->changed;
+    return ctx->handler(ctx->evt_sock, rt_msg_type, nh, (void *)ctx->vrf_name, vrf_id);
+}
+
+/* Synthesize the delete for the entries of the table that are not in the dump */
+static size_t nl_resync_delete_stale(nl_resync_ctx_t *ctx, uint32_t vrf_id, nl_resync_table_t table) {
+    std::vector<std::pair<std::string, std::string>> stale;
+    {
+        std::lock_guard<std::mutex> lock(_shadow_mutex);
+        auto it = nl_resync_shadow->find(vrf_id);
+        if (it == nl_resync_shadow->end()) return 0;
+        for (auto &entry : it->second) {
+            if ((entry.first[0] == table) && (ctx->seen.find(entry.first) == ctx->seen.end())) {
+                stale.push_back(std::make_pair(entry.first, entry.second.msg));
+            }
+        }
+    }
+
+    for (auto &entry : stale) {
+        struct nlmsghdr *nh = (struct nlmsghdr *)&entry.second[0];
+        nh->nlmsg_type = (table == NL_RESYNC_T_ROUTE) ? RTM_DELROUTE :
+                         ((table == NL_RESYNC_T_NEIGH) ? RTM_DELNEIGH : RTM_DELADDR);
+        nh->nlmsg_flags = 0;
+        ctx->handler(ctx->evt_sock, nh->nlmsg_type, nh, (void *)ctx->vrf_name, vrf_id);
+
+        /* Remove the entry even if the handler did not publish the delete */
+        std::lock_guard<std::mutex> lock(_shadow_mutex);
+        auto it = nl_resync_shadow->find(vrf_id);
+        if (it != nl_resync_shadow->end()) it->second.erase(entry.first);
+    }
+    return stale.size();
+}
+
+/* Synthesize the delete for the interfaces in the cache that are not in the dump */
+static size_t nl_resync_delete_stale_links(nl_resync_ctx_t *ctx, uint32_t vrf_id) {
+    INTERFACE *fill = os_get_if_db_hdlr();
+    if ((fill == nullptr) || (vrf_id != NAS_DEFAULT_VRF_ID)) return 0;
+
+    std::vector<std::pair<hal_ifindex_t, if_info_t>> stale;
+    fill->for_each_mbr([ctx, &stale](int ifix, if_info_t& ifinfo) {
+        /* Bridge members are updated with the master events */
+        if (ifinfo.if_type == BASE_CMN_INTERFACE_TYPE_L2_PORT) return;
+        if (ctx->seen_links.find(ifix) == ctx->seen_links.end()) {
+            stale.push_back(std::make_pair(ifix, ifinfo));
+        }
+    });
+
+    for (auto &entry : stale) {
+        char buff[NL_DUMP_REQ_BUFFER_LEN + HAL_IF_NAME_SZ];
+        memset(buff, 0, sizeof(buff));
+
+        struct nlmsghdr *nh = (struct nlmsghdr *)buff;
+        nh->nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+        nh->nlmsg_type = RTM_DELLINK;
+        struct ifinfomsg *ifmsg = (struct ifinfomsg *)NLMSG_DATA(nh);
+        ifmsg->ifi_index = entry.first;
+
+        const std::string &name = entry.second.if_name;
+        nlmsg_add_attr(nh, sizeof(buff), IFLA_IFNAME, name.c_str(), name.size()+1);
+        if (!entry.second.os_link_type.empty()) {
+            struct nlattr *linkinfo = nlmsg_nested_start(nh, sizeof(buff));
+            if (linkinfo != nullptr) {
+                linkinfo->nla_type = IFLA_LINKINFO;
+                const std::string &kind = entry.second.os_link_type;
+                nlmsg_add_attr(nh, sizeof(buff), IFLA_INFO_KIND, kind.c_str(), kind.size()+1);
+                nlmsg_nested_end(nh, linkinfo);
+            }
+        }
+        EV_LOGGING(NETLINK, INFO, "NL-RESYNC", "Synthesized delete for interface %s(%d)",
+                   name.c_str(), entry.first);
+        ctx->handler(ctx->evt_sock, RTM_DELLINK, nh, (void *)ctx->vrf_name, vrf_id);
+    }
+    return stale.size();
+}
+
+typedef std::function<bool (int sock, int seq)> nl_resync_dump_fn;
+
+/* Dump on a request socket so that the events keep queuing on the event socket */
+static bool nl_resync_dump(int *sock, const char *vrf_name, nas_nl_sock_TYPES type,
+                           nl_resync_ctx_t *ctx, uint32_t vrf_id, nl_resync_dump_fn fn) {
+    char buff[1024];
+    auto seen = ctx->seen;
+    auto seen_links = ctx->seen_links;
+    for (size_t retry = 0; retry <= NL_RESYNC_MAX_RETRY; ++retry) {
+        int seq = nl_get_next_seq();
+        int error = 0;
+        if (!fn(*sock, seq)) return false;
+        if (netlink_tools_process_socket(*sock, nl_resync_process, ctx, buff, sizeof(buff),
+                                         &seq, &error, vrf_id)) {
+            return true;
+        }
+        if (error != EINTR) return false;
+        /* Dump is interrupted by a change in the table - the entries already given
+         * are in the shadow now, start again with only the entries of the earlier dumps
+         * taken as seen */
+        ctx->seen = seen;
+        ctx->seen_links = seen_links;
+        EV_LOGGING(NETLINK, INFO, "NL-RESYNC", "Dump interrupted sock:%d retry:%lu", *sock, retry);
+
+        /* Rest of the interrupted dump is still queued and the kernel does not take a new
+         * dump on the socket until it is read, start again on a new socket */
+        close(*sock);
+        *sock = nas_nl_sock_create(vrf_name, type, false);
+        if (*sock == -1) {
+            EV_LOGGING(NETLINK, ERR, "NL-RESYNC", "Failed to create the socket VRF:%s type:%d",
+                       vrf_name, type);
+            return false;
+        }
+    }
+    return false;
+}
+
+extern "C" bool nl_resync_table(const char *vrf_name, uint32_t vrf_id, nas_nl_sock_TYPES type,
+                                int evt_sock, fun_process_nl_message handler) {
+    std::vector<nl_resync_dump_fn> dumps;
+    nl_resync_table_t table;
+
+    switch (type) {
+        case nas_nl_sock_T_ROUTE:
+            table = NL_RESYNC_T_ROUTE;
+            dumps.push_back([](int sock, int seq) { return nl_request_existing_routes(sock, AF_INET, seq); });
+            dumps.push_back([](int sock, int seq) { return nl_request_existing_routes(sock, AF_INET6, seq); });
+            break;
+        case nas_nl_sock_T_NEI:
+            table = NL_RESYNC_T_NEIGH;
+            dumps.push_back([](int sock, int seq) { return nl_neigh_get_all_request(sock, AF_INET, seq); });
+            dumps.push_back([](int sock, int seq) { return nl_neigh_get_all_request(sock, AF_INET6, seq); });
+            dumps.push_back([](int sock, int seq) { return nl_neigh_get_all_request(sock, AF_BRIDGE, seq); });
+            break;
+        case nas_nl_sock_T_INT:
+            table = NL_RESYNC_T_ADDR;
+            dumps.push_back([vrf_name, vrf_id](int sock, int seq) {
+                return nl_interface_get_request(sock, seq, (char *)vrf_name, vrf_id);
+            });
+            dumps.push_back([](int sock, int seq) { return nl_addr_send_dump(sock, AF_INET, 0, seq); });
+            dumps.push_back([](int sock, int seq) { return nl_addr_send_dump(sock, AF_INET6, 0, seq); });
+            break;
+        default:
+            return false;
+    }
+
+    int sock = nas_nl_sock_create(vrf_name, type, false);
+    if (sock == -1) {
+        EV_LOGGING(NETLINK, ERR, "NL-RESYNC", "Failed to create the socket VRF:%s type:%d", vrf_name, type);
+        return false;
+    }
+
+    nl_resync_ctx_t ctx;
+    ctx.vrf_name = vrf_name;
+    ctx.evt_sock = evt_sock;
+    ctx.handler = handler;
+    ctx.changed = 0;
+
+    bool rc = true;
+    for (auto &fn : dumps) {
+        if (!nl_resync_dump(&sock, vrf_name, type, &ctx, vrf_id, fn)) {
+            rc = false;
+            break;
+        }
+    }
+    if (sock != -1) close(sock);
+
+    if (!rc) {
+        /* Without the complete dump the missing entries can not be told apart from the deleted */
+        EV_LOGGING(NETLINK, ERR, "NL-RESYNC", "Resync failed VRF:%s type:%d", vrf_name, type);
+        return false;
+    }
+
+    size_t deleted = nl_resync_delete_stale(&ctx, vrf_id, table);
+    if (type == nas_nl_sock_T_INT) {
+        deleted += nl_resync_delete_stale_links(&ctx, vrf_id);
+    }
+    EV_LOGGING(NETLINK, INFO, "NL-RESYNC", "Resync done VRF:%s type:%d changed:%lu deleted:%lu",
+               vrf_name, type, ctx.changed, deleted);
+    return true;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_sock_pool.cpp
+ */
+
+/*
+ * Pool of long lived netlink request sockets per VRF and socket type,
+ * used for the set requests instead of opening a socket per request.
+ */
+
+#include "netlink_sock_pool.h"
+#include "event_log.h"
+
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef NETLINK_CAP_ACK
+#define NETLINK_CAP_ACK 10
+#endif
+
+#ifndef NETLINK_EXT_ACK
+#define NETLINK_EXT_ACK 11
+#endif
+
+typedef struct {
+    uint64_t gen;
+    std::vector<int> idle[nas_nl_sock_T_MAX];
+} nl_req_sock_pool_t;
+
+typedef struct {
+    std::string vrf_name;
+    uint64_t gen;
+} nl_req_sock_owner_t;
+
+static std::mutex _pool_mutex;
+static uint64_t _pool_gen = 0;
+//VRF name to pool of idle request sockets
+static auto nl_req_sock_pool = new std::map<std::string, nl_req_sock_pool_t>;
+//Pooled sockets given to the callers
+static auto nl_req_sock_in_use = new std::map<int, nl_req_sock_owner_t>;
+
+static const char *nl_req_vrf(const char *vrf_name) {
+    return (vrf_name == nullptr) ? NL_DEFAULT_VRF_NAME : vrf_name;
+}
+
+static int nl_req_sock_create(const char *vrf_name, nas_nl_sock_TYPES type) {
+    int sock = nas_nl_sock_create(vrf_name, type, false);
+    if (sock == -1) return -1;
+
+    /* Ask the kernel to not copy the request in the ACK and to add the
+     * extended error information on failures, older kernels do not support these. */
+    int on = 1;
+    if (setsockopt(sock, NL_SOL_NETLINK, NETLINK_CAP_ACK, &on, sizeof(on)) != 0) {
+        EV_LOGGING(NETLINK, DEBUG, "NL-SOCK-POOL", "CAP_ACK not supported sock:%d errno:%d", sock, errno);
+    }
+    if (setsockopt(sock, NL_SOL_NETLINK, NETLINK_EXT_ACK, &on, sizeof(on)) != 0) {
+        EV_LOGGING(NETLINK, DEBUG, "NL-SOCK-POOL", "EXT_ACK not supported sock:%d errno:%d", sock, errno);
+    }
+    return sock;
+}
+
+extern "C" t_std_error nas_nl_req_sock_pool_init (const char *vrf_name) {
+    std::lock_guard<std::mutex> lock(_pool_mutex);
+
+    std::string vrf(nl_req_vrf(vrf_name));
+    if (nl_req_sock_pool->find(vrf) != nl_req_sock_pool->end()) {
+        return STD_ERR_OK;
+    }
+    nl_req_sock_pool_t pool;
+    pool.gen = ++_pool_gen;
+    nl_req_sock_pool->insert(std::make_pair(vrf, std::move(pool)));
+
+    EV_LOGGING(NETLINK, INFO, "NL-SOCK-POOL", "Request socket pool enabled for VRF:%s", vrf.c_str());
+    return STD_ERR_OK;
+}
+
+extern "C" t_std_error nas_nl_req_sock_pool_deinit (const char *vrf_name) {
+    std::lock_guard<std::mutex> lock(_pool_mutex);
+
+    auto it = nl_req_sock_pool->find(std::string(nl_req_vrf(vrf_name)));
+    if (it == nl_req_sock_pool->end()) {
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+    for (size_t ix = 0; ix < (size_t)nas_nl_sock_T_MAX; ++ix) {
+        for (auto sock : it->second.idle[ix]) {
+            close(sock);
+        }
+    }
+    EV_LOGGING(NETLINK, INFO, "NL-SOCK-POOL", "Request socket pool disabled for VRF:%s", it->first.c_str());
+    nl_req_sock_pool->erase(it);
+    return STD_ERR_OK;
+}
+
+extern "C" int nas_nl_req_sock_get (const char *vrf_name, nas_nl_sock_TYPES type) {
+    if (type >= nas_nl_sock_T_MAX) return -1;
+
+    std::string vrf(nl_req_vrf(vrf_name));
+    uint64_t gen = 0;
+    {
+        std::lock_guard<std::mutex> lock(_pool_mutex);
+        auto it = nl_req_sock_pool->find(vrf);
+        if (it != nl_req_sock_pool->end()) {
+            gen = it->second.gen;
+            if (!it->second.idle[type].empty()) {
+                int sock = it->second.idle[type].back();
+                it->second.idle[type].pop_back();
+                (*nl_req_sock_in_use)[sock] = { vrf, gen };
+                return sock;
+            }
+        }
+    }
+
+    /* Create the socket outside the lock since it can involve a namespace switch */
+    int sock = nl_req_sock_create(vrf.c_str(), type);
+    if ((sock == -1) || (gen == 0)) return sock;
+
+    std::lock_guard<std::mutex> lock(_pool_mutex);
+    (*nl_req_sock_in_use)[sock] = { vrf, gen };
+    return sock;
+}
+
+extern "C" void nas_nl_req_sock_put (const char *vrf_name, nas_nl_sock_TYPES type, int sock, bool sock_err) {
+    if (sock == -1) return;
+
+    std::lock_guard<std::mutex> lock(_pool_mutex);
+    auto owner = nl_req_sock_in_use->find(sock);
+    if (owner == nl_req_sock_in_use->end()) {
+        /* Socket was not taken from the pool */
+        close(sock);
+        return;
+    }
+    auto it = nl_req_sock_pool->find(owner->second.vrf_name);
+    /* Close the socket if the VRF is deleted (or re-created) while the socket is in use */
+    bool reuse = !sock_err && (type < nas_nl_sock_T_MAX) && (it != nl_req_sock_pool->end()) &&
+                 (it->second.gen == owner->second.gen) &&
+                 (it->second.idle[type].size() < NL_REQ_SOCK_POOL_MAX_IDLE);
+    nl_req_sock_in_use->erase(owner);
+
+    if (!reuse) {
+        close(sock);
+        return;
+    }
+    it->second.idle[type].push_back(sock);
+}
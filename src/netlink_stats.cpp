@@ -24,9 +24,12 @@
 
 #include "netlink_stats.h"
 #include <map>
+#include <mutex>
 
 //NAS netlink stats table
 static auto nlm_counters = new std::map<int, nas_nl_stats_desc_t>;
+/* Counters are updated by the event thread and the event dispatch workers */
+static std::mutex nlm_counters_mutex;
 
 static inline bool nas_nl_is_rt_add_event (int rt_msg_type) {
     return ((rt_msg_type == RTM_NEWLINK) || (rt_msg_type == RTM_NEWADDR) ||
@@ -48,11 +51,13 @@ static inline bool nas_nl_is_rt_get_event (int rt_msg_type) {
 
 static void nl_stats_print (int sock) {
 
-    printf("\r %-10d | %-10d | %-10d | %-10d\r\n",
+    printf("\r %-10d | %-10d | %-10d | %-10d | %-10d | %-10d\r\n",
             nlm_counters->at(sock).num_events_rcvd,
             nlm_counters->at(sock).num_bulk_events_rcvd,
             nlm_counters->at(sock).max_events_rcvd_in_bulk,
-            nlm_counters->at(sock).min_events_rcvd_in_bulk);
+            nlm_counters->at(sock).min_events_rcvd_in_bulk,
+            nlm_counters->at(sock).num_batch_reads,
+            nlm_counters->at(sock).max_datagrams_in_batch);
 }
 
 static void nl_stats_print_msg_detail (int sock) {
@@ -77,12 +82,22 @@ static void nl_stats_print_pub_detail (int sock) {
            nlm_counters->at(sock).num_get_events_pub_failed);
 }
 
+static void nl_stats_print_rcvq_detail (int sock) {
+
+    printf("\r %-10u | %-10u | %-10u | %-10u | %-10u\r\n",
+           nlm_counters->at(sock).rcvbuf_len,
+           nlm_counters->at(sock).peak_rcvq_len,
+           nlm_counters->at(sock).num_drops,
+           nlm_counters->at(sock).num_rcvbuf_grow,
+           nlm_counters->at(sock).num_rcvbuf_shrink);
+}
+
 
 /* function used to reset the nas netlink stats
  * for given netlink socket
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_reset (int sock) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it == nlm_counters->end())
@@ -95,6 +110,8 @@ extern "C" t_std_error nas_nl_stats_reset (int sock) {
     it->second.num_bulk_events_rcvd = 0;
     it->second.max_events_rcvd_in_bulk = 0;
     it->second.min_events_rcvd_in_bulk = 0;
+    it->second.num_batch_reads = 0;
+    it->second.max_datagrams_in_batch = 0;
 
     it->second.num_add_events= 0;
     it->second.num_del_events= 0;
@@ -108,15 +125,20 @@ extern "C" t_std_error nas_nl_stats_reset (int sock) {
     it->second.num_add_events_pub_failed= 0;
     it->second.num_del_events_pub_failed= 0;
     it->second.num_get_events_pub_failed= 0;
+    /* rcvbuf_len is a gauge of the current size, not reset */
+    it->second.peak_rcvq_len = 0;
+    it->second.num_drops = 0;
+    it->second.num_rcvbuf_grow = 0;
+    it->second.num_rcvbuf_shrink = 0;
 
     return STD_ERR_OK;
 }
 
 /* function used to print the nas netlink stats
  * for given netlink socket
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_print (int sock) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it == nlm_counters->end())
@@ -126,8 +148,11 @@ extern "C" t_std_error nas_nl_stats_print (int sock) {
     }
 
     //printf("\r =========================\r\n");
-    printf("\r %-10s | %-10s | %-10s | %-10s\r\n", "#events", "#bulk", "#max_bulk", "min_bulk");
-    printf("\r %-10s | %-10s | %-10s | %-10s\r\n",
+    printf("\r %-10s | %-10s | %-10s | %-10s | %-10s | %-10s\r\n", "#events", "#bulk", "#max_bulk", "min_bulk",
+           "#batch", "#max_batch");
+    printf("\r %-10s | %-10s | %-10s | %-10s | %-10s | %-10s\r\n",
+           "==========",
+           "==========",
            "==========",
            "==========",
            "==========",
@@ -153,14 +178,22 @@ extern "C" t_std_error nas_nl_stats_print (int sock) {
     /* dump netlink message publish stats information */
     nl_stats_print_pub_detail (sock);
 
+    //printf("\r ============Netlink Receive Queue Details ===========\r\n");
+    printf("\r %-10s | %-10s | %-10s | %-10s | %-10s\r\n",
+           "#rcvbuf", "#peak_rcvq", "#drops", "#grow", "#shrink");
+    printf("\r %-10s | %-10s | %-10s | %-10s | %-10s\r\n",
+           "==========", "==========", "==========", "==========", "==========");
+    /* dump netlink receive queue stats information */
+    nl_stats_print_rcvq_detail (sock);
+
     return STD_ERR_OK;
 }
 
 
 /* function used to update the netlink stats for given rt_msg_type.
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_update_tot_msg (int sock, int rt_msg_type) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it == nlm_counters->end())
@@ -182,9 +215,9 @@ extern "C" t_std_error nas_nl_stats_update_tot_msg (int sock, int rt_msg_type) {
 
 /* function used to update the netlink stats for invalid evets
  * for given rt_msg_type.
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_update_invalid_msg (int sock, int rt_msg_type) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it == nlm_counters->end())
@@ -205,9 +238,9 @@ extern "C" t_std_error nas_nl_stats_update_invalid_msg (int sock, int rt_msg_typ
 
 /* function used to update the netlink event publish stats
  * for given rt_msg_type.
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_update_pub_msg (int sock, int rt_msg_type) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it == nlm_counters->end())
@@ -228,9 +261,9 @@ extern "C" t_std_error nas_nl_stats_update_pub_msg (int sock, int rt_msg_type) {
 
 /* function used to update the netlink event publish failure stats
  * for given rt_msg_type.
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_update_pub_msg_failed (int sock, int rt_msg_type) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it == nlm_counters->end())
@@ -250,9 +283,9 @@ extern "C" t_std_error nas_nl_stats_update_pub_msg_failed (int sock, int rt_msg_
 
 
 /* function used to update the netlink event and bulk event receive stats.
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_update (int sock, uint32_t bulk_msg_count) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it == nlm_counters->end())
@@ -280,11 +313,78 @@ extern "C" t_std_error nas_nl_stats_update (int sock, uint32_t bulk_msg_count) {
 }
 
 
+/* function used to update the number of datagrams read in one system call.
+ */
+extern "C" t_std_error nas_nl_stats_update_batch (int sock, uint32_t datagram_count) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
+
+    auto it = nlm_counters->find(sock);
+    if (it == nlm_counters->end())
+    {
+        /* stats not initialized for fd */
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+
+    if (datagram_count > 1) //increment batch count only if more than one datagram is read.
+    {
+        it->second.num_batch_reads++;
+
+        if (datagram_count > it->second.max_datagrams_in_batch)
+            it->second.max_datagrams_in_batch = datagram_count;
+    }
+
+    return STD_ERR_OK;
+}
+
+
+/* function used to update the receive queue gauges and the kernel drops.
+ */
+extern "C" t_std_error nas_nl_stats_update_rcvq (int sock, uint32_t rcvbuf_len, uint32_t rcvq_len,
+                                                 uint32_t drops) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
+
+    auto it = nlm_counters->find(sock);
+    if (it == nlm_counters->end())
+    {
+        /* stats not initialized for fd */
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+
+    it->second.rcvbuf_len = rcvbuf_len;
+    if (rcvq_len > it->second.peak_rcvq_len)
+        it->second.peak_rcvq_len = rcvq_len;
+    it->second.num_drops += drops;
+
+    return STD_ERR_OK;
+}
+
+
+/* function used to update the receive buffer grow and shrink stats.
+ */
+extern "C" t_std_error nas_nl_stats_update_rcvbuf_resize (int sock, bool grow) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
+
+    auto it = nlm_counters->find(sock);
+    if (it == nlm_counters->end())
+    {
+        /* stats not initialized for fd */
+        return (STD_ERR(NAS_OS,FAIL, 0));
+    }
+
+    if (grow)
+        it->second.num_rcvbuf_grow++;
+    else
+        it->second.num_rcvbuf_shrink++;
+
+    return STD_ERR_OK;
+}
+
+
 /* function used to initialize the nas netlink event stats
  * for given netlink socket.
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_init (int sock) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it != nlm_counters->end())
@@ -304,9 +404,9 @@ extern "C" t_std_error nas_nl_stats_init (int sock) {
 
 /* function used to de-init the nas netlink event stats
  * for given netlink socket
- * This code can only be used from one thread - it is not thread safe
  */
 extern "C" t_std_error nas_nl_stats_deinit (int sock) {
+    std::lock_guard<std::mutex> lock(nlm_counters_mutex);
 
     auto it = nlm_counters->find(sock);
     if (it == nlm_counters->end())
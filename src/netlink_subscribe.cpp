@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_subscribe.cpp
+ */
+
+#include "netlink_subscribe.h"
+#include "nas_nlmsg.h"
+#include "nas_os_nl_config.h"
+#include "event_log.h"
+
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <linux/if_bridge.h>
+#include <linux/if_ether.h>
+#include <linux/netconf.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+/* Index of the family in a profile */
+enum { NL_SUBSCRIBE_IPV4, NL_SUBSCRIBE_IPV6, NL_SUBSCRIBE_FAMILY_MAX };
+
+typedef struct {
+    uint32_t events[NL_SUBSCRIBE_FAMILY_MAX];
+} nl_subscribe_profile_t;
+
+/* Groups of the event sockets, AF_UNSPEC for the groups shared by the families */
+static const struct {
+    nas_nl_sock_TYPES type;
+    uint32_t event;
+    int family;
+    int group;
+} nl_subscribe_group_list[] = {
+    { nas_nl_sock_T_ROUTE, NL_SUBSCRIBE_ROUTE, AF_INET, RTNLGRP_IPV4_ROUTE },
+    { nas_nl_sock_T_ROUTE, NL_SUBSCRIBE_ROUTE, AF_INET6, RTNLGRP_IPV6_ROUTE },
+    { nas_nl_sock_T_INT, NL_SUBSCRIBE_LINK, AF_UNSPEC, RTNLGRP_LINK },
+    { nas_nl_sock_T_INT, NL_SUBSCRIBE_ADDR, AF_INET, RTNLGRP_IPV4_IFADDR },
+    { nas_nl_sock_T_INT, NL_SUBSCRIBE_ADDR, AF_INET6, RTNLGRP_IPV6_IFADDR },
+    { nas_nl_sock_T_NEI, NL_SUBSCRIBE_NEIGH, AF_UNSPEC, RTNLGRP_NEIGH },
+    { nas_nl_sock_T_NETCONF, NL_SUBSCRIBE_NETCONF, AF_INET, RTNLGRP_IPV4_NETCONF },
+    { nas_nl_sock_T_NETCONF, NL_SUBSCRIBE_NETCONF, AF_INET6, RTNLGRP_IPV6_NETCONF },
+    { nas_nl_sock_T_MCAST_SNOOP, NL_SUBSCRIBE_MDB, AF_UNSPEC, RTNLGRP_MDB },
+};
+
+static const struct {
+    const char *name;
+    uint32_t event;
+} nl_subscribe_names[] = {
+    { "link", NL_SUBSCRIBE_LINK },
+    { "addr", NL_SUBSCRIBE_ADDR },
+    { "route", NL_SUBSCRIBE_ROUTE },
+    { "neigh", NL_SUBSCRIBE_NEIGH },
+    { "netconf", NL_SUBSCRIBE_NETCONF },
+    { "mdb", NL_SUBSCRIBE_MDB },
+};
+
+/* Profiles are read for every event, they are published as an immutable table that the
+ * event thread and the dispatch workers read without a lock. A change copies the table
+ * and swaps it in, the changes are serialized by the mutex. */
+typedef struct {
+    std::map<std::string, nl_subscribe_profile_t> profiles;
+    nl_subscribe_profile_t default_profile;
+    bool filtering;                     /* a profile leaves out a class */
+} nl_subscribe_table_t;
+
+typedef std::shared_ptr<const nl_subscribe_table_t> nl_subscribe_table_ptr;
+
+static std::mutex _sub_mutex;
+/* Never destroyed, read by the event thread until the process exits */
+static auto nl_subscribe_table_cur = new nl_subscribe_table_ptr;
+
+static int nl_subscribe_family_ix(int family) {
+    if (family == AF_INET) return NL_SUBSCRIBE_IPV4;
+    if (family == AF_INET6) return NL_SUBSCRIBE_IPV6;
+    return -1;
+}
+
+/* Default profile less the classes of the netlink config (subscribe_off) */
+static void nl_subscribe_default(nl_subscribe_table_t &table) {
+    nl_subscribe_profile_t &profile = table.default_profile;
+    for (auto &events : profile.events) events = NL_SUBSCRIBE_ALL;
+    table.filtering = false;
+
+    nas_os_nl_config_t cfg;
+    nas_os_nl_config_get(&cfg);
+    if (cfg.subscribe_off[0] == '\0') return;
+
+    std::stringstream list(cfg.subscribe_off);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        std::string name = item.substr(0, item.find(':'));
+        std::string family = (item.find(':') != std::string::npos) ? item.substr(item.find(':') + 1) : "";
+        uint32_t event = 0;
+        for (auto &entry : nl_subscribe_names) {
+            if (name == entry.name) event = entry.event;
+        }
+        if ((event == 0) || (!family.empty() && (family != "ipv4") && (family != "ipv6"))) {
+            EV_LOGGING(NETLINK, ERR, "NL-SUBSCRIBE", "Invalid class %s in %s", item.c_str(), cfg.subscribe_off);
+            continue;
+        }
+        if (family != "ipv6") profile.events[NL_SUBSCRIBE_IPV4] &= ~event;
+        if (family != "ipv4") profile.events[NL_SUBSCRIBE_IPV6] &= ~event;
+    }
+    for (auto events : profile.events) {
+        if (events != NL_SUBSCRIBE_ALL) table.filtering = true;
+    }
+    EV_LOGGING(NETLINK, INFO, "NL-SUBSCRIBE", "Default profile ipv4:0x%x ipv6:0x%x",
+               profile.events[NL_SUBSCRIBE_IPV4], profile.events[NL_SUBSCRIBE_IPV6]);
+}
+
+/* Current table, the default profile is read from the netlink config on the first use */
+static nl_subscribe_table_ptr nl_subscribe_table(void) {
+    nl_subscribe_table_ptr table = std::atomic_load(nl_subscribe_table_cur);
+    if (table != nullptr) return table;
+
+    std::lock_guard<std::mutex> lock(_sub_mutex);
+    table = std::atomic_load(nl_subscribe_table_cur);
+    if (table == nullptr) {
+        auto init = std::make_shared<nl_subscribe_table_t>();
+        nl_subscribe_default(*init);
+        table = init;
+        std::atomic_store(nl_subscribe_table_cur, table);
+    }
+    return table;
+}
+
+/* Profile of the VRF in the table */
+static const nl_subscribe_profile_t &nl_subscribe_profile(const nl_subscribe_table_t &table,
+                                                          const char *vrf_name) {
+    if (table.profiles.empty()) return table.default_profile;
+    auto it = table.profiles.find(vrf_name);
+    return (it != table.profiles.end()) ? it->second : table.default_profile;
+}
+
+/* Classes of the family, either family for AF_UNSPEC */
+static uint32_t nl_subscribe_events(const nl_subscribe_profile_t &profile, int family) {
+    int ix = nl_subscribe_family_ix(family);
+    if (ix >= 0) return profile.events[ix];
+    return (profile.events[NL_SUBSCRIBE_IPV4] | profile.events[NL_SUBSCRIBE_IPV6]);
+}
+
+extern "C" t_std_error nl_subscribe_set (const char *vrf_name, int family, uint32_t events) {
+    int ix = nl_subscribe_family_ix(family);
+    if ((ix < 0) || ((events & ~NL_SUBSCRIBE_ALL) != 0)) {
+        EV_LOGGING(NETLINK, ERR, "NL-SUBSCRIBE", "Invalid profile VRF:%s family:%d events:0x%x",
+                   vrf_name, family, events);
+        return STD_ERR(NAS_OS, PARAM, 0);
+    }
+
+    /* Table is created before the lock is taken */
+    nl_subscribe_table();
+    std::lock_guard<std::mutex> lock(_sub_mutex);
+    nl_subscribe_table_ptr cur = std::atomic_load(nl_subscribe_table_cur);
+    auto table = std::make_shared<nl_subscribe_table_t>(*cur);
+    nl_subscribe_profile_t profile = nl_subscribe_profile(*table, vrf_name);
+    profile.events[ix] = events;
+    table->profiles[vrf_name] = profile;
+    if (events != NL_SUBSCRIBE_ALL) table->filtering = true;
+    std::atomic_store(nl_subscribe_table_cur, nl_subscribe_table_ptr(table));
+    EV_LOGGING(NETLINK, INFO, "NL-SUBSCRIBE", "Profile VRF:%s family:%d events:0x%x", vrf_name, family, events);
+    return STD_ERR_OK;
+}
+
+extern "C" uint32_t nl_subscribe_get (const char *vrf_name, int family) {
+    nl_subscribe_table_ptr table = nl_subscribe_table();
+    return nl_subscribe_events(nl_subscribe_profile(*table, vrf_name), family);
+}
+
+extern "C" void nl_subscribe_clear (const char *vrf_name) {
+    /* Table is created before the lock is taken */
+    nl_subscribe_table();
+    std::lock_guard<std::mutex> lock(_sub_mutex);
+    nl_subscribe_table_ptr cur = std::atomic_load(nl_subscribe_table_cur);
+    if (cur->profiles.count(vrf_name) == 0) return;
+    auto table = std::make_shared<nl_subscribe_table_t>(*cur);
+    table->profiles.erase(vrf_name);
+    std::atomic_store(nl_subscribe_table_cur, nl_subscribe_table_ptr(table));
+}
+
+extern "C" uint64_t nl_subscribe_groups (const char *vrf_name, nas_nl_sock_TYPES type) {
+    nl_subscribe_table_ptr table = nl_subscribe_table();
+    const nl_subscribe_profile_t &profile = nl_subscribe_profile(*table, vrf_name);
+    uint64_t groups = 0;
+    for (auto &entry : nl_subscribe_group_list) {
+        if ((entry.type == type) && (nl_subscribe_events(profile, entry.family) & entry.event)) {
+            groups |= (1ULL << entry.group);
+        }
+    }
+    return groups;
+}
+
+extern "C" t_std_error nl_subscribe_sock_apply (int sock, nas_nl_sock_TYPES type, uint64_t groups) {
+    t_std_error rc = STD_ERR_OK;
+    for (auto &entry : nl_subscribe_group_list) {
+        if (entry.type != type) continue;
+        /* Joining a joined group and leaving a group not joined are no-ops */
+        bool join = ((groups & (1ULL << entry.group)) != 0);
+        int group = entry.group;
+        if (setsockopt(sock, NL_SOL_NETLINK, join ? NETLINK_ADD_MEMBERSHIP : NETLINK_DROP_MEMBERSHIP,
+                       &group, sizeof(group)) != 0) {
+            EV_LOGGING(NETLINK, ERR, "NL-SUBSCRIBE", "Failed to %s group %d sock %d errno %d",
+                       join ? "join" : "leave", group, sock, errno);
+            rc = STD_ERR(NAS_OS, FAIL, errno);
+        }
+    }
+    return rc;
+}
+
+/* Family of the MDB entry of the event */
+static int nl_subscribe_mdb_family(struct nlmsghdr *hdr) {
+    static const nla_select_t mdb_sel[] = { { MDBA_MDB, 0 } };
+    if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(struct br_port_msg))) return AF_UNSPEC;
+
+    struct nlattr *attrs[__MDBA_MAX];
+    nla_parse_selected(attrs, __MDBA_MAX, mdb_sel, 1, nlmsg_attrdata(hdr, sizeof(struct br_port_msg)),
+                       nlmsg_attrlen(hdr, sizeof(struct br_port_msg)));
+    if (attrs[MDBA_MDB] == NULL) return AF_UNSPEC;
+
+    struct nlattr *entry;
+    int rem;
+    nla_for_each_nested(entry, attrs[MDBA_MDB], rem) {
+        if ((nla_type(entry) != MDBA_MDB_ENTRY) || (nla_len(entry) < NLA_HDRLEN)) continue;
+        struct nlattr *info = (struct nlattr *)nla_data(entry);
+        if ((nla_type(info) != MDBA_MDB_ENTRY_INFO) ||
+            (nla_len(info) < (int)sizeof(struct br_mdb_entry))) continue;
+        struct br_mdb_entry *mdb = (struct br_mdb_entry *)nla_data(info);
+        return (ntohs(mdb->addr.proto) == ETH_P_IP) ? AF_INET : AF_INET6;
+    }
+    return AF_UNSPEC;
+}
+
+/* Family of the message if it has one, AF_UNSPEC otherwise */
+template <typename T>
+static int nl_subscribe_msg_family(struct nlmsghdr *hdr, unsigned char T::*family) {
+    if (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(T))) return AF_UNSPEC;
+    return ((T *)NLMSG_DATA(hdr))->*family;
+}
+
+extern "C" bool nl_subscribe_wanted (const char *vrf_name, int rt_msg_type, struct nlmsghdr *hdr) {
+    nl_subscribe_table_ptr table = nl_subscribe_table();
+    if (!table->filtering) return true;
+
+    /* Ranges of the handlers of get_netlink_data */
+    uint32_t event = 0;
+    int family = AF_UNSPEC;
+    if (rt_msg_type < RTM_BASE) {
+        return true;
+    } else if (rt_msg_type <= RTM_SETLINK) {
+        event = NL_SUBSCRIBE_LINK;
+    } else if (rt_msg_type <= RTM_GETADDR) {
+        event = NL_SUBSCRIBE_ADDR;
+        family = nl_subscribe_msg_family(hdr, &ifaddrmsg::ifa_family);
+    } else if (rt_msg_type <= RTM_GETROUTE) {
+        event = NL_SUBSCRIBE_ROUTE;
+        family = nl_subscribe_msg_family(hdr, &rtmsg::rtm_family);
+    } else if (rt_msg_type <= RTM_GETNEIGH) {
+        /* Bridge FDB entries share the group with both the families */
+        event = NL_SUBSCRIBE_NEIGH;
+        family = nl_subscribe_msg_family(hdr, &ndmsg::ndm_family);
+    } else if (rt_msg_type <= RTM_GETNETCONF) {
+        event = NL_SUBSCRIBE_NETCONF;
+        family = nl_subscribe_msg_family(hdr, &netconfmsg::ncm_family);
+    } else if (rt_msg_type <= RTM_GETMDB) {
+        event = NL_SUBSCRIBE_MDB;
+        family = nl_subscribe_mdb_family(hdr);
+    } else {
+        return true;
+    }
+
+    return ((nl_subscribe_events(nl_subscribe_profile(*table, (vrf_name != nullptr) ? vrf_name : NL_DEFAULT_VRF_NAME),
+                                 family) & event) != 0);
+}
@@ -22,6 +22,9 @@
  * nl_api.c
  */
 
+/* recvmmsg */
+#define _GNU_SOURCE
+
 #include "netlink_tools.h"
 #include "std_socket_tools.h"
 #include "std_time_tools.h"
@@ -29,12 +32,24 @@
 #include "nas_nlmsg.h"
 #include "nas_os_interface.h"
 #include "netlink_stats.h"
+#include "netlink_rcvbuf.h"
+#include "netlink_sock_pool.h"
+#include "netlink_filter.h"
+#include "netlink_uring.h"
+#include "netlink_capture.h"
+#include "netlink_transport.h"
+#include "netlink_nsid.h"
+#include "netlink_subscribe.h"
+#include "ds_api_linux_interface.h"
+#include "std_utils.h"
 #include <string.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include <linux/rtnetlink.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <pthread.h>
 #include <time.h>
 
 #include <linux/netfilter/nfnetlink.h>
@@ -62,6 +77,33 @@ int nla_parse(struct nlattr *tb[], int max_type, struct nlattr * head, int len)
     return 0;
 }
 
+int nla_parse_selected(struct nlattr *tb[], int max_type, const nla_select_t *sel, size_t sel_count,
+                       struct nlattr *head, int len) {
+    size_t ix = 0;
+    for (ix = 0; ix < sel_count; ++ix) {
+        if (sel[ix].type >= max_type) return -1;
+        tb[sel[ix].type] = NULL;
+    }
+
+    int rc = 0;
+    struct nlattr *attr = head;
+    for ( ; nla_ok(attr, len); attr = nla_next(attr, &len)) {
+        int type = nla_type(attr);
+        for (ix = 0; ix < sel_count; ++ix) {
+            if (sel[ix].type != type) continue;
+            if (nla_len(attr) < sel[ix].min_len) {
+                EV_LOGGING(NETLINK, DEBUG, "NL-PARSE", "Attribute %d dropped, len %d expected %d",
+                           type, nla_len(attr), sel[ix].min_len);
+                rc = -1;
+            } else {
+                tb[type] = attr;
+            }
+            break;
+        }
+    }
+    return rc;
+}
+
 int nl_sock_create(const char *vrf_name, int ln_groups, int type,bool include_bind, int sock_buf_len) {
     struct sockaddr_nl sa;
     int sock = 0;
@@ -72,9 +114,27 @@ int nl_sock_create(const char *vrf_name, int ln_groups, int type,bool include_bi
     if (os_sock_create(vrf_name, e_std_sock_NETLINK, e_std_sock_type_RAW, type, &sock) != STD_ERR_OK)
         return -1;
 
-    std_sock_set_rcvbuf(sock, sock_buf_len);
+    if (!include_bind) {
+        /* Request and dump sockets read a response as it is received, the buffer only
+         * has to hold the ACKs of a batch. Bound the wait for the responses, the event
+         * sockets are read only when readable and keep blocking reads */
+        int rcvbuf = NL_BATCH_RCVBUF_LEN;
+        if ((setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) != 0) &&
+            (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) != 0)) {
+            EV_LOGGING(NETLINK, ERR, "NETLINK", "Failed to set the receive buffer for sock %d errno %d",
+                       sock, errno);
+        }
+        struct timeval tv = { NL_RECV_TIMEOUT_SEC, 0 };
+        if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0) {
+            EV_LOGGING(NETLINK, ERR, "NETLINK", "Failed to set the receive timeout for sock %d errno %d",
+                       sock, errno);
+        }
+        return sock;
+    }
 
-    if (!include_bind) return sock;
+    /* Event sockets start small, the buffer is grown on demand up to sock_buf_len
+     * (netlink_rcvbuf) */
+    std_sock_set_rcvbuf(sock, (sock_buf_len < NL_RCVBUF_START_LEN) ? sock_buf_len : NL_RCVBUF_START_LEN);
 
     if (bind(sock, (struct sockaddr *) &sa, sizeof(sa))!=0) {
         close(sock);
@@ -84,59 +144,45 @@ int nl_sock_create(const char *vrf_name, int ln_groups, int type,bool include_bi
 }
 
 
-void netlink_tools_receive_event(int sock, fun_process_nl_message handlers,
-        void * context, char * scratch_buff, size_t scratch_buff_len,int *error_code, uint32_t vrf_id) {
-    int len = 0;
-    struct nlmsghdr * nh = NULL;
-    int _error_code = 0;
-    if (error_code==NULL) error_code = &_error_code;
-    while (true) {
-        struct nlmsghdr *nh = (struct nlmsghdr *)scratch_buff;
-        struct iovec iov = { scratch_buff,scratch_buff_len };
-        struct sockaddr_nl snl;
-        struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
-
-        char   cmsgbuf[32];
-        if (vrf_id == NL_DEFAULT_VRF_ID) {
-            /* Read control message from socket */
-            msg.msg_control = &cmsgbuf;
-            msg.msg_controllen = sizeof(cmsgbuf);
-        }
-
-        len = recvmsg(sock, &msg,MSG_TRUNC);
-        if ((len==-1) && (errno==EINTR || errno==EAGAIN)) continue;
-        if (len==-1) {
-            bool _mem = (errno==ENOMEM || errno==ENOBUFS);
-            EV_LOGGING(NETLINK,ERR,"READ/ERR","Failed to read from socket %s - %d", _mem ? "due to ENOMEM or ENOBUFS" : "generic error",errno);
-        }
-        if (len==-1) { *error_code = errno; return ; }
-        if (msg.msg_flags & MSG_TRUNC) {
-            EV_LOGGING(NETLINK,ERR,"READ/ERR","Truncated message %lu (type:%d)",msg.msg_iovlen,
-                       nh->nlmsg_type);
-            return ;
-        }
-        if (vrf_id == NL_DEFAULT_VRF_ID) {
-            /* Read VRF-id (NSID) from control message */
-            struct cmsghdr *cmsg;
-            for (cmsg = CMSG_FIRSTHDR(&msg); cmsg;
-                 cmsg = CMSG_NXTHDR(&msg, cmsg)) {
-                if (cmsg->cmsg_level == SOL_NETLINK &&
-                    cmsg->cmsg_type == NETLINK_LISTEN_ALL_NSID &&
-                    cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
-                    int *data = (int *)CMSG_DATA(cmsg);
-                    if (*data != -1) {
-                        EV_LOGGING(NETLINK, DEBUG,"VRF-INFO","sock %d, msg len %d, msg type %d vrf-id:%d",
-                                   sock, len, nh->nlmsg_type, *data);
-                        vrf_id = *data;
-                    }
-                }
+/* Get the VRF of the message from the NSID of the control message. The NSID is the
+ * VRF-id, or is mapped to the VRF when the VRF events are received by the listeners of
+ * the default VRF - returns false for a namespace that is not mapped to a VRF. The VRF
+ * name is copied to vrf_name, which has to outlive the processing of the datagram.
+ * VRF-id and the context are kept if the NSID is not present, the NSID is returned in
+ * nsid (NL_CAPTURE_NSID_NONE if not present) */
+static bool nl_get_msg_vrf(int sock, struct msghdr *msg, uint32_t *vrf_id, void **context,
+                           char *vrf_name, size_t vrf_name_len, int *nsid) {
+    *nsid = NL_CAPTURE_NSID_NONE;
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg;
+         cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_NETLINK &&
+            cmsg->cmsg_type == NETLINK_LISTEN_ALL_NSID &&
+            cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+            int *data = (int *)CMSG_DATA(cmsg);
+            if (*data == -1) break;
+            *nsid = *data;
+            EV_LOGGING(NETLINK, DEBUG,"VRF-INFO","sock %d, vrf-id:%d", sock, *data);
+            if (!nl_nsid_enabled()) {
+                *vrf_id = *data;
+                break;
             }
+            if (!nl_nsid_vrf_get(*data, vrf_id, vrf_name, vrf_name_len)) return false;
+            /* Handlers are given the VRF name as the context */
+            *context = (void *)vrf_name;
+            break;
         }
-
-        break;
     }
+    return true;
+}
+
+/* Process all the event messages of a datagram, returns the number of messages
+ * given to the handler */
+static size_t nl_process_event_msgs(int sock, fun_process_nl_message handlers,
+        void * context, char * buff, int len, int *error_code, uint32_t vrf_id) {
+    struct nlmsghdr * nh = NULL;
     size_t msg_count = 0;
-    for(nh = (struct nlmsghdr *) scratch_buff; NLMSG_OK (nh, len);
+    for(nh = (struct nlmsghdr *) buff; NLMSG_OK (nh, len);
         nh = NLMSG_NEXT (nh, len)) {
 
         int nlmsg_type = nh->nlmsg_type;
@@ -146,7 +192,7 @@ void netlink_tools_receive_event(int sock, fun_process_nl_message handlers,
         //not expected during this phase..
         if (nh->nlmsg_flags & NLM_F_DUMP_INTR) {
             *error_code = EINTR;
-            return ;    //current messages are incomplete.
+            return msg_count;    //current messages are incomplete.
         }
 
         if (nh->nlmsg_type == NLMSG_DONE) {
@@ -170,23 +216,248 @@ void netlink_tools_receive_event(int sock, fun_process_nl_message handlers,
              * Converting to a positive error code for putting to STD_ERR private space
              */
             *error_code = -(err->error);
-            return ;
+            return msg_count;
         }
 
         msg_count++; //track statistics
         if (!handlers(sock, nh->nlmsg_type,nh,context, vrf_id)) { //assume function will log an error
+            return msg_count;
+        }
+    }
+    return msg_count;
+}
+
+void netlink_tools_receive_event(int sock, fun_process_nl_message handlers,
+        void * context, char * scratch_buff, size_t scratch_buff_len,int *error_code, uint32_t vrf_id) {
+    int len = 0;
+    int _error_code = 0;
+    char vrf_name[NAS_VRF_NAME_SZ + 1];
+    int nsid = NL_CAPTURE_NSID_NONE;
+    if (error_code==NULL) error_code = &_error_code;
+    while (true) {
+        struct nlmsghdr *nh = (struct nlmsghdr *)scratch_buff;
+        struct iovec iov = { scratch_buff,scratch_buff_len };
+        struct sockaddr_nl snl;
+        struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
+
+        char   cmsgbuf[32];
+        if (vrf_id == NL_DEFAULT_VRF_ID) {
+            /* Read control message from socket */
+            msg.msg_control = &cmsgbuf;
+            msg.msg_controllen = sizeof(cmsgbuf);
+        }
+
+        len = recvmsg(sock, &msg,MSG_TRUNC);
+        if ((len==-1) && (errno==EINTR || errno==EAGAIN)) continue;
+        if (len==-1) {
+            bool _mem = (errno==ENOMEM || errno==ENOBUFS);
+            EV_LOGGING(NETLINK,ERR,"READ/ERR","Failed to read from socket %s - %d", _mem ? "due to ENOMEM or ENOBUFS" : "generic error",errno);
+        }
+        if (len==-1) { *error_code = errno; return ; }
+        if (msg.msg_flags & MSG_TRUNC) {
+            EV_LOGGING(NETLINK,ERR,"READ/ERR","Truncated message %lu (type:%d)",msg.msg_iovlen,
+                       nh->nlmsg_type);
             return ;
         }
+        if ((vrf_id == NL_DEFAULT_VRF_ID) &&
+            !nl_get_msg_vrf(sock, &msg, &vrf_id, &context, vrf_name, sizeof(vrf_name), &nsid)) {
+            /* Event of a namespace that is not a VRF */
+            return;
+        }
+
+        break;
     }
+    nl_capture_write(sock, nsid, vrf_id, scratch_buff, len);
+    size_t msg_count = nl_process_event_msgs(sock, handlers, context, scratch_buff, len, error_code, vrf_id);
     nas_nl_stats_update (sock, msg_count);
 }
 
-bool netlink_tools_process_socket(int sock,
+size_t netlink_tools_process_datagram(int sock, fun_process_nl_message handlers,
+        void * context, char * buff, int len, int *error_code, uint32_t vrf_id) {
+    int _error_code = 0;
+    if (error_code==NULL) error_code = &_error_code;
+    return nl_process_event_msgs(sock, handlers, context, buff, len, error_code, vrf_id);
+}
+
+nl_event_ring_t *nl_event_ring_create(size_t depth, size_t buff_len) {
+    nl_event_ring_t *ring = (nl_event_ring_t *)calloc(1, sizeof(nl_event_ring_t));
+    if (ring == NULL) return NULL;
+
+    ring->depth = depth;
+    ring->buff_len = buff_len;
+    ring->msgs = (struct mmsghdr *)calloc(depth, sizeof(struct mmsghdr));
+    ring->iov = (struct iovec *)calloc(depth, sizeof(struct iovec));
+    ring->addrs = (struct sockaddr_nl *)calloc(depth, sizeof(struct sockaddr_nl));
+    ring->cmsg = (char *)calloc(depth, NL_EVENT_RING_CMSG_LEN);
+    ring->buffs = (char *)malloc(depth * buff_len);
+    if ((ring->msgs == NULL) || (ring->iov == NULL) || (ring->addrs == NULL) ||
+        (ring->cmsg == NULL) || (ring->buffs == NULL)) {
+        nl_event_ring_destroy(ring);
+        return NULL;
+    }
+    size_t ix = 0;
+    for ( ; ix < depth; ++ix) {
+        ring->iov[ix].iov_base = ring->buffs + (ix * buff_len);
+        ring->iov[ix].iov_len = buff_len;
+    }
+    return ring;
+}
+
+void nl_event_ring_destroy(nl_event_ring_t *ring) {
+    if (ring == NULL) return;
+    free(ring->msgs);
+    free(ring->iov);
+    free(ring->addrs);
+    free(ring->cmsg);
+    free(ring->buffs);
+    free(ring);
+}
+
+size_t netlink_tools_process_event_datagram(int sock, fun_process_nl_message handlers,
+        void * context, struct msghdr *msg, char *buff, int len, int *error_code, uint32_t vrf_id) {
+    int _error_code = 0;
+    if (error_code==NULL) error_code = &_error_code;
+    if (msg->msg_flags & MSG_TRUNC) {
+        EV_LOGGING(NETLINK,ERR,"READ/ERR","Truncated message %d (type:%d)",len,
+                   ((struct nlmsghdr *)buff)->nlmsg_type);
+        return 0;
+    }
+    /* Name of the VRF of the NSID, kept until the datagram is processed */
+    char vrf_name[NAS_VRF_NAME_SZ + 1];
+    int nsid = NL_CAPTURE_NSID_NONE;
+    if ((vrf_id == NL_DEFAULT_VRF_ID) &&
+        !nl_get_msg_vrf(sock, msg, &vrf_id, &context, vrf_name, sizeof(vrf_name), &nsid)) {
+        return 0;
+    }
+    nl_capture_write(sock, nsid, vrf_id, buff, len);
+    return nl_process_event_msgs(sock, handlers, context, buff, len, error_code, vrf_id);
+}
+
+size_t netlink_tools_receive_events(int sock, fun_process_nl_message handlers,
+        void * context, nl_event_ring_t *ring, int *error_code, uint32_t vrf_id) {
+    int _error_code = 0;
+    if (error_code==NULL) error_code = &_error_code;
+
+    size_t ix = 0;
+    for ( ; ix < ring->depth; ++ix) {
+        struct msghdr *msg = &ring->msgs[ix].msg_hdr;
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_name = &ring->addrs[ix];
+        msg->msg_namelen = sizeof(struct sockaddr_nl);
+        msg->msg_iov = &ring->iov[ix];
+        msg->msg_iovlen = 1;
+        if (vrf_id == NL_DEFAULT_VRF_ID) {
+            /* Read control message from socket for the VRF-id (NSID) */
+            msg->msg_control = ring->cmsg + (ix * NL_EVENT_RING_CMSG_LEN);
+            msg->msg_controllen = NL_EVENT_RING_CMSG_LEN;
+        }
+    }
+
+    /* Drain whatever is already queued on the socket, up to the ring depth */
+    int count = 0;
+    do {
+        count = recvmmsg(sock, ring->msgs, ring->depth, MSG_DONTWAIT, NULL);
+    } while ((count==-1) && (errno==EINTR));
+
+    if (count==-1) {
+        if (errno==EAGAIN) return 0;
+        bool _mem = (errno==ENOMEM || errno==ENOBUFS);
+        EV_LOGGING(NETLINK,ERR,"READ/ERR","Failed to read from socket %s - %d", _mem ? "due to ENOMEM or ENOBUFS" : "generic error",errno);
+        *error_code = errno;
+        return 0;
+    }
+
+    size_t msg_count = 0;
+    for (ix = 0; ix < (size_t)count; ++ix) {
+        msg_count += netlink_tools_process_event_datagram(sock, handlers, context, &ring->msgs[ix].msg_hdr,
+                                                          (char *)ring->iov[ix].iov_base,
+                                                          ring->msgs[ix].msg_len, error_code, vrf_id);
+    }
+    nas_nl_stats_update (sock, msg_count);
+    nas_nl_stats_update_batch (sock, count);
+    return count;
+}
+
+#ifndef NLM_F_ACK_TLVS
+#define NLM_F_CAPPED    0x100
+#define NLM_F_ACK_TLVS  0x200
+#define NLMSGERR_ATTR_MSG 1
+#endif
+
+/* Log the error string added by the kernel when extended ACK is enabled on the socket */
+static void nl_log_ext_ack(int sock, struct nlmsghdr *nh) {
+    if (!(nh->nlmsg_flags & NLM_F_ACK_TLVS)) return;
+
+    struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA (nh);
+    size_t offset = sizeof(*err);
+    if (!(nh->nlmsg_flags & NLM_F_CAPPED)) {
+        offset += err->msg.nlmsg_len - sizeof(struct nlmsghdr);
+    }
+    if (NLMSG_LENGTH(offset) >= nh->nlmsg_len) return;
+
+    struct nlattr *tb[NLMSGERR_ATTR_MSG+1];
+    nla_parse(tb, NLMSGERR_ATTR_MSG+1, (struct nlattr *)((char *)err + offset),
+              nh->nlmsg_len - NLMSG_LENGTH(offset));
+    if (tb[NLMSGERR_ATTR_MSG] != NULL) {
+        EV_LOGGING(NETLINK,INFO,"ACK/ERR","sock %d, msg_type %d, error %d: %.*s", sock,
+                   err->msg.nlmsg_type, err->error, (int)nla_len(tb[NLMSGERR_ATTR_MSG]),
+                   (char *)nla_data(tb[NLMSGERR_ATTR_MSG]));
+    }
+}
+
+/* Receive buffer used when the caller buffer is smaller than the datagrams that the
+ * kernel can send, grown after a truncated datagram. One buffer per thread, freed when
+ * the thread exits. */
+static __thread char *nl_recv_buff = NULL;
+static __thread size_t nl_recv_buff_len = 0;
+static pthread_key_t nl_recv_buff_key;
+static pthread_once_t nl_recv_buff_once = PTHREAD_ONCE_INIT;
+
+static void nl_recv_buff_key_init(void) {
+    if (pthread_key_create(&nl_recv_buff_key, free) != 0) {
+        EV_LOGGING(NETLINK, ERR, "NETLINK", "Failed to create the receive buffer key");
+    }
+}
+
+static void nl_set_recv_buff(char *buff, size_t len) {
+    pthread_once(&nl_recv_buff_once, nl_recv_buff_key_init);
+    pthread_setspecific(nl_recv_buff_key, buff);
+    nl_recv_buff = buff;
+    nl_recv_buff_len = len;
+}
+
+static char *nl_get_recv_buff(char *scratch_buff, size_t scratch_buff_len, size_t *buff_len) {
+    if ((scratch_buff_len >= NL_RECV_MIN_BUFFER_LEN) && (scratch_buff_len >= nl_recv_buff_len)) {
+        *buff_len = scratch_buff_len;
+        return scratch_buff;
+    }
+    if (nl_recv_buff == NULL) {
+        char *buff = (char *)malloc(NL_RECV_MIN_BUFFER_LEN);
+        if (buff == NULL) {
+            *buff_len = scratch_buff_len;
+            return scratch_buff;
+        }
+        nl_set_recv_buff(buff, NL_RECV_MIN_BUFFER_LEN);
+    }
+    *buff_len = nl_recv_buff_len;
+    return nl_recv_buff;
+}
+
+/* Grow the receive buffer for the next reads after a truncated datagram */
+static void nl_grow_recv_buff(size_t len) {
+    if (len <= nl_recv_buff_len) return;
+    char *buff = (char *)realloc(nl_recv_buff, len);
+    if (buff == NULL) return;
+    nl_set_recv_buff(buff, len);
+}
+
+/* Process the response messages, first_len is the length of the first datagram if it
+ * is already read into the receive buffer (nl_get_recv_buff) - -1 otherwise */
+static bool nl_process_socket(int sock,
             fun_process_nl_message func,
             void * context, char * scratch_buff, size_t scratch_buff_len,
-            const int * seq, int *error_code, uint32_t vrf_id) {
+            const int * seq, int *error_code, uint32_t vrf_id, int first_len) {
 
-    struct timeval tv = {0, 1000};
     int error_rc ;//will init below...
     if(error_code==NULL) error_code = &error_rc;
     //zap out existing error code
@@ -194,64 +465,57 @@ bool netlink_tools_process_socket(int sock,
 
     bool rc =false;
     bool cont=true;
-    fd_set sel_fds;
-    FD_ZERO(&sel_fds);
 
     EV_LOGGING(NETLINK, DEBUG ,"ACK/ERR","sock %d", sock);
 
     while (cont) {
-        struct nlmsghdr *nh = (struct nlmsghdr *)scratch_buff;
-        struct iovec iov = { scratch_buff,sizeof(struct nlmsghdr) };
-        struct sockaddr_nl snl;
-        struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
-
-        /*Check size of message - new kernels shold return size of new message not size of truncated one - old kernels will return
-         * len matching input iov len and then you need to use the message header to determine the size*/
-        int len = recvmsg (sock, &msg, MSG_PEEK | MSG_TRUNC);
-        if (len<0  && ((errno==EINTR) || (errno==EAGAIN))) {
-            EV_LOGGING(NETLINK, DEBUG ,"ACK/ERR","Recvmsg interrupted for sock %d", sock);
-            continue;
-        }
-        if (len==-1) return false;
-
-        EV_LOGGING(NETLINK, DEBUG ,"ACK/ERR","sock %d, msg len %d", sock, len);
-
-        //Check len and update iov.iov_len appropriately (using the conditions above)
-        if (msg.msg_flags & MSG_TRUNC) {
-            if (iov.iov_len == len) {
-                /*
-                 * In cases where the input buffer is less then the required space
-                 * read just one message - higher overhead but at least no truncated messages
-                 *
-                 * */
-                iov.iov_len = nh->nlmsg_len; //actual size of messasge when the lenght returned is just the header length (old kernel)
-            } else {
-                iov.iov_len = len; //actual length of message from new kernel
-            }
+        /* Each datagram is read with one recvmsg into a buffer of at least
+         * NL_RECV_MIN_BUFFER_LEN, which fits the dump datagrams. The socket receive timeout
+         * set at socket creation bounds the wait for the next datagram. */
+        size_t buff_len = 0;
+        char *buff = nl_get_recv_buff(scratch_buff, scratch_buff_len, &buff_len);
+        int len = first_len;
+        first_len = -1;
+        if (len < 0) {
+            struct iovec iov = { buff, buff_len };
+            struct sockaddr_nl snl;
+            struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
+            /* Length of a truncated datagram is returned in full */
+            len = recvmsg (sock, &msg, MSG_TRUNC);
         }
-        /*
-         * Block possible buffer overwrite - truncate the message if the buffer size is smaller then even a single
-         * message - likely only the case when people are querying with less then 1024 bytes
-         * */
-        if (iov.iov_len > scratch_buff_len) {
-            EV_LOGGING(NETLINK, INFO ,"ACK/ERR","iov len %lu greater than scratch buff len", iov.iov_len);
-            iov.iov_len =  nh->nlmsg_len < scratch_buff_len ?
-                    nh->nlmsg_len : scratch_buff_len;
-        }
-        len = recvmsg (sock, &msg, 0);
-
         if (len<0) {
+            if (errno==EINTR) {
+                EV_LOGGING(NETLINK, DEBUG ,"ACK/ERR","Recvmsg interrupted for sock %d", sock);
+                continue;
+            }
+            if ((errno==EAGAIN) || (errno==EWOULDBLOCK)) {
+                EV_LOGGING(NETLINK, INFO ,"ACK/ERR","Recvmsg timed-out for sock %d", sock);
+                *error_code = ETIMEDOUT;
+                return false;
+            }
             EV_LOGGING(NETLINK, INFO ,"ACK/ERR","Recvmsg len<0, errno %d, sock %d", errno, sock);
-            if ((errno==EINTR) || (errno==EAGAIN)) continue;
             *error_code = errno;
             return false;
         }
 
+        struct nlmsghdr *nh = (struct nlmsghdr *)buff;
+        if ((size_t)len > buff_len) {
+            /* Only a single message larger than the buffer makes the kernel send a larger
+             * datagram, the rest of it is lost - the buffer is grown for the next reads */
+            EV_LOGGING(NETLINK,ERR,"ACK/ERR","Truncated message len %d buff len %lu (type:%d)",
+                       len, buff_len, nh->nlmsg_type);
+            nl_grow_recv_buff(len);
+            *error_code = EMSGSIZE;
+            return false;
+        }
+
+        nl_capture_write(sock, NL_CAPTURE_NSID_NONE, vrf_id, buff, len);
+
         int nlmsg_type = nh->nlmsg_type;
         uint32_t msg_count = 0;
 
         EV_LOGGING(NETLINK, DEBUG ,"ACK/ERR","sock %d, msg len %d, msg type %d", sock, len, nlmsg_type);
-        for(nh = (struct nlmsghdr *) scratch_buff; NLMSG_OK (nh, len);
+        for(nh = (struct nlmsghdr *) buff; NLMSG_OK (nh, len);
             nh = NLMSG_NEXT (nh, len)) {
 
             nlmsg_type = nh->nlmsg_type;
@@ -291,6 +555,7 @@ bool netlink_tools_process_socket(int sock,
                     rc = true;
                     continue;
                 }
+                nl_log_ext_ack(sock, nh);
                 /*
                  * Netlink error is returned as a -ve number but all other errorno is +ve.
                  * Converting to a positive error code for putting to STD_ERR private space
@@ -308,22 +573,50 @@ bool netlink_tools_process_socket(int sock,
         }
 
         EV_LOGGING(NETLINK, DEBUG ,"ACK/ERR","sock %d, rc %d", sock, rc);
+    }
+    return rc;
+}
 
-        if (msg.msg_flags & MSG_TRUNC) {
-            EV_LOGGING(NETLINK,INFO,"ACK/ERR","Truncated message %lu (type:%d)",msg.msg_iovlen,
-                    nlmsg_type);
-            return false;
-        }
+bool netlink_tools_process_socket(int sock,
+            fun_process_nl_message func,
+            void * context, char * scratch_buff, size_t scratch_buff_len,
+            const int * seq, int *error_code, uint32_t vrf_id) {
+    return nl_process_socket(sock, func, context, scratch_buff, scratch_buff_len, seq, error_code,
+                             vrf_id, -1);
+}
 
-        FD_SET(sock, &sel_fds);
-        if(cont && select((sock+1), &sel_fds, NULL, NULL, &tv) <= 0) {
-            EV_LOGGING(NETLINK, INFO ,"ACK/ERR","Select timed-out for %d, errno %d", sock, errno);
-            rc = false;
-            break;
-        }
+static ssize_t nl_kernel_send(int sock, const struct msghdr *msg, int flags) {
+    return sendmsg(sock, msg, flags);
+}
 
-    }
-    return rc;
+static const nl_transport_t nl_kernel_transport = {
+    .name = "kernel",
+    .sock_get = nas_nl_req_sock_get,
+    .sock_put = nas_nl_req_sock_put,
+    .send = nl_kernel_send,
+};
+
+static const nl_transport_t * volatile nl_transport = &nl_kernel_transport;
+
+void nl_transport_set(const nl_transport_t *transport) {
+    nl_transport = (transport != NULL) ? transport : &nl_kernel_transport;
+    EV_LOGGING(NETLINK, INFO, "NL-TRANSPORT", "Netlink requests sent with the %s transport", nl_transport->name);
+}
+
+bool nl_transport_is_kernel(void) {
+    return nl_transport == &nl_kernel_transport;
+}
+
+int nl_transport_sock_get(const char *vrf_name, nas_nl_sock_TYPES type) {
+    return nl_transport->sock_get(vrf_name, type);
+}
+
+void nl_transport_sock_put(const char *vrf_name, nas_nl_sock_TYPES type, int sock, bool sock_err) {
+    nl_transport->sock_put(vrf_name, type, sock, sock_err);
+}
+
+ssize_t nl_transport_send(int sock, const struct msghdr *msg, int flags) {
+    return nl_transport->send(sock, msg, flags);
 }
 
 bool nl_send_nlmsg(int sock, struct nlmsghdr *m) {
@@ -343,7 +636,32 @@ bool nl_send_nlmsg(int sock, struct nlmsghdr *m) {
         .msg_iovlen = 1,
     };
 
-    return sendmsg(sock,&msg,0)==(m->nlmsg_len);
+    return nl_transport_send(sock,&msg,0)==(m->nlmsg_len);
+}
+
+/* Send the message and read the first datagram of the response into the receive buffer
+ * with the io_uring backend, nl_process_socket then handles it from the buffer */
+static bool nl_send_recv_nlmsg(int sock, struct nlmsghdr *m, char *scratch_buff, size_t scratch_buff_len,
+                               int *recv_len) {
+    struct sockaddr_nl nladdr ;
+    memset(&nladdr,0,sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+
+    struct iovec iov = { .iov_base = m, .iov_len = m->nlmsg_len };
+    struct msghdr msg = {
+        .msg_name = &nladdr,
+        .msg_namelen = sizeof(nladdr),
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+
+    size_t buff_len = 0;
+    char *buff = nl_get_recv_buff(scratch_buff, scratch_buff_len, &buff_len);
+    struct iovec recv_iov = { buff, buff_len };
+    struct sockaddr_nl snl;
+    struct msghdr recv_msg = { (void *) &snl, sizeof snl, &recv_iov, 1, NULL, 0, 0 };
+
+    return nl_uring_send_recv(sock, &msg, &recv_msg, MSG_TRUNC, recv_len);
 }
 
 bool nl_send_request(int sock, int type, int flags, int seq, void * req, size_t len ) {
@@ -371,6 +689,19 @@ bool nl_send_request(int sock, int type, int flags, int seq, void * req, size_t
     return sendmsg(sock,&msg,0)==(sizeof(nlh)+len);
 }
 
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK 12
+#endif
+
+bool nl_sock_set_strict_check(int sock) {
+    int on = 1;
+    if (setsockopt(sock, NL_SOL_NETLINK, NETLINK_GET_STRICT_CHK, &on, sizeof(on)) != 0) {
+        EV_LOGGING(NETLINK, DEBUG, "NETLINK", "Strict check not supported sock:%d errno:%d", sock, errno);
+        return false;
+    }
+    return true;
+}
+
 void * nlmsg_reserve(struct nlmsghdr * m, int maxlen, int len) {
     void * p = nlmsg_tail(m);
     if ((NLMSG_ALIGN(m->nlmsg_len) + RTA_ALIGN(len)) > maxlen) {
@@ -400,32 +731,297 @@ int nlmsg_add_attr(struct nlmsghdr * m, int maxlen, int type, const void * data,
 bool _process_set_fun(int sock, int rt_msg_type, struct nlmsghdr *hdr, void * context, uint32_t vrf_id) {
     return true;
 }
-t_std_error nl_do_set_request(const char *vrf_name, nas_nl_sock_TYPES type,struct nlmsghdr *m, void *buff,
-                              size_t bufflen) {
+/* Sequence numbers for the requests sent on the pooled sockets, a running counter
+ * makes sure that a late response for an earlier request is never taken as the ACK */
+static uint32_t nl_req_seq = 0;
+
+int nl_get_next_seq(void) {
+    return (int)__sync_add_and_fetch(&nl_req_seq, 1);
+}
+
+/* Reserve a block of consecutive sequence numbers, returns the first one */
+static uint32_t nl_get_seq_block(uint32_t count) {
+    return __sync_fetch_and_add(&nl_req_seq, count) + 1;
+}
+
+/* Messages echoed for a request sent with NLM_F_ECHO */
+typedef struct {
+    fun_process_nl_message func;
+    void *context;
+    bool echoed;
+} nl_echo_ctx_t;
+
+static bool nl_process_echo(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    nl_echo_ctx_t *echo = (nl_echo_ctx_t *)context;
+    echo->echoed = true;
+    return echo->func(sock, rt_msg_type, hdr, echo->context, vrf_id);
+}
+
+static t_std_error nl_do_request(const char *vrf_name, nas_nl_sock_TYPES type,struct nlmsghdr *m, void *buff,
+                                 size_t bufflen, nl_echo_ctx_t *echo) {
     int error = 0;
-    int sock = nas_nl_sock_create(vrf_name, type,false);
+    int sock = nl_transport_sock_get(vrf_name, type);
     if (sock==-1) return STD_ERR(ROUTE,FAIL,errno);
     do {
-        int seq = (int)std_get_uptime(NULL);
+        int seq = nl_get_next_seq();
         m->nlmsg_seq = seq;
-        if (!nl_send_nlmsg(sock,m)) {
+        int first_len = -1;
+        if ((m->nlmsg_flags & NLM_F_ACK) && nl_uring_enabled() && nl_transport_is_kernel()) {
+            /* Send and receive the ACK with one system call */
+            if (!nl_send_recv_nlmsg(sock, m, (char *)buff, bufflen, &first_len) && (errno != ENOSYS)) {
+                EV_LOGGING(NETLINK,ERR,"NL-URING","sock %d, request failed errno %d", sock, errno);
+                break;
+            }
+        }
+        if ((first_len < 0) && !nl_send_nlmsg(sock,m)) {
             break;
         }
         /* Default VRF-id is used here since it's not required for any operations,
          * if required in the future, pass the vrf-id associated with the vrf-name */
         if ((m->nlmsg_flags & NLM_F_ACK) &&
-            !netlink_tools_process_socket(sock,_process_set_fun,(char*)vrf_name,buff,bufflen,&seq, &error, NL_DEFAULT_VRF_ID)) {
+            !nl_process_socket(sock,(echo != NULL) ? nl_process_echo : _process_set_fun,
+                               (echo != NULL) ? (void *)echo : (void *)vrf_name,buff,bufflen,&seq, &error,
+                               NL_DEFAULT_VRF_ID, first_len)) {
+            break;
+        }
+        /* Echoed message is a datagram of its own sent before the ACK, read the ACK */
+        if ((echo != NULL) && echo->echoed &&
+            !nl_process_socket(sock,_process_set_fun,(char*)vrf_name,buff,bufflen,&seq, &error,
+                               NL_DEFAULT_VRF_ID, -1)) {
             break;
         }
 
-        close(sock);
+        nl_transport_sock_put(vrf_name, type, sock, false);
         return cps_api_ret_code_OK;
     } while(0);
 
-    if (sock!=-1) close(sock);
+    /* Kernel error is the last message for the request so the socket can be reused,
+     * on other failures the socket can still have unread messages so close it */
+    nl_transport_sock_put(vrf_name, type, sock, (error == 0));
     return STD_ERR(ROUTE,FAIL,error);
 }
 
+t_std_error nl_do_set_request(const char *vrf_name, nas_nl_sock_TYPES type,struct nlmsghdr *m, void *buff,
+                              size_t bufflen) {
+    return nl_do_request(vrf_name, type, m, buff, bufflen, NULL);
+}
+
+t_std_error nl_do_set_request_echo(const char *vrf_name, nas_nl_sock_TYPES type, struct nlmsghdr *m,
+                                   void *buff, size_t bufflen, fun_process_nl_message func, void *context) {
+    nl_echo_ctx_t echo = { func, context, false };
+    m->nlmsg_flags |= (NLM_F_ACK | NLM_F_ECHO);
+    return nl_do_request(vrf_name, type, m, buff, bufflen, &echo);
+}
+
+static bool nl_link_echo(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    static const nla_select_t link_sel[] = {
+        { IFLA_ADDRESS, sizeof(hal_mac_addr_t) },
+        { IFLA_MTU, sizeof(uint32_t) },
+    };
+    nl_link_echo_t *link = (nl_link_echo_t *)context;
+    struct ifinfomsg *ifmsg = (struct ifinfomsg *)NLMSG_DATA(hdr);
+
+    if ((rt_msg_type != RTM_NEWLINK) || (hdr->nlmsg_len < NLMSG_LENGTH(sizeof(*ifmsg)))) return true;
+
+    struct nlattr *attrs[__IFLA_MAX];
+    nla_parse_selected(attrs, __IFLA_MAX, link_sel, sizeof(link_sel)/sizeof(*link_sel),
+                       nlmsg_attrdata(hdr, sizeof(*ifmsg)), nlmsg_attrlen(hdr, sizeof(*ifmsg)));
+
+    link->ifindex = ifmsg->ifi_index;
+    link->flags = ifmsg->ifi_flags;
+    link->echoed = true;
+    if (attrs[IFLA_MTU] != NULL) link->mtu = *(uint32_t *)nla_data(attrs[IFLA_MTU]);
+    if (attrs[IFLA_ADDRESS] != NULL) memcpy(link->mac, nla_data(attrs[IFLA_ADDRESS]), sizeof(link->mac));
+    EV_LOGGING(NETLINK, DEBUG, "NL-ECHO", "Link created ifindex %d flags 0x%x mtu %u",
+               link->ifindex, link->flags, link->mtu);
+    return true;
+}
+
+t_std_error nl_do_link_create_request(const char *vrf_name, struct nlmsghdr *m, void *buff, size_t bufflen,
+                                      nl_link_echo_t *link) {
+    static const nla_select_t name_sel[] = { { IFLA_IFNAME, 1 } };
+    char if_name[HAL_IF_NAME_SZ] = {0};
+    memset(link, 0, sizeof(*link));
+
+    /* Keep the name for the lookup, the response can be received in the request buffer */
+    struct nlattr *attrs[__IFLA_MAX];
+    if (m->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifinfomsg))) {
+        nla_parse_selected(attrs, __IFLA_MAX, name_sel, 1, nlmsg_attrdata(m, sizeof(struct ifinfomsg)),
+                           nlmsg_attrlen(m, sizeof(struct ifinfomsg)));
+        if (attrs[IFLA_IFNAME] != NULL) {
+            safestrncpy(if_name, (const char *)nla_data(attrs[IFLA_IFNAME]), sizeof(if_name));
+        }
+    }
+
+    t_std_error rc = nl_do_set_request_echo(vrf_name, nas_nl_sock_T_INT, m, buff, bufflen, nl_link_echo, link);
+    if ((rc != STD_ERR_OK) && (STD_ERR_EXT_PRIV(rc) == EEXIST) && (if_name[0] != '\0')) {
+        /* Link is already there (NLM_F_EXCL), e.g. created again after a restart - it is
+         * taken as created as before the create was acknowledged */
+        EV_LOGGING(NETLINK, INFO, "NL-ECHO", "Link %s already exists", if_name);
+        memset(link, 0, sizeof(*link));
+        rc = STD_ERR_OK;
+    }
+    if (rc != STD_ERR_OK) return rc;
+
+    if (link->ifindex == 0) {
+        /* Kernel does not echo the created links */
+        link->ifindex = cps_api_interface_name_to_if_index(if_name);
+        if (link->ifindex == 0) {
+            EV_LOGGING(NETLINK, ERR, "NL-ECHO", "Created link %s not found", if_name);
+            return STD_ERR(ROUTE,FAIL,ENODEV);
+        }
+    }
+    return STD_ERR_OK;
+}
+
+/* Send the requests in one sendmsg, the kernel processes the messages in order
+ * and sends an ACK (or error) for each of them since NLM_F_ACK is set. Only the
+ * nlmsg_len bytes of a request are read, the kernel expects the next message at the
+ * aligned offset so the padding is sent from a separate buffer */
+static bool nl_batch_send(int sock, nl_batch_req_t *reqs, size_t count, uint32_t first_seq) {
+    static const char pad[NLMSG_ALIGNTO] = { 0 };
+    struct sockaddr_nl nladdr ;
+    memset(&nladdr,0,sizeof(nladdr));
+    nladdr.nl_family = AF_NETLINK;
+
+    struct iovec iov[2 * NL_BATCH_MAX_MSGS];
+    size_t iov_count = 0;
+    size_t len = 0;
+    size_t ix = 0;
+    for ( ; ix < count ; ++ix) {
+        reqs[ix].msg->nlmsg_flags |= NLM_F_ACK;
+        reqs[ix].msg->nlmsg_seq = first_seq + ix;
+        iov[iov_count].iov_base = reqs[ix].msg;
+        iov[iov_count].iov_len = reqs[ix].msg->nlmsg_len;
+        len += iov[iov_count++].iov_len;
+        size_t pad_len = NLMSG_ALIGN(reqs[ix].msg->nlmsg_len) - reqs[ix].msg->nlmsg_len;
+        if ((pad_len != 0) && ((ix + 1) < count)) {
+            iov[iov_count].iov_base = (void *)pad;
+            iov[iov_count].iov_len = pad_len;
+            len += iov[iov_count++].iov_len;
+        }
+    }
+    struct msghdr msg = {
+        .msg_name = &nladdr,
+        .msg_namelen = sizeof(nladdr),
+        .msg_iov = iov,
+        .msg_iovlen = iov_count,
+    };
+
+    ssize_t rc = nl_transport_send(sock,&msg,0);
+    if (rc != len) {
+        EV_LOGGING(NETLINK,ERR,"NL-BATCH","sock %d, send of %lu msgs (len %lu) failed, errno %d",
+                   sock, count, len, errno);
+        return false;
+    }
+    return true;
+}
+
+/* Collect the ACK of every request in the batch, returns the number of requests
+ * that were not acknowledged by the kernel */
+static size_t nl_batch_recv_acks(int sock, nl_batch_req_t *reqs, size_t count, uint32_t first_seq,
+                                 char *buff, size_t bufflen) {
+    size_t pending = count;
+    while (pending > 0) {
+        struct iovec iov = { buff, bufflen };
+        struct sockaddr_nl snl;
+        struct msghdr msg = { (void *) &snl, sizeof snl, &iov, 1, NULL, 0, 0 };
+
+        int len = recvmsg(sock, &msg, 0);
+        if (len<0) {
+            if (errno==EINTR) continue;
+            /* EAGAIN is the receive timeout of the socket, the pending requests fail */
+            EV_LOGGING(NETLINK,ERR,"NL-BATCH","sock %d, recvmsg failed errno %d, %lu ACKs pending",
+                       sock, errno, pending);
+            return pending;
+        }
+        struct nlmsghdr *nh = (struct nlmsghdr *)buff;
+        for ( ; NLMSG_OK (nh, len); nh = NLMSG_NEXT (nh, len)) {
+            uint32_t ix = nh->nlmsg_seq - first_seq;
+            if ((ix >= count) || (nh->nlmsg_type != NLMSG_ERROR)) {
+                EV_LOGGING(NETLINK,INFO,"NL-BATCH","sock %d, ignored msg_type %d seq %u",
+                           sock, nh->nlmsg_type, nh->nlmsg_seq);
+                continue;
+            }
+            struct nlmsgerr *err = (struct nlmsgerr *) NLMSG_DATA (nh);
+            if (reqs[ix].error_code == NL_BATCH_ERR_PENDING) --pending;
+            reqs[ix].error_code = -(err->error);
+            if (err->error != 0) {
+                nl_log_ext_ack(sock, nh);
+            }
+        }
+        if (msg.msg_flags & MSG_TRUNC) {
+            /* ACKs past the end of the buffer are lost, the batch can not be completed */
+            EV_LOGGING(NETLINK,ERR,"NL-BATCH","sock %d, truncated ACK message, %lu ACKs pending",
+                       sock, pending);
+            return pending;
+        }
+    }
+    return 0;
+}
+
+/* Max. number of requests sent at once whose ACKs fit in the receive buffer of the socket
+ * - a socket whose buffer could not be set to NL_BATCH_RCVBUF_LEN gets smaller batches */
+static size_t nl_batch_max_msgs(int sock) {
+    int rcvbuf = 0;
+    socklen_t optlen = sizeof(rcvbuf);
+    if (getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &optlen) != 0) return NL_BATCH_MAX_MSGS;
+    if (rcvbuf <= (NL_BATCH_MAX_SEND_LEN + NL_BATCH_ACK_MEM)) return 1;
+    size_t max_msgs = (rcvbuf - NL_BATCH_MAX_SEND_LEN) / NL_BATCH_ACK_MEM;
+    return (max_msgs < NL_BATCH_MAX_MSGS) ? max_msgs : NL_BATCH_MAX_MSGS;
+}
+
+t_std_error nl_do_batch_request(const char *vrf_name, nas_nl_sock_TYPES type, nl_batch_req_t *reqs,
+                                size_t count, void *buff, size_t bufflen, size_t *failed_count) {
+    size_t failed = 0;
+    size_t ix = 0;
+    for ( ; ix < count; ++ix) {
+        reqs[ix].error_code = NL_BATCH_ERR_PENDING;
+    }
+
+    int sock = nl_transport_sock_get(vrf_name, type);
+    bool sock_err = (sock == -1);
+    size_t max_msgs = sock_err ? 0 : nl_batch_max_msgs(sock);
+    size_t start = 0;
+    while (!sock_err && (start < count)) {
+        /* Limit the size of a single send to the socket send buffer and its ACKs
+         * to the receive buffer */
+        size_t len = 0;
+        size_t end = start;
+        for ( ; (end < count) && ((end - start) < max_msgs); ++end) {
+            /* Padding of the previous request is sent before the request */
+            size_t msg_len = NLMSG_ALIGN(len) - len + reqs[end].msg->nlmsg_len;
+            if ((end > start) && ((len + msg_len) > NL_BATCH_MAX_SEND_LEN)) break;
+            len += msg_len;
+        }
+        uint32_t first_seq = nl_get_seq_block(end - start);
+        if (!nl_batch_send(sock, &reqs[start], end - start, first_seq) ||
+            (nl_batch_recv_acks(sock, &reqs[start], end - start, first_seq, buff, bufflen) != 0)) {
+            sock_err = true;
+            break;
+        }
+        start = end;
+    }
+    nl_transport_sock_put(vrf_name, type, sock, sock_err);
+
+    int error = 0;
+    for (ix = 0; ix < count; ++ix) {
+        /* Requests that could not be sent or that were not acknowledged */
+        if (reqs[ix].error_code == NL_BATCH_ERR_PENDING) {
+            reqs[ix].error_code = EIO;
+        }
+        if (reqs[ix].error_code != 0) {
+            if (error == 0) error = reqs[ix].error_code;
+            ++failed;
+        }
+    }
+    if (failed_count != NULL) *failed_count = failed;
+
+    EV_LOGGING(NETLINK,DEBUG,"NL-BATCH","VRF:%s type:%d requests:%lu failed:%lu",
+               (vrf_name ? vrf_name : ""), type, count, failed);
+    return (failed == 0) ? STD_ERR_OK : STD_ERR(ROUTE,FAIL,error);
+}
+
 static int create_intf_socket(const char *vrf_name, bool include_bind) {
     int sock = nl_sock_create(vrf_name, RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR,
                               NETLINK_ROUTE,include_bind, NL_INTF_SOCKET_BUFFER_LEN);
@@ -454,6 +1050,8 @@ static int create_route_socket(const char *vrf_name, bool include_bind) {
             close(sock);
             return -1;
         }
+        /* Events are still filtered in user space if the filter can not be attached */
+        nl_filter_attach(sock, nas_nl_sock_T_ROUTE);
     }
     return sock;
 }
@@ -470,6 +1068,8 @@ static int create_neigh_socket(const char *vrf_name, bool include_bind) {
             close(sock);
             return -1;
         }
+        /* Events are still filtered in user space if the filter can not be attached */
+        nl_filter_attach(sock, nas_nl_sock_T_NEI);
     }
     return sock;
 }
@@ -545,7 +1145,13 @@ static create_soc_fn sock_create_functions[] = {
 
 int nas_nl_sock_create(const char *vrf_name, nas_nl_sock_TYPES type, bool include_bind)  {
     if (type >= nas_nl_sock_T_MAX) return -1;
-    return sock_create_functions[type](vrf_name, include_bind);
+    int sock = sock_create_functions[type](vrf_name, include_bind);
+    if ((sock != -1) && include_bind) {
+        /* Keep only the groups of the subscription profile of the VRF, the events
+         * received before the groups are left are dropped by the handler */
+        nl_subscribe_sock_apply(sock, type, nl_subscribe_groups(vrf_name, type));
+    }
+    return sock;
 }
 
 
@@ -0,0 +1,681 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * filename: netlink_uring.c
+ */
+
+/*
+ * io_uring backend of the netlink sockets - a multishot receive is kept pending on every
+ * event socket, the datagrams of all the sockets are received in the buffers provided to
+ * the ring and reaped with one system call. The receives run only while the event thread
+ * waits on the ring (DEFER_TASKRUN), the dump responses read from an event socket by the
+ * event thread itself are not taken by the ring. The request path sends the request and
+ * receives the first datagram of the response with one system call.
+ * The ring is set up with the raw system calls, no library is required.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "netlink_uring.h"
+#include "event_log.h"
+#include "nas_os_nl_config.h"
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(IORING_ENTER_EXT_ARG)
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* user_data of the linked timeout of the request and of the cancels */
+#define NL_URING_UDATA_INTERNAL ((__u64)-1)
+
+typedef struct {
+    int fd;
+    unsigned int entries;
+    void *sq_ptr;
+    size_t sq_len;
+    void *cq_ptr;
+    size_t cq_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned int sq_local_tail;   /* SQEs filled but not yet visible to the kernel */
+} nl_uring_t;
+
+static int nl_uring_setup(unsigned int entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int nl_uring_enter(int fd, unsigned int to_submit, unsigned int min_complete,
+                          unsigned int flags, void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static void nl_uring_destroy(nl_uring_t *ring) {
+    if (ring->sqes != NULL) munmap(ring->sqes, ring->sqes_len);
+    if ((ring->cq_ptr != NULL) && (ring->cq_ptr != ring->sq_ptr)) munmap(ring->cq_ptr, ring->cq_len);
+    if (ring->sq_ptr != NULL) munmap(ring->sq_ptr, ring->sq_len);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+/* Map the queues of the ring set up */
+static bool nl_uring_map(nl_uring_t *ring, const struct io_uring_params *p) {
+    ring->entries = p->sq_entries;
+    ring->sq_len = p->sq_off.array + (p->sq_entries * sizeof(unsigned));
+    ring->cq_len = p->cq_off.cqes + (p->cq_entries * sizeof(struct io_uring_cqe));
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_len > ring->sq_len) ring->sq_len = ring->cq_len;
+        ring->cq_len = ring->sq_len;
+    }
+    ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        ring->sq_ptr = NULL;
+        nl_uring_destroy(ring);
+        return false;
+    }
+    if (p->features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            ring->cq_ptr = NULL;
+            nl_uring_destroy(ring);
+            return false;
+        }
+    }
+    ring->sqes_len = p->sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring->sqes = NULL;
+        nl_uring_destroy(ring);
+        return false;
+    }
+    ring->sq_head = (unsigned *)((char *)ring->sq_ptr + p->sq_off.head);
+    ring->sq_tail = (unsigned *)((char *)ring->sq_ptr + p->sq_off.tail);
+    ring->sq_mask = (unsigned *)((char *)ring->sq_ptr + p->sq_off.ring_mask);
+    ring->sq_array = (unsigned *)((char *)ring->sq_ptr + p->sq_off.array);
+    ring->cq_head = (unsigned *)((char *)ring->cq_ptr + p->cq_off.head);
+    ring->cq_tail = (unsigned *)((char *)ring->cq_ptr + p->cq_off.tail);
+    ring->cq_mask = (unsigned *)((char *)ring->cq_ptr + p->cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ptr + p->cq_off.cqes);
+    ring->sq_local_tail = *ring->sq_tail;
+    return true;
+}
+
+static bool nl_uring_create(nl_uring_t *ring, unsigned int entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = nl_uring_setup(entries, &p);
+    if (ring->fd < 0) {
+        EV_LOGGING(NETLINK, INFO, "NL-URING", "io_uring setup failed errno %d", errno);
+        ring->fd = -1;
+        return false;
+    }
+    /* The wait with timeout and the submit of the linked requests need these */
+    if (!(p.features & IORING_FEAT_EXT_ARG) || !(p.features & IORING_FEAT_NODROP)) {
+        EV_LOGGING(NETLINK, INFO, "NL-URING", "io_uring features 0x%x not supported", p.features);
+        nl_uring_destroy(ring);
+        errno = ENOSYS;
+        return false;
+    }
+    return nl_uring_map(ring, &p);
+}
+
+/* Make the filled SQEs visible to the kernel and submit them */
+static int nl_uring_submit(nl_uring_t *ring, unsigned int min_complete, unsigned int flags,
+                           void *arg, size_t argsz) {
+    unsigned int to_submit = ring->sq_local_tail - *ring->sq_tail;
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    if ((to_submit == 0) && (min_complete == 0)) return 0;
+    int rc;
+    do {
+        rc = nl_uring_enter(ring->fd, to_submit, min_complete, flags, arg, argsz);
+    } while ((rc < 0) && (errno == EINTR) && (to_submit != 0));
+    return rc;
+}
+
+static struct io_uring_sqe *nl_uring_get_sqe(nl_uring_t *ring) {
+    unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if ((ring->sq_local_tail - head) >= ring->entries) {
+        /* Full, submit the queued ones to make room */
+        if (nl_uring_submit(ring, 0, 0, NULL, 0) < 0) return NULL;
+        head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        if ((ring->sq_local_tail - head) >= ring->entries) return NULL;
+    }
+    unsigned int ix = ring->sq_local_tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[ix];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[ix] = ix;
+    ring->sq_local_tail++;
+    return sqe;
+}
+
+static void nl_uring_prep_msg(struct io_uring_sqe *sqe, __u8 opcode, int sock, struct msghdr *msg,
+                              int flags, __u64 user_data) {
+    sqe->opcode = opcode;
+    sqe->fd = sock;
+    sqe->addr = (__u64)(uintptr_t)msg;
+    sqe->len = 1;
+    sqe->msg_flags = flags;
+    sqe->user_data = user_data;
+}
+
+/* Backend selection - evaluated once */
+static pthread_once_t nl_uring_once = PTHREAD_ONCE_INIT;
+static bool nl_uring_selected = false;
+
+static void nl_uring_select(void) {
+    nas_os_nl_config_t cfg;
+    nas_os_nl_config_get(&cfg);
+    if (!cfg.io_uring) return;
+
+    /* Probe the kernel support with a small ring */
+    nl_uring_t ring;
+    if (!nl_uring_create(&ring, 4)) {
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "io_uring not available, using the classic netlink path");
+        return;
+    }
+    nl_uring_destroy(&ring);
+    nl_uring_selected = true;
+    EV_LOGGING(NETLINK, INFO, "NL-URING", "Using io_uring for the netlink requests");
+}
+
+bool nl_uring_enabled(void) {
+    pthread_once(&nl_uring_once, nl_uring_select);
+    return nl_uring_selected;
+}
+
+#ifdef IORING_SETUP_DEFER_TASKRUN
+
+/* user_data of the poll on the wake up eventfd of the event ring */
+#define NL_URING_UDATA_WAKE ((__u64)-2)
+/* Buffer group of the buffers provided to the event sockets */
+#define NL_URING_EVENT_BGID 0
+
+typedef struct {
+    int sock;
+    void *context;
+    bool active;            /* socket on the ring, cleared when removed */
+    bool armed;             /* receive submitted to the kernel and not stopped */
+    bool arm;               /* receive to be submitted by the next wait */
+    bool cancel;            /* receive to be cancelled by the next wait */
+} nl_uring_slot_t;
+
+/* Event ring - only the event thread submits and waits (DEFER_TASKRUN, the datagrams are
+ * received only while it waits). The slots are protected by the mutex since the sockets
+ * are added and removed by the VRF handling threads, which wake up the event thread with
+ * the eventfd for their change to be submitted. */
+static nl_uring_t nl_evt_ring = { .fd = -1 };
+static pthread_mutex_t nl_evt_mutex = PTHREAD_MUTEX_INITIALIZER;
+static nl_uring_slot_t nl_evt_slots[NL_URING_MAX_SOCKS];
+static bool nl_evt_changed = false;
+static int nl_evt_wake_fd = -1;
+static bool nl_evt_wake_armed = false;
+/* Provided buffers, event thread only */
+static struct io_uring_buf_ring *nl_evt_buf_ring = NULL;
+static char *nl_evt_buffs = NULL;
+static unsigned int nl_evt_buffs_out = 0;       /* buffers taken by the received datagrams */
+/* Address and control message reserved in front of each datagram */
+static struct msghdr nl_evt_msg_template = {
+    .msg_namelen = sizeof(struct sockaddr_nl),
+    .msg_controllen = NL_EVENT_RING_CMSG_LEN,
+};
+
+static int nl_uring_register(int fd, unsigned int opcode, void *arg, unsigned int nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void nl_uring_buff_recycle(int bid) {
+    struct io_uring_buf *buf = &nl_evt_buf_ring->bufs[nl_evt_buf_ring->tail & (NL_URING_EVENT_BUFFS - 1)];
+    buf->addr = (__u64)(uintptr_t)(nl_evt_buffs + ((size_t)bid * NL_URING_EVENT_BUFF_LEN));
+    buf->len = NL_URING_EVENT_BUFF_LEN;
+    buf->bid = (__u16)bid;
+    __atomic_store_n(&nl_evt_buf_ring->tail, nl_evt_buf_ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+static void nl_uring_event_cleanup(void) {
+    nl_uring_destroy(&nl_evt_ring);
+    if (nl_evt_wake_fd != -1) close(nl_evt_wake_fd);
+    nl_evt_wake_fd = -1;
+    free(nl_evt_buf_ring);
+    nl_evt_buf_ring = NULL;
+    free(nl_evt_buffs);
+    nl_evt_buffs = NULL;
+}
+
+bool nl_uring_event_init(void) {
+    if (!nl_uring_enabled()) return false;
+    if (nl_evt_ring.fd >= 0) return true;
+
+    /* Created by the thread that waits on it, the receives run in its wait only */
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_CQSIZE;
+    p.cq_entries = NL_URING_MAX_EVENTS * 2;
+    memset(&nl_evt_ring, 0, sizeof(nl_evt_ring));
+    nl_evt_ring.fd = nl_uring_setup(NL_URING_EVENT_ENTRIES, &p);
+    if (nl_evt_ring.fd < 0) {
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "Event ring setup failed errno %d, using epoll", errno);
+        nl_evt_ring.fd = -1;
+        return false;
+    }
+    if (!nl_uring_map(&nl_evt_ring, &p)) {
+        nl_uring_event_cleanup();
+        return false;
+    }
+
+    if ((posix_memalign((void **)&nl_evt_buf_ring, 4096,
+                        NL_URING_EVENT_BUFFS * sizeof(struct io_uring_buf)) != 0) ||
+        (posix_memalign((void **)&nl_evt_buffs, 4096,
+                        (size_t)NL_URING_EVENT_BUFFS * NL_URING_EVENT_BUFF_LEN) != 0)) {
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "Failed to allocate the event buffers");
+        nl_uring_event_cleanup();
+        return false;
+    }
+    memset(nl_evt_buf_ring, 0, NL_URING_EVENT_BUFFS * sizeof(struct io_uring_buf));
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (__u64)(uintptr_t)nl_evt_buf_ring;
+    reg.ring_entries = NL_URING_EVENT_BUFFS;
+    reg.bgid = NL_URING_EVENT_BGID;
+    if (nl_uring_register(nl_evt_ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "Event buffers not supported errno %d, using epoll", errno);
+        nl_uring_event_cleanup();
+        return false;
+    }
+    int bid = 0;
+    for ( ; bid < NL_URING_EVENT_BUFFS; ++bid) {
+        nl_uring_buff_recycle(bid);
+    }
+    nl_evt_buffs_out = 0;
+
+    nl_evt_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (nl_evt_wake_fd == -1) {
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "Failed to create the eventfd errno %d", errno);
+        nl_uring_event_cleanup();
+        return false;
+    }
+    nl_evt_wake_armed = false;
+    EV_LOGGING(NETLINK, INFO, "NL-URING", "Using io_uring for the netlink events");
+    return true;
+}
+
+static void nl_uring_event_wake(void) {
+    uint64_t val = 1;
+    if (write(nl_evt_wake_fd, &val, sizeof(val)) != sizeof(val)) {
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "Failed to wake up the event thread errno %d", errno);
+    }
+}
+
+bool nl_uring_event_add(int sock, void *context) {
+    if (nl_evt_ring.fd < 0) return false;
+
+    pthread_mutex_lock(&nl_evt_mutex);
+    /* A slot is free once its receive has stopped, the socket can be closed before */
+    uint32_t ix = 0;
+    for ( ; (ix < NL_URING_MAX_SOCKS) && (nl_evt_slots[ix].active || nl_evt_slots[ix].armed); ++ix);
+    if (ix < NL_URING_MAX_SOCKS) {
+        nl_uring_slot_t *slot = &nl_evt_slots[ix];
+        memset(slot, 0, sizeof(*slot));
+        slot->sock = sock;
+        slot->context = context;
+        slot->active = true;
+        slot->arm = true;
+        nl_evt_changed = true;
+    }
+    pthread_mutex_unlock(&nl_evt_mutex);
+
+    if (ix == NL_URING_MAX_SOCKS) {
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "Event ring full, sock %d not added", sock);
+        return false;
+    }
+    nl_uring_event_wake();
+    return true;
+}
+
+void nl_uring_event_del(int sock) {
+    if (nl_evt_ring.fd < 0) return;
+
+    bool changed = false;
+    pthread_mutex_lock(&nl_evt_mutex);
+    uint32_t ix = 0;
+    for ( ; ix < NL_URING_MAX_SOCKS; ++ix) {
+        nl_uring_slot_t *slot = &nl_evt_slots[ix];
+        if (!slot->active || (slot->sock != sock)) continue;
+        slot->active = false;
+        slot->arm = false;
+        /* Slot is freed when the cancelled receive stops */
+        slot->cancel = slot->armed;
+        changed = slot->cancel;
+    }
+    nl_evt_changed = nl_evt_changed || changed;
+    pthread_mutex_unlock(&nl_evt_mutex);
+
+    if (changed) nl_uring_event_wake();
+}
+
+/* Queue the receives and the cancels of the sockets added and removed, called with the lock */
+static void nl_uring_event_submit_changes(void) {
+    if (!nl_evt_wake_armed) {
+        struct io_uring_sqe *sqe = nl_uring_get_sqe(&nl_evt_ring);
+        if (sqe != NULL) {
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = nl_evt_wake_fd;
+            sqe->poll32_events = POLLIN;
+            sqe->len = IORING_POLL_ADD_MULTI;
+            sqe->user_data = NL_URING_UDATA_WAKE;
+            nl_evt_wake_armed = true;
+        }
+    }
+    if (!nl_evt_changed) return;
+    nl_evt_changed = false;
+
+    uint32_t ix = 0;
+    for ( ; ix < NL_URING_MAX_SOCKS; ++ix) {
+        nl_uring_slot_t *slot = &nl_evt_slots[ix];
+        if (!slot->arm && !slot->cancel) continue;
+        struct io_uring_sqe *sqe = nl_uring_get_sqe(&nl_evt_ring);
+        if (sqe == NULL) {
+            /* Retried by the next wait */
+            nl_evt_changed = true;
+            break;
+        }
+        if (slot->cancel) {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = ix;
+            sqe->user_data = NL_URING_UDATA_INTERNAL;
+            slot->cancel = false;
+            continue;
+        }
+        nl_uring_prep_msg(sqe, IORING_OP_RECVMSG, slot->sock, &nl_evt_msg_template, 0, ix);
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = NL_URING_EVENT_BGID;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        slot->arm = false;
+        slot->armed = true;
+    }
+}
+
+/* Fill the event with the datagram received in the buffer */
+static void nl_uring_event_datagram(nl_uring_event_t *event, int bid, int res) {
+    char *buff = nl_evt_buffs + ((size_t)bid * NL_URING_EVENT_BUFF_LEN);
+    struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)buff;
+    size_t hdr_len = sizeof(*out) + nl_evt_msg_template.msg_namelen + nl_evt_msg_template.msg_controllen;
+
+    memset(&event->msg, 0, sizeof(event->msg));
+    event->msg.msg_name = buff + sizeof(*out);
+    event->msg.msg_namelen = out->namelen;
+    event->msg.msg_control = (char *)event->msg.msg_name + nl_evt_msg_template.msg_namelen;
+    event->msg.msg_controllen = out->controllen;
+    event->msg.msg_flags = out->flags;
+    event->buff = buff + hdr_len;
+    event->res = ((size_t)res > hdr_len) ? (int)(res - hdr_len) : 0;
+    event->bid = bid;
+}
+
+size_t nl_uring_event_wait(nl_uring_event_t *events, size_t max_events, unsigned int timeout_msec) {
+    if (nl_evt_ring.fd < 0) return 0;
+
+    pthread_mutex_lock(&nl_evt_mutex);
+    nl_uring_event_submit_changes();
+    pthread_mutex_unlock(&nl_evt_mutex);
+
+    /* Submit and wait in one system call */
+    struct __kernel_timespec ts = { .tv_sec = timeout_msec / 1000,
+                                    .tv_nsec = (long long)(timeout_msec % 1000) * 1000000 };
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (__u64)(uintptr_t)&ts;
+    unsigned int head = *nl_evt_ring.cq_head;
+    unsigned int min_complete = (head == __atomic_load_n(nl_evt_ring.cq_tail, __ATOMIC_ACQUIRE)) ? 1 : 0;
+    if ((nl_uring_submit(&nl_evt_ring, min_complete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                         &arg, sizeof(arg)) < 0) && (errno != ETIME) && (errno != EINTR)) {
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "Event ring wait failed errno %d", errno);
+    }
+
+    size_t count = 0;
+    pthread_mutex_lock(&nl_evt_mutex);
+    unsigned int tail = __atomic_load_n(nl_evt_ring.cq_tail, __ATOMIC_ACQUIRE);
+    for ( ; (head != tail) && (count < max_events); ++head) {
+        struct io_uring_cqe *cqe = &nl_evt_ring.cqes[head & *nl_evt_ring.cq_mask];
+        bool more = (cqe->flags & IORING_CQE_F_MORE);
+        int bid = (cqe->flags & IORING_CQE_F_BUFFER) ? (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT) : -1;
+        if (bid >= 0) nl_evt_buffs_out++;
+
+        if (cqe->user_data == NL_URING_UDATA_WAKE) {
+            /* Clear the eventfd for the next wake up */
+            uint64_t val = 0;
+            if ((read(nl_evt_wake_fd, &val, sizeof(val)) < 0) && (errno != EAGAIN)) {
+                EV_LOGGING(NETLINK, ERR, "NL-URING", "Failed to read the eventfd errno %d", errno);
+            }
+            if (!more) nl_evt_wake_armed = false;
+            continue;
+        }
+        if (cqe->user_data >= NL_URING_MAX_SOCKS) continue;
+
+        uint32_t ix = (uint32_t)cqe->user_data;
+        nl_uring_slot_t *slot = &nl_evt_slots[ix];
+        if (!more) {
+            slot->armed = false;
+            if (slot->active) {
+                slot->arm = true;
+                nl_evt_changed = true;
+            }
+        }
+        bool exhausted = ((cqe->res == -ENOBUFS) && (nl_evt_buffs_out >= NL_URING_EVENT_BUFFS));
+        if (!slot->active || exhausted) {
+            /* Dropped, or no buffer left - the datagrams are still queued on the socket
+             * and are received once the receive is submitted again */
+            if (bid >= 0) {
+                nl_uring_buff_recycle(bid);
+                nl_evt_buffs_out--;
+            }
+            continue;
+        }
+
+        nl_uring_event_t *event = &events[count++];
+        event->context = slot->context;
+        event->sock = slot->sock;
+        if ((bid >= 0) && (cqe->res >= 0)) {
+            nl_uring_event_datagram(event, bid, cqe->res);
+        } else {
+            if (bid >= 0) {
+                nl_uring_buff_recycle(bid);
+                nl_evt_buffs_out--;
+            }
+            memset(&event->msg, 0, sizeof(event->msg));
+            event->res = (cqe->res < 0) ? cqe->res : -EIO;
+            event->buff = NULL;
+            event->bid = -1;
+        }
+    }
+    __atomic_store_n(nl_evt_ring.cq_head, head, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&nl_evt_mutex);
+    return count;
+}
+
+void nl_uring_event_done(const nl_uring_event_t *events, size_t count) {
+    size_t ix = 0;
+    for ( ; ix < count; ++ix) {
+        if (events[ix].bid < 0) continue;
+        nl_uring_buff_recycle(events[ix].bid);
+        nl_evt_buffs_out--;
+    }
+}
+
+#else
+
+/* Multishot receives with provided buffers are not supported by the build headers */
+
+bool nl_uring_event_init(void) {
+    return false;
+}
+
+bool nl_uring_event_add(int sock, void *context) {
+    return false;
+}
+
+void nl_uring_event_del(int sock) {
+}
+
+size_t nl_uring_event_wait(nl_uring_event_t *events, size_t max_events, unsigned int timeout_msec) {
+    return 0;
+}
+
+void nl_uring_event_done(const nl_uring_event_t *events, size_t count) {
+}
+
+#endif
+
+/* Request ring of the thread - send, receive and the receive timeout */
+static __thread nl_uring_t nl_req_ring = { .fd = -1 };
+
+bool nl_uring_send_recv(int sock, struct msghdr *send_msg, struct msghdr *recv_msg, int recv_flags,
+                        int *recv_len) {
+    if (!nl_uring_enabled() ||
+        ((nl_req_ring.fd < 0) && !nl_uring_create(&nl_req_ring, 4))) {
+        errno = ENOSYS;
+        return false;
+    }
+
+    size_t send_len = 0;
+    size_t ix = 0;
+    for ( ; ix < send_msg->msg_iovlen; ++ix) {
+        send_len += send_msg->msg_iov[ix].iov_len;
+    }
+    struct __kernel_timespec ts = { .tv_sec = NL_RECV_TIMEOUT_SEC, .tv_nsec = 0 };
+
+    struct io_uring_sqe *sqe = nl_uring_get_sqe(&nl_req_ring);
+    nl_uring_prep_msg(sqe, IORING_OP_SENDMSG, sock, send_msg, 0, 0);
+    sqe->flags |= IOSQE_IO_LINK;
+    sqe = nl_uring_get_sqe(&nl_req_ring);
+    nl_uring_prep_msg(sqe, IORING_OP_RECVMSG, sock, recv_msg, recv_flags, 1);
+    sqe->flags |= IOSQE_IO_LINK;
+    sqe = nl_uring_get_sqe(&nl_req_ring);
+    sqe->opcode = IORING_OP_LINK_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (__u64)(uintptr_t)&ts;
+    sqe->len = 1;
+    sqe->user_data = NL_URING_UDATA_INTERNAL;
+
+    if (nl_uring_submit(&nl_req_ring, 3, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+        /* The ring state is unknown, create a new one for the next request */
+        int err = errno;
+        EV_LOGGING(NETLINK, ERR, "NL-URING", "Request ring submit failed sock %d errno %d", sock, err);
+        nl_uring_destroy(&nl_req_ring);
+        errno = err;
+        return false;
+    }
+
+    int send_res = -ECANCELED;
+    int recv_res = -ECANCELED;
+    unsigned int done = 0;
+    while (done < 3) {
+        unsigned int head = *nl_req_ring.cq_head;
+        unsigned int tail = __atomic_load_n(nl_req_ring.cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if ((nl_uring_enter(nl_req_ring.fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) &&
+                (errno != EINTR)) {
+                int err = errno;
+                nl_uring_destroy(&nl_req_ring);
+                errno = err;
+                return false;
+            }
+            continue;
+        }
+        for ( ; head != tail; ++head, ++done) {
+            struct io_uring_cqe *cqe = &nl_req_ring.cqes[head & *nl_req_ring.cq_mask];
+            if (cqe->user_data == 0) send_res = cqe->res;
+            else if (cqe->user_data == 1) recv_res = cqe->res;
+        }
+        __atomic_store_n(nl_req_ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    if ((send_res < 0) || ((size_t)send_res != send_len)) {
+        errno = (send_res < 0) ? -send_res : EIO;
+        return false;
+    }
+    if (recv_res < 0) {
+        /* Receive is cancelled by the linked timeout */
+        errno = (recv_res == -ECANCELED) ? EAGAIN : -recv_res;
+        return false;
+    }
+    *recv_len = recv_res;
+    return true;
+}
+
+#else
+
+/* io_uring is not supported by the build headers - the classic path is used */
+
+bool nl_uring_enabled(void) {
+    return false;
+}
+
+bool nl_uring_event_init(void) {
+    return false;
+}
+
+bool nl_uring_event_add(int sock, void *context) {
+    return false;
+}
+
+void nl_uring_event_del(int sock) {
+}
+
+size_t nl_uring_event_wait(nl_uring_event_t *events, size_t max_events, unsigned int timeout_msec) {
+    return 0;
+}
+
+void nl_uring_event_done(const nl_uring_event_t *events, size_t count) {
+}
+
+bool nl_uring_send_recv(int sock, struct msghdr *send_msg, struct msghdr *recv_msg, int recv_flags,
+                        int *recv_len) {
+    errno = ENOSYS;
+    return false;
+}
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_async.h"
+#include "netlink_transport.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <gtest/gtest.h>
+
+#define ASYNC_TEST_WAIT_MS 2000
+
+/* Transport that keeps the requests, the test answers them on the other end of the
+ * socket pair in any order */
+static std::mutex _mutex;
+static std::vector<struct nlmsghdr> _sent;
+static int _peer = -1;
+
+static int test_sock_get(const char *vrf_name, nas_nl_sock_TYPES type) {
+    int socks[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, socks) != 0) return -1;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_peer != -1) close(_peer);
+    _peer = socks[1];
+    return socks[0];
+}
+
+static void test_sock_put(const char *vrf_name, nas_nl_sock_TYPES type, int sock, bool sock_err) {
+    if (sock != -1) close(sock);
+}
+
+static ssize_t test_send(int sock, const struct msghdr *msg, int flags) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _sent.push_back(*(struct nlmsghdr *)msg->msg_iov[0].iov_base);
+    return msg->msg_iov[0].iov_len;
+}
+
+static const nl_transport_t test_transport = { "test", test_sock_get, test_sock_put, test_send };
+
+/* Result of each request, by context */
+static std::map<size_t, int> _results;
+
+static void record_result(void *context, int error_code) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _results[(size_t)context] = error_code;
+}
+
+static size_t sent_count() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _sent.size();
+}
+
+static bool wait_sent(size_t count) {
+    for (int ms = 0; ms < ASYNC_TEST_WAIT_MS; ++ms) {
+        if (sent_count() >= count) return true;
+        usleep(1000);
+    }
+    return false;
+}
+
+/* ACK (or error) of the request with the given sequence number */
+static void answer(uint32_t seq, int err) {
+    char buff[NLMSG_SPACE(sizeof(struct nlmsgerr))];
+    memset(buff, 0, sizeof(buff));
+    struct nlmsghdr *hdr = (struct nlmsghdr *)buff;
+    hdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct nlmsgerr));
+    hdr->nlmsg_type = NLMSG_ERROR;
+    hdr->nlmsg_seq = seq;
+    ((struct nlmsgerr *)NLMSG_DATA(hdr))->error = -err;
+    int peer;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        peer = _peer;
+    }
+    ASSERT_EQ(send(peer, buff, sizeof(buff), 0), (ssize_t)sizeof(buff));
+}
+
+static void submit(size_t context) {
+    char buff[NLMSG_SPACE(sizeof(struct rtmsg))];
+    memset(buff, 0, sizeof(buff));
+    struct nlmsghdr *hdr = (struct nlmsghdr *)buff;
+    hdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    hdr->nlmsg_type = RTM_NEWROUTE;
+    hdr->nlmsg_flags = NLM_F_REQUEST;
+    ASSERT_EQ(nl_async_submit(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, hdr, record_result,
+                              (void *)context), STD_ERR_OK);
+}
+
+class nas_nl_async_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        nl_transport_set(&test_transport);
+        _sent.clear();
+        _results.clear();
+    }
+    void TearDown() override {
+        nl_transport_set(nullptr);
+    }
+};
+
+TEST_F(nas_nl_async_test, dispatch_by_seq) {
+    for (size_t ix = 0; ix < 3; ++ix) submit(ix);
+    ASSERT_TRUE(wait_sent(3));
+    for (auto &hdr : _sent) {
+        ASSERT_TRUE(hdr.nlmsg_flags & NLM_F_ACK);
+    }
+    ASSERT_NE(_sent[0].nlmsg_seq, _sent[1].nlmsg_seq);
+    ASSERT_NE(_sent[1].nlmsg_seq, _sent[2].nlmsg_seq);
+
+    /* Answers are given to the request of their sequence number, in any order, the
+     * answer of an unknown sequence number is ignored */
+    answer(_sent[2].nlmsg_seq, EEXIST);
+    answer(_sent[2].nlmsg_seq + 1000, EINVAL);
+    answer(_sent[0].nlmsg_seq, 0);
+    answer(_sent[1].nlmsg_seq, ENOENT);
+    nl_async_flush();
+
+    std::map<size_t, int> expected = { { 0, 0 }, { 1, ENOENT }, { 2, EEXIST } };
+    ASSERT_EQ(_results, expected);
+}
+
+TEST_F(nas_nl_async_test, window) {
+    for (size_t ix = 0; ix <= NL_ASYNC_MAX_OUTSTANDING; ++ix) submit(ix);
+
+    /* Requests above the window wait for an ACK */
+    ASSERT_TRUE(wait_sent(NL_ASYNC_MAX_OUTSTANDING));
+    usleep(10000);
+    ASSERT_EQ(sent_count(), (size_t)NL_ASYNC_MAX_OUTSTANDING);
+
+    answer(_sent[0].nlmsg_seq, 0);
+    ASSERT_TRUE(wait_sent(NL_ASYNC_MAX_OUTSTANDING + 1));
+    for (size_t ix = 1; ix <= NL_ASYNC_MAX_OUTSTANDING; ++ix) {
+        answer(_sent[ix].nlmsg_seq, (ix == NL_ASYNC_MAX_OUTSTANDING) ? EBUSY : 0);
+    }
+    nl_async_flush();
+
+    ASSERT_EQ(_results.size(), (size_t)NL_ASYNC_MAX_OUTSTANDING + 1);
+    ASSERT_EQ(_results[0], 0);
+    ASSERT_EQ(_results[NL_ASYNC_MAX_OUTSTANDING], EBUSY);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
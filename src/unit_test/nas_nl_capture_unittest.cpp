@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_capture.h"
+#include "nas_nlmsg_builder.h"
+
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <unistd.h>
+#include <string.h>
+#include <gtest/gtest.h>
+
+static const char *capture_file = "/tmp/nas_nl_capture_ut.pcap";
+
+/* Fake event socket fds, only used as the key of the captured sockets */
+static const int cap_sock = 100;
+static const int other_sock = 101;
+
+typedef nas_nl::msg_size<ifinfomsg, nas_nl::attr_len<IFNAMSIZ>, nas_nl::attr<uint32_t>> link_msg_size;
+
+static size_t build_link_msg(nas_nl::msg_buffer<link_msg_size::value> &buff, const char *name) {
+    nas_nl::msg_builder b(buff, RTM_NEWLINK, 0);
+    b.family_header<ifinfomsg>();
+    b.put_str(IFLA_IFNAME, name);
+    b.put(IFLA_MTU, (uint32_t)1500);
+    return b.len();
+}
+
+TEST(nas_nl_capture_test, round_trip) {
+    nas_nl::msg_buffer<link_msg_size::value> m1, m2;
+    size_t len1 = build_link_msg(m1, "e101-001-0");
+    size_t len2 = build_link_msg(m2, "br100");
+
+    nl_capture_sock_add(cap_sock, nas_nl_sock_T_INT);
+    ASSERT_EQ(nl_capture_start(capture_file), STD_ERR_OK);
+    nl_capture_write(cap_sock, NL_CAPTURE_NSID_NONE, NL_DEFAULT_VRF_ID, m1.data, len1);
+    /* Socket not registered for the capture */
+    nl_capture_write(other_sock, NL_CAPTURE_NSID_NONE, NL_DEFAULT_VRF_ID, m1.data, len1);
+    /* Event of the VRF 5 received with its NSID 3 */
+    nl_capture_write(cap_sock, 3, 5, m2.data, len2);
+    nl_capture_stop();
+    /* Not captured once stopped */
+    nl_capture_write(cap_sock, NL_CAPTURE_NSID_NONE, NL_DEFAULT_VRF_ID, m1.data, len1);
+    nl_capture_sock_del(cap_sock);
+
+    nl_capture_reader_t *reader = nl_capture_open(capture_file);
+    ASSERT_NE(reader, nullptr);
+
+    nl_capture_rec_t rec;
+    ASSERT_TRUE(nl_capture_read(reader, &rec));
+    ASSERT_EQ(rec.sock_type, nas_nl_sock_T_INT);
+    ASSERT_EQ(rec.nsid, NL_CAPTURE_NSID_NONE);
+    ASSERT_EQ(rec.vrf_id, (uint32_t)NL_DEFAULT_VRF_ID);
+    ASSERT_EQ(rec.len, len1);
+    ASSERT_EQ(memcmp(rec.data, m1.data, len1), 0);
+    uint64_t ts = rec.ts_nsec;
+
+    ASSERT_TRUE(nl_capture_read(reader, &rec));
+    ASSERT_EQ(rec.sock_type, nas_nl_sock_T_INT);
+    ASSERT_EQ(rec.nsid, 3);
+    ASSERT_EQ(rec.vrf_id, 5u);
+    ASSERT_EQ(rec.len, len2);
+    ASSERT_EQ(memcmp(rec.data, m2.data, len2), 0);
+    ASSERT_GE(rec.ts_nsec, ts);
+
+    ASSERT_FALSE(nl_capture_read(reader, &rec));
+    nl_capture_close(reader);
+    unlink(capture_file);
+}
+
+TEST(nas_nl_capture_test, not_a_capture) {
+    FILE *file = fopen(capture_file, "w");
+    ASSERT_NE(file, nullptr);
+    fputs("not a pcap file, just some text", file);
+    fclose(file);
+
+    ASSERT_EQ(nl_capture_open(capture_file), nullptr);
+    ASSERT_EQ(nl_capture_open("/tmp/nas_nl_capture_ut.missing"), nullptr);
+    unlink(capture_file);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_dispatch.h"
+#include "nas_nlmsg_builder.h"
+#include "nas_nlmsg.h"
+
+#include <linux/if_link.h>
+#include <linux/if_bridge.h>
+#include <linux/netconf.h>
+#include <linux/neighbour.h>
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <gtest/gtest.h>
+
+#define DISPATCH_TEST_WORKERS 4
+#define DISPATCH_TEST_MAX_QUEUED 128
+
+typedef nas_nl::msg_size<rtmsg, nas_nl::attr<uint32_t>, nas_nl::attr<uint32_t>> route_msg_size;
+typedef nas_nl::msg_size<ndmsg, nas_nl::attr<uint32_t>> neigh_msg_size;
+
+/* Route to the prefix, the sequence number of the event is carried as the output interface */
+static void build_route_msg(nas_nl::msg_buffer<route_msg_size::value> &buff, uint32_t prefix, uint32_t seq,
+                            uint16_t type = RTM_NEWROUTE, uint16_t flags = 0) {
+    nas_nl::msg_builder b(buff, type, flags);
+    rtmsg *rm = b.family_header<rtmsg>();
+    rm->rtm_family = AF_INET;
+    rm->rtm_dst_len = 32;
+    rm->rtm_table = RT_TABLE_MAIN;
+    b.put(RTA_DST, prefix);
+    b.put(RTA_OIF, seq);
+}
+
+typedef struct {
+    int type;
+    uint32_t seq;
+    uint16_t flags;
+} route_event_t;
+
+static std::mutex _seen_mutex;
+static auto seen = new std::map<uint32_t, std::vector<route_event_t>>;
+
+/* Worker processing the gate prefix blocks until it is released */
+#define GATE_PREFIX 0x0b000000
+static std::mutex _gate_mutex;
+static std::condition_variable _gate_cond;
+static bool _gate_closed = false;
+static bool _gate_held = false;
+
+static void gate_wait() {
+    std::unique_lock<std::mutex> lock(_gate_mutex);
+    _gate_held = true;
+    _gate_cond.notify_all();
+    _gate_cond.wait(lock, [] { return !_gate_closed; });
+    _gate_held = false;
+}
+
+/* Wait until a worker is blocked on the gate, its lane has nothing else taken */
+static bool wait_gate_held() {
+    std::unique_lock<std::mutex> lock(_gate_mutex);
+    return _gate_cond.wait_for(lock, std::chrono::seconds(5), [] { return _gate_held; });
+}
+
+/* Links and netconf are recorded by type, the link of the gate index blocks */
+#define GATE_IFINDEX 1000
+static auto seen_intf = new std::vector<int>;
+
+static bool record_intf(int rt_msg_type, struct nlmsghdr *hdr) {
+    if (rt_msg_type == RTM_NEWLINK) {
+        struct ifinfomsg *ifi = (struct ifinfomsg *)NLMSG_DATA(hdr);
+        if (ifi->ifi_index == GATE_IFINDEX) {
+            gate_wait();
+            return true;
+        }
+    }
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    seen_intf->push_back(rt_msg_type);
+    return true;
+}
+
+static bool record_route(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    if ((rt_msg_type < RTM_NEWROUTE) || (rt_msg_type > RTM_GETROUTE)) return record_intf(rt_msg_type, hdr);
+    struct rtattr *rta = RTM_RTA(NLMSG_DATA(hdr));
+    int len = RTM_PAYLOAD(hdr);
+    uint32_t prefix = *(uint32_t *)RTA_DATA(rta);
+    rta = RTA_NEXT(rta, len);
+    uint32_t seq = *(uint32_t *)RTA_DATA(rta);
+    if (prefix == htonl(GATE_PREFIX)) {
+        gate_wait();
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    (*seen)[prefix].push_back({rt_msg_type, seq, hdr->nlmsg_flags});
+    return true;
+}
+
+TEST(nas_nl_dispatch_test, lane) {
+    nas_nl::msg_buffer<route_msg_size::value> r1, r2;
+    build_route_msg(r1, htonl(0x0a000001), 1);
+    build_route_msg(r2, htonl(0x0a000001), 2);
+
+    /* Same prefix on the same lane, off the interface lane */
+    size_t lane = nl_dispatch_lane(RTM_NEWROUTE, (struct nlmsghdr *)r1.data, 0, DISPATCH_TEST_WORKERS);
+    ASSERT_NE(lane, (size_t)NL_DISPATCH_LANE_INTF);
+    ASSERT_LT(lane, (size_t)DISPATCH_TEST_WORKERS);
+    ASSERT_EQ(nl_dispatch_lane(RTM_DELROUTE, (struct nlmsghdr *)r2.data, 0, DISPATCH_TEST_WORKERS), lane);
+    ASSERT_EQ(nl_dispatch_lane(RTM_NEWROUTE, (struct nlmsghdr *)r1.data, 0, 1), (size_t)NL_DISPATCH_LANE_INTF);
+
+    /* Prefixes are spread over all the route lanes */
+    std::vector<bool> used(DISPATCH_TEST_WORKERS, false);
+    for (uint32_t ix = 0; ix < 256; ++ix) {
+        build_route_msg(r1, htonl(0x0a000000 + ix), 0);
+        used[nl_dispatch_lane(RTM_NEWROUTE, (struct nlmsghdr *)r1.data, 0, DISPATCH_TEST_WORKERS)] = true;
+    }
+    for (size_t ix = 1; ix < DISPATCH_TEST_WORKERS; ++ix) ASSERT_TRUE(used[ix]);
+
+    nas_nl::msg_buffer<neigh_msg_size::value> nbuff;
+    nas_nl::msg_builder nb(nbuff, RTM_NEWNEIGH, 0);
+    ndmsg *nd = nb.family_header<ndmsg>();
+    nd->ndm_family = AF_INET;
+    nd->ndm_ifindex = 10;
+    nb.put(NDA_DST, htonl(0x0a000001));
+    ASSERT_NE(nl_dispatch_lane(RTM_NEWNEIGH, nb.msg(), 0, DISPATCH_TEST_WORKERS), (size_t)NL_DISPATCH_LANE_INTF);
+
+    /* Links are kept on the interface lane */
+    nas_nl::msg_buffer<nas_nl::msg_size<ifinfomsg>::value> lbuff;
+    nas_nl::msg_builder lb(lbuff, RTM_NEWLINK, 0);
+    lb.family_header<ifinfomsg>()->ifi_index = 10;
+    ASSERT_EQ(nl_dispatch_lane(RTM_NEWLINK, lb.msg(), 0, DISPATCH_TEST_WORKERS), (size_t)NL_DISPATCH_LANE_INTF);
+
+    /* MDB entries of a bridge are kept off the interface lane */
+    nas_nl::msg_buffer<nas_nl::msg_size<br_port_msg>::value> mbuff;
+    nas_nl::msg_builder mb(mbuff, RTM_NEWMDB, 0);
+    mb.family_header<br_port_msg>()->ifindex = 10;
+    ASSERT_NE(nl_dispatch_lane(RTM_NEWMDB, mb.msg(), 0, DISPATCH_TEST_WORKERS), (size_t)NL_DISPATCH_LANE_INTF);
+}
+
+TEST(nas_nl_dispatch_test, prio) {
+    ASSERT_EQ(nl_dispatch_prio(RTM_NEWLINK), NL_DISPATCH_PRIO_HIGH);
+    ASSERT_EQ(nl_dispatch_prio(RTM_DELLINK), NL_DISPATCH_PRIO_HIGH);
+    ASSERT_EQ(nl_dispatch_prio(RTM_NEWADDR), NL_DISPATCH_PRIO_HIGH);
+    ASSERT_EQ(nl_dispatch_prio(RTM_NEWROUTE), NL_DISPATCH_PRIO_LOW);
+    ASSERT_EQ(nl_dispatch_prio(RTM_NEWNEIGH), NL_DISPATCH_PRIO_LOW);
+    ASSERT_EQ(nl_dispatch_prio(RTM_NEWMDB), NL_DISPATCH_PRIO_LOW);
+    ASSERT_EQ(nl_dispatch_prio(RTM_NEWNETCONF), NL_DISPATCH_PRIO_LOW);
+}
+
+TEST(nas_nl_dispatch_test, order_per_key) {
+    ASSERT_EQ(nl_dispatch_init(record_route), STD_ERR_OK);
+    ASSERT_EQ(nl_dispatch_workers(), (size_t)DISPATCH_TEST_WORKERS);
+
+    const uint32_t prefixes = 64;
+    const uint32_t events = 100;
+    nas_nl::msg_buffer<route_msg_size::value> buff;
+    char vrf_name[] = "default";
+    for (uint32_t seq = 0; seq < events; ++seq) {
+        for (uint32_t ix = 0; ix < prefixes; ++ix) {
+            build_route_msg(buff, htonl(0x0a000000 + ix), seq);
+            ASSERT_TRUE(nl_dispatch_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+        }
+    }
+    nl_dispatch_drain();
+
+    /* Queued events of a prefix can be coalesced, the ones processed are in order
+     * and the last one is always processed */
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    ASSERT_EQ(seen->size(), prefixes);
+    for (auto &it : *seen) {
+        ASSERT_FALSE(it.second.empty());
+        for (size_t ix = 1; ix < it.second.size(); ++ix) ASSERT_LT(it.second[ix-1].seq, it.second[ix].seq);
+        ASSERT_EQ(it.second.back().seq, events - 1);
+    }
+    seen->clear();
+}
+
+TEST(nas_nl_dispatch_test, coalesce) {
+    ASSERT_EQ(nl_dispatch_init(record_route), STD_ERR_OK);
+    nas_nl::msg_buffer<route_msg_size::value> buff;
+    char vrf_name[] = "default";
+
+    /* Hold the lane of the test prefixes so that their events are queued */
+    build_route_msg(buff, htonl(GATE_PREFIX), 0);
+    size_t lane = nl_dispatch_lane(RTM_NEWROUTE, (struct nlmsghdr *)buff.data, 0, DISPATCH_TEST_WORKERS);
+    std::vector<uint32_t> prefixes;
+    for (uint32_t ix = 1; prefixes.size() < 2; ++ix) {
+        nas_nl::msg_buffer<route_msg_size::value> p;
+        build_route_msg(p, htonl(0x0c000000 + ix), 0);
+        if (nl_dispatch_lane(RTM_NEWROUTE, (struct nlmsghdr *)p.data, 0, DISPATCH_TEST_WORKERS) == lane) {
+            prefixes.push_back(htonl(0x0c000000 + ix));
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(_gate_mutex);
+        _gate_closed = true;
+    }
+    ASSERT_TRUE(nl_dispatch_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+
+    nl_dispatch_stats_t before;
+    nl_dispatch_stats_get(&before);
+
+    /* Created, deleted (dropped with the create), created and replaced - one create */
+    build_route_msg(buff, prefixes[0], 1);
+    nl_dispatch_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0);
+    build_route_msg(buff, prefixes[0], 2, RTM_DELROUTE);
+    nl_dispatch_msg(-1, RTM_DELROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0);
+    build_route_msg(buff, prefixes[0], 3);
+    nl_dispatch_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0);
+    build_route_msg(buff, prefixes[0], 4, RTM_NEWROUTE, NLM_F_REPLACE);
+    nl_dispatch_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0);
+
+    /* Replaced, deleted and created again - the delete and the create */
+    build_route_msg(buff, prefixes[1], 1, RTM_NEWROUTE, NLM_F_REPLACE);
+    nl_dispatch_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0);
+    build_route_msg(buff, prefixes[1], 2, RTM_DELROUTE);
+    nl_dispatch_msg(-1, RTM_DELROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0);
+    build_route_msg(buff, prefixes[1], 3);
+    nl_dispatch_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(_gate_mutex);
+        _gate_closed = false;
+    }
+    _gate_cond.notify_all();
+    nl_dispatch_drain();
+
+    nl_dispatch_stats_t after;
+    nl_dispatch_stats_get(&after);
+    ASSERT_EQ(after.cancelled - before.cancelled, 1u);
+    ASSERT_EQ(after.coalesced - before.coalesced, 2u);
+    ASSERT_EQ(after.pending, 0u);
+
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    auto &first = (*seen)[prefixes[0]];
+    ASSERT_EQ(first.size(), 1u);
+    ASSERT_EQ(first[0].type, RTM_NEWROUTE);
+    ASSERT_EQ(first[0].seq, 4u);
+    ASSERT_FALSE(first[0].flags & NLM_F_REPLACE);
+
+    auto &second = (*seen)[prefixes[1]];
+    ASSERT_EQ(second.size(), 2u);
+    ASSERT_EQ(second[0].type, RTM_DELROUTE);
+    ASSERT_EQ(second[0].seq, 2u);
+    ASSERT_EQ(second[1].type, RTM_NEWROUTE);
+    ASSERT_EQ(second[1].seq, 3u);
+    seen->clear();
+}
+
+TEST(nas_nl_dispatch_test, high_prio_first) {
+    ASSERT_EQ(nl_dispatch_init(record_route), STD_ERR_OK);
+    char vrf_name[] = "default";
+
+    nas_nl::msg_buffer<nas_nl::msg_size<ifinfomsg>::value> gate, link;
+    nas_nl::msg_builder gb(gate, RTM_NEWLINK, 0);
+    gb.family_header<ifinfomsg>()->ifi_index = GATE_IFINDEX;
+    nas_nl::msg_builder lb(link, RTM_NEWLINK, 0);
+    lb.family_header<ifinfomsg>()->ifi_index = 20;
+    nas_nl::msg_buffer<nas_nl::msg_size<netconfmsg>::value> conf;
+    nas_nl::msg_builder cb(conf, RTM_NEWNETCONF, 0);
+    cb.family_header<netconfmsg>()->ncm_family = AF_INET;
+
+    nl_dispatch_lane_stats_t before;
+    ASSERT_TRUE(nl_dispatch_lane_stats_get(NL_DISPATCH_LANE_INTF, &before));
+    {
+        std::lock_guard<std::mutex> lock(_gate_mutex);
+        _gate_closed = true;
+    }
+    /* Interface lane is held, the link queued after the netconf is processed first */
+    ASSERT_TRUE(nl_dispatch_msg(-1, RTM_NEWLINK, gb.msg(), vrf_name, 0));
+    ASSERT_TRUE(nl_dispatch_msg(-1, RTM_NEWNETCONF, cb.msg(), vrf_name, 0));
+    ASSERT_TRUE(nl_dispatch_msg(-1, RTM_NEWLINK, lb.msg(), vrf_name, 0));
+    {
+        std::lock_guard<std::mutex> lock(_gate_mutex);
+        _gate_closed = false;
+    }
+    _gate_cond.notify_all();
+    nl_dispatch_drain();
+
+    {
+        std::lock_guard<std::mutex> lock(_seen_mutex);
+        ASSERT_EQ(seen_intf->size(), 2u);
+        ASSERT_EQ((*seen_intf)[0], RTM_NEWLINK);
+        ASSERT_EQ((*seen_intf)[1], RTM_NEWNETCONF);
+        seen_intf->clear();
+    }
+
+    nl_dispatch_lane_stats_t after;
+    ASSERT_TRUE(nl_dispatch_lane_stats_get(NL_DISPATCH_LANE_INTF, &after));
+    ASSERT_EQ(after.latency[NL_DISPATCH_PRIO_HIGH].events - before.latency[NL_DISPATCH_PRIO_HIGH].events, 2u);
+    ASSERT_EQ(after.latency[NL_DISPATCH_PRIO_LOW].events - before.latency[NL_DISPATCH_PRIO_LOW].events, 1u);
+    ASSERT_EQ(after.latency[NL_DISPATCH_PRIO_LOW].depth, 0u);
+    ASSERT_FALSE(nl_dispatch_lane_stats_get(DISPATCH_TEST_WORKERS, &after));
+}
+
+TEST(nas_nl_dispatch_test, overload_shed) {
+    ASSERT_EQ(nl_dispatch_init(record_route), STD_ERR_OK);
+    nas_nl::msg_buffer<route_msg_size::value> buff;
+    char vrf_name[] = "default";
+    const int sock = 5;
+
+    /* Hold a route lane and queue more routes than it can take */
+    build_route_msg(buff, htonl(GATE_PREFIX), 0);
+    size_t lane = nl_dispatch_lane(RTM_NEWROUTE, (struct nlmsghdr *)buff.data, 0, DISPATCH_TEST_WORKERS);
+    {
+        std::lock_guard<std::mutex> lock(_gate_mutex);
+        _gate_closed = true;
+    }
+    ASSERT_TRUE(nl_dispatch_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+    ASSERT_TRUE(wait_gate_held());
+
+    nl_dispatch_lane_stats_t before;
+    ASSERT_TRUE(nl_dispatch_lane_stats_get(lane, &before));
+    ASSERT_FALSE(nl_dispatch_dropped(sock));
+    ASSERT_FALSE(nl_dispatch_dropped_any());
+    ASSERT_FALSE(nl_dispatch_overloaded());
+
+    const uint32_t extra = 10;
+    uint32_t sent = 0;
+    for (uint32_t ix = 1; sent < DISPATCH_TEST_MAX_QUEUED + extra; ++ix) {
+        build_route_msg(buff, htonl(0x0d000000 + ix), 0);
+        if (nl_dispatch_lane(RTM_NEWROUTE, (struct nlmsghdr *)buff.data, 0, DISPATCH_TEST_WORKERS) != lane) continue;
+        ASSERT_TRUE(nl_dispatch_msg(sock, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+        ++sent;
+    }
+
+    nl_dispatch_lane_stats_t after;
+    ASSERT_TRUE(nl_dispatch_lane_stats_get(lane, &after));
+    ASSERT_EQ(after.dropped - before.dropped, extra);
+    ASSERT_EQ(after.overloads - before.overloads, 1u);
+    ASSERT_EQ(after.latency[NL_DISPATCH_PRIO_LOW].depth, (uint64_t)DISPATCH_TEST_MAX_QUEUED);
+    ASSERT_TRUE(nl_dispatch_overloaded());
+    /* Socket is reported once for the resync */
+    ASSERT_TRUE(nl_dispatch_dropped_any());
+    ASSERT_TRUE(nl_dispatch_dropped(sock));
+    ASSERT_FALSE(nl_dispatch_dropped(sock));
+    ASSERT_FALSE(nl_dispatch_dropped_any());
+
+    {
+        std::lock_guard<std::mutex> lock(_gate_mutex);
+        _gate_closed = false;
+    }
+    _gate_cond.notify_all();
+    nl_dispatch_drain();
+    /* Lane drained under its low-water mark, the resync can run */
+    ASSERT_FALSE(nl_dispatch_overloaded());
+
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    ASSERT_EQ(seen->size(), (size_t)DISPATCH_TEST_MAX_QUEUED);
+    seen->clear();
+}
+
+TEST(nas_nl_dispatch_test, dump_fence) {
+    ASSERT_EQ(nl_dispatch_init(record_route), STD_ERR_OK);
+    nas_nl::msg_buffer<route_msg_size::value> buff;
+    char vrf_name[] = "default";
+    const uint32_t deleted = htonl(0x0c000001);
+    const uint32_t other = htonl(0x0c000002);
+    const uint32_t other_vrf = htonl(0x0c000003);
+    nl_dispatch_stats_t before;
+    nl_dispatch_stats_get(&before);
+
+    /* Route is deleted while the dump runs, its dumped entry is older than the delete */
+    nl_dispatch_fence_start(0);
+    build_route_msg(buff, deleted, 1, RTM_DELROUTE);
+    ASSERT_TRUE(nl_dispatch_msg(-1, RTM_DELROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+    build_route_msg(buff, deleted, 0);
+    ASSERT_TRUE(nl_dispatch_dump_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+    build_route_msg(buff, other, 0);
+    ASSERT_TRUE(nl_dispatch_dump_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+    /* Events of the other VRFs are not recorded */
+    build_route_msg(buff, other_vrf, 1, RTM_DELROUTE);
+    ASSERT_TRUE(nl_dispatch_msg(-1, RTM_DELROUTE, (struct nlmsghdr *)buff.data, vrf_name, 1));
+    build_route_msg(buff, other_vrf, 0);
+    ASSERT_TRUE(nl_dispatch_dump_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+    nl_dispatch_fence_stop(0);
+    nl_dispatch_drain();
+
+    nl_dispatch_stats_t after;
+    nl_dispatch_stats_get(&after);
+    ASSERT_EQ(after.fenced - before.fenced, 1u);
+    {
+        std::lock_guard<std::mutex> lock(_seen_mutex);
+        ASSERT_EQ((*seen)[deleted].size(), 1u);
+        ASSERT_EQ((*seen)[deleted][0].type, RTM_DELROUTE);
+        ASSERT_EQ((*seen)[other].size(), 1u);
+        ASSERT_EQ((*seen)[other_vrf].size(), 2u);
+        seen->clear();
+    }
+
+    /* Without a fence the dumped entries are queued */
+    build_route_msg(buff, deleted, 2);
+    ASSERT_TRUE(nl_dispatch_dump_msg(-1, RTM_NEWROUTE, (struct nlmsghdr *)buff.data, vrf_name, 0));
+    nl_dispatch_drain();
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    ASSERT_EQ((*seen)[deleted].size(), 1u);
+    ASSERT_EQ((*seen)[deleted][0].seq, 2u);
+    seen->clear();
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  nas_os_nl_config_t cfg;
+  nas_os_nl_config_default(&cfg);
+  cfg.dispatch_workers = 4;
+  cfg.dispatch_max_queued = 128;
+  nas_os_nl_config_set(&cfg);
+
+  return RUN_ALL_TESTS();
+}
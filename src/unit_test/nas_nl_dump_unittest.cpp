@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_dump.h"
+#include "standard_netlink_requests.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+/* Dumps of the default namespace, the loopback has a link, addresses and local routes */
+static bool link_request(int sock, int family, int req_id) {
+    return nl_route_send_get_all(sock, RTM_GETLINK, family, req_id);
+}
+
+static bool route_request(int sock, int family, int req_id) {
+    return nl_route_send_get_all(sock, RTM_GETROUTE, family, req_id);
+}
+
+static bool addr_request(int sock, int family, int req_id) {
+    return nl_route_send_get_all(sock, RTM_GETADDR, family, req_id);
+}
+
+static bool failed_request(int sock, int family, int req_id) {
+    return false;
+}
+
+static std::mutex _seen_mutex;
+static auto seen = new std::vector<int>;
+static auto failed = new std::vector<nas_nl_sock_TYPES>;
+
+/* Handler blocks on the links while the gate is closed */
+static std::mutex _gate_mutex;
+static std::condition_variable _gate_cond;
+static bool _gate_closed = false;
+static bool _gate_held = false;
+
+static bool record_entry(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    if (rt_msg_type == RTM_NEWLINK) {
+        std::unique_lock<std::mutex> lock(_gate_mutex);
+        _gate_held = true;
+        _gate_cond.notify_all();
+        _gate_cond.wait(lock, [] { return !_gate_closed; });
+        _gate_held = false;
+    }
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    seen->push_back(rt_msg_type);
+    return true;
+}
+
+static void record_failed(const char *vrf_name, nas_nl_sock_TYPES type) {
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    failed->push_back(type);
+}
+
+class nas_nl_dump_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(nl_dump_init(record_entry, record_failed), STD_ERR_OK);
+        std::lock_guard<std::mutex> lock(_seen_mutex);
+        seen->clear();
+        failed->clear();
+    }
+};
+
+TEST_F(nas_nl_dump_test, links_first) {
+    nl_dump_stats_t before;
+    nl_dump_stats_get(&before);
+
+    const nl_dump_t dumps[] = {
+        { nas_nl_sock_T_ROUTE, -1, false, route_request, AF_INET },
+        { nas_nl_sock_T_ROUTE, -1, false, route_request, AF_INET6 },
+        { nas_nl_sock_T_INT, -1, false, addr_request, AF_INET },
+        { nas_nl_sock_T_INT, -1, true, link_request, AF_PACKET },
+    };
+    ASSERT_TRUE(nl_dump_vrf(NL_DEFAULT_VRF_NAME, NL_DEFAULT_VRF_ID, dumps, sizeof(dumps)/sizeof(*dumps)));
+    nl_dump_wait();
+
+    nl_dump_stats_t after;
+    nl_dump_stats_get(&after);
+    ASSERT_EQ(after.dumps - before.dumps, 4u);
+    ASSERT_EQ(after.vrfs - before.vrfs, 1u);
+    ASSERT_EQ(after.failed, before.failed);
+    ASSERT_EQ(after.pending, 0u);
+
+    /* All the links are given before the entries referring to them */
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    ASSERT_FALSE(seen->empty());
+    ASSERT_EQ(seen->front(), RTM_NEWLINK);
+    size_t links = 0;
+    while ((links < seen->size()) && ((*seen)[links] == RTM_NEWLINK)) ++links;
+    for (size_t ix = links; ix < seen->size(); ++ix) ASSERT_NE((*seen)[ix], RTM_NEWLINK);
+    ASSERT_LT(links, seen->size());
+}
+
+TEST_F(nas_nl_dump_test, failed) {
+    const nl_dump_t dumps[] = {
+        { nas_nl_sock_T_NEI, -1, false, failed_request, AF_INET },
+    };
+    ASSERT_TRUE(nl_dump_vrf(NL_DEFAULT_VRF_NAME, NL_DEFAULT_VRF_ID, dumps, 1));
+    nl_dump_wait();
+
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    ASSERT_EQ(failed->size(), 1u);
+    ASSERT_EQ(failed->front(), nas_nl_sock_T_NEI);
+}
+
+TEST_F(nas_nl_dump_test, cancel) {
+    {
+        std::lock_guard<std::mutex> lock(_gate_mutex);
+        _gate_closed = true;
+    }
+    const nl_dump_t dumps[] = {
+        { nas_nl_sock_T_INT, -1, true, link_request, AF_PACKET },
+        { nas_nl_sock_T_ROUTE, -1, false, route_request, AF_INET },
+    };
+    ASSERT_TRUE(nl_dump_vrf(NL_DEFAULT_VRF_NAME, NL_DEFAULT_VRF_ID, dumps, 2));
+    {
+        std::unique_lock<std::mutex> lock(_gate_mutex);
+        ASSERT_TRUE(_gate_cond.wait_for(lock, std::chrono::seconds(5), [] { return _gate_held; }));
+    }
+
+    /* Route dump held for the links is dropped, the cancel waits for the link dump */
+    std::thread canceller([] { nl_dump_cancel(NL_DEFAULT_VRF_NAME); });
+    nl_dump_stats_t stats;
+    do {
+        usleep(1000);
+        nl_dump_stats_get(&stats);
+    } while (stats.pending != 1);
+    {
+        std::lock_guard<std::mutex> lock(_gate_mutex);
+        _gate_closed = false;
+    }
+    _gate_cond.notify_all();
+    canceller.join();
+    nl_dump_wait();
+
+    std::lock_guard<std::mutex> lock(_seen_mutex);
+    for (auto type : *seen) ASSERT_EQ(type, RTM_NEWLINK);
+    ASSERT_TRUE(failed->empty());
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  nas_os_nl_config_t cfg;
+  nas_os_nl_config_default(&cfg);
+  cfg.dump_threads = 4;
+  nas_os_nl_config_set(&cfg);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_tools.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+#include <vector>
+#include <gtest/gtest.h>
+
+#define RING_TEST_VRF_ID 5
+#define RING_TEST_DEPTH 4
+
+/* Sequence numbers of the messages given to the handler */
+static std::vector<uint32_t> _seen;
+static uint32_t _stop_seq = 0;
+
+static bool record_msg(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    if (vrf_id != RING_TEST_VRF_ID) return false;
+    _seen.push_back(hdr->nlmsg_seq);
+    return hdr->nlmsg_seq != _stop_seq;
+}
+
+/* Datagram of the messages with the given sequence numbers, a message of error if
+ * err is not 0 */
+static std::vector<char> datagram(const std::vector<uint32_t> &seqs, int err = 0, size_t pad = 0) {
+    std::vector<char> buff;
+    for (auto seq : seqs) {
+        size_t len = NLMSG_LENGTH(sizeof(struct ifinfomsg) + pad);
+        std::vector<char> msg(NLMSG_ALIGN(len), 0);
+        struct nlmsghdr *hdr = (struct nlmsghdr *)msg.data();
+        hdr->nlmsg_len = len;
+        hdr->nlmsg_type = RTM_NEWLINK;
+        hdr->nlmsg_seq = seq;
+        buff.insert(buff.end(), msg.begin(), msg.end());
+    }
+    if (err != 0) {
+        std::vector<char> msg(NLMSG_SPACE(sizeof(struct nlmsgerr)), 0);
+        struct nlmsghdr *hdr = (struct nlmsghdr *)msg.data();
+        hdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct nlmsgerr));
+        hdr->nlmsg_type = NLMSG_ERROR;
+        ((struct nlmsgerr *)NLMSG_DATA(hdr))->error = -err;
+        buff.insert(buff.end(), msg.begin(), msg.end());
+    }
+    return buff;
+}
+
+/* Datagrams are queued on a socket pair, the ring reads them as from an event socket */
+class nas_nl_event_ring_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM, 0, socks), 0);
+        ring = nl_event_ring_create(RING_TEST_DEPTH, NL_EVENT_RING_BUFF_LEN);
+        ASSERT_NE(ring, nullptr);
+        _seen.clear();
+        _stop_seq = 0;
+    }
+    void TearDown() override {
+        nl_event_ring_destroy(ring);
+        close(socks[0]);
+        close(socks[1]);
+    }
+    void send_datagram(const std::vector<char> &buff) {
+        ASSERT_EQ(send(socks[1], buff.data(), buff.size(), 0), (ssize_t)buff.size());
+    }
+    size_t receive(int *err) {
+        return netlink_tools_receive_events(socks[0], record_msg, nullptr, ring, err, RING_TEST_VRF_ID);
+    }
+    int socks[2] = { -1, -1 };
+    nl_event_ring_t *ring = nullptr;
+};
+
+TEST_F(nas_nl_event_ring_test, drain_in_order) {
+    for (uint32_t seq = 1; seq <= 10; seq += 2) {
+        send_datagram(datagram({ seq, seq + 1 }));
+    }
+
+    /* Up to the ring depth is read with one call, the messages are processed in order */
+    int err = 0;
+    ASSERT_EQ(receive(&err), (size_t)RING_TEST_DEPTH);
+    ASSERT_EQ(err, 0);
+    ASSERT_EQ(_seen, std::vector<uint32_t>({ 1, 2, 3, 4, 5, 6, 7, 8 }));
+
+    ASSERT_EQ(receive(&err), 1u);
+    ASSERT_EQ(_seen.size(), 10u);
+    ASSERT_EQ(_seen.back(), 10u);
+
+    /* Nothing queued - does not wait */
+    ASSERT_EQ(receive(&err), 0u);
+    ASSERT_EQ(err, 0);
+}
+
+TEST_F(nas_nl_event_ring_test, truncated) {
+    nl_event_ring_destroy(ring);
+    ring = nl_event_ring_create(RING_TEST_DEPTH, 256);
+    ASSERT_NE(ring, nullptr);
+
+    send_datagram(datagram({ 1 }));
+    send_datagram(datagram({ 2 }, 0, 512));
+    send_datagram(datagram({ 3 }));
+
+    /* Datagram larger than the ring buffer is dropped, the others are processed */
+    int err = 0;
+    ASSERT_EQ(receive(&err), 3u);
+    ASSERT_EQ(_seen, std::vector<uint32_t>({ 1, 3 }));
+}
+
+TEST_F(nas_nl_event_ring_test, error_msg) {
+    send_datagram(datagram({ 1 }, EBUSY));
+    send_datagram(datagram({ 2 }));
+
+    /* Error ends its datagram, the next datagrams are processed */
+    int err = 0;
+    ASSERT_EQ(receive(&err), 2u);
+    ASSERT_EQ(err, EBUSY);
+    ASSERT_EQ(_seen, std::vector<uint32_t>({ 1, 2 }));
+}
+
+TEST_F(nas_nl_event_ring_test, handler_stop) {
+    send_datagram(datagram({ 1, 2, 3 }));
+    send_datagram(datagram({ 4 }));
+
+    /* Handler failure ends the messages of its datagram only */
+    _stop_seq = 2;
+    int err = 0;
+    ASSERT_EQ(receive(&err), 2u);
+    ASSERT_EQ(_seen, std::vector<uint32_t>({ 1, 2, 4 }));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
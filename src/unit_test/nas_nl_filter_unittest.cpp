@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_filter.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+#include <vector>
+#include <gtest/gtest.h>
+
+#define RTM_OFF(field) (NLMSG_HDRLEN + offsetof(struct rtmsg, field))
+#define NDM_OFF(field) (NLMSG_HDRLEN + offsetof(struct ndmsg, field))
+#define RTM_ATTR_OFF (NLMSG_HDRLEN + NLMSG_ALIGN(sizeof(struct rtmsg)))
+
+#define RULE(c) { c, sizeof(c)/sizeof(c[0]) }
+
+/* Route message, with a gateway attribute if gw is set */
+static std::vector<char> route_msg(int type, uint8_t family, uint8_t rt_type, uint32_t flags,
+                                   bool gw = false, uint16_t nl_flags = 0) {
+    size_t len = NLMSG_LENGTH(sizeof(struct rtmsg)) + (gw ? RTA_SPACE(sizeof(uint32_t)) : 0);
+    std::vector<char> buff(NLMSG_ALIGN(len), 0);
+    struct nlmsghdr *hdr = (struct nlmsghdr *)buff.data();
+    hdr->nlmsg_len = len;
+    hdr->nlmsg_type = type;
+    hdr->nlmsg_flags = nl_flags;
+    struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA(hdr);
+    rtm->rtm_family = family;
+    rtm->rtm_table = RT_TABLE_MAIN;
+    rtm->rtm_type = rt_type;
+    rtm->rtm_flags = flags;
+    if (gw) {
+        struct rtattr *rta = RTM_RTA(rtm);
+        rta->rta_type = RTA_GATEWAY;
+        rta->rta_len = RTA_LENGTH(sizeof(uint32_t));
+    }
+    return buff;
+}
+
+static std::vector<char> neigh_msg(uint8_t family, uint16_t state) {
+    std::vector<char> buff(NLMSG_SPACE(sizeof(struct ndmsg)), 0);
+    struct nlmsghdr *hdr = (struct nlmsghdr *)buff.data();
+    hdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct ndmsg));
+    hdr->nlmsg_type = RTM_NEWNEIGH;
+    struct ndmsg *ndm = (struct ndmsg *)NLMSG_DATA(hdr);
+    ndm->ndm_family = family;
+    ndm->ndm_state = state;
+    return buff;
+}
+
+/* The program is attached to a socket pair, the filter drops the datagrams as it
+ * does on the netlink event socket */
+class nas_nl_filter_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_DGRAM, 0, socks), 0);
+    }
+    void TearDown() override {
+        close(socks[0]);
+        close(socks[1]);
+    }
+    void attach(const uint16_t *types, size_t n_types, const nl_filter_rule_t *rules, size_t n_rules) {
+        struct sock_filter insns[NL_FILTER_MAX_INSNS];
+        size_t len = 0;
+        ASSERT_TRUE(nl_filter_compile(types, n_types, rules, n_rules, insns, &len));
+        struct sock_fprog fprog = { (unsigned short)len, insns };
+        ASSERT_EQ(setsockopt(socks[0], SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)), 0);
+    }
+    bool accepted(const std::vector<char> &msg) {
+        if (send(socks[1], msg.data(), msg.size(), 0) != (ssize_t)msg.size()) return false;
+        char buff[256];
+        return recv(socks[0], buff, sizeof(buff), MSG_DONTWAIT) == (ssize_t)msg.size();
+    }
+    int socks[2] = { -1, -1 };
+};
+
+static const uint16_t route_types[] = { RTM_NEWROUTE, RTM_DELROUTE };
+
+TEST_F(nas_nl_filter_test, all_conds) {
+    static const nl_filter_cond_t v6_cloned[] = {
+        { RTM_OFF(rtm_family), 1, NL_FILTER_OP_EQ, AF_INET6 },
+        { RTM_OFF(rtm_flags), 4, NL_FILTER_OP_SET, RTM_F_CLONED },
+    };
+    static const nl_filter_rule_t rules[] = { RULE(v6_cloned) };
+    attach(route_types, 2, rules, 1);
+
+    /* Dropped only when every condition of the rule matches */
+    ASSERT_FALSE(accepted(route_msg(RTM_NEWROUTE, AF_INET6, RTN_UNICAST, RTM_F_CLONED)));
+    ASSERT_FALSE(accepted(route_msg(RTM_DELROUTE, AF_INET6, RTN_UNICAST, RTM_F_CLONED | RTM_F_NOTIFY)));
+    ASSERT_TRUE(accepted(route_msg(RTM_NEWROUTE, AF_INET, RTN_UNICAST, RTM_F_CLONED)));
+    ASSERT_TRUE(accepted(route_msg(RTM_NEWROUTE, AF_INET6, RTN_UNICAST, RTM_F_NOTIFY)));
+
+    /* Other message types and the dump responses are accepted */
+    ASSERT_TRUE(accepted(route_msg(RTM_GETROUTE, AF_INET6, RTN_UNICAST, RTM_F_CLONED)));
+    ASSERT_TRUE(accepted(route_msg(RTM_NEWROUTE, AF_INET6, RTN_UNICAST, RTM_F_CLONED, false, NLM_F_MULTI)));
+}
+
+TEST_F(nas_nl_filter_test, rules) {
+    static const nl_filter_cond_t non_ip[] = {
+        { RTM_OFF(rtm_family), 1, NL_FILTER_OP_NE, AF_INET },
+        { RTM_OFF(rtm_family), 1, NL_FILTER_OP_NE, AF_INET6 },
+    };
+    static const nl_filter_cond_t local_no_gw[] = {
+        { RTM_OFF(rtm_type), 1, NL_FILTER_OP_EQ, RTN_LOCAL },
+        { RTM_ATTR_OFF, 0, NL_FILTER_OP_NO_ATTR, RTA_GATEWAY },
+    };
+    static const nl_filter_rule_t rules[] = { RULE(non_ip), RULE(local_no_gw) };
+    attach(route_types, 2, rules, 2);
+
+    /* Dropped when any rule matches */
+    ASSERT_FALSE(accepted(route_msg(RTM_NEWROUTE, AF_BRIDGE, RTN_UNICAST, 0)));
+    ASSERT_TRUE(accepted(route_msg(RTM_NEWROUTE, AF_INET, RTN_UNICAST, 0)));
+    ASSERT_TRUE(accepted(route_msg(RTM_NEWROUTE, AF_INET6, RTN_UNICAST, 0)));
+
+    /* Attribute condition */
+    ASSERT_FALSE(accepted(route_msg(RTM_NEWROUTE, AF_INET, RTN_LOCAL, 0)));
+    ASSERT_TRUE(accepted(route_msg(RTM_NEWROUTE, AF_INET, RTN_LOCAL, 0, true)));
+}
+
+TEST_F(nas_nl_filter_test, host_order) {
+    static const uint16_t types[] = { RTM_NEWNEIGH };
+    static const nl_filter_cond_t probe[] = {
+        { NDM_OFF(ndm_state), 2, NL_FILTER_OP_EQ, NUD_PROBE },
+    };
+    static const nl_filter_rule_t rules[] = { RULE(probe) };
+    attach(types, 1, rules, 1);
+
+    /* 2 byte field compared in host byte order */
+    ASSERT_FALSE(accepted(neigh_msg(AF_INET, NUD_PROBE)));
+    ASSERT_TRUE(accepted(neigh_msg(AF_INET, NUD_REACHABLE)));
+    ASSERT_TRUE(accepted(neigh_msg(AF_INET, NUD_PROBE << 8)));
+}
+
+TEST_F(nas_nl_filter_test, route_socket) {
+    /* Filter of the route event sockets */
+    ASSERT_EQ(nl_filter_attach(socks[0], nas_nl_sock_T_ROUTE), STD_ERR_OK);
+    ASSERT_FALSE(accepted(route_msg(RTM_NEWROUTE, AF_INET6, RTN_UNICAST, RTM_F_CLONED)));
+    ASSERT_FALSE(accepted(route_msg(RTM_NEWROUTE, AF_INET, RTN_MULTICAST, 0)));
+    ASSERT_TRUE(accepted(route_msg(RTM_NEWROUTE, AF_INET, RTN_UNICAST, 0, true)));
+    ASSERT_TRUE(accepted(route_msg(RTM_DELROUTE, AF_INET6, RTN_BLACKHOLE, 0)));
+}
+
+TEST(nas_nl_filter_compile_test, overflow) {
+    std::vector<nl_filter_cond_t> conds(NL_FILTER_MAX_INSNS, { RTM_OFF(rtm_type), 1, NL_FILTER_OP_NE, RTN_LOCAL });
+    nl_filter_rule_t rule = { conds.data(), conds.size() };
+    struct sock_filter insns[NL_FILTER_MAX_INSNS];
+    size_t len = 0;
+    /* Program that does not fit is not compiled */
+    ASSERT_FALSE(nl_filter_compile(route_types, 2, &rule, 1, insns, &len));
+    ASSERT_EQ(len, 0u);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+/*
+ * Write path through the mock netlink transport, runs without root. The benchmarks
+ * take the number of objects from NAS_NL_MOCK_BENCH_COUNT (default 10000).
+ */
+
+#include "netlink_mock.h"
+#include "nas_nlmsg_builder.h"
+#include "nas_nlmsg.h"
+#include "nas_os_l3.h"
+
+#include "cps_api_object.h"
+#include "cps_api_object_key.h"
+#include "cps_class_map.h"
+#include "dell-base-routing.h"
+#include "std_error_codes.h"
+
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <gtest/gtest.h>
+
+typedef nas_nl::msg_size<rtmsg, nas_nl::attr<uint32_t>, nas_nl::attr<uint32_t>> route_msg_size;
+
+static void build_route_msg(nas_nl::msg_buffer<route_msg_size::value> &buff, uint32_t prefix, uint16_t flags) {
+    nas_nl::msg_builder b(buff, RTM_NEWROUTE, NLM_F_REQUEST | NLM_F_CREATE | flags);
+    rtmsg *rm = b.family_header<rtmsg>();
+    rm->rtm_family = AF_INET;
+    rm->rtm_dst_len = 32;
+    rm->rtm_table = RT_TABLE_MAIN;
+    rm->rtm_type = RTN_UNICAST;
+    b.put(RTA_DST, prefix);
+    b.put(RTA_OIF, (uint32_t)1);
+}
+
+static uint64_t bench_count() {
+    const char *count = getenv("NAS_NL_MOCK_BENCH_COUNT");
+    return (count != nullptr) ? strtoull(count, nullptr, 0) : 10000;
+}
+
+static uint64_t now_usec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+class nas_nl_mock_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        nl_mock_reset();
+        nl_mock_enable();
+    }
+    void TearDown() override {
+        nl_mock_disable();
+        nl_mock_reset();
+    }
+};
+
+TEST_F(nas_nl_mock_test, ack) {
+    nas_nl::msg_buffer<route_msg_size::value> req;
+    char buff[NL_RECV_MIN_BUFFER_LEN];
+    build_route_msg(req, htonl(0x0a000001), NLM_F_ACK);
+
+    ASSERT_EQ(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, (struct nlmsghdr *)req.data,
+                                buff, sizeof(buff)), STD_ERR_OK);
+    nl_mock_stats_t stats;
+    nl_mock_stats_get(&stats);
+    ASSERT_EQ(stats.requests, 1u);
+    ASSERT_EQ(stats.acks, 1u);
+    ASSERT_EQ(stats.errors, 0u);
+}
+
+/* Create with NLM_F_EXCL fails with EEXIST, the replace goes through (nas_os_update_route retry) */
+TEST_F(nas_nl_mock_test, injected_error) {
+    nas_nl::msg_buffer<route_msg_size::value> req;
+    char buff[NL_RECV_MIN_BUFFER_LEN];
+    ASSERT_EQ(nl_mock_inject_error(RTM_NEWROUTE, NLM_F_EXCL, EEXIST, 1), STD_ERR_OK);
+
+    build_route_msg(req, htonl(0x0a000002), NLM_F_ACK | NLM_F_EXCL);
+    t_std_error rc = nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, (struct nlmsghdr *)req.data,
+                                       buff, sizeof(buff));
+    ASSERT_EQ(STD_ERR_EXT_PRIV(rc), EEXIST);
+
+    build_route_msg(req, htonl(0x0a000002), NLM_F_ACK | NLM_F_REPLACE);
+    ASSERT_EQ(nl_do_set_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, (struct nlmsghdr *)req.data,
+                                buff, sizeof(buff)), STD_ERR_OK);
+
+    nl_mock_stats_t stats;
+    nl_mock_stats_get(&stats);
+    ASSERT_EQ(stats.errors, 1u);
+    ASSERT_EQ(stats.acks, 1u);
+}
+
+static int fail_deletes(const struct nlmsghdr *req, void *context) {
+    ++*(size_t *)context;
+    return (req->nlmsg_type == RTM_DELROUTE) ? ENOENT : 0;
+}
+
+TEST_F(nas_nl_mock_test, batch) {
+    const size_t count = NL_BATCH_MAX_MSGS + 10;
+    std::vector<nas_nl::msg_buffer<route_msg_size::value>> msgs(count);
+    std::vector<nl_batch_req_t> reqs(count);
+    size_t seen = 0;
+    nl_mock_set_handler(fail_deletes, &seen);
+
+    for (size_t ix = 0; ix < count; ++ix) {
+        build_route_msg(msgs[ix], htonl(0x0b000000 + ix), 0);
+        if (ix == 7) ((struct nlmsghdr *)msgs[ix].data)->nlmsg_type = RTM_DELROUTE;
+        reqs[ix].msg = (struct nlmsghdr *)msgs[ix].data;
+    }
+    char buff[NL_RECV_MIN_BUFFER_LEN];
+    size_t failed = 0;
+    ASSERT_NE(nl_do_batch_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, reqs.data(), count,
+                                  buff, sizeof(buff), &failed), STD_ERR_OK);
+    ASSERT_EQ(failed, 1u);
+    ASSERT_EQ(seen, count);
+    ASSERT_EQ(reqs[7].error_code, ENOENT);
+    ASSERT_EQ(reqs[8].error_code, 0);
+}
+
+/* Requests are read up to their nlmsg_len, the next one is still at the aligned offset */
+TEST_F(nas_nl_mock_test, batch_unaligned) {
+    const size_t count = 8;
+    std::vector<nas_nl::msg_buffer<route_msg_size::value + RTA_SPACE(1)>> msgs(count);
+    std::vector<nl_batch_req_t> reqs(count);
+    size_t seen = 0;
+    nl_mock_set_handler(fail_deletes, &seen);
+
+    for (size_t ix = 0; ix < count; ++ix) {
+        nas_nl::msg_builder b(msgs[ix], RTM_NEWROUTE, NLM_F_REQUEST | NLM_F_CREATE);
+        rtmsg *rm = b.family_header<rtmsg>();
+        rm->rtm_family = AF_INET;
+        rm->rtm_dst_len = 32;
+        b.put(RTA_DST, htonl(0x0b000000 + (uint32_t)ix));
+        /* Last attribute is not padded, the bytes past the message are not sent */
+        struct nlmsghdr *nlh = b.msg();
+        struct rtattr *rta = (struct rtattr *)((char *)nlh + NLMSG_ALIGN(nlh->nlmsg_len));
+        rta->rta_type = RTA_TTL_PROPAGATE;
+        rta->rta_len = RTA_LENGTH(1);
+        *(uint8_t *)RTA_DATA(rta) = 1;
+        nlh->nlmsg_len = NLMSG_ALIGN(nlh->nlmsg_len) + rta->rta_len;
+        memset((char *)nlh + nlh->nlmsg_len, 0xff, NLMSG_ALIGN(nlh->nlmsg_len) - nlh->nlmsg_len);
+        if (ix == 3) nlh->nlmsg_type = RTM_DELROUTE;
+        reqs[ix].msg = nlh;
+    }
+    char buff[NL_RECV_MIN_BUFFER_LEN];
+    size_t failed = 0;
+    ASSERT_NE(nl_do_batch_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, reqs.data(), count,
+                                  buff, sizeof(buff), &failed), STD_ERR_OK);
+    ASSERT_EQ(failed, 1u);
+    ASSERT_EQ(seen, count);
+    ASSERT_EQ(reqs[3].error_code, ENOENT);
+    ASSERT_EQ(reqs[4].error_code, 0);
+}
+
+/* ACKs that do not fit in the buffer fail the batch instead of being dropped */
+TEST_F(nas_nl_mock_test, batch_truncated) {
+    const size_t count = 4;
+    std::vector<nas_nl::msg_buffer<route_msg_size::value>> msgs(count);
+    std::vector<nl_batch_req_t> reqs(count);
+    for (size_t ix = 0; ix < count; ++ix) {
+        build_route_msg(msgs[ix], htonl(0x0b000000 + ix), 0);
+        reqs[ix].msg = (struct nlmsghdr *)msgs[ix].data;
+    }
+    char buff[NLMSG_HDRLEN];
+    size_t failed = 0;
+    t_std_error rc = nl_do_batch_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, reqs.data(), count,
+                                         buff, sizeof(buff), &failed);
+    ASSERT_NE(rc, STD_ERR_OK);
+    ASSERT_EQ(failed, count);
+    ASSERT_EQ(reqs[0].error_code, EIO);
+
+    /* Socket of the failed batch is not reused, the next requests get their own ACKs */
+    char ack[NL_RECV_MIN_BUFFER_LEN];
+    ASSERT_EQ(nl_do_batch_request(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, reqs.data(), count,
+                                  ack, sizeof(ack), &failed), STD_ERR_OK);
+    ASSERT_EQ(failed, 0u);
+}
+
+TEST_F(nas_nl_mock_test, link_echo) {
+    typedef nas_nl::msg_size<ifinfomsg, nas_nl::attr_len<IFNAMSIZ>> link_msg_size;
+    nas_nl::msg_buffer<link_msg_size::value> req;
+    nas_nl::msg_builder b(req, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL);
+    b.family_header<ifinfomsg>();
+    b.put_str(IFLA_IFNAME, "br4000");
+
+    char buff[NL_RECV_MIN_BUFFER_LEN];
+    nl_link_echo_t link;
+    ASSERT_EQ(nl_do_link_create_request(NL_DEFAULT_VRF_NAME, b.msg(), buff, sizeof(buff), &link), STD_ERR_OK);
+    ASSERT_TRUE(link.echoed);
+    ASSERT_GE(link.ifindex, NL_MOCK_FIRST_IFINDEX);
+}
+
+TEST_F(nas_nl_mock_test, link_exists) {
+    typedef nas_nl::msg_size<ifinfomsg, nas_nl::attr_len<IFNAMSIZ>> link_msg_size;
+    nas_nl::msg_buffer<link_msg_size::value> req;
+    nas_nl::msg_builder b(req, RTM_NEWLINK, NLM_F_REQUEST | NLM_F_CREATE | NLM_F_EXCL);
+    b.family_header<ifinfomsg>();
+    b.put_str(IFLA_IFNAME, "lo");
+    ASSERT_EQ(nl_mock_inject_error(RTM_NEWLINK, NLM_F_EXCL, EEXIST, 1), STD_ERR_OK);
+
+    /* Existing link is found by its name */
+    char buff[NL_RECV_MIN_BUFFER_LEN];
+    nl_link_echo_t link;
+    ASSERT_EQ(nl_do_link_create_request(NL_DEFAULT_VRF_NAME, b.msg(), buff, sizeof(buff), &link), STD_ERR_OK);
+    ASSERT_FALSE(link.echoed);
+    ASSERT_EQ(link.ifindex, if_nametoindex("lo"));
+}
+
+static cps_api_object_t route_obj(uint64_t ix, uint32_t if_index) {
+    cps_api_object_t obj = cps_api_object_create();
+    cps_api_key_from_attr_with_qual(cps_api_object_key(obj), BASE_ROUTE_OBJ_OBJ, cps_api_qualifier_TARGET);
+    cps_api_object_attr_add_u32(obj, BASE_ROUTE_OBJ_ENTRY_AF, AF_INET);
+    uint32_t prefix = htonl(0x0c000000 + (uint32_t)ix);
+    cps_api_object_attr_add(obj, BASE_ROUTE_OBJ_ENTRY_ROUTE_PREFIX, &prefix, sizeof(prefix));
+    cps_api_object_attr_add_u32(obj, BASE_ROUTE_OBJ_ENTRY_PREFIX_LEN, 32);
+    cps_api_attr_id_t ids[3] = { BASE_ROUTE_OBJ_ENTRY_NH_LIST, 0, BASE_ROUTE_OBJ_ENTRY_NH_LIST_IFINDEX };
+    cps_api_object_e_add(obj, ids, 3, cps_api_object_ATTR_T_U32, &if_index, sizeof(if_index));
+    cps_api_object_attr_add_u32(obj, BASE_ROUTE_OBJ_ENTRY_NH_COUNT, 1);
+    return obj;
+}
+
+static cps_api_object_t neighbor_obj(uint64_t ix, uint32_t if_index) {
+    const char *mac = "00:11:22:33:44:55";
+    cps_api_object_t obj = cps_api_object_create();
+    cps_api_key_from_attr_with_qual(cps_api_object_key(obj), BASE_ROUTE_OBJ_NBR, cps_api_qualifier_TARGET);
+    cps_api_object_attr_add_u32(obj, BASE_ROUTE_OBJ_NBR_AF, AF_INET);
+    uint32_t ip = htonl(0x0d000000 + (uint32_t)ix);
+    cps_api_object_attr_add(obj, BASE_ROUTE_OBJ_NBR_ADDRESS, &ip, sizeof(ip));
+    cps_api_object_attr_add_u32(obj, BASE_ROUTE_OBJ_NBR_IFINDEX, if_index);
+    cps_api_object_attr_add(obj, BASE_ROUTE_OBJ_NBR_MAC_ADDR, mac, strlen(mac) + 1);
+    return obj;
+}
+
+TEST_F(nas_nl_mock_test, bench_route_add) {
+    uint64_t count = bench_count();
+    uint32_t lo_index = if_nametoindex("lo");
+    uint64_t start = now_usec();
+    for (uint64_t ix = 0; ix < count; ++ix) {
+        cps_api_object_t obj = route_obj(ix, lo_index);
+        ASSERT_EQ(nas_os_add_route(obj), STD_ERR_OK);
+        cps_api_object_delete(obj);
+    }
+    uint64_t elapsed = now_usec() - start;
+
+    nl_mock_stats_t stats;
+    nl_mock_stats_get(&stats);
+    ASSERT_EQ(stats.requests, count);
+    printf("route add: %lu routes in %lu usec, %lu bytes sent\n", count, elapsed, stats.bytes);
+}
+
+TEST_F(nas_nl_mock_test, bench_route_add_list) {
+    uint64_t count = bench_count();
+    uint32_t lo_index = if_nametoindex("lo");
+    cps_api_object_list_t objs = cps_api_object_list_create();
+    for (uint64_t ix = 0; ix < count; ++ix) {
+        ASSERT_TRUE(cps_api_object_list_append(objs, route_obj(ix, lo_index)));
+    }
+    /* Failed routes are reported in the order of the list */
+    ASSERT_EQ(nl_mock_inject_error(RTM_NEWROUTE, 0, ENETUNREACH, 1), STD_ERR_OK);
+    std::vector<t_std_error> results(count);
+    uint64_t start = now_usec();
+    ASSERT_NE(nas_os_add_route_list(objs, results.data()), STD_ERR_OK);
+    uint64_t elapsed = now_usec() - start;
+    cps_api_object_list_destroy(objs, true);
+
+    ASSERT_EQ(STD_ERR_EXT_PRIV(results[0]), ENETUNREACH);
+    for (uint64_t ix = 1; ix < count; ++ix) ASSERT_EQ(results[ix], STD_ERR_OK);
+    nl_mock_stats_t stats;
+    nl_mock_stats_get(&stats);
+    ASSERT_EQ(stats.requests, count);
+    printf("route add list: %lu routes in %lu usec, %lu bytes sent\n", count, elapsed, stats.bytes);
+}
+
+TEST_F(nas_nl_mock_test, bench_neighbor_add) {
+    uint64_t count = bench_count();
+    uint32_t lo_index = if_nametoindex("lo");
+    uint64_t start = now_usec();
+    for (uint64_t ix = 0; ix < count; ++ix) {
+        cps_api_object_t obj = neighbor_obj(ix, lo_index);
+        ASSERT_EQ(nas_os_add_neighbor(obj), STD_ERR_OK);
+        cps_api_object_delete(obj);
+    }
+    uint64_t elapsed = now_usec() - start;
+
+    nl_mock_stats_t stats;
+    nl_mock_stats_get(&stats);
+    ASSERT_EQ(stats.requests, count);
+    printf("neighbor add: %lu neighbors in %lu usec, %lu bytes sent\n", count, elapsed, stats.bytes);
+}
+
+TEST_F(nas_nl_mock_test, bench_neighbor_add_list) {
+    uint64_t count = bench_count();
+    uint32_t lo_index = if_nametoindex("lo");
+    cps_api_object_list_t objs = cps_api_object_list_create();
+    for (uint64_t ix = 0; ix < count; ++ix) {
+        ASSERT_TRUE(cps_api_object_list_append(objs, neighbor_obj(ix, lo_index)));
+    }
+    uint64_t start = now_usec();
+    ASSERT_EQ(nas_os_add_neighbor_list(objs, nullptr), STD_ERR_OK);
+    uint64_t elapsed = now_usec() - start;
+    cps_api_object_list_destroy(objs, true);
+
+    nl_mock_stats_t stats;
+    nl_mock_stats_get(&stats);
+    ASSERT_EQ(stats.requests, count);
+    printf("neighbor add list: %lu neighbors in %lu usec, %lu bytes sent\n", count, elapsed, stats.bytes);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_nsid.h"
+#include "netlink_tools.h"
+#include "nas_os_nl_config.h"
+
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/rtnetlink.h>
+#include <string>
+#include <gtest/gtest.h>
+
+/* Namespace of the test VRF, events of its links are received in the default namespace */
+#define NSID_TEST_VRF "nas_nl_nsid_ut"
+#define NSID_TEST_VRF_ID 77
+
+static char scratch[NL_SCRATCH_BUFFER_LEN];
+
+typedef struct {
+    bool seen;
+    uint32_t vrf_id;
+    std::string vrf_name;
+} nsid_test_link_t;
+
+static nsid_test_link_t *_link = nullptr;
+
+static bool record_link(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    if ((rt_msg_type != RTM_NEWLINK) && (rt_msg_type != RTM_DELLINK)) return true;
+    _link->seen = true;
+    _link->vrf_id = vrf_id;
+    _link->vrf_name = (const char *)context;
+    return true;
+}
+
+/* Receive the events of the listener until the link event or the timeout */
+static void receive_link(int sock, nsid_test_link_t *link) {
+    _link = link;
+    struct pollfd pfd = { sock, POLLIN, 0 };
+    while (!link->seen && (poll(&pfd, 1, 1000) > 0)) {
+        int err = 0;
+        netlink_tools_receive_event(sock, record_link, (void *)NL_DEFAULT_VRF_NAME, scratch, sizeof(scratch),
+                                    &err, NL_DEFAULT_VRF_ID);
+    }
+}
+
+class nas_nl_nsid_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(nl_nsid_enabled());
+        system("ip netns del " NSID_TEST_VRF " 2>/dev/null");
+        ASSERT_EQ(system("ip netns add " NSID_TEST_VRF), 0);
+        sock = nas_nl_sock_create(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT, true);
+        ASSERT_NE(sock, -1);
+    }
+    void TearDown() override {
+        nl_nsid_vrf_del(NSID_TEST_VRF, nullptr);
+        if (sock != -1) close(sock);
+        system("ip netns del " NSID_TEST_VRF);
+    }
+    int sock = -1;
+};
+
+TEST_F(nas_nl_nsid_test, map) {
+    ASSERT_EQ(nl_nsid_vrf_add(NSID_TEST_VRF, NSID_TEST_VRF_ID), STD_ERR_OK);
+    /* Added again, e.g. the VRF is recreated */
+    ASSERT_EQ(nl_nsid_vrf_add(NSID_TEST_VRF, NSID_TEST_VRF_ID), STD_ERR_OK);
+
+    nl_nsid_stats_t stats;
+    nl_nsid_stats_get(&stats);
+    ASSERT_EQ(stats.vrfs, 1u);
+
+    int found_nsid = -1;
+    nl_nsid_vrf_walk([](int nsid, uint32_t vrf_id, const char *vrf_name, void *context) {
+        if ((vrf_id == NSID_TEST_VRF_ID) && (strcmp(vrf_name, NSID_TEST_VRF) == 0)) *(int *)context = nsid;
+    }, &found_nsid);
+    ASSERT_GE(found_nsid, 0);
+
+    uint32_t vrf_id = 0;
+    char vrf_name[NAS_VRF_NAME_SZ + 1];
+    ASSERT_TRUE(nl_nsid_vrf_get(found_nsid, &vrf_id, vrf_name, sizeof(vrf_name)));
+    ASSERT_EQ(vrf_id, (uint32_t)NSID_TEST_VRF_ID);
+    ASSERT_STREQ(vrf_name, NSID_TEST_VRF);
+
+    ASSERT_TRUE(nl_nsid_vrf_del(NSID_TEST_VRF, &vrf_id));
+    ASSERT_EQ(vrf_id, (uint32_t)NSID_TEST_VRF_ID);
+    ASSERT_FALSE(nl_nsid_vrf_get(found_nsid, &vrf_id, vrf_name, sizeof(vrf_name)));
+    ASSERT_FALSE(nl_nsid_vrf_del(NSID_TEST_VRF, nullptr));
+}
+
+TEST_F(nas_nl_nsid_test, event_mapped) {
+    ASSERT_EQ(nl_nsid_vrf_add(NSID_TEST_VRF, NSID_TEST_VRF_ID), STD_ERR_OK);
+    ASSERT_EQ(system("ip netns exec " NSID_TEST_VRF " ip link set lo up"), 0);
+
+    /* Link event of the VRF namespace is given the VRF-id and name of the map */
+    nsid_test_link_t link = { false, 0, "" };
+    receive_link(sock, &link);
+    ASSERT_TRUE(link.seen);
+    ASSERT_EQ(link.vrf_id, (uint32_t)NSID_TEST_VRF_ID);
+    ASSERT_EQ(link.vrf_name, NSID_TEST_VRF);
+}
+
+TEST_F(nas_nl_nsid_test, event_unmapped) {
+    nl_nsid_stats_t before;
+    nl_nsid_stats_get(&before);
+    /* Events are sent to the listeners only for the namespaces with an NSID */
+    ASSERT_EQ(system("ip netns set " NSID_TEST_VRF " auto"), 0);
+    ASSERT_EQ(system("ip netns exec " NSID_TEST_VRF " ip link set lo up"), 0);
+
+    /* Events of a namespace that is not a VRF are dropped */
+    nsid_test_link_t link = { false, 0, "" };
+    receive_link(sock, &link);
+    ASSERT_FALSE(link.seen);
+
+    nl_nsid_stats_t after;
+    nl_nsid_stats_get(&after);
+    ASSERT_GT(after.unmapped, before.unmapped);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  nas_os_nl_config_t cfg;
+  nas_os_nl_config_default(&cfg);
+  cfg.nsid_listener = true;
+  nas_os_nl_config_set(&cfg);
+
+  return RUN_ALL_TESTS();
+}
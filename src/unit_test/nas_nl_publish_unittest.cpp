@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_publish.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include <gtest/gtest.h>
+
+#define PUBLISH_TEST_BATCH 4
+#define PUBLISH_TEST_DEADLINE_USEC 20000
+
+/* The objects are only tokens, the publish function records them */
+static std::mutex _published_mutex;
+static std::condition_variable _published_cond;
+static auto published = new std::vector<uintptr_t>;
+
+static cps_api_return_code_t record_publish(cps_api_object_t obj) {
+    std::lock_guard<std::mutex> lock(_published_mutex);
+    published->push_back((uintptr_t)obj);
+    _published_cond.notify_all();
+    return cps_api_ret_code_OK;
+}
+
+/* Tokens from 100 up have the key token/100, the lower ones have no key */
+#define PUBLISH_TEST_KEYED 100
+
+static size_t token_key(nl_publish_class_t cls, cps_api_object_t obj, void *key, size_t len) {
+    uintptr_t token = (uintptr_t)obj;
+    if ((token < PUBLISH_TEST_KEYED) || (len < sizeof(token))) return 0;
+    token /= PUBLISH_TEST_KEYED;
+    memcpy(key, &token, sizeof(token));
+    return sizeof(token);
+}
+
+static auto freed = new std::vector<uintptr_t>;
+
+static void record_free(cps_api_object_t obj) {
+    std::lock_guard<std::mutex> lock(_published_mutex);
+    freed->push_back((uintptr_t)obj);
+}
+
+static uint64_t now_usec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static bool wait_published(size_t count) {
+    std::unique_lock<std::mutex> lock(_published_mutex);
+    return _published_cond.wait_for(lock, std::chrono::seconds(5),
+                                    [count] { return published->size() >= count; });
+}
+
+class nas_nl_publish_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(nl_publish_init(record_publish, token_key, record_free), STD_ERR_OK);
+        ASSERT_TRUE(nl_publish_batching());
+        std::lock_guard<std::mutex> lock(_published_mutex);
+        published->clear();
+        freed->clear();
+    }
+};
+
+TEST_F(nas_nl_publish_test, full_batch) {
+    /* Batch is published once full, well before the deadline */
+    uint64_t start = now_usec();
+    for (uintptr_t ix = 1; ix <= PUBLISH_TEST_BATCH; ++ix) {
+        nl_publish_add(NL_PUBLISH_CLASS_ROUTE, (cps_api_object_t)ix);
+    }
+    ASSERT_TRUE(wait_published(PUBLISH_TEST_BATCH));
+    ASSERT_LT(now_usec() - start, (uint64_t)PUBLISH_TEST_DEADLINE_USEC);
+
+    std::lock_guard<std::mutex> lock(_published_mutex);
+    for (uintptr_t ix = 1; ix <= PUBLISH_TEST_BATCH; ++ix) ASSERT_EQ((*published)[ix-1], ix);
+}
+
+TEST_F(nas_nl_publish_test, deadline) {
+    uint64_t start = now_usec();
+    nl_publish_add(NL_PUBLISH_CLASS_NEIGH, (cps_api_object_t)1);
+    ASSERT_TRUE(wait_published(1));
+    ASSERT_GE(now_usec() - start, (uint64_t)PUBLISH_TEST_DEADLINE_USEC);
+}
+
+TEST_F(nas_nl_publish_test, intf_not_held) {
+    /* Interface objects do not wait for the deadline of their batch */
+    uint64_t start = now_usec();
+    nl_publish_add(NL_PUBLISH_CLASS_INTF, (cps_api_object_t)1);
+    ASSERT_TRUE(wait_published(1));
+    ASSERT_LT(now_usec() - start, (uint64_t)PUBLISH_TEST_DEADLINE_USEC);
+}
+
+TEST_F(nas_nl_publish_test, intf_after_held) {
+    /* Held routes and neighbors are published ahead of the later interface object */
+    nl_publish_add(NL_PUBLISH_CLASS_ROUTE, (cps_api_object_t)1);
+    nl_publish_add(NL_PUBLISH_CLASS_NEIGH, (cps_api_object_t)2);
+    uint64_t start = now_usec();
+    nl_publish_add(NL_PUBLISH_CLASS_INTF, (cps_api_object_t)3);
+    nl_publish_add(NL_PUBLISH_CLASS_ROUTE, (cps_api_object_t)4);
+    ASSERT_TRUE(wait_published(3));
+    ASSERT_LT(now_usec() - start, (uint64_t)PUBLISH_TEST_DEADLINE_USEC);
+    nl_publish_flush();
+
+    std::lock_guard<std::mutex> lock(_published_mutex);
+    ASSERT_EQ(published->size(), 4u);
+    for (uintptr_t ix = 1; ix <= 4; ++ix) ASSERT_EQ((*published)[ix-1], ix);
+}
+
+TEST_F(nas_nl_publish_test, flush) {
+    nl_publish_stats_t before;
+    nl_publish_stats_get(&before);
+
+    nl_publish_add(NL_PUBLISH_CLASS_INTF, (cps_api_object_t)1);
+    nl_publish_add(NL_PUBLISH_CLASS_ROUTE, (cps_api_object_t)2);
+    nl_publish_flush();
+    {
+        std::lock_guard<std::mutex> lock(_published_mutex);
+        ASSERT_EQ(published->size(), 2u);
+    }
+
+    nl_publish_stats_t stats;
+    nl_publish_stats_get(&stats);
+    ASSERT_EQ(stats.objects - before.objects, 2u);
+    ASSERT_EQ(stats.failed, 0u);
+    ASSERT_LE(stats.max_batch, (uint64_t)PUBLISH_TEST_BATCH);
+}
+
+TEST_F(nas_nl_publish_test, coalesce) {
+    nl_publish_stats_t before;
+    nl_publish_stats_get(&before);
+
+    /* Updates of the same key held in the batch are published once, with the last
+     * state at the place of the first one */
+    nl_publish_add(NL_PUBLISH_CLASS_ROUTE, (cps_api_object_t)101);
+    nl_publish_add(NL_PUBLISH_CLASS_ROUTE, (cps_api_object_t)1);
+    for (uintptr_t ix = 2; ix <= 9; ++ix) {
+        nl_publish_add(NL_PUBLISH_CLASS_ROUTE, (cps_api_object_t)(100 + ix));
+    }
+    /* Same key in another class is another object */
+    nl_publish_add(NL_PUBLISH_CLASS_NEIGH, (cps_api_object_t)150);
+    nl_publish_flush();
+
+    nl_publish_stats_t stats;
+    nl_publish_stats_get(&stats);
+    {
+        std::lock_guard<std::mutex> lock(_published_mutex);
+        std::vector<uintptr_t> expected = { 109, 1, 150 };
+        ASSERT_EQ(*published, expected);
+        std::vector<uintptr_t> expected_freed = { 101, 102, 103, 104, 105, 106, 107, 108 };
+        ASSERT_EQ(*freed, expected_freed);
+        published->clear();
+    }
+    ASSERT_EQ(stats.coalesced - before.coalesced, 8u);
+    ASSERT_EQ(stats.objects - before.objects, 3u);
+    ASSERT_EQ(stats.queued, 0u);
+
+    /* Published objects are not replaced, the later update of the key is published too */
+    nl_publish_add(NL_PUBLISH_CLASS_ROUTE, (cps_api_object_t)110);
+    nl_publish_flush();
+    std::lock_guard<std::mutex> lock(_published_mutex);
+    ASSERT_EQ(*published, std::vector<uintptr_t>{ 110 });
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  nas_os_nl_config_t cfg;
+  nas_os_nl_config_default(&cfg);
+  cfg.publish_batch = 4;
+  cfg.publish_deadline_usec = 20000;
+  nas_os_nl_config_set(&cfg);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_resync.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_addr.h>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+/* Tables of the VRF namespace are resynced, the namespace has only the test entries */
+#define RESYNC_TEST_VRF "nas_nl_resync_ut"
+#define RESYNC_TEST_VRF_ID 11
+#define RESYNC_TEST_IP(cmd) "ip -n " RESYNC_TEST_VRF " " cmd
+
+/* Interrupted dump - enough addresses for the dump to go on after the datagrams
+ * the kernel fills ahead of the reads */
+#define RESYNC_TEST_ADDRS 4000
+
+/* IPv4 events given to the handler, e.g. "add 10.1.0.0/16" */
+static std::vector<std::string> _events;
+/* Delete the first address dumped while the dump is in progress */
+static bool _interrupt = false;
+static std::string _deleted_addr;
+
+static std::string prefix_str(const void *addr, int len) {
+    char buff[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, addr, buff, sizeof(buff));
+    return std::string(buff) + "/" + std::to_string(len);
+}
+
+static std::string route_event(int rt_msg_type, struct nlmsghdr *hdr) {
+    struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA(hdr);
+    if ((rtm->rtm_family != AF_INET) || (rtm->rtm_table != RT_TABLE_MAIN)) return "";
+    int len = RTM_PAYLOAD(hdr);
+    for (struct rtattr *rta = RTM_RTA(rtm); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type != RTA_DST) continue;
+        const char *op = (rt_msg_type == RTM_DELROUTE) ? "del " :
+                         ((hdr->nlmsg_flags & NLM_F_REPLACE) ? "update " : "add ");
+        return op + prefix_str(RTA_DATA(rta), rtm->rtm_dst_len);
+    }
+    return "";
+}
+
+static std::string addr_event(int rt_msg_type, struct nlmsghdr *hdr) {
+    struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(hdr);
+    if (ifa->ifa_family != AF_INET) return "";
+    int len = IFA_PAYLOAD(hdr);
+    for (struct rtattr *rta = IFA_RTA(ifa); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type != IFA_LOCAL) continue;
+        std::string addr = prefix_str(RTA_DATA(rta), ifa->ifa_prefixlen);
+        if ((rt_msg_type == RTM_NEWADDR) && _interrupt) {
+            /* Table changes while the dump is in progress */
+            _interrupt = false;
+            _deleted_addr = addr;
+            system((RESYNC_TEST_IP("addr del ") + addr + " dev veth0").c_str());
+        }
+        return ((rt_msg_type == RTM_DELADDR) ? "del " : "add ") + addr;
+    }
+    return "";
+}
+
+/* Handler publishes the event, the published state is kept in the shadow */
+static bool publish(int sock, int rt_msg_type, struct nlmsghdr *hdr, void *context, uint32_t vrf_id) {
+    if (vrf_id != RESYNC_TEST_VRF_ID) return false;
+    std::string event;
+    if ((rt_msg_type == RTM_NEWROUTE) || (rt_msg_type == RTM_DELROUTE)) event = route_event(rt_msg_type, hdr);
+    if ((rt_msg_type == RTM_NEWADDR) || (rt_msg_type == RTM_DELADDR)) event = addr_event(rt_msg_type, hdr);
+    if (!event.empty()) _events.push_back(event);
+    nl_resync_shadow_update(vrf_id, hdr);
+    return true;
+}
+
+static bool has_event(const std::string &event) {
+    for (auto &e : _events) {
+        if (e == event) return true;
+    }
+    return false;
+}
+
+class nas_nl_resync_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        system("ip netns del " RESYNC_TEST_VRF " 2>/dev/null");
+        ASSERT_EQ(system("ip netns add " RESYNC_TEST_VRF), 0);
+        ASSERT_EQ(system(RESYNC_TEST_IP("link add veth0 type veth peer name veth1")), 0);
+        nl_resync_shadow_clear(RESYNC_TEST_VRF_ID);
+        _events.clear();
+        _interrupt = false;
+    }
+    void TearDown() override {
+        nl_resync_shadow_clear(RESYNC_TEST_VRF_ID);
+        system("ip netns del " RESYNC_TEST_VRF);
+    }
+    bool resync(nas_nl_sock_TYPES type) {
+        _events.clear();
+        return nl_resync_table(RESYNC_TEST_VRF, RESYNC_TEST_VRF_ID, type, -1, publish);
+    }
+};
+
+TEST_F(nas_nl_resync_test, route_diff) {
+    ASSERT_EQ(system(RESYNC_TEST_IP("link set veth0 up")), 0);
+    ASSERT_EQ(system(RESYNC_TEST_IP("addr add 10.0.0.1/24 dev veth0")), 0);
+    ASSERT_EQ(system(RESYNC_TEST_IP("route add 10.1.0.0/16 via 10.0.0.2")), 0);
+    ASSERT_EQ(system(RESYNC_TEST_IP("route add 10.2.0.0/16 via 10.0.0.2")), 0);
+
+    /* Nothing published yet */
+    ASSERT_TRUE(resync(nas_nl_sock_T_ROUTE));
+    ASSERT_EQ(_events, std::vector<std::string>({ "add 10.0.0.0/24", "add 10.1.0.0/16", "add 10.2.0.0/16" }));
+
+    /* Nothing changed */
+    ASSERT_TRUE(resync(nas_nl_sock_T_ROUTE));
+    ASSERT_TRUE(_events.empty());
+
+    /* Changed route is published as an update, the delete is synthesized for the removed one */
+    ASSERT_EQ(system(RESYNC_TEST_IP("route del 10.2.0.0/16")), 0);
+    ASSERT_EQ(system(RESYNC_TEST_IP("route replace 10.1.0.0/16 via 10.0.0.3")), 0);
+    ASSERT_TRUE(resync(nas_nl_sock_T_ROUTE));
+    ASSERT_EQ(_events, std::vector<std::string>({ "update 10.1.0.0/16", "del 10.2.0.0/16" }));
+}
+
+TEST_F(nas_nl_resync_test, stale_shadow) {
+    /* Route published but removed from the kernel while the events were lost */
+    char buff[NLMSG_SPACE(sizeof(struct rtmsg) + RTA_SPACE(sizeof(struct in_addr)))];
+    memset(buff, 0, sizeof(buff));
+    struct nlmsghdr *hdr = (struct nlmsghdr *)buff;
+    hdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg) + RTA_SPACE(sizeof(struct in_addr)));
+    hdr->nlmsg_type = RTM_NEWROUTE;
+    struct rtmsg *rtm = (struct rtmsg *)NLMSG_DATA(hdr);
+    rtm->rtm_family = AF_INET;
+    rtm->rtm_dst_len = 16;
+    rtm->rtm_table = RT_TABLE_MAIN;
+    rtm->rtm_type = RTN_UNICAST;
+    struct rtattr *rta = RTM_RTA(rtm);
+    rta->rta_type = RTA_DST;
+    rta->rta_len = RTA_LENGTH(sizeof(struct in_addr));
+    inet_pton(AF_INET, "10.99.0.0", RTA_DATA(rta));
+    nl_resync_shadow_update(RESYNC_TEST_VRF_ID, hdr);
+
+    ASSERT_TRUE(resync(nas_nl_sock_T_ROUTE));
+    ASSERT_EQ(_events, std::vector<std::string>({ "del 10.99.0.0/16" }));
+
+    /* Entry is removed from the shadow with the delete */
+    ASSERT_TRUE(resync(nas_nl_sock_T_ROUTE));
+    ASSERT_TRUE(_events.empty());
+}
+
+TEST_F(nas_nl_resync_test, interrupted_dump) {
+    char path[] = "/tmp/nas_nl_resync_ut.XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(fd, -1);
+    FILE *batch = fdopen(fd, "w");
+    for (int ix = 0; ix < RESYNC_TEST_ADDRS; ++ix) {
+        fprintf(batch, "addr add 10.%d.%d.1/32 dev veth0\n", 100 + ix / 250, ix % 250);
+    }
+    fclose(batch);
+    int rc = system((RESYNC_TEST_IP("-batch ") + std::string(path)).c_str());
+    unlink(path);
+    ASSERT_EQ(rc, 0);
+
+    /* Address dumped first is deleted, the rest of the dump is flagged as interrupted */
+    _interrupt = true;
+    ASSERT_TRUE(resync(nas_nl_sock_T_INT));
+    ASSERT_FALSE(_interrupt);
+    ASSERT_FALSE(_deleted_addr.empty());
+
+    /* Dump is restarted with the entries of the interrupted one not taken as seen, the
+     * delete is synthesized for the address published before the interruption */
+    ASSERT_TRUE(has_event("add " + _deleted_addr));
+    ASSERT_TRUE(has_event("del " + _deleted_addr));
+    ASSERT_TRUE(has_event("add 10.115.249.1/32"));
+
+    ASSERT_TRUE(resync(nas_nl_sock_T_INT));
+    ASSERT_TRUE(_events.empty());
+}
+
+TEST(nas_nl_resync_type_test, not_supported) {
+    ASSERT_FALSE(nl_resync_table(NL_DEFAULT_VRF_NAME, NL_DEFAULT_VRF_ID, nas_nl_sock_T_NETCONF, -1, publish));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
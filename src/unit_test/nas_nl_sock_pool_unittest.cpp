@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_sock_pool.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include <gtest/gtest.h>
+
+static bool sock_open(int sock) {
+    return fcntl(sock, F_GETFD) != -1;
+}
+
+class nas_nl_sock_pool_test : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_EQ(nas_nl_req_sock_pool_init(NL_DEFAULT_VRF_NAME), STD_ERR_OK);
+    }
+    void TearDown() override {
+        nas_nl_req_sock_pool_deinit(NL_DEFAULT_VRF_NAME);
+    }
+};
+
+TEST_F(nas_nl_sock_pool_test, reuse) {
+    int sock = nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE);
+    ASSERT_NE(sock, -1);
+    nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, sock, false);
+    ASSERT_TRUE(sock_open(sock));
+
+    /* Idle socket is given back for the same type only */
+    int other = nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI);
+    ASSERT_NE(other, sock);
+    ASSERT_EQ(nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE), sock);
+    nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NEI, other, false);
+    nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, sock, false);
+}
+
+TEST_F(nas_nl_sock_pool_test, sock_error) {
+    int sock = nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE);
+    ASSERT_NE(sock, -1);
+    /* Socket with unread data is closed, not reused */
+    nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, sock, true);
+    ASSERT_FALSE(sock_open(sock));
+}
+
+TEST_F(nas_nl_sock_pool_test, max_idle) {
+    std::vector<int> socks;
+    for (size_t ix = 0; ix <= NL_REQ_SOCK_POOL_MAX_IDLE; ++ix) {
+        int sock = nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT);
+        ASSERT_NE(sock, -1);
+        socks.push_back(sock);
+    }
+    for (auto sock : socks) {
+        nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT, sock, false);
+    }
+    /* Sockets above the max. idle are closed */
+    for (size_t ix = 0; ix < NL_REQ_SOCK_POOL_MAX_IDLE; ++ix) {
+        ASSERT_TRUE(sock_open(socks[ix]));
+    }
+    ASSERT_FALSE(sock_open(socks.back()));
+}
+
+TEST_F(nas_nl_sock_pool_test, deinit) {
+    int idle = nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE);
+    int in_use = nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE);
+    ASSERT_NE(idle, -1);
+    ASSERT_NE(in_use, -1);
+    nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, idle, false);
+
+    /* Idle sockets are closed with the pool, the one in use when it is given back */
+    ASSERT_EQ(nas_nl_req_sock_pool_deinit(NL_DEFAULT_VRF_NAME), STD_ERR_OK);
+    ASSERT_FALSE(sock_open(idle));
+    ASSERT_TRUE(sock_open(in_use));
+    nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, in_use, false);
+    ASSERT_FALSE(sock_open(in_use));
+    ASSERT_NE(nas_nl_req_sock_pool_deinit(NL_DEFAULT_VRF_NAME), STD_ERR_OK);
+}
+
+TEST_F(nas_nl_sock_pool_test, vrf_recreated) {
+    int sock = nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE);
+    ASSERT_NE(sock, -1);
+
+    /* Socket of the deleted VRF is not given to the re-created one */
+    ASSERT_EQ(nas_nl_req_sock_pool_deinit(NL_DEFAULT_VRF_NAME), STD_ERR_OK);
+    ASSERT_EQ(nas_nl_req_sock_pool_init(NL_DEFAULT_VRF_NAME), STD_ERR_OK);
+    nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, sock, false);
+    ASSERT_FALSE(sock_open(sock));
+}
+
+TEST(nas_nl_sock_pool_no_pool, not_enabled) {
+    /* Without the pool the sockets are created per request and closed */
+    int sock = nas_nl_req_sock_get(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE);
+    ASSERT_NE(sock, -1);
+    nas_nl_req_sock_put(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE, sock, false);
+    ASSERT_FALSE(sock_open(sock));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_subscribe.h"
+#include "nas_os_nl_config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <atomic>
+#include <thread>
+#include <gtest/gtest.h>
+
+#define SUBSCRIBE_TEST_VRF "subscribe_ut"
+
+#define GROUP(g) (1ULL << (g))
+
+/* Groups joined by the socket, read back from the kernel */
+static uint64_t sock_groups(int sock) {
+    uint32_t groups[2] = { 0, 0 };
+    socklen_t len = sizeof(groups);
+    if (getsockopt(sock, SOL_NETLINK, NETLINK_LIST_MEMBERSHIPS, groups, &len) != 0) return ~0ULL;
+    /* Bit n-1 of the list is group n */
+    return (((uint64_t)groups[1] << 32) | groups[0]) << 1;
+}
+
+static struct nlmsghdr *route_msg(char *buff, int family) {
+    memset(buff, 0, NLMSG_SPACE(sizeof(struct rtmsg)));
+    struct nlmsghdr *hdr = (struct nlmsghdr *)buff;
+    hdr->nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+    hdr->nlmsg_type = RTM_NEWROUTE;
+    ((struct rtmsg *)NLMSG_DATA(hdr))->rtm_family = family;
+    return hdr;
+}
+
+TEST(nas_nl_subscribe_test, default_profile) {
+    /* subscribe_off of the config leaves out the IPv6 netconf and MDB */
+    ASSERT_EQ(nl_subscribe_get(NL_DEFAULT_VRF_NAME, AF_INET), (uint32_t)NL_SUBSCRIBE_ALL);
+    ASSERT_EQ(nl_subscribe_get(NL_DEFAULT_VRF_NAME, AF_INET6),
+              (uint32_t)(NL_SUBSCRIBE_ALL & ~(NL_SUBSCRIBE_NETCONF | NL_SUBSCRIBE_MDB)));
+
+    ASSERT_EQ(nl_subscribe_groups(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_NETCONF), GROUP(RTNLGRP_IPV4_NETCONF));
+    /* MDB group is shared by the families, joined for IPv4 */
+    ASSERT_EQ(nl_subscribe_groups(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_MCAST_SNOOP), GROUP(RTNLGRP_MDB));
+    ASSERT_EQ(nl_subscribe_groups(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_INT),
+              GROUP(RTNLGRP_LINK) | GROUP(RTNLGRP_IPV4_IFADDR) | GROUP(RTNLGRP_IPV6_IFADDR));
+}
+
+TEST(nas_nl_subscribe_test, vrf_profile) {
+    ASSERT_NE(nl_subscribe_set(SUBSCRIBE_TEST_VRF, AF_PACKET, NL_SUBSCRIBE_ALL), STD_ERR_OK);
+    ASSERT_NE(nl_subscribe_set(SUBSCRIBE_TEST_VRF, AF_INET, 0x100), STD_ERR_OK);
+
+    ASSERT_EQ(nl_subscribe_set(SUBSCRIBE_TEST_VRF, AF_INET6, NL_SUBSCRIBE_ALL & ~NL_SUBSCRIBE_ROUTE), STD_ERR_OK);
+    ASSERT_EQ(nl_subscribe_groups(SUBSCRIBE_TEST_VRF, nas_nl_sock_T_ROUTE), GROUP(RTNLGRP_IPV4_ROUTE));
+    /* Other VRFs keep the default profile */
+    ASSERT_EQ(nl_subscribe_groups(NL_DEFAULT_VRF_NAME, nas_nl_sock_T_ROUTE),
+              GROUP(RTNLGRP_IPV4_ROUTE) | GROUP(RTNLGRP_IPV6_ROUTE));
+
+    char buff[NLMSG_SPACE(sizeof(struct rtmsg))];
+    ASSERT_FALSE(nl_subscribe_wanted(SUBSCRIBE_TEST_VRF, RTM_NEWROUTE, route_msg(buff, AF_INET6)));
+    ASSERT_TRUE(nl_subscribe_wanted(SUBSCRIBE_TEST_VRF, RTM_NEWROUTE, route_msg(buff, AF_INET)));
+    ASSERT_TRUE(nl_subscribe_wanted(NL_DEFAULT_VRF_NAME, RTM_NEWROUTE, route_msg(buff, AF_INET6)));
+    ASSERT_TRUE(nl_subscribe_wanted(nullptr, RTM_NEWROUTE, route_msg(buff, AF_INET6)));
+
+    nl_subscribe_clear(SUBSCRIBE_TEST_VRF);
+    ASSERT_TRUE(nl_subscribe_wanted(SUBSCRIBE_TEST_VRF, RTM_NEWROUTE, route_msg(buff, AF_INET6)));
+}
+
+TEST(nas_nl_subscribe_test, update_while_read) {
+    /* Events are checked against the profile table of the time, the changes of the
+     * profiles do not hold up or disturb the readers */
+    std::atomic<bool> done(false);
+    std::atomic<size_t> unwanted(0);
+    std::thread reader([&] {
+        char buff[NLMSG_SPACE(sizeof(struct rtmsg))];
+        while (!done) {
+            if (!nl_subscribe_wanted(NL_DEFAULT_VRF_NAME, RTM_NEWROUTE, route_msg(buff, AF_INET6))) ++unwanted;
+            nl_subscribe_wanted(SUBSCRIBE_TEST_VRF, RTM_NEWROUTE, route_msg(buff, AF_INET6));
+        }
+    });
+    for (int ix = 0; ix < 1000; ++ix) {
+        ASSERT_EQ(nl_subscribe_set(SUBSCRIBE_TEST_VRF, AF_INET6, (ix & 1) ? NL_SUBSCRIBE_ALL : 0), STD_ERR_OK);
+        if ((ix % 10) == 0) nl_subscribe_clear(SUBSCRIBE_TEST_VRF);
+    }
+    done = true;
+    reader.join();
+    ASSERT_EQ(unwanted, 0u);
+
+    nl_subscribe_clear(SUBSCRIBE_TEST_VRF);
+    ASSERT_EQ(nl_subscribe_get(SUBSCRIBE_TEST_VRF, AF_INET6), nl_subscribe_get(NL_DEFAULT_VRF_NAME, AF_INET6));
+}
+
+TEST(nas_nl_subscribe_test, memberships) {
+    int sock = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+    ASSERT_NE(sock, -1);
+    struct sockaddr_nl sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+    ASSERT_EQ(bind(sock, (struct sockaddr *)&sa, sizeof(sa)), 0);
+
+    /* Groups are left and joined on the open socket */
+    ASSERT_EQ(nl_subscribe_sock_apply(sock, nas_nl_sock_T_ROUTE, GROUP(RTNLGRP_IPV4_ROUTE)), STD_ERR_OK);
+    ASSERT_EQ(sock_groups(sock), GROUP(RTNLGRP_IPV4_ROUTE));
+    ASSERT_EQ(nl_subscribe_sock_apply(sock, nas_nl_sock_T_ROUTE,
+                                      GROUP(RTNLGRP_IPV4_ROUTE) | GROUP(RTNLGRP_IPV6_ROUTE)), STD_ERR_OK);
+    ASSERT_EQ(sock_groups(sock), GROUP(RTNLGRP_IPV4_ROUTE) | GROUP(RTNLGRP_IPV6_ROUTE));
+
+    /* Only the groups of the socket type are changed */
+    ASSERT_EQ(nl_subscribe_sock_apply(sock, nas_nl_sock_T_NETCONF, GROUP(RTNLGRP_IPV6_NETCONF)), STD_ERR_OK);
+    ASSERT_EQ(sock_groups(sock), GROUP(RTNLGRP_IPV4_ROUTE) | GROUP(RTNLGRP_IPV6_ROUTE) |
+                                 GROUP(RTNLGRP_IPV6_NETCONF));
+    close(sock);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  nas_os_nl_config_t cfg;
+  nas_os_nl_config_default(&cfg);
+  strcpy(cfg.subscribe_off, "netconf:ipv6,mdb:ipv6");
+  nas_os_nl_config_set(&cfg);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "netlink_uring.h"
+#include "nas_os_nl_config.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <map>
+#include <vector>
+#include <gtest/gtest.h>
+
+#define URING_TEST_WAIT_MS 100
+#define URING_TEST_MAX_WAITS 50
+
+/* Event sockets are user netlink sockets, the datagrams are sent by the test */
+static int create_sock(uint32_t *pid) {
+    int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_USERSOCK);
+    if (sock == -1) return -1;
+    struct sockaddr_nl sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    socklen_t len = sizeof(sa);
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf));
+    if ((bind(sock, (struct sockaddr *)&sa, sizeof(sa)) != 0) ||
+        (getsockname(sock, (struct sockaddr *)&sa, &len) != 0)) {
+        close(sock);
+        return -1;
+    }
+    *pid = sa.nl_pid;
+    return sock;
+}
+
+static int _sender = -1;
+
+static void send_msg(uint32_t pid, uint32_t seq) {
+    struct nlmsghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.nlmsg_len = sizeof(hdr);
+    hdr.nlmsg_type = NLMSG_MIN_TYPE;
+    hdr.nlmsg_seq = seq;
+    struct sockaddr_nl sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_pid = pid;
+    ASSERT_EQ(sendto(_sender, &hdr, sizeof(hdr), 0, (struct sockaddr *)&sa, sizeof(sa)),
+              (ssize_t)sizeof(hdr));
+}
+
+/* Sequence numbers of the datagrams received by context, and the stopped receives */
+typedef struct {
+    std::map<size_t, std::vector<uint32_t>> seqs;
+    size_t errors = 0;
+} received_t;
+
+/* Wait for the expected datagrams, or for max_waits when no more are expected */
+static void receive(received_t &rcv, size_t expected, int max_waits = URING_TEST_MAX_WAITS) {
+    static nl_uring_event_t events[NL_URING_MAX_EVENTS];
+    size_t total = 0;
+    for (int wait = 0; (wait < max_waits) && (total < expected); ++wait) {
+        size_t count = nl_uring_event_wait(events, NL_URING_MAX_EVENTS, URING_TEST_WAIT_MS);
+        for (size_t ix = 0; ix < count; ++ix) {
+            if (events[ix].buff == nullptr) {
+                ++rcv.errors;
+                continue;
+            }
+            ASSERT_EQ(events[ix].res, (int)sizeof(struct nlmsghdr));
+            rcv.seqs[(size_t)events[ix].context].push_back(((struct nlmsghdr *)events[ix].buff)->nlmsg_seq);
+            ++total;
+        }
+        nl_uring_event_done(events, count);
+    }
+}
+
+class nas_nl_uring_test : public ::testing::Test {
+protected:
+    static void SetUpTestCase() {
+        nas_os_nl_config_t cfg;
+        nas_os_nl_config_default(&cfg);
+        cfg.io_uring = true;
+        nas_os_nl_config_set(&cfg);
+        _sender = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_USERSOCK);
+    }
+    void SetUp() override {
+        if (!nl_uring_event_init()) {
+            GTEST_SKIP() << "io_uring event ring not supported";
+        }
+    }
+};
+
+TEST_F(nas_nl_uring_test, receive) {
+    uint32_t pid1, pid2;
+    int sock1 = create_sock(&pid1);
+    int sock2 = create_sock(&pid2);
+    ASSERT_NE(sock1, -1);
+    ASSERT_NE(sock2, -1);
+    ASSERT_TRUE(nl_uring_event_add(sock1, (void *)1));
+    ASSERT_TRUE(nl_uring_event_add(sock2, (void *)2));
+
+    /* Datagrams queued before the receives are submitted are received too */
+    send_msg(pid1, 1);
+    send_msg(pid2, 10);
+    send_msg(pid1, 2);
+    received_t rcv;
+    receive(rcv, 3);
+    send_msg(pid2, 11);
+    send_msg(pid1, 3);
+    receive(rcv, 2);
+
+    std::vector<uint32_t> expected1 = { 1, 2, 3 };
+    std::vector<uint32_t> expected2 = { 10, 11 };
+    ASSERT_EQ(rcv.seqs[1], expected1);
+    ASSERT_EQ(rcv.seqs[2], expected2);
+    ASSERT_EQ(rcv.errors, 0u);
+
+    /* Datagrams of a removed socket are dropped */
+    nl_uring_event_del(sock1);
+    send_msg(pid1, 4);
+    send_msg(pid2, 12);
+    received_t rcv_del;
+    receive(rcv_del, 2, 3);
+    ASSERT_EQ(rcv_del.seqs.count(1), 0u);
+    ASSERT_EQ(rcv_del.seqs[2], std::vector<uint32_t>{ 12 });
+
+    nl_uring_event_del(sock2);
+    receive(rcv_del, 1, 1);
+    close(sock1);
+    close(sock2);
+}
+
+/* More datagrams than buffers - the receive stops when the buffers are used and goes on
+ * once they are given back, nothing is lost or reported as an error */
+TEST_F(nas_nl_uring_test, buffers_used) {
+    const uint32_t count = NL_URING_EVENT_BUFFS * 3;
+    uint32_t pid;
+    int sock = create_sock(&pid);
+    ASSERT_NE(sock, -1);
+    ASSERT_TRUE(nl_uring_event_add(sock, (void *)3));
+    for (uint32_t seq = 0; seq < count; ++seq) send_msg(pid, seq);
+
+    received_t rcv;
+    receive(rcv, count);
+    std::vector<uint32_t> expected;
+    for (uint32_t seq = 0; seq < count; ++seq) expected.push_back(seq);
+    ASSERT_EQ(rcv.seqs[3], expected);
+    ASSERT_EQ(rcv.errors, 0u);
+
+    nl_uring_event_del(sock);
+    receive(rcv, 1, 1);
+    close(sock);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "nas_nlattr_parser.h"
+#include "nas_nlmsg_builder.h"
+#include "nas_nlmsg.h"
+
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <gtest/gtest.h>
+
+typedef nas_nl::msg_size<ifinfomsg, nas_nl::attr_len<IFNAMSIZ>, nas_nl::attr<uint32_t>,
+                         nas_nl::attr<uint16_t>,
+                         nas_nl::nest<nas_nl::attr_len<IFNAMSIZ>, nas_nl::nest<>>> link_msg_size;
+
+typedef nas_nl::attr_parser<__IFLA_MAX,
+                            nas_nl::sel<IFLA_IFNAME, 1>,
+                            nas_nl::sel<IFLA_MTU, sizeof(uint32_t)>,
+                            nas_nl::sel<IFLA_LINKINFO>> link_parser;
+
+typedef nas_nl::attr_parser<IFLA_INFO_MAX,
+                            nas_nl::sel<IFLA_INFO_KIND, 1>,
+                            nas_nl::sel<IFLA_INFO_DATA>> linkinfo_parser;
+
+/* RTM_NEWLINK with a name, MTU, a short master and a vlan linkinfo */
+static void build_link_msg(nas_nl::msg_builder &b) {
+    b.family_header<ifinfomsg>();
+    b.put_str(IFLA_IFNAME, "br100");
+    b.put(IFLA_MTU, (uint32_t)9000);
+    b.put(IFLA_MASTER, (uint16_t)1);
+    struct nlattr *info = b.nest_start(IFLA_LINKINFO);
+    b.put_str(IFLA_INFO_KIND, "vlan");
+    b.nest_end(b.nest_start(IFLA_INFO_DATA));
+    b.nest_end(info);
+}
+
+TEST(nas_nlattr_parser_test, selected_only) {
+    nas_nl::msg_buffer<link_msg_size::value> buff;
+    nas_nl::msg_builder b(buff, RTM_NEWLINK, 0);
+    build_link_msg(b);
+    ASSERT_TRUE(b.ok());
+
+    struct nlattr *attrs[__IFLA_MAX];
+    struct nlattr sentinel;
+    for (auto &attr : attrs) attr = &sentinel;
+
+    ASSERT_EQ(link_parser::parse_msg(attrs, b.msg(), sizeof(ifinfomsg)), 0);
+    ASSERT_NE(attrs[IFLA_IFNAME], nullptr);
+    ASSERT_STREQ((const char *)nla_data(attrs[IFLA_IFNAME]), "br100");
+    ASSERT_EQ(*(uint32_t *)nla_data(attrs[IFLA_MTU]), 9000u);
+    ASSERT_NE(attrs[IFLA_LINKINFO], nullptr);
+
+    /* Slots that were not selected are neither cleared nor filled */
+    ASSERT_EQ(attrs[IFLA_MASTER], &sentinel);
+    ASSERT_EQ(attrs[IFLA_ADDRESS], &sentinel);
+
+    struct nlattr *linkinfo[IFLA_INFO_MAX];
+    ASSERT_EQ(linkinfo_parser::parse_nested(linkinfo, attrs[IFLA_LINKINFO]), 0);
+    ASSERT_STREQ((const char *)nla_data(linkinfo[IFLA_INFO_KIND]), "vlan");
+    ASSERT_NE(linkinfo[IFLA_INFO_DATA], nullptr);
+}
+
+TEST(nas_nlattr_parser_test, missing_and_short) {
+    nas_nl::msg_buffer<link_msg_size::value> buff;
+    nas_nl::msg_builder b(buff, RTM_NEWLINK, 0);
+    build_link_msg(b);
+    ASSERT_TRUE(b.ok());
+
+    typedef nas_nl::attr_parser<__IFLA_MAX,
+                                nas_nl::sel<IFLA_MASTER, sizeof(uint32_t)>,
+                                nas_nl::sel<IFLA_ADDRESS, 6>> master_parser;
+    struct nlattr *attrs[__IFLA_MAX];
+    struct nlattr sentinel;
+    for (auto &attr : attrs) attr = &sentinel;
+
+    /* IFLA_MASTER is shorter than a u32, dropped - IFLA_ADDRESS is not in the message */
+    ASSERT_NE(master_parser::parse_msg(attrs, b.msg(), sizeof(ifinfomsg)), 0);
+    ASSERT_EQ(attrs[IFLA_MASTER], nullptr);
+    ASSERT_EQ(attrs[IFLA_ADDRESS], nullptr);
+    ASSERT_EQ(attrs[IFLA_IFNAME], &sentinel);
+}
+
+TEST(nas_nlattr_parser_test, c_table) {
+    nas_nl::msg_buffer<link_msg_size::value> buff;
+    nas_nl::msg_builder b(buff, RTM_NEWLINK, 0);
+    build_link_msg(b);
+    ASSERT_TRUE(b.ok());
+
+    static const nla_select_t sel[] = {
+        { IFLA_IFNAME, 1 },
+        { IFLA_MTU, sizeof(uint32_t) },
+    };
+    struct nlattr *attrs[__IFLA_MAX];
+    struct nlattr *ref[__IFLA_MAX];
+    ASSERT_EQ(nla_parse_selected(attrs, __IFLA_MAX, sel, sizeof(sel)/sizeof(*sel),
+                                 nlmsg_attrdata(b.msg(), sizeof(ifinfomsg)),
+                                 nlmsg_attrlen(b.msg(), sizeof(ifinfomsg))), 0);
+    ASSERT_EQ(nla_parse(ref, __IFLA_MAX, nlmsg_attrdata(b.msg(), sizeof(ifinfomsg)),
+                        nlmsg_attrlen(b.msg(), sizeof(ifinfomsg))), 0);
+    ASSERT_EQ(attrs[IFLA_IFNAME], ref[IFLA_IFNAME]);
+    ASSERT_EQ(attrs[IFLA_MTU], ref[IFLA_MTU]);
+
+    /* Selected attribute out of the table is rejected */
+    static const nla_select_t bad_sel[] = { { __IFLA_MAX, 0 } };
+    ASSERT_NE(nla_parse_selected(attrs, __IFLA_MAX, bad_sel, 1,
+                                 nlmsg_attrdata(b.msg(), sizeof(ifinfomsg)),
+                                 nlmsg_attrlen(b.msg(), sizeof(ifinfomsg))), 0);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
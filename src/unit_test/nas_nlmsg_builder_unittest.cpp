@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2019 Dell Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License. You may obtain
+ * a copy of the License at http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * THIS CODE IS PROVIDED ON AN *AS IS* BASIS, WITHOUT WARRANTIES OR
+ * CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT
+ * LIMITATION ANY IMPLIED WARRANTIES OR CONDITIONS OF TITLE, FITNESS
+ * FOR A PARTICULAR PURPOSE, MERCHANTABLITY OR NON-INFRINGEMENT.
+ *
+ * See the Apache Version 2.0 License for specific language governing
+ * permissions and limitations under the License.
+ */
+
+#include "nas_nlmsg_builder.h"
+
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <gtest/gtest.h>
+
+#define BUILDER_TEST_GUARD 0xa5
+
+/* Tagged interface create - name, link and IFLA_LINKINFO(kind, IFLA_INFO_DATA(vlan id)) */
+typedef nas_nl::msg_size<struct ifinfomsg,
+                         nas_nl::attr_len<IFNAMSIZ>,
+                         nas_nl::attr<int>,
+                         nas_nl::nest<nas_nl::attr_len<sizeof("vlan")>,
+                                      nas_nl::nest<nas_nl::attr<int>>>> vlan_msg_size;
+
+/* Route with 4 next hops of a gateway and an interface each */
+#define BUILDER_TEST_NH 4
+typedef nas_nl::msg_size<struct rtmsg,
+                         nas_nl::attr<struct in6_addr>,
+                         nas_nl::multipath<BUILDER_TEST_NH, nas_nl::attr<struct in6_addr>,
+                                           nas_nl::attr<uint32_t>>> route_msg_size;
+
+static void build_vlan_msg(nas_nl::msg_builder &b, const char *name) {
+    b.family_header<struct ifinfomsg>();
+    b.put_str(IFLA_IFNAME, name);
+    b.put(IFLA_LINK, (int)5);
+    struct nlattr *info = b.nest_start(IFLA_LINKINFO);
+    b.put_str(IFLA_INFO_KIND, "vlan");
+    struct nlattr *data = b.nest_start(IFLA_INFO_DATA);
+    b.put(IFLA_VLAN_ID, (int)100);
+    b.nest_end(data);
+    b.nest_end(info);
+}
+
+static bool guard_intact(const unsigned char *p, size_t len) {
+    for (size_t ix = 0; ix < len; ++ix) {
+        if (p[ix] != BUILDER_TEST_GUARD) return false;
+    }
+    return true;
+}
+
+/* The computed size is the exact length of the largest message it describes */
+TEST(nas_nlmsg_builder_test, msg_size) {
+    static_assert(vlan_msg_size::value ==
+                  NLMSG_SPACE(sizeof(struct ifinfomsg)) + NLA_ALIGN(NLA_HDRLEN + IFNAMSIZ) +
+                  NLA_ALIGN(NLA_HDRLEN + sizeof(int)) +
+                  NLA_HDRLEN + NLA_ALIGN(NLA_HDRLEN + sizeof("vlan")) +
+                  NLA_HDRLEN + NLA_ALIGN(NLA_HDRLEN + sizeof(int)),
+                  "vlan request size");
+
+    char name[IFNAMSIZ];
+    memset(name, 'e', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+
+    nas_nl::msg_buffer<vlan_msg_size::value> buff;
+    nas_nl::msg_builder b(buff, RTM_NEWLINK, NLM_F_REQUEST);
+    build_vlan_msg(b, name);
+    ASSERT_TRUE(b.ok());
+    ASSERT_EQ(b.len(), (size_t)vlan_msg_size::value);
+    ASSERT_EQ(b.msg()->nlmsg_len, (size_t)vlan_msg_size::value);
+
+    nas_nl::msg_buffer<route_msg_size::value> rbuff;
+    nas_nl::msg_builder r(rbuff, RTM_NEWROUTE, NLM_F_REQUEST);
+    r.family_header<struct rtmsg>();
+    struct in6_addr addr;
+    memset(&addr, 0, sizeof(addr));
+    r.put(RTA_DST, addr);
+    struct nlattr *mp = r.nest_start(RTA_MULTIPATH);
+    for (size_t ix = 0; ix < BUILDER_TEST_NH; ++ix) {
+        struct rtnexthop *rtnh = r.nexthop_start();
+        r.put(RTA_GATEWAY, addr);
+        r.put(RTA_OIF, (uint32_t)ix);
+        r.nexthop_end(rtnh);
+        ASSERT_EQ(rtnh->rtnh_len, RTNH_ALIGN(sizeof(struct rtnexthop)) +
+                  nas_nl::attr_space(sizeof(addr)) + nas_nl::attr_space(sizeof(uint32_t)));
+    }
+    r.nest_end(mp);
+    ASSERT_TRUE(r.ok());
+    ASSERT_EQ(r.len(), (size_t)route_msg_size::value);
+    ASSERT_EQ(mp->nla_len, route_msg_size::value - NLMSG_SPACE(sizeof(struct rtmsg)) -
+              nas_nl::attr_space(sizeof(addr)));
+}
+
+/* An attribute that does not fit fails the builder, nothing is written past its capacity
+ * and the later writes are ignored */
+TEST(nas_nlmsg_builder_test, overflow) {
+    const size_t capacity = vlan_msg_size::value - NLA_HDRLEN;
+    alignas(struct nlmsghdr) unsigned char raw[vlan_msg_size::value + 64];
+    memset(raw, BUILDER_TEST_GUARD, sizeof(raw));
+
+    nas_nl::msg_builder b(raw, capacity, RTM_NEWLINK, NLM_F_REQUEST);
+    ASSERT_EQ(b.capacity(), capacity);
+    build_vlan_msg(b, "br1");
+    ASSERT_TRUE(b.ok());
+    size_t used = b.msg()->nlmsg_len;
+
+    char name[IFNAMSIZ];
+    memset(name, 'e', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    ASSERT_FALSE(b.put_str(IFLA_IFALIAS, name));
+    ASSERT_FALSE(b.ok());
+    ASSERT_EQ(b.len(), 0u);
+    ASSERT_EQ(b.msg()->nlmsg_len, used);
+    ASSERT_TRUE(guard_intact(raw + used, sizeof(raw) - used));
+
+    /* Small writes that would still fit are not done once the builder has failed */
+    ASSERT_FALSE(b.put(IFLA_MTU, (uint32_t)1500));
+    ASSERT_EQ(b.nest_start(IFLA_LINKINFO), nullptr);
+    ASSERT_EQ(b.reserve(sizeof(uint32_t)), nullptr);
+    ASSERT_EQ(b.msg()->nlmsg_len, used);
+    ASSERT_TRUE(guard_intact(raw + used, sizeof(raw) - used));
+
+    /* The full message does not fit one attribute header short of its size */
+    memset(raw, BUILDER_TEST_GUARD, sizeof(raw));
+    char long_name[IFNAMSIZ];
+    memcpy(long_name, name, sizeof(long_name));
+    nas_nl::msg_builder full(raw, capacity, RTM_NEWLINK, NLM_F_REQUEST);
+    build_vlan_msg(full, long_name);
+    ASSERT_FALSE(full.ok());
+    ASSERT_LE(full.msg()->nlmsg_len, capacity);
+    ASSERT_TRUE(guard_intact(raw + capacity, sizeof(raw) - capacity));
+
+    /* A buffer smaller than the netlink header is never written */
+    memset(raw, BUILDER_TEST_GUARD, sizeof(raw));
+    nas_nl::msg_builder tiny(raw, NLMSG_HDRLEN - 1, RTM_NEWLINK, NLM_F_REQUEST);
+    ASSERT_FALSE(tiny.ok());
+    ASSERT_EQ(tiny.family_header<struct ifinfomsg>(), nullptr);
+    ASSERT_TRUE(guard_intact(raw, sizeof(raw)));
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}